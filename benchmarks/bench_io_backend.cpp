@@ -0,0 +1,163 @@
+/**
+ * UDP 收发 I/O 后端基准（loopback）
+ *
+ * 发送端按"帧"发包（每帧 kPacketsPerFrame 个 RTP 大小的报文），接收端持续取包，比较：
+ *   - per-packet：逐包 sendto；接收 poll + recvfrom（批量接口之前的路径）
+ *   - poll      ：sendBatchTo(sendmmsg) / recvBatch(poll + recvmmsg)
+ *   - io_uring  ：sendBatchTo(一次提交) / recvBatch(多发 recv + 提供缓冲环)
+ * 输出接收吞吐、两端每秒系统调用数，以及每 Gbps 占用的 CPU（线程 CPU 时间 / 墙钟 / Gbps）。
+ *
+ * 用法：bench_io_backend [frames]
+ */
+
+#include <rtsp-common/common.h>
+#include <rtsp-common/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace rtsp;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const uint16_t kPort = 19901;
+const size_t kPacketsPerFrame = 32;
+const size_t kPacketSize = 1200;
+
+enum class Mode { PerPacket, Batch };
+
+struct Side {
+    uint64_t syscalls = 0;
+    double cpu_seconds = 0.0;
+};
+
+struct Result {
+    double seconds = 0.0;
+    uint64_t packets_sent = 0;
+    uint64_t packets_received = 0;
+    uint64_t bytes_received = 0;
+    Side sender;
+    Side receiver;
+};
+
+double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+Result run(Mode mode, int frames) {
+    Socket receiver;
+    Socket sender;
+    if (!receiver.bindUdp("127.0.0.1", kPort) || !sender.bindUdp("127.0.0.1", 0)) {
+        std::fprintf(stderr, "bind failed\n");
+        std::exit(1);
+    }
+    receiver.setRecvBufferSize(8 * 1024 * 1024);
+    receiver.setNonBlocking(true);
+    sender.setSendBufferSize(8 * 1024 * 1024);
+
+    Result result;
+    std::atomic<bool> sending{true};
+    std::thread receive_thread([&]() {
+        const uint64_t syscalls = threadIoSyscalls();
+        const double cpu = threadCpuSeconds();
+        uint8_t buffer[65536];
+        std::string from_ip;
+        uint16_t from_port = 0;
+        auto on_datagram = [&](const uint8_t*, size_t size) {
+            result.packets_received++;
+            result.bytes_received += size;
+        };
+        // 发送结束后再排空 100ms 内到达的包
+        auto drained_at = Clock::time_point::max();
+        while (Clock::now() < drained_at) {
+            if (!sending && drained_at == Clock::time_point::max()) {
+                drained_at = Clock::now() + std::chrono::milliseconds(100);
+            }
+            if (mode == Mode::PerPacket) {
+                if (receiver.waitReadable(20) > 0) {
+                    const ssize_t len = receiver.recvFrom(buffer, sizeof(buffer), from_ip, from_port);
+                    if (len > 0) {
+                        on_datagram(buffer, static_cast<size_t>(len));
+                    }
+                }
+            } else {
+                receiver.recvBatch(on_datagram, 20);
+            }
+        }
+        result.receiver.syscalls = threadIoSyscalls() - syscalls;
+        result.receiver.cpu_seconds = threadCpuSeconds() - cpu;
+    });
+
+    std::vector<uint8_t> payload(kPacketSize * kPacketsPerFrame, 0x5A);
+    std::vector<UdpDatagram> datagrams;
+    for (size_t i = 0; i < kPacketsPerFrame; ++i) {
+        datagrams.push_back({payload.data() + i * kPacketSize, kPacketSize});
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const uint64_t syscalls = threadIoSyscalls();
+    const double cpu = threadCpuSeconds();
+    const auto begin = Clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        if (mode == Mode::PerPacket) {
+            for (const auto& datagram : datagrams) {
+                if (sender.sendTo(datagram.data, datagram.size, "127.0.0.1", kPort) > 0) {
+                    result.packets_sent++;
+                }
+            }
+        } else {
+            result.packets_sent += sender.sendBatchTo(datagrams.data(), datagrams.size(), "127.0.0.1", kPort);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    result.sender.syscalls = threadIoSyscalls() - syscalls;
+    result.sender.cpu_seconds = threadCpuSeconds() - cpu;
+    sending = false;
+    receive_thread.join();
+    return result;
+}
+
+void report(const char* name, const Result& r) {
+    const double gbps = r.bytes_received * 8 / r.seconds / 1e9;
+    auto cpuPerGbps = [&](const Side& side) {
+        return gbps > 0 ? side.cpu_seconds / r.seconds / gbps * 100.0 : 0.0;
+    };
+    std::printf("%-11s %8.3f %9.1f%% %13.0f %13.0f %12.1f%% %12.1f%%\n", name, gbps,
+                r.packets_sent ? 100.0 * r.packets_received / r.packets_sent : 0.0,
+                r.sender.syscalls / r.seconds, r.receiver.syscalls / r.seconds,
+                cpuPerGbps(r.sender), cpuPerGbps(r.receiver));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 20000;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    std::printf("%d frames x %zu packets x %zu bytes over loopback\n", frames, kPacketsPerFrame, kPacketSize);
+    std::printf("%-11s %8s %10s %13s %13s %13s %13s\n", "backend", "Gbps", "delivered", "tx sys/s",
+                "rx sys/s", "tx CPU/Gbps", "rx CPU/Gbps");
+
+    setIoBackend(IoBackend::Poll);
+    report("per-packet", run(Mode::PerPacket, frames));
+    report("poll", run(Mode::Batch, frames));
+    if (setIoBackend(IoBackend::IoUring)) {
+        report("io_uring", run(Mode::Batch, frames));
+    } else {
+        std::printf("%-11s unavailable on this kernel\n", "io_uring");
+    }
+    return 0;
+}
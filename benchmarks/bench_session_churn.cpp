@@ -0,0 +1,190 @@
+/**
+ * 会话建立/拆除吞吐基准（loopback）
+ *
+ * 服务端一个直播路径持续推流（25fps），若干客户端线程循环执行
+ * SETUP(UDP) → PLAY → TEARDOWN，统计稳态下每秒完成的会话数：
+ *   - reconnect ：每个会话新建一条 TCP 连接（重连风暴）
+ *   - keep-alive：同一条连接上反复建立/拆除会话（只看会话本身的开销）
+ * 客户端直接收发 RTSP 文本，不启动 RtspClient 的接收线程，避免客户端开销掩盖服务端。
+ *
+ * 用法：bench_session_churn [seconds] [client_threads]
+ */
+
+#include <rtsp-common/common.h>
+#include <rtsp-common/socket.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace rtsp;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const uint16_t kPort = 19902;
+const char* kPath = "/live/churn";
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    if (index % 25 == 0) {
+        out = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8,
+               0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+               0x00, 0x00, 0x00, 0x01, 0x65, 0x88};
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A};
+    }
+    out.resize(out.size() + 4000, 0x42);
+    return out;
+}
+
+// 发一个请求并等到响应；返回状态码（失败返回 0），session 非空时取出 Session 头
+int request(Socket& socket, const std::string& text, std::string* session) {
+    if (socket.sendAll(reinterpret_cast<const uint8_t*>(text.data()), text.size(), 2000) !=
+        static_cast<ssize_t>(text.size())) {
+        return 0;
+    }
+    std::string response;
+    if (!recvRtspMessage(socket, &response, 2000) || response.compare(0, 9, "RTSP/1.0 ") != 0) {
+        return 0;
+    }
+    if (session) {
+        static const std::regex session_re("Session:\\s*([^;\\r\\n]+)", std::regex::icase);
+        std::smatch m;
+        if (std::regex_search(response, m, session_re)) {
+            *session = m[1].str();
+        }
+    }
+    return std::atoi(response.c_str() + 9);
+}
+
+// 一个完整会话：SETUP → PLAY → TEARDOWN
+bool churnOnce(Socket& socket, int& cseq, uint16_t client_port) {
+    const std::string url = "rtsp://127.0.0.1:" + std::to_string(kPort) + kPath;
+    std::string session;
+    if (request(socket, "SETUP " + url + "/track0 RTSP/1.0\r\nCSeq: " + std::to_string(++cseq) +
+                            "\r\nTransport: RTP/AVP;unicast;client_port=" + std::to_string(client_port) + "-" +
+                            std::to_string(client_port + 1) + "\r\n\r\n",
+                &session) != 200 ||
+        session.empty()) {
+        return false;
+    }
+    if (request(socket, "PLAY " + url + " RTSP/1.0\r\nCSeq: " + std::to_string(++cseq) +
+                            "\r\nSession: " + session + "\r\n\r\n",
+                nullptr) != 200) {
+        return false;
+    }
+    return request(socket, "TEARDOWN " + url + " RTSP/1.0\r\nCSeq: " + std::to_string(++cseq) +
+                               "\r\nSession: " + session + "\r\n\r\n",
+                   nullptr) == 200;
+}
+
+struct Result {
+    uint64_t sessions = 0;
+    uint64_t failures = 0;
+    double seconds = 0.0;
+};
+
+Result run(bool reconnect, int seconds, int threads) {
+    Result result;
+    std::atomic<uint64_t> sessions{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<bool> measuring{false};
+    std::atomic<bool> running{true};
+
+    std::vector<std::thread> clients;
+    for (int t = 0; t < threads; ++t) {
+        clients.emplace_back([&, t]() {
+            // 客户端 RTP 端口不需要真的接收，丢到一个空闲端口即可
+            const uint16_t client_port = static_cast<uint16_t>(40000 + t * 2);
+            std::unique_ptr<Socket> socket;
+            int cseq = 0;
+            while (running) {
+                if (!socket) {
+                    socket.reset(new Socket());
+                    if (!socket->connect("127.0.0.1", kPort, 2000)) {
+                        failures++;
+                        socket.reset();
+                        continue;
+                    }
+                }
+                const bool ok = churnOnce(*socket, cseq, client_port);
+                if (measuring) {
+                    (ok ? sessions : failures)++;
+                }
+                if (!ok || reconnect) {
+                    socket.reset();
+                }
+            }
+        });
+    }
+
+    // 预热 1 秒后再计数
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    const auto begin = Clock::now();
+    measuring = true;
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    measuring = false;
+    result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    running = false;
+    for (auto& client : clients) {
+        client.join();
+    }
+    result.sessions = sessions;
+    result.failures = failures;
+    return result;
+}
+
+void report(const char* name, const Result& r) {
+    std::printf("%-11s %12.0f %10llu %10llu\n", name, r.sessions / r.seconds,
+                static_cast<unsigned long long>(r.sessions), static_cast<unsigned long long>(r.failures));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = argc > 1 ? std::atoi(argv[1]) : 5;
+    const int threads = argc > 2 ? std::atoi(argv[2]) : 8;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    if (!server.init("127.0.0.1", kPort)) {
+        return 1;
+    }
+    PathConfig path;
+    path.path = kPath;
+    server.addPath(path);
+    if (!server.start()) {
+        std::fprintf(stderr, "server start failed\n");
+        return 1;
+    }
+    std::atomic<bool> pushing{true};
+    std::thread pusher([&]() {
+        for (int i = 0; pushing; ++i) {
+            const auto frame = makeFrame(i);
+            server.pushH264Data(kPath, frame.data(), frame.size(), static_cast<uint64_t>(i) * 40, i % 25 == 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        }
+    });
+
+    std::printf("%d client threads, %d s per mode\n", threads, seconds);
+    std::printf("%-11s %12s %10s %10s\n", "mode", "sessions/s", "sessions", "failures");
+    report("reconnect", run(true, seconds, threads));
+    report("keep-alive", run(false, seconds, threads));
+
+    pushing = false;
+    pusher.join();
+    server.stop();
+    return 0;
+}
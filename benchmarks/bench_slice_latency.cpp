@@ -0,0 +1,184 @@
+/**
+ * slice 级提前交付的延迟基准
+ *
+ * 模拟按 slice 输出的编码器：每帧 N 个 slice 在帧间隔内均匀产出，server 端用
+ * pushNalu() 到达即发；client 同时挂 NALU 回调与帧回调，统计以"首个 slice 推送"
+ * 为起点的：
+ *   - first_nalu：解码器可开始解码的时刻（NALU 回调首个 slice）
+ *   - frame     ：整帧回调时刻（传统帧级交付）
+ * saving = frame - first_nalu，即按 slice 交付为每帧省下的等待时间。
+ *
+ * 用法：bench_slice_latency [frames_per_resolution]
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace rtsp;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const uint16_t kPort = 19900;
+const uint32_t kFps = 30;
+
+struct Resolution {
+    const char* name;
+    uint32_t width;
+    uint32_t height;
+    size_t frame_bytes;   // 典型 P 帧大小
+    size_t slices;        // 每帧 slice 数
+};
+
+struct Timing {
+    Clock::time_point pushed;
+    Clock::time_point first_nalu;
+    Clock::time_point frame;
+    bool has_nalu = false;
+    bool has_frame = false;
+};
+
+std::vector<uint8_t> makeSlice(uint8_t nal_header, size_t bytes) {
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01, nal_header};
+    out.reserve(bytes + 5);
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(0x20 + (i % 0x40)));
+    }
+    return out;
+}
+
+double toMs(Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void runResolution(RtspServer& server, const Resolution& res, int frames) {
+    const std::string path = std::string("/bench/") + res.name;
+    PathConfig cfg;
+    cfg.path = path;
+    cfg.codec = CodecType::H264;
+    cfg.width = res.width;
+    cfg.height = res.height;
+    cfg.fps = kFps;
+    cfg.sps = {0x67, 0x42, 0x00, 0x28};
+    cfg.pps = {0x68, 0xCE, 0x3C, 0x80};
+    server.addPath(cfg);
+
+    std::mutex mu;
+    std::map<uint64_t, Timing> timings;
+
+    RtspClient client;
+    RtspClientConfig client_cfg;
+    client_cfg.prefer_tcp_transport = true;
+    client.setConfig(client_cfg);
+    client.setNaluCallback([&](const ReceivedNalu& nalu) {
+        if (!nalu.access_unit_start) return;
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mu);
+        auto it = timings.find(nalu.pts);
+        if (it != timings.end() && !it->second.has_nalu) {
+            it->second.first_nalu = now;
+            it->second.has_nalu = true;
+        }
+    });
+    client.setFrameCallback([&](const VideoFrame& frame) {
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mu);
+        auto it = timings.find(frame.pts);
+        if (it != timings.end() && !it->second.has_frame) {
+            it->second.frame = now;
+            it->second.has_frame = true;
+        }
+    });
+    if (!client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + path) ||
+        !client.describe() || !client.setup(0) || !client.play(0)) {
+        std::cerr << "client open failed for " << path << std::endl;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const size_t slice_bytes = res.frame_bytes / res.slices;
+    const auto idr_slice = makeSlice(0x65, slice_bytes);
+    const auto p_slice = makeSlice(0x41, slice_bytes);
+    const auto frame_interval = std::chrono::microseconds(1000000 / kFps);
+    const auto slice_interval = frame_interval / static_cast<int>(res.slices);
+
+    auto next = Clock::now();
+    for (int f = 0; f < frames; ++f) {
+        const uint64_t pts = static_cast<uint64_t>(f + 1) * 1000 / kFps;
+        const auto& slice = (f == 0) ? idr_slice : p_slice;
+        for (size_t s = 0; s < res.slices; ++s) {
+            std::this_thread::sleep_until(next);
+            if (s == 0) {
+                std::lock_guard<std::mutex> lock(mu);
+                timings[pts].pushed = Clock::now();
+            }
+            server.pushNalu(path, slice.data(), slice.size(), pts, s + 1 == res.slices);
+            next += slice_interval;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    client.close();
+    server.removePath(path);
+
+    double nalu_sum = 0.0;
+    double frame_sum = 0.0;
+    int samples = 0;
+    std::lock_guard<std::mutex> lock(mu);
+    for (const auto& kv : timings) {
+        const Timing& t = kv.second;
+        if (!t.has_nalu || !t.has_frame) continue;
+        nalu_sum += toMs(t.first_nalu - t.pushed);
+        frame_sum += toMs(t.frame - t.pushed);
+        samples++;
+    }
+    if (samples == 0) {
+        std::printf("%-6s  no samples\n", res.name);
+        return;
+    }
+    const double nalu_ms = nalu_sum / samples;
+    const double frame_ms = frame_sum / samples;
+    std::printf("%-6s %5ux%-5u %3zu slices %7zu B  first_nalu %7.2f ms  frame %7.2f ms  saving %7.2f ms  (%d frames)\n",
+                res.name, res.width, res.height, res.slices, res.frame_bytes,
+                nalu_ms, frame_ms, frame_ms - nalu_ms, samples);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 90;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Warning;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    if (!server.init("127.0.0.1", kPort) || !server.start()) {
+        std::cerr << "server start failed" << std::endl;
+        return 1;
+    }
+
+    const Resolution resolutions[] = {
+        {"360p", 640, 360, 8 * 1024, 2},
+        {"720p", 1280, 720, 24 * 1024, 4},
+        {"1080p", 1920, 1080, 48 * 1024, 8},
+        {"2160p", 3840, 2160, 160 * 1024, 16},
+    };
+    std::printf("slice-level delivery latency @%u fps, slices paced over the frame interval\n", kFps);
+    for (const auto& res : resolutions) {
+        runResolution(server, res, frames);
+    }
+
+    server.stop();
+    return 0;
+}
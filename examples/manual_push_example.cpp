@@ -22,6 +22,7 @@ void signalHandler(int) {
 // 生成测试H.264帧
 std::vector<uint8_t> generateTestFrame(uint32_t frame_index, bool is_key) {
     std::vector<uint8_t> data;
+    data.reserve(24);
     
     if (is_key) {
         // IDR帧：包含SPS、PPS、IDR slice
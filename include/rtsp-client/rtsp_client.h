@@ -18,6 +18,7 @@
 #include <thread>
 #include <atomic>
 #include <queue>
+#include <deque>
 
 namespace rtsp {
 
@@ -50,6 +51,56 @@ struct RtspClientConfig {
      * @brief 接收超时时间（毫秒）
      */
     uint32_t receive_timeout_ms = 5000;
+
+    /**
+     * @brief DESCRIBE 最多跟随的重定向次数
+     *
+     * 301/302/303/307 按 Location 改连新地址；305 Use Proxy 连到 Location 指向的代理，
+     * 请求 URL 保持不变。超过次数视为失败（防止节点间互相重定向成环）。
+     */
+    uint32_t max_redirects = 3;
+
+    /**
+     * @brief 帧输出格式
+     *
+     * AnnexB（默认）：起始码分隔；Avcc：4 字节大端长度前缀，可直接送 MP4 封装或硬件解码器；
+     * NaluSpans：数据同 AnnexB，另在 VideoFrame::nalus 给出各 NALU 位置，调用方按需取用。
+     * 三种格式都在组帧缓冲上原地生成，不再额外扫描、拷贝。NaluCallback 始终为 AnnexB。
+     */
+    FrameFormat output_format = FrameFormat::AnnexB;
+
+    /**
+     * @brief 帧数据之后额外分配并清零的字节数（不计入 VideoFrame::size）
+     *
+     * 供按块读取、可能越过末尾的解码器原地使用（如 FFmpeg 要求 AV_INPUT_BUFFER_PADDING_SIZE = 64）。
+     */
+    uint32_t output_padding = 0;
+
+    /**
+     * @brief VideoFrame::data 起始地址的对齐字节数（2 的幂；0 表示不要求）
+     */
+    uint32_t output_alignment = 0;
+
+    /**
+     * @brief 第一个 IDR 前没有参数集时，插入 SDP sprop 中的 SPS/PPS（H.265 另含 VPS）
+     *
+     * 解码器不必等编码器下一次重复参数集即可开始解码。
+     */
+    bool inject_parameter_sets = true;
+
+    /**
+     * @brief 自适应播放调度（默认关闭：帧组好即输出）
+     *
+     * 开启后以 RTP 时间戳对照到达时间估计网络抖动，目标延迟取最近约 256 帧相对延迟的
+     * playout_jitter_percentile 分位（限定在 [min, max] 内），帧由定时线程按呈现时刻释放到
+     * receiveFrame 队列与 FrameCallback（此时回调在调度线程上执行）。只作用于第一个 SETUP 的轨道；
+     * TrackFrameCallback、NaluCallback 仍在组帧后立即回调。
+     */
+    bool playout_scheduler = false;
+    uint32_t playout_min_delay_ms = 20;         ///< 目标延迟下限
+    uint32_t playout_max_delay_ms = 1000;       ///< 目标延迟上限
+    uint32_t playout_jitter_percentile = 95;    ///< 覆盖的抖动分位（1~100），越大越平滑、延迟越高
+    uint32_t playout_late_drop_ms = 0;          ///< 晚于呈现时刻超过该值的帧丢弃至下一个 IDR；0 为只计数不丢
 };
 
 /**
@@ -67,6 +118,9 @@ struct MediaInfo {
     std::vector<uint8_t> sps;   ///< SPS数据
     std::vector<uint8_t> pps;   ///< PPS数据
     std::vector<uint8_t> vps;   ///< VPS数据（仅HEVC）
+    uint8_t profile_idc = 0;    ///< SPS 中的 profile（H.265 为 general_profile_idc），0 为未知
+    uint8_t level_idc = 0;      ///< SPS 中的 level（H.265 为 general_level_idc），0 为未知
+    bool high_tier = false;     ///< H.265 general_tier_flag
 };
 
 /**
@@ -76,7 +130,7 @@ struct SessionInfo {
     std::string session_id;           ///< 会话ID
     std::string base_url;             ///< 基础URL
     std::vector<MediaInfo> media_streams;  ///< 媒体流列表
-    uint64_t duration_ms = 0;         ///< 时长（毫秒）
+    uint64_t duration_ms = 0;         ///< 时长（毫秒），来自 SDP a=range；直播为 0
     bool has_video = false;           ///< 是否有视频
     bool has_audio = false;           ///< 是否有音频
 };
@@ -87,7 +141,15 @@ struct RtspClientStats {
     uint64_t rtp_packets_reordered = 0;
     uint64_t rtp_packet_loss_events = 0;
     uint64_t frames_output = 0;
+    uint64_t rtcp_packets_received = 0;   // RTP over TCP 的 RTCP 通道收到的包数
+    uint64_t redirects_followed = 0;
     bool using_tcp_transport = false;
+    // 以下仅在 RtspClientConfig::playout_scheduler 开启时有效
+    uint64_t playout_frames_released = 0;
+    uint64_t playout_frames_late = 0;     // 到达时已过呈现时刻、立即释放的帧
+    uint64_t playout_frames_dropped = 0;  // 晚于 playout_late_drop_ms 而丢弃（及其后等 IDR 期间）的帧
+    uint32_t playout_target_delay_ms = 0; // 当前自适应目标延迟
+    uint32_t playout_jitter_ms = 0;       // RTP 时间戳对照到达时间估计的抖动（RFC 3550）
 };
 
 /**
@@ -99,6 +161,43 @@ struct RtspClientStats {
  */
 using FrameCallback = std::function<void(const VideoFrame& frame)>;
 
+/**
+ * @brief 按轨道区分的帧回调函数类型
+ *
+ * @param stream_index 帧所属媒体流索引（与 setup() 的参数一致）
+ * @param frame 视频帧数据，智能托管，无需手动释放
+ *
+ * 一个会话 SETUP 多条流（如主/子码流）时，所有轨道的帧都经由此回调送出。
+ */
+using TrackFrameCallback = std::function<void(int stream_index, const VideoFrame& frame)>;
+
+/**
+ * @brief 解包完成的单个 NALU（slice 级提前交付）
+ *
+ * data 指向 Annex-B 格式的单个 NALU（含 4 字节起始码），仅在回调期间有效。
+ * access_unit_end 取自 RTP marker；对端不置 marker 时，以下一个 NALU 的
+ * access_unit_start 作为上一 AU 的结束。
+ */
+struct ReceivedNalu {
+    int stream_index = 0;               ///< 所属媒体流索引
+    CodecType codec = CodecType::H264;  ///< 编码类型
+    uint8_t nal_type = 0;               ///< NALU 类型（H.264 5bit / H.265 6bit）
+    const uint8_t* data = nullptr;      ///< 起始码 + NALU
+    size_t size = 0;                    ///< 数据大小
+    uint64_t pts = 0;                   ///< 所属 AU 的显示时间戳（毫秒）
+    uint64_t pts_us = 0;                ///< 同上（微秒，由展开为 64 位的 90kHz RTP 时间戳换算）
+    bool access_unit_start = false;     ///< 是否为 AU 的第一个 NALU
+    bool access_unit_end = false;       ///< 是否为 AU 的最后一个 NALU
+};
+
+/**
+ * @brief NALU 级回调函数类型
+ *
+ * 每个 NALU（单包、STAP/AP 拆出的、或 FU 重组完成的）一经完整即回调，
+ * 解码器可按 slice 提前开始解码，无需等待整帧收齐。
+ */
+using NaluCallback = std::function<void(const ReceivedNalu& nalu)>;
+
 /**
  * @brief 错误回调函数类型
  */
@@ -174,7 +273,23 @@ public:
      * @param callback 帧回调函数
      */
     void setFrameCallback(FrameCallback callback);
-    
+
+    /**
+     * @brief 设置按轨道区分的帧回调
+     *
+     * 多轨会话中每条已 SETUP 的流都会回调；setFrameCallback()/receiveFrame()
+     * 仍只接收第一个 SETUP 的流，保持单流用法不变。
+     */
+    void setTrackFrameCallback(TrackFrameCallback callback);
+
+    /**
+     * @brief 设置 NALU 级回调（可选，需在 setup() 之前设置）
+     *
+     * 与帧回调/receiveFrame() 并存：同一份数据既按 NALU 提前送出，
+     * 也照常拼装成整帧交付。未设置时解包路径没有额外开销。
+     */
+    void setNaluCallback(NaluCallback callback);
+
     /**
      * @brief 设置错误回调
      */
@@ -182,10 +297,21 @@ public:
     
     /**
      * @brief 发送SETUP请求
+     *
+     * 可对不同 stream_index 多次调用，所有轨道共用同一 RTSP 会话与控制连接：
+     * TCP 模式下依次使用 interleaved 通道对 0-1、2-3 ...，UDP 模式下每轨一对端口。
+     * 之后一次 play() 即聚合播放全部轨道。
+     *
      * @param stream_index 媒体流索引（从describe获取）
      * @return 是否成功
      */
     bool setup(int stream_index = 0);
+
+    /**
+     * @brief 对 describe() 得到的全部媒体流依次 SETUP（同一会话）
+     * @return 全部成功返回 true
+     */
+    bool setupAll();
     
     /**
      * @brief 发送PLAY请求开始播放
@@ -259,6 +385,23 @@ private:
     std::unique_ptr<Impl> impl_;
 };
 
+/**
+ * @brief SimpleRtspPlayer 阻塞读取使用的帧缓存方式
+ */
+enum class PlayerBufferMode {
+    Queue,      ///< 先进先出队列（默认）：缓存满时新到的帧被丢弃
+    Mailbox     ///< 只保留最近的 IDR 及其后的依赖帧：读取跟不上时丢掉积压，从最新 IDR 继续
+};
+
+/**
+ * @brief SimpleRtspPlayer 缓存统计
+ */
+struct SimplePlayerStats {
+    uint64_t frames_received = 0;   ///< 进入缓存流程的帧数
+    uint64_t frames_read = 0;       ///< 被 readFrame()/readLatestFrame() 取走的帧数
+    uint64_t frames_skipped = 0;    ///< 未被读取就丢弃的帧数（缓存满、被新 IDR 取代、等待 IDR）
+};
+
 /**
  * @brief 简化版RTSP播放器（封装了常用操作）
  * 
@@ -267,7 +410,8 @@ private:
  * 2. 阻塞方式：调用 readFrame() 阻塞读取
  * 
  * 内部维护接收线程，自动缓存帧数据。
- * 队列大小由 RtspClientConfig::buffer_size 控制。
+ * 阻塞方式的缓存可选先进先出队列或"最新帧"信箱（setBufferMode()），
+ * 信箱模式适合显示/推理等只关心最新画面的场景。
  * 
  * 使用示例（回调方式）：
  * @code
@@ -334,12 +478,37 @@ public:
      * @brief 读取一帧（阻塞方式）
      * 
      * 如果没有设置回调，可以使用此方法阻塞读取帧。
-     * 内部有队列缓存，队列满时会丢弃最旧的帧。
+     * Queue 模式下队列满时新到的帧被丢弃；Mailbox 模式下按 setBufferMode() 的说明折叠积压。
      * 
      * @param frame 输出帧数据（智能托管，无需手动释放）
      * @return true 成功，false 结束或出错
      */
     bool readFrame(VideoFrame& frame);
+
+    /**
+     * @brief 设置阻塞读取的缓存方式（须在 open() 之前调用）
+     *
+     * Mailbox 模式下缓存只含最近的 IDR 及其后的依赖帧：新 IDR 到达时未读的积压整段丢弃；
+     * 积压超过缓存上限时全部丢弃并等待下一个 IDR。读出的帧序列始终从可解码点开始。
+     */
+    void setBufferMode(PlayerBufferMode mode);
+
+    /**
+     * @brief 读取最接近直播点的可解码帧（仅 Mailbox 模式）
+     *
+     * 积压已在收帧时折叠，读取只取信箱头部，不遍历队列。
+     * 连续调用按解码顺序返回最新 IDR 之后的帧。
+     *
+     * @param frame 输出帧数据（智能托管，无需手动释放）
+     * @param timeout_ms 无帧时最长等待时间，0 表示不等待
+     * @return true 取到帧；false 超时、已停止或不是 Mailbox 模式
+     */
+    bool readLatestFrame(VideoFrame& frame, uint32_t timeout_ms);
+
+    /**
+     * @brief 获取缓存统计（收到/读取/跳过的帧数）
+     */
+    SimplePlayerStats getStats() const;
     
     /**
      * @brief 关闭播放器
@@ -358,15 +527,22 @@ public:
     bool isRunning() const;
 
 private:
+    void bufferFrame(const VideoFrame& frame);   ///< 收帧线程调用，持有 buffer_mutex_
+    void dropBufferedFrames();                   ///< 丢弃未读的缓存帧并计入 frames_skipped
+
     std::unique_ptr<RtspClient> client_;
-    std::vector<VideoFrame> frame_buffer_;
-    std::mutex buffer_mutex_;
+    std::deque<VideoFrame> frame_buffer_;
+    mutable std::mutex buffer_mutex_;
     std::condition_variable buffer_cv_;
     std::thread receive_thread_;
     std::atomic<bool> running_{false};
     
     FrameCallback frame_callback_;
     ErrorCallback error_callback_;
+
+    PlayerBufferMode buffer_mode_ = PlayerBufferMode::Queue;
+    bool waiting_for_idr_ = true;   ///< Mailbox 模式：依赖链已断开，丢帧直到下一个 IDR
+    SimplePlayerStats stats_;
     
     static constexpr size_t MAX_BUFFER_SIZE = 30;  ///< 默认最大缓存帧数
 };
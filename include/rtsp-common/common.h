@@ -30,20 +30,42 @@ struct NaluUnit {
     bool start_code;        // 是否包含起始码
 };
 
+// 帧数据的组织方式（客户端输出可选，见 RtspClientConfig::output_format）
+enum class FrameFormat {
+    AnnexB,     // 每个 NALU 前 4 字节起始码 00 00 00 01
+    Avcc,       // 每个 NALU 前 4 字节大端长度（MP4 / 多数硬件解码器的输入格式）
+    NaluSpans   // 数据同 AnnexB，另在 VideoFrame::nalus 中给出各 NALU 的位置
+};
+
+// 帧内一个 NALU 的位置：相对 VideoFrame::data 的偏移与长度，不含起始码/长度前缀
+struct NaluSpan {
+    uint32_t offset;
+    uint32_t size;
+};
+
 // 视频帧
 struct VideoFrame {
     CodecType codec;        // 编码类型
     FrameType type;         // 帧类型
     uint8_t* data;          // 帧数据
-    // 智能托管的数据持有者。若非空，data 指向 managed_data->data()，
+    // 智能托管的数据持有者。若非空，data 指向 managed_data 的缓冲，
     // 用户无需手动 delete[]。
     std::shared_ptr<std::vector<uint8_t>> managed_data;
+    // 外部数据的生命周期锚点（如文件点播的映射区）：data 指向别处的只读内存，
+    // 由它维持存活，managed_data 为空；同样无需 delete[]
+    std::shared_ptr<const void> data_owner;
     size_t size;            // 数据大小
     uint64_t pts;           // 显示时间戳 (毫秒)
     uint64_t dts;           // 解码时间戳 (毫秒)
     uint32_t width;         // 宽度
     uint32_t height;        // 高度
     uint32_t fps;           // 帧率
+    FrameFormat format = FrameFormat::AnnexB;  // data 的组织方式；服务端推流接口只接受 AnnexB
+    std::vector<NaluSpan> nalus;               // FrameFormat::NaluSpans 时填写，其余为空
+    // 微秒时间戳：推流时 pts_us 非 0 则优先于 pts/dts 换算 RTP 时间戳（29.97/59.94fps 等不再有毫秒取整抖动），
+    // 此时 dts_us 为 0 视同 pts_us。服务端内部与客户端输出的帧两组字段都会填写
+    uint64_t pts_us = 0;
+    uint64_t dts_us = 0;
 };
 
 // 音频帧
@@ -78,6 +100,7 @@ struct SdpMediaInfo {
     uint32_t width = 0;
     uint32_t height = 0;
     uint32_t fps = 0;
+    std::string control;    // a=control 属性（轨道控制 URL，可为相对路径）
 };
 
 // 时间戳转换工具
@@ -85,6 +108,58 @@ inline uint32_t convertToRtpTimestamp(uint64_t pts_ms, uint32_t clock_rate) {
     return static_cast<uint32_t>((pts_ms * clock_rate) / 1000);
 }
 
+// 微秒 -> RTP 时钟（四舍五入）；先拆出整秒，墙钟量级的 pts_us 相乘也不会溢出。
+// 由有理帧率截断得到的 pts_us 误差不足 1 微秒，舍入后落回精确的时钟刻度（29.97fps 恒为 3003）
+inline uint32_t convertUsToRtpTimestamp(uint64_t pts_us, uint32_t clock_rate) {
+    const uint64_t seconds = pts_us / 1000000;
+    const uint64_t rest = pts_us % 1000000;
+    return static_cast<uint32_t>(seconds * clock_rate + (rest * clock_rate + 500000) / 1000000);
+}
+
+// 帧的微秒时间戳：pts_us/dts_us 非 0 时取之，否则由毫秒字段换算
+inline uint64_t framePtsUs(const VideoFrame& frame) {
+    return frame.pts_us != 0 ? frame.pts_us : frame.pts * 1000;
+}
+
+inline uint64_t frameDtsUs(const VideoFrame& frame) {
+    if (frame.dts_us != 0) return frame.dts_us;
+    return frame.pts_us != 0 ? frame.pts_us : frame.dts * 1000;
+}
+
+// 接收端 RTP 时间戳展开为 64 位：按与最新值的有符号差判断前后，32 位回绕后继续递增，
+// 乱序到达的旧时间戳不会被误判为回绕
+class RtpTimestampUnwrapper {
+public:
+    uint64_t unwrap(uint32_t timestamp) {
+        if (!initialized_) {
+            initialized_ = true;
+            last_ = timestamp;
+            extended_ = timestamp;
+            return extended_;
+        }
+        const int32_t delta = static_cast<int32_t>(timestamp - last_);
+        if (delta < 0) {
+            const uint64_t back = static_cast<uint64_t>(-static_cast<int64_t>(delta));
+            return back > extended_ ? 0 : extended_ - back;
+        }
+        last_ = timestamp;
+        extended_ += static_cast<uint64_t>(delta);
+        return extended_;
+    }
+
+    void reset() { initialized_ = false; }
+
+private:
+    bool initialized_ = false;
+    uint32_t last_ = 0;
+    uint64_t extended_ = 0;
+};
+
+// 64 位 RTP 时间戳 -> 微秒
+inline uint64_t rtpTimestampToUs(uint64_t timestamp, uint32_t clock_rate) {
+    return timestamp / clock_rate * 1000000 + timestamp % clock_rate * 1000000 / clock_rate;
+}
+
 // Base64编码/解码
 std::string base64Encode(const uint8_t* data, size_t size);
 std::vector<uint8_t> base64Decode(const std::string& str);
@@ -124,6 +199,52 @@ LogConfig getLogConfig();
 void setLogCallback(LogCallback callback);
 void log(LogLevel level, const std::string& msg);
 
+// UDP 收发的 I/O 后端（进程级，运行时选择）。RTP 发送按帧批量提交，RTP 接收一次取回多个报文。
+// 初值取环境变量 RTSP_IO_BACKEND（auto / poll / io_uring），未设置为 Auto。
+enum class IoBackend {
+    Auto,      // io_uring 可用时用 io_uring，否则 Poll
+    Poll,      // poll 等待 + sendmmsg/recvmmsg（非 Linux 逐包 sendto/recvfrom）
+    IoUring    // Linux io_uring：批量提交发送，多发 recv + 提供缓冲环接收
+};
+
+// 选择后端；请求 IoUring 但内核不支持时返回 false 且不改变当前设置。
+// 已在收包的 socket 在下一次等待时切换。
+bool setIoBackend(IoBackend backend);
+// 实际生效的后端（Auto 已解析为 Poll 或 IoUring）
+IoBackend getIoBackend();
+
+// SDK 内部线程的角色（ThreadPolicy 按角色配置放置与优先级）
+enum class ThreadRole {
+    Connection,     // RTSP 控制连接与监听
+    MediaSend,      // 会话 RTP 发送、文件点播排程
+    MediaReceive,   // RTP 接收（客户端收流、服务端接收推流、TCP interleaved 收包、播放器）
+    Background,     // 会话清理、录像写盘、拉流转发、线程回收
+    Http,           // HLS 与 ONVIF SOAP 的 HTTP 服务
+    Discovery       // ONVIF WS-Discovery
+};
+
+struct ThreadRolePolicy {
+    std::vector<int> cpus;   // 允许运行的 CPU 编号，空为不限（仅 Linux）
+    int fifo_priority = 0;   // 1~99 时以 SCHED_FIFO 运行（需 CAP_SYS_NICE，失败记警告后按普通调度运行；仅 Linux）
+};
+
+// 线程放置策略：所有 SDK 线程启动时按角色应用，只影响之后创建的线程。
+// 绑定了 CPU 的线程同时设为本地内存分配（MPOL_LOCAL），线程自己分配并首次写入的
+// 缓冲（收发批量缓冲、打包后的 RTP 包、io_uring 缓冲环）落在所在 NUMA 节点。
+struct ThreadPolicy {
+    ThreadRolePolicy connection;
+    ThreadRolePolicy media_send;
+    ThreadRolePolicy media_receive;
+    ThreadRolePolicy background;
+    ThreadRolePolicy http;
+    ThreadRolePolicy discovery;
+    bool set_names = true;           // 线程名（pthread_setname_np），如 "rtsp-send"
+    bool numa_local_memory = true;   // 绑定 CPU 的线程使用 MPOL_LOCAL
+};
+
+void setThreadPolicy(const ThreadPolicy& policy);
+ThreadPolicy getThreadPolicy();
+
 #define RTSP_LOG_DEBUG(msg) rtsp::log(rtsp::LogLevel::Debug, msg)
 #define RTSP_LOG_INFO(msg) rtsp::log(rtsp::LogLevel::Info, msg)
 #define RTSP_LOG_WARNING(msg) rtsp::log(rtsp::LogLevel::Warning, msg)
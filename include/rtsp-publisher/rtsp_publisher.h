@@ -21,7 +21,7 @@ struct PublishMediaInfo {
     std::vector<uint8_t> pps;
     std::vector<uint8_t> vps;
     uint8_t payload_type = 96;
-    std::string control_track = "streamid=0";
+    std::string control_track;  // a=control；为空时按轨道序号取 "streamid=<i>"
 };
 
 class RtspPublisher {
@@ -32,11 +32,17 @@ public:
     void setConfig(const RtspPublishConfig& config);
     bool open(const std::string& url);
     bool announce(const PublishMediaInfo& media);
+    // 多轨推流（如主/子码流）：一个 ANNOUNCE 携带全部轨道，setup() 逐轨 SETUP 到同一会话，
+    // record() 一次聚合开始。轨道索引即 medias 中的下标。
+    bool announce(const std::vector<PublishMediaInfo>& medias);
     bool setup();
     bool record();
     bool pushFrame(const VideoFrame& frame);
+    bool pushFrame(size_t track_index, const VideoFrame& frame);
     bool pushH264Data(const uint8_t* data, size_t size, uint64_t pts, bool is_key);
+    bool pushH264Data(size_t track_index, const uint8_t* data, size_t size, uint64_t pts, bool is_key);
     bool pushH265Data(const uint8_t* data, size_t size, uint64_t pts, bool is_key);
+    bool pushH265Data(size_t track_index, const uint8_t* data, size_t size, uint64_t pts, bool is_key);
     bool teardown();
     bool closeWithTimeout(uint32_t timeout_ms);
     void close();
@@ -26,6 +26,17 @@ struct RtspServerConfig {
     std::string auth_realm = "RTSP Server"; // 鉴权域
     std::string auth_nonce;            // Digest nonce（可选，空则自动生成）
     uint32_t auth_nonce_ttl_ms = 60000; // Digest nonce有效期
+    // 单线程模式：不创建任何内部线程，由应用循环调用 processEvents 驱动（见 RtspServer::processEvents）
+    bool single_threaded = false;
+    // 观看会话共用的发送线程数（rtsp-send），会话建立/拆除不再创建线程；0 表示按 CPU 核数（至少 2）
+    uint32_t send_threads = 0;
+    // 会话结束后保留的已绑定 UDP 端口对个数，新的 UDP SETUP 直接复用；0 关闭
+    uint32_t udp_port_pool_size = 64;
+    // 推流（RECORD）收流事件循环线程数（rtsp-ingest），推流者再多也不增加线程；0 表示按 CPU 核数（至多 4）
+    uint32_t ingest_threads = 0;
+    // 非 0 时所有 UDP 推流者共用这个 RTP 端口（RTCP 为 +1），按来源地址分流、首包锁定 SSRC；
+    // 要求推流端从 SETUP 声明的 client_port 发送（对称 RTP）。0 表示每个推流者一对端口
+    uint16_t shared_ingest_port = 0;
     
     static uint16_t getNextRtpPort(uint32_t& current, uint32_t start, uint32_t end);
 };
@@ -39,6 +50,62 @@ struct RtspServerStats {
     uint64_t frames_pushed = 0;
     uint64_t rtp_packets_sent = 0;
     uint64_t rtp_bytes_sent = 0;
+    uint64_t rendition_switches = 0;
+    uint64_t redirects = 0;            // 因负载重定向到其他节点的请求数
+    uint64_t subscription_frames_dropped = 0;   // 订阅模式（mode=idr / every / maxfps）丢弃的 AU 数（按会话计）
+    // 准入控制拒绝（453）次数，按原因分别计数
+    uint64_t admission_rejected_sessions = 0;   // 观看会话总数达到上限
+    uint64_t admission_rejected_path = 0;       // 单路径会话数达到上限
+    uint64_t admission_rejected_ip = 0;         // 单客户端 IP 会话数达到上限
+    uint64_t admission_rejected_bandwidth = 0;  // 估算出口码率超限（全局或单网卡）
+};
+
+// 单线程模式下应用需要等待的描述符（poll 的 POLLIN / POLLOUT）
+struct PollDescriptor {
+    int fd = -1;
+    bool readable = true;              // 始终等待可读（新连接、请求、对端关闭）
+    bool writable = false;             // 有待发数据时等待可写
+};
+
+// 本节点负载（重定向策略的输入）
+struct ServerLoad {
+    uint32_t sessions = 0;             // 观看会话数
+    uint64_t egress_bps = 0;           // RTP 发送码率（最近约 1 秒）
+    uint64_t queued_units = 0;         // 所有观看会话发送队列中待发的单元数
+    double cpu_usage = 0.0;            // 进程 CPU 占用，按核数归一化到 0~1（最近约 1 秒）
+};
+
+// 负载感知重定向：任一阈值达到时，新观看者（DESCRIBE，或未经 DESCRIBE 的 SETUP）
+// 收到 302/305 与 Location，指向按路径选出的同级节点；已建立的会话不受影响。
+struct RedirectPeer {
+    std::string url;                   // 同级节点地址，如 "rtsp://10.0.0.2:8554"，302 时请求路径拼在其后
+    uint32_t weight = 1;               // 0 表示不参与选择
+};
+
+enum class RedirectPeerSelection {
+    ConsistentHash,                    // 按路径加权一致性哈希（rendezvous）：同一路径总落到同一节点
+    WeightedRoundRobin                 // 平滑加权轮询
+};
+
+struct RedirectConfig {
+    std::vector<RedirectPeer> peers;   // 为空则不重定向
+    uint32_t max_sessions = 0;         // 以下阈值为 0 表示不检查
+    uint64_t max_egress_bps = 0;
+    uint64_t max_queued_units = 0;
+    double max_cpu_usage = 0.0;
+    RedirectPeerSelection selection = RedirectPeerSelection::ConsistentHash;
+    int status_code = 302;             // 302 Moved Temporarily，或 305 Use Proxy（Location 为代理节点本身）
+};
+
+// 准入控制：观看者 SETUP 在绑定端口、创建发送线程之前检查，任一上限达到即回 453 Not Enough Bandwidth，
+// 已建立的会话不受影响。出口码率按各路径实测码率（约每秒采样，文件点播取平均码率）× 观看数估算，
+// 新会话按其路径的码率计入；码率组按最高档计。各项为 0 表示不限。
+struct AdmissionConfig {
+    uint32_t max_sessions = 0;                  // 观看会话总数
+    uint32_t max_sessions_per_path = 0;         // 单路径观看会话数
+    uint32_t max_sessions_per_ip = 0;           // 同一客户端 IP 的观看会话数
+    uint64_t max_egress_bps = 0;                // 全部会话的估算出口码率
+    uint64_t max_egress_bps_per_interface = 0;  // 按控制连接的本地地址（网卡）分别估算的出口码率
 };
 
 // 媒体路径配置
@@ -51,6 +118,97 @@ struct PathConfig {
     std::vector<uint8_t> sps;          // SPS
     std::vector<uint8_t> pps;          // PPS
     std::vector<uint8_t> vps;          // VPS (仅HEVC)
+    // 以下由 SPS 解析得出（addPath、ANNOUNCE 及 SPS 变化时刷新），同时以 SPS 中的分辨率覆盖
+    // width/height，VUI 带 timing 时覆盖 fps；0 为未知
+    uint8_t profile_idc = 0;           // H.264 profile_idc / H.265 general_profile_idc
+    uint8_t level_idc = 0;             // H.264 level_idc / H.265 general_level_idc
+    bool high_tier = false;            // H.265 general_tier_flag
+    // 打包时在不带参数集的 IDR 前补发上面的 SPS/PPS(/VPS)（聚合为一个 STAP-A/AP），
+    // 供忽略 SDP sprop 的播放端使用；AU 已自带 SPS 时不补
+    bool insert_parameter_sets = false;
+    // 直播时移：内存中保留最近若干 GOP（按字节封顶，整 GOP 淘汰），0 为关闭。
+    // 开启后 PLAY 带 Range: npt=<pts 毫秒/1000> 从不晚于该时刻的 IDR 回看，PAUSE 后续播从暂停处继续。
+    size_t timeshift_max_bytes = 0;
+    double timeshift_catchup_speed = 1.0; // 回看倍速（>=1），大于 1 时逐渐追上直播并无缝切回
+};
+
+// 码率组（simulcast / 多档位）配置：一个对外逻辑路径由多个已添加的路径组成。
+// 每个观看会话独立选择档位，依据发送队列积压与 RTCP RR 丢包率在目标档位的 IDR 处切换；
+// 切换前后 RTP 序列号/时间戳在该会话的 SSRC 上保持连续，SDP 只描述最高档一路视频。
+struct RenditionGroupConfig {
+    std::string path;                      // 对外逻辑路径，如 "/live/cam"
+    std::vector<std::string> renditions;   // 组内档位路径，按码率从高到低（须已 addPath，编码类型一致）
+    uint32_t downgrade_backlog_aus = 8;    // 会话发送队列积压 AU 数达到该值即降一档
+    uint8_t downgrade_fraction_lost = 13;  // RTCP RR fraction lost（x/256）达到该值即降一档，约 5%
+    uint32_t upgrade_backlog_aus = 1;      // 积压不超过该值且无明显丢包视为链路空闲
+    uint32_t upgrade_hold_ms = 10000;      // 链路空闲持续该时长后升一档
+    uint32_t loss_report_max_age_ms = 15000; // 超过该时长没有新的 RTCP RR，之前的丢包率作废（RR 约 5 s 一个）
+};
+
+// 路径录像配置：直接取路径广播的帧（与播放会话共享同一份引用计数缓冲），
+// 按 GOP 写 fragmented MP4（moof/mdat），在 IDR 处切分段文件。写盘在独立线程完成，推流线程只入队。
+struct RecordConfig {
+    std::string directory;                     // 输出目录（须已存在）
+    uint32_t segment_duration_ms = 60000;      // 段时长达到该值后，在下一个 IDR 切新文件
+    size_t max_backlog_bytes = 64 * 1024 * 1024; // 待写数据上限，超出后丢帧直到下一个 IDR
+};
+
+struct RecordStats {
+    uint64_t frames_written = 0;
+    uint64_t frames_dropped = 0;        // 因积压超限丢弃的 AU 数
+    uint64_t bytes_written = 0;
+    uint64_t segments_completed = 0;    // 已关闭的段文件数
+    uint64_t backlog_bytes = 0;         // 尚未写盘的数据量
+    uint64_t max_backlog_bytes = 0;     // 积压峰值
+    uint64_t last_write_latency_us = 0; // 单次写盘（fwrite + fflush）耗时
+    uint64_t max_write_latency_us = 0;
+    uint64_t avg_write_latency_us = 0;
+    std::string current_file;           // 正在写（或最后写）的段文件
+};
+
+// HLS / LL-HLS 输出配置：路径广播的帧按 CMAF（fMP4 moof/mdat）切成部分段，
+// 完整段在 IDR 处切分，最近若干段保存在内存中，由内置 HTTP 服务提供：
+//   http://<host>:<port><path>/index.m3u8   （支持 _HLS_msn/_HLS_part 阻塞重载）
+// 段数据在生成时封装一次，所有 HTTP 请求共享同一份缓冲。
+struct HlsConfig {
+    uint32_t part_duration_ms = 200;       // 部分段目标时长，在 AU 边界切
+    uint32_t segment_duration_ms = 2000;   // 完整段时长达到该值后在下一个 IDR 切
+    uint32_t segment_count = 6;            // 播放列表保留的完整段数
+};
+
+// 文件点播路径配置：文件只读映射，首次加载建立 AU 索引并写入 <file>.idx，
+// PLAY 的 Range: npt= 定位到不晚于该时刻的最近 IDR，按时间戳节奏发送。
+struct FilePathConfig {
+    std::string path;                  // 路径，如 "/vod/cam1"
+    std::string file;                  // Annex-B 裸流，或 fragmented MP4（如 startRecording 录制的文件）
+    CodecType codec = CodecType::H264; // 仅 Annex-B：编码类型（fMP4 以文件内 avcC/hvcC 为准）
+    uint32_t fps = 25;                 // 仅 Annex-B：按帧序号推算时间戳
+    uint32_t fps_den = 1;              // 仅 Annex-B：帧率为 fps/fps_den，如 30000/1001（29.97）；帧时长按有理数精确推算
+    uint32_t width = 1920;             // 仅 Annex-B：SDP 中的分辨率
+    uint32_t height = 1080;
+    bool write_index = true;           // 是否把索引写入旁路文件供下次直接加载
+};
+
+// 拉流转发路径配置（边缘代理）：无论多少观看者，每个路径至多一路上游拉流。
+// 添加后预取上游 DESCRIBE 并缓存编码与参数集，观看者的 DESCRIBE 直接用缓存应答
+// （预取完成前应答 503 + Retry-After，不占用连接线程等待）；
+// 第一个观看者 SETUP 时建立上游，最后一个观看者离开 idle_timeout_ms 后断开。
+struct RelayPathConfig {
+    std::string path;                      // 本地路径，如 "/relay/cam1"
+    std::string url;                       // 上游 RTSP URL，可带 user:pass@
+    bool prefer_tcp_transport = false;     // 上游是否走 RTP over RTSP(TCP)
+    uint32_t idle_timeout_ms = 10000;      // 无观看者后保持上游的时长
+    uint32_t retry_interval_ms = 2000;     // 上游失败后的重试间隔
+    uint32_t upstream_timeout_ms = 5000;   // 上游这么久没有帧视为断流（有观看者时重连）
+};
+
+struct RelayStats {
+    bool described = false;             // 上游参数已预取，DESCRIBE 可直接应答
+    bool upstream_active = false;       // 当前是否在拉上游
+    uint64_t upstream_connects = 0;     // 建立上游拉流的次数
+    uint64_t upstream_failures = 0;     // 上游请求失败或断流次数
+    uint64_t frames_relayed = 0;
+    uint64_t bytes_relayed = 0;
 };
 
 // 视频帧输入接口
@@ -75,14 +233,51 @@ public:
     void stop();
     bool stopWithTimeout(uint32_t timeout_ms);
     bool isRunning() const;
+
+    // 单线程模式（RtspServerConfig::single_threaded）的事件驱动接口，须在同一线程调用，
+    // 推帧也在该线程完成。accept、RTSP 请求解析、媒体发送、会话超时都在 processEvents 内进行；
+    // 响应与 RTP over TCP 写入每连接的待发缓冲，可写时非阻塞写出，积压过多时按整 AU 丢帧。
+    // 该模式只服务播放端：推流（ANNOUNCE）、文件点播、时移、录像、HLS、拉流转发需要内部线程，不可用。
+    // 用法：poll(getPollDescriptors(), nextTimerDeadline()) 之后调用 processEvents(0)；
+    // 或直接调用 processEvents(timeout_ms)，由其自行等待。多线程模式下分别返回空 / -1 / -1。
+    std::vector<PollDescriptor> getPollDescriptors() const;
+    // 等待最多 timeout_ms（-1 为只按内部定时器等待）后处理就绪事件与到期定时器，返回就绪的描述符数
+    int processEvents(int timeout_ms);
+    // 距下一次必须调用 processEvents 的毫秒数；有待发的帧时为 0
+    int nextTimerDeadline() const;
     
     // 添加媒体路径
     bool addPath(const PathConfig& config);
     bool addPath(const std::string& path, CodecType codec);
     
-    // 删除媒体路径
+    // 删除媒体路径。仍属于某个码率组的档位路径不能删除（返回 false），须先删除码率组
     bool removePath(const std::string& path);
 
+    // 添加文件点播路径（每个观看会话独立的播放进度，所有会话共用一个排程线程）。
+    // 文件路径不接受推流，用 removePath 删除。
+    bool addFilePath(const FilePathConfig& config);
+
+    // 添加拉流转发路径（不接受推流，可录像/HLS）。用 removePath 删除，同时断开上游。
+    bool addRelayPath(const RelayPathConfig& config);
+    bool getRelayStats(const std::string& path, RelayStats& stats) const;
+
+    // 添加码率组：之后对 config.path 的 DESCRIBE/SETUP/PLAY 按会话自动选档。
+    // 帧仍推送到各档位路径；码率组本身不接受推流。用 removePath(config.path) 删除。
+    bool addRenditionGroup(const RenditionGroupConfig& config);
+
+    // 开始/停止录制某路径（码率组路径不支持，应录制各档位路径）。
+    // stopRecording 会写完已入队的数据并关闭当前段文件；removePath/stop 时自动停止。
+    bool startRecording(const std::string& path, const RecordConfig& config);
+    bool stopRecording(const std::string& path);
+    bool getRecordStats(const std::string& path, RecordStats& stats) const;
+
+    // HLS 的 HTTP 服务（所有开启 HLS 的路径共用一个端口），stop() 时一并停止
+    bool startHlsServer(uint16_t port, const std::string& host = "0.0.0.0");
+    void stopHlsServer();
+    // 开始/停止某路径的 HLS 切片（码率组与文件路径不支持）；removePath 时自动停止
+    bool startHls(const std::string& path, const HlsConfig& config = HlsConfig());
+    bool stopHls(const std::string& path);
+
     // 获取当前所有路径的配置快照（线程安全，返回拷贝）。
     // 用于 ONVIF daemon 等外部模块动态生成 profile；避免暴露内部结构。
     std::vector<PathConfig> getPathsSnapshot() const;
@@ -95,6 +290,13 @@ public:
                       uint64_t pts, bool is_key);
     bool pushH265Data(const std::string& path, const uint8_t* data, size_t size,
                       uint64_t pts, bool is_key);
+
+    // 低延迟按 slice 推送：data 为一个或多个 NALU（可带或不带起始码，编码类型取路径配置），
+    // 到达即打包发送，无需等编码器产出整帧。同一 access unit 的各片段使用相同 pts，
+    // 最后一个片段传 last_in_access_unit=true，仅该片段的最后一个 RTP 包置 marker。
+    // 帧类型由 NALU 类型判断；会话队列满时按整 AU 丢弃，IDR 缓存在 AU 结束后整体更新。
+    bool pushNalu(const std::string& path, const uint8_t* data, size_t size,
+                  uint64_t pts, bool last_in_access_unit);
     
     // 获取帧输入接口（用于更复杂的场景）
     std::shared_ptr<IVideoFrameInput> getFrameInput(const std::string& path);
@@ -102,6 +304,9 @@ public:
     // 设置回调
     using ClientConnectCallback = std::function<void(const std::string& path, const std::string& client_ip)>;
     using ClientDisconnectCallback = std::function<void(const std::string& path, const std::string& client_ip)>;
+    // 自定义重定向：返回 0 在本节点服务，返回 3xx 状态码（如 302/305）并填 location 则重定向
+    using RedirectCallback = std::function<int(const std::string& path, const ServerLoad& load,
+                                               std::string& location)>;
     
     void setClientConnectCallback(ClientConnectCallback callback);
     void setClientDisconnectCallback(ClientDisconnectCallback callback);
@@ -111,6 +316,16 @@ public:
                        const std::string& realm = "RTSP Server");
     RtspServerStats getStats() const;
 
+    // 负载感知重定向（见 RedirectConfig）；设置了回调时以回调为准
+    void setRedirectPolicy(const RedirectConfig& config);
+    void setRedirectCallback(RedirectCallback callback);
+    ServerLoad getLoad() const;
+
+    // 准入控制（见 AdmissionConfig）；默认全部不限
+    void setAdmissionControl(const AdmissionConfig& config);
+    // 路径实测码率（bit/s），路径不存在或尚未采样时为 0
+    uint64_t getPathBitrate(const std::string& path) const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
@@ -0,0 +1,172 @@
+#include "playout_scheduler.h"
+
+#include <rtsp-common/thread_policy.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace rtsp {
+
+namespace {
+
+// pts 前后跳变超过该值视为不连续（seek、换源），重新估计
+constexpr int64_t kDiscontinuityUs = 3000000;
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+PlayoutScheduler::PlayoutScheduler(const PlayoutConfig& config, ReleaseCallback release)
+    : config_(config), release_(std::move(release)) {
+    target_delay_us_ = static_cast<int64_t>(config_.min_delay_ms) * 1000;
+    stats_.target_delay_ms = config_.min_delay_ms;
+    thread_ = startThread(ThreadRole::MediaReceive, "rtsp-playout", [this] { loop(); });
+}
+
+PlayoutScheduler::~PlayoutScheduler() {
+    stop();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void PlayoutScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        queue_.clear();
+    }
+    cv_.notify_all();
+    // 不 detach：调度线程退出前还要访问本对象，必须由所有者在对象销毁前 join
+    if (thread_.joinable() && !onSchedulerThread()) {
+        thread_.join();
+    }
+}
+
+bool PlayoutScheduler::onSchedulerThread() const {
+    return thread_.get_id() == std::this_thread::get_id();
+}
+
+PlayoutStats PlayoutScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void PlayoutScheduler::resetEstimatorLocked() {
+    transits_.clear();
+    has_last_ = false;
+    jitter_us_ = 0;
+    last_due_us_ = 0;
+}
+
+int64_t PlayoutScheduler::targetDelayLocked(int64_t transit) {
+    transits_.push_back(transit);
+    while (transits_.size() > std::max<size_t>(1, config_.window_frames)) {
+        transits_.pop_front();
+    }
+    const int64_t max_delay_us = static_cast<int64_t>(config_.max_delay_ms) * 1000;
+    if (transit - *std::min_element(transits_.begin(), transits_.end()) > max_delay_us) {
+        // 延迟阶跃超过上限（发送端停顿后按原节奏继续、路由切换）：以这一帧重定基准
+        transits_.clear();
+        transits_.push_back(transit);
+    }
+    const int64_t base = *std::min_element(transits_.begin(), transits_.end());
+    scratch_.clear();
+    for (int64_t t : transits_) {
+        scratch_.push_back(t - base);
+    }
+    const uint32_t percentile = std::min<uint32_t>(100, std::max<uint32_t>(1, config_.percentile));
+    const size_t rank = (scratch_.size() - 1) * percentile / 100;
+    std::nth_element(scratch_.begin(), scratch_.begin() + static_cast<std::ptrdiff_t>(rank), scratch_.end());
+    const int64_t wanted = std::min<int64_t>(
+        max_delay_us,
+        std::max<int64_t>(static_cast<int64_t>(config_.min_delay_ms) * 1000, scratch_[rank]));
+    if (wanted >= target_delay_us_) {
+        target_delay_us_ = wanted;
+    } else {
+        // 逐帧收敛，每帧至多缩短差值的 1/16
+        target_delay_us_ -= std::max<int64_t>(1, (target_delay_us_ - wanted) / 16);
+    }
+    return base;
+}
+
+void PlayoutScheduler::push(const VideoFrame& frame, int64_t arrival_us) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        const uint64_t pts_us = framePtsUs(frame);
+        if (has_last_) {
+            const int64_t step = static_cast<int64_t>(pts_us - last_pts_us_);
+            if (step > kDiscontinuityUs || step < -kDiscontinuityUs) {
+                resetEstimatorLocked();
+            }
+        }
+
+        const int64_t transit = arrival_us - static_cast<int64_t>(pts_us);
+        if (has_last_) {
+            const double d = static_cast<double>(std::llabs(transit - last_transit_));
+            jitter_us_ += (d - jitter_us_) / 16.0;
+        }
+        has_last_ = true;
+        last_pts_us_ = pts_us;
+        last_transit_ = transit;
+
+        const int64_t base = targetDelayLocked(transit);
+        const int64_t due_us = static_cast<int64_t>(pts_us) + base + target_delay_us_;
+        stats_.target_delay_ms = static_cast<uint32_t>(target_delay_us_ / 1000);
+        stats_.jitter_ms = static_cast<uint32_t>(jitter_us_ / 1000.0);
+
+        const bool is_idr = frame.type == FrameType::IDR;
+        if (is_idr) {
+            waiting_idr_ = false;
+        }
+        const int64_t lateness = arrival_us - due_us;
+        if (!is_idr && (waiting_idr_ ||
+                        (config_.late_drop_ms > 0 && lateness > static_cast<int64_t>(config_.late_drop_ms) * 1000))) {
+            // 丢掉一帧后其后的帧都缺参考，一直丢到下一个 IDR
+            waiting_idr_ = true;
+            stats_.frames_dropped++;
+            return;
+        }
+        if (lateness > 0) {
+            stats_.frames_late++;
+        }
+
+        Pending pending;
+        pending.frame = frame;
+        pending.due_us = std::max(due_us, last_due_us_);   // 按到达（解码）顺序释放
+        last_due_us_ = pending.due_us;
+        queue_.push_back(std::move(pending));
+    }
+    cv_.notify_one();
+}
+
+void PlayoutScheduler::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (queue_.empty()) {
+            cv_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+            continue;
+        }
+        const int64_t due_us = queue_.front().due_us;
+        if (due_us > nowUs()) {
+            cv_.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::microseconds(due_us)));
+            continue;
+        }
+        VideoFrame frame = std::move(queue_.front().frame);
+        queue_.pop_front();
+        stats_.frames_released++;
+        lock.unlock();
+        release_(frame);
+        lock.lock();
+    }
+}
+
+} // namespace rtsp
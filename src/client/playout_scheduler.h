@@ -0,0 +1,91 @@
+#pragma once
+
+// 客户端播放调度：以 RTP 时间戳（pts_us）对照到达时间估计网络抖动，维持自适应目标延迟，
+// 由定时线程在每帧的呈现时刻释放，渲染端看到的是按时间表均匀到来的帧。
+//
+//   transit   = 到达时刻 - pts_us（含两端时钟差，只用相对值）
+//   基准      = 最近窗口内 transit 的最小值（最快到达的帧）
+//   目标延迟  = clamp(窗口内 (transit - 基准) 的 percentile 分位, min_delay, max_delay)
+//   释放时刻  = pts_us + 基准 + 目标延迟（按到达顺序单调，B 帧不重排）
+//
+// 目标延迟变大立即生效，变小时逐帧收敛，避免释放节奏突变；单帧相对延迟超过 max_delay 时重定基准。
+
+#include <rtsp-common/common.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rtsp {
+
+struct PlayoutConfig {
+    uint32_t min_delay_ms = 20;
+    uint32_t max_delay_ms = 1000;
+    uint32_t percentile = 95;        // 1~100
+    uint32_t late_drop_ms = 0;       // 到达时已晚于释放时刻超过该值的帧丢弃，直到下一个 IDR；0 为不丢
+    size_t window_frames = 256;      // 抖动统计窗口（帧数）
+};
+
+struct PlayoutStats {
+    uint64_t frames_released = 0;
+    uint64_t frames_late = 0;        // 到达时已过释放时刻（立即释放）
+    uint64_t frames_dropped = 0;     // 超过 late_drop_ms 及其后等待 IDR 期间丢弃的帧
+    uint32_t target_delay_ms = 0;
+    uint32_t jitter_ms = 0;          // RFC 3550 到达间隔抖动（1/16 平滑）
+};
+
+class PlayoutScheduler {
+public:
+    using ReleaseCallback = std::function<void(const VideoFrame&)>;
+
+    // release 在调度线程上调用，不持有内部锁。析构会 join 调度线程，不能在 release 回调里析构
+    PlayoutScheduler(const PlayoutConfig& config, ReleaseCallback release);
+    ~PlayoutScheduler();
+
+    PlayoutScheduler(const PlayoutScheduler&) = delete;
+    PlayoutScheduler& operator=(const PlayoutScheduler&) = delete;
+
+    // frame 须为托管缓冲；arrival_us 为 steady_clock 微秒
+    void push(const VideoFrame& frame, int64_t arrival_us);
+    // 停止调度线程，丢弃未释放的帧。在 release 回调里调用时只置停止标志，
+    // 调度线程在回调返回后退出，由之后的 stop() 或析构 join
+    void stop();
+    // 当前线程是否为调度线程（即正在 release 回调里）
+    bool onSchedulerThread() const;
+    PlayoutStats stats() const;
+
+private:
+    struct Pending {
+        VideoFrame frame;
+        int64_t due_us = 0;
+    };
+
+    void loop();
+    void resetEstimatorLocked();
+    int64_t targetDelayLocked(int64_t transit);
+
+    const PlayoutConfig config_;
+    const ReleaseCallback release_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Pending> queue_;
+    std::deque<int64_t> transits_;   // 最近 window_frames 帧的 transit
+    std::vector<int64_t> scratch_;   // 分位数计算复用
+    int64_t target_delay_us_ = 0;
+    int64_t last_due_us_ = 0;
+    bool has_last_ = false;
+    uint64_t last_pts_us_ = 0;
+    int64_t last_transit_ = 0;
+    double jitter_us_ = 0;
+    bool waiting_idr_ = false;
+    PlayoutStats stats_;
+    bool running_ = true;
+    std::thread thread_;
+};
+
+} // namespace rtsp
@@ -2,11 +2,17 @@
 #include <rtsp-common/socket.h>
 #include <rtsp-common/rtsp_request.h>
 #include <rtsp-common/sdp.h>
+#include <rtsp-common/sps_parser.h>
 #include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
+#include "playout_scheduler.h"
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <sstream>
 #include <thread>
 #include <queue>
+#include <deque>
 #include <regex>
 #include <map>
 #include <unordered_map>
@@ -39,8 +45,14 @@ VideoFrame cloneFrameManaged(const VideoFrame& src) {
     return copy;
 }
 
+// 托管帧的缓冲交付后不再改写，排队时共享即可（同时保留输出的对齐与尾部填充）；非托管帧才拷贝
+VideoFrame shareFrameManaged(const VideoFrame& src) {
+    return src.managed_data ? src : cloneFrameManaged(src);
+}
+
 void releaseFrameData(VideoFrame& frame) {
     frame.managed_data.reset();
+    frame.data_owner.reset();
     frame.data = nullptr;
     frame.size = 0;
 }
@@ -53,7 +65,7 @@ bool joinThreadWithTimeout(std::thread& t, uint32_t timeout_ms) {
     std::thread owned = std::move(t);
     std::promise<void> done;
     auto fut = done.get_future();
-    std::thread joiner([owned = std::move(owned), done = std::move(done)]() mutable {
+    std::thread joiner = startThread(ThreadRole::Background, "rtsp-joiner", [owned = std::move(owned), done = std::move(done)]() mutable {
         if (owned.joinable()) {
             owned.join();
         }
@@ -87,18 +99,40 @@ bool parseContentLength(const std::string& headers, std::size_t* out) {
     }
 }
 
-bool recvRtspResponse(Socket* socket, std::string* response, int timeout_ms) {
-    if (socket == nullptr || response == nullptr) {
+// excess：上次读取越过响应末尾的字节（服务端在 PLAY 响应后紧接着发 interleaved 数据时），
+// 调用时作为本次响应的开头，返回时存放本次响应之后多读的字节
+bool recvRtspResponse(Socket* socket, std::string* response, int timeout_ms, std::string* excess) {
+    if (socket == nullptr || response == nullptr || excess == nullptr) {
         return false;
     }
 
-    response->clear();
+    response->swap(*excess);
+    excess->clear();
 
     const auto timeout = std::chrono::milliseconds(std::max(0, timeout_ms));
     const auto deadline = std::chrono::steady_clock::now() + timeout;
 
-    std::size_t expected_total_size = 0;
-    while (std::chrono::steady_clock::now() < deadline) {
+    // 已有完整响应时拆出多余字节（不把流水线里后续的响应或 $ 包当作本次响应的一部分）
+    auto complete = [&]() {
+        const auto header_end_pos = response->find("\r\n\r\n");
+        if (header_end_pos == std::string::npos) {
+            return false;
+        }
+        const std::size_t header_size = header_end_pos + 4;
+        std::size_t content_length = 0;
+        const std::size_t expected_total_size =
+            parseContentLength(response->substr(0, header_size), &content_length) ? header_size + content_length
+                                                                                  : header_size;
+        if (response->size() < expected_total_size) {
+            return false;
+        }
+        excess->assign(*response, expected_total_size, std::string::npos);
+        response->resize(expected_total_size);
+        return true;
+    };
+
+    bool done = complete();
+    while (!done && std::chrono::steady_clock::now() < deadline) {
         const auto now = std::chrono::steady_clock::now();
         const auto remain =
             static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
@@ -108,35 +142,15 @@ bool recvRtspResponse(Socket* socket, std::string* response, int timeout_ms) {
         const ssize_t len = socket->recv(reinterpret_cast<std::uint8_t*>(buffer), sizeof(buffer), poll_timeout_ms);
         if (len > 0) {
             response->append(buffer, static_cast<std::size_t>(len));
-
-            if (expected_total_size == 0) {
-                const auto header_end_pos = response->find("\r\n\r\n");
-                if (header_end_pos != std::string::npos) {
-                    const std::size_t header_size = header_end_pos + 4;
-                    std::size_t content_length = 0;
-                    if (parseContentLength(response->substr(0, header_size), &content_length)) {
-                        expected_total_size = header_size + content_length;
-                    } else {
-                        expected_total_size = header_size;
-                    }
-                }
-            }
-
-            if (expected_total_size != 0 && response->size() >= expected_total_size) {
-                // Do not return extra bytes if the peer pipelined multiple RTSP responses.
-                response->resize(expected_total_size);
-                return true;
-            }
+            done = complete();
         } else if (len == 0) {
             // Peer closed.
-            break;
-        } else {
-            // Timeout / transient error.
-            continue;
+            return false;
         }
+        // Timeout / transient error: keep waiting until the deadline.
     }
 
-    return false;
+    return done;
 }
 
 } // namespace
@@ -149,6 +163,7 @@ public:
         uint64_t packets_reordered = 0;
         uint64_t packet_loss_events = 0;
         uint64_t frames_output = 0;
+        uint64_t rtcp_packets_received = 0;
     };
 
     RtpReceiver() = default;
@@ -171,7 +186,7 @@ public:
     void start() {
         if (running_) return;
         running_ = true;
-        receive_thread_ = std::thread([this]() { receiveLoop(); });
+        receive_thread_ = startThread(ThreadRole::MediaReceive, "rtsp-recv", [this]() { receiveLoop(); });
     }
 
     bool stopWithTimeout(uint32_t timeout_ms) {
@@ -203,6 +218,11 @@ public:
         callback_ = callback;
     }
 
+    void setNaluCallback(int stream_index, NaluCallback callback) {
+        nalu_stream_index_ = stream_index;
+        nalu_callback_ = callback;
+    }
+
     void setVideoInfo(CodecType codec, uint32_t width, uint32_t height, uint32_t fps, uint8_t payload_type) {
         codec_ = codec;
         width_ = width;
@@ -215,12 +235,36 @@ public:
         jitter_buffer_packets_ = packets == 0 ? 1 : packets;
     }
 
+    void setOutputFormat(FrameFormat format, uint32_t padding, uint32_t alignment) {
+        output_format_ = format;
+        output_padding_ = padding;
+        // 只接受 2 的幂
+        output_alignment_ = (alignment & (alignment - 1)) == 0 ? alignment : 0;
+    }
+
+    // SDP sprop 中的参数集，第一个 IDR 前帧内没有时插入（都为空则不插）
+    void setParameterSets(const std::vector<uint8_t>& vps, const std::vector<uint8_t>& sps,
+                          const std::vector<uint8_t>& pps) {
+        inband_parameter_sets_.clear();
+        inband_parameter_set_starts_.clear();
+        for (const auto* nalu : {&vps, &sps, &pps}) {
+            if (!nalu->empty()) {
+                static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+                inband_parameter_set_starts_.push_back(inband_parameter_sets_.size());
+                inband_parameter_sets_.insert(inband_parameter_sets_.end(), start_code, start_code + 4);
+                inband_parameter_sets_.insert(inband_parameter_sets_.end(), nalu->begin(), nalu->end());
+            }
+        }
+        first_idr_seen_ = false;
+    }
+
     StatsSnapshot getStats() const {
         StatsSnapshot s;
         s.packets_received = packets_received_.load();
         s.packets_reordered = packets_reordered_.load();
         s.packet_loss_events = packet_loss_events_.load();
         s.frames_output = frames_output_.load();
+        s.rtcp_packets_received = rtcp_packets_received_.load();
         return s;
     }
 
@@ -248,6 +292,11 @@ public:
         }
         if (seq != expected_seq_) {
             packets_reordered_++;
+        } else if (reorder_buffer_.empty()) {
+            // 按序到达且没有等待中的乱序包：直接解包，不复制
+            processRtpPacket(data, len);
+            expected_seq_ = static_cast<uint16_t>(expected_seq_ + 1);
+            return;
         }
 
         reorder_buffer_[seq] = std::vector<uint8_t>(data, data + len);
@@ -293,6 +342,13 @@ public:
         }
     }
 
+    // RTP over TCP 的 RTCP 通道（服务端 SR 等）：只计数，不进入 RTP 解包
+    void ingestRtcpPacket(const uint8_t* data, size_t len) {
+        if (data && len >= 4) {
+            rtcp_packets_received_++;
+        }
+    }
+
     uint16_t getRtpPort() const { return rtp_port_; }
     uint16_t getRtcpPort() const { return rtcp_port_; }
 
@@ -300,18 +356,96 @@ private:
     void appendAnnexBNalu(const uint8_t* nalu, size_t len) {
         if (!nalu || len == 0) return;
         static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+        nalu_starts_.push_back(frame_buffer_.size());
         frame_buffer_.insert(frame_buffer_.end(), start_code, start_code + 4);
         frame_buffer_.insert(frame_buffer_.end(), nalu, nalu + len);
     }
 
+    // FU 丢片回退组帧缓冲时同步丢掉回退位置之后的 NALU 记录
+    void truncateFrameBuffer(size_t size) {
+        frame_buffer_.resize(size);
+        while (!nalu_starts_.empty() && nalu_starts_.back() >= size) {
+            nalu_starts_.pop_back();
+        }
+    }
+
+    bool frameHasParameterSets() const {
+        for (size_t start : nalu_starts_) {
+            if (start + 4 >= frame_buffer_.size()) continue;
+            const uint8_t header = frame_buffer_[start + 4];
+            if (codec_ == CodecType::H265 ? ((header >> 1) & 0x3F) == 33 : (header & 0x1F) == 7) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 第一个 IDR 缺参数集时把 sprop 中的插到帧首（每个会话至多一次）
+    void injectParameterSets() {
+        if (first_idr_seen_ || !frame_is_idr_) return;
+        first_idr_seen_ = true;
+        if (inband_parameter_sets_.empty() || frameHasParameterSets()) return;
+
+        const size_t shift = inband_parameter_sets_.size();
+        frame_buffer_.insert(frame_buffer_.begin(), inband_parameter_sets_.begin(), inband_parameter_sets_.end());
+        for (auto& start : nalu_starts_) {
+            start += shift;
+        }
+        nalu_starts_.insert(nalu_starts_.begin(), inband_parameter_set_starts_.begin(),
+                            inband_parameter_set_starts_.end());
+    }
+
+    // 按输出格式原地改写前缀：AVCC 把起始码换成大端长度，NaluSpans 记下各 NALU 位置
+    void applyOutputFormat(VideoFrame& frame) const {
+        frame.format = output_format_;
+        if (output_format_ == FrameFormat::AnnexB) return;
+        for (size_t i = 0; i < nalu_starts_.size(); ++i) {
+            const size_t start = nalu_starts_[i];
+            const size_t end = i + 1 < nalu_starts_.size() ? nalu_starts_[i + 1] : frame.size;
+            const uint32_t len = static_cast<uint32_t>(end - start - 4);
+            if (output_format_ == FrameFormat::Avcc) {
+                frame.data[start] = static_cast<uint8_t>(len >> 24);
+                frame.data[start + 1] = static_cast<uint8_t>(len >> 16);
+                frame.data[start + 2] = static_cast<uint8_t>(len >> 8);
+                frame.data[start + 3] = static_cast<uint8_t>(len);
+            } else {
+                frame.nalus.push_back(NaluSpan{static_cast<uint32_t>(start + 4), len});
+            }
+        }
+    }
+
     bool isH265Irap(uint8_t nal_type) const {
         return nal_type >= 16 && nal_type <= 21;
     }
 
     void clearCurrentFrameState() {
         frame_buffer_.clear();
+        nalu_starts_.clear();
         frame_is_idr_ = false;
         frame_in_progress_ = false;
+        h264_fu_in_progress_ = false;
+    }
+
+    // frame_buffer_ 中 nalu_offset 处的 NALU 已完整，按需立即回调（slice 级提前交付）
+    void notifyNalu(size_t nalu_offset, uint32_t timestamp, bool access_unit_end) {
+        if (!nalu_callback_) return;
+        if (nalu_offset + 4 >= frame_buffer_.size()) return;
+
+        ReceivedNalu nalu;
+        nalu.stream_index = nalu_stream_index_;
+        nalu.codec = codec_;
+        const uint8_t header = frame_buffer_[nalu_offset + 4];
+        nalu.nal_type = codec_ == CodecType::H265 ? static_cast<uint8_t>((header >> 1) & 0x3F)
+                                                  : static_cast<uint8_t>(header & 0x1F);
+        nalu.data = frame_buffer_.data() + nalu_offset;
+        nalu.size = frame_buffer_.size() - nalu_offset;
+        nalu.pts_us = rtpTimestampToUs(timestamp_unwrapper_.unwrap(timestamp), 90000);
+        nalu.pts = nalu.pts_us / 1000;
+        nalu.access_unit_start = !nalu_au_open_ || timestamp != nalu_au_ts_;
+        nalu.access_unit_end = access_unit_end;
+        nalu_au_open_ = !access_unit_end;
+        nalu_au_ts_ = timestamp;
+        nalu_callback_(nalu);
     }
 
     void emitFrame(uint32_t timestamp) {
@@ -319,40 +453,64 @@ private:
 
         VideoFrame frame;
         frame.codec = codec_;
-        frame.pts = timestamp / 90;
+        frame.pts_us = rtpTimestampToUs(timestamp_unwrapper_.unwrap(timestamp), 90000);
+        frame.dts_us = frame.pts_us;
+        frame.pts = frame.pts_us / 1000;
         frame.dts = frame.pts;
         frame.width = width_;
         frame.height = height_;
         frame.fps = fps_;
         frame.type = frame_is_idr_ ? FrameType::IDR : FrameType::P;
-        frame.managed_data = makeManagedBuffer(frame_buffer_.data(), frame_buffer_.size());
-        frame.data = frame.managed_data->empty() ? nullptr : frame.managed_data->data();
-        frame.size = frame.managed_data->size();
+        injectParameterSets();
+
+        const size_t size = frame_buffer_.size();
+        if (output_alignment_ <= 1) {
+            // 组帧缓冲（连同清零的尾部填充）直接交给帧，不拷贝；下一帧按这一帧的大小预留
+            frame_buffer_.resize(size + output_padding_, 0);
+            frame.managed_data = std::make_shared<std::vector<uint8_t>>(std::move(frame_buffer_));
+            frame.data = frame.managed_data->data();
+            frame_buffer_ = std::vector<uint8_t>();
+            frame_buffer_.reserve(size);
+        } else {
+            // 要求对齐时多分配 alignment - 1 字节，从对齐处开始拷贝
+            frame.managed_data = std::make_shared<std::vector<uint8_t>>(size + output_alignment_ - 1 + output_padding_, 0);
+            const uintptr_t base = reinterpret_cast<uintptr_t>(frame.managed_data->data());
+            const size_t offset = (output_alignment_ - base % output_alignment_) % output_alignment_;
+            frame.data = frame.managed_data->data() + offset;
+            memcpy(frame.data, frame_buffer_.data(), size);
+            frame_buffer_.clear();
+        }
+        frame.size = size;
+        applyOutputFormat(frame);
 
         if (callback_) {
             callback_(frame);
         }
         frames_output_++;
-        frame_buffer_.clear();
+        nalu_starts_.clear();
         frame_is_idr_ = false;
         frame_in_progress_ = false;
+        h264_fu_in_progress_ = false;
     }
 
     void receiveLoop() {
-        uint8_t buffer[65536];
-        std::string from_ip;
-        uint16_t from_port;
-
-        // 用 poll(200ms) 替代 1ms 忙等，减少嵌入式设备 idle 时的 CPU 占用。
+        // 每次最多等 200ms，一次取回已到达的全部报文（recvmmsg 或 io_uring 多发 recv），
+        // 减少嵌入式设备 idle 时的 CPU 占用与高码率下的系统调用数。
         // 停止路径通过 shutdownReadWrite + 自发 UDP 包唤醒。
+        const auto ingest = [this](const uint8_t* data, size_t len) {
+            if (running_) {
+                ingestRtpPacket(data, len);
+            }
+        };
+        // 出错（如 socket 已失效）时不立即重试，按 10ms 起倍增、最多 200ms 退避，避免空转占满 CPU
+        int backoff_ms = 0;
         while (running_) {
-            int r = rtp_socket_.waitReadable(200);
-            if (!running_) break;
-            if (r <= 0) continue;
-            ssize_t len = rtp_socket_.recvFrom(buffer, sizeof(buffer), from_ip, from_port);
-            if (len > 0) {
-                ingestRtpPacket(buffer, static_cast<size_t>(len));
+            if (rtp_socket_.recvBatch(ingest, 200) >= 0) {
+                backoff_ms = 0;
+                continue;
             }
+            backoff_ms = backoff_ms == 0 ? 10 : std::min(backoff_ms * 2, 200);
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
         }
     }
 
@@ -377,11 +535,13 @@ private:
                     h265_fu_drop_mode_ = true;
                     h265_fu_in_progress_ = false;
                     if (h265_fu_start_offset_ <= frame_buffer_.size()) {
-                        frame_buffer_.resize(h265_fu_start_offset_);
+                        truncateFrameBuffer(h265_fu_start_offset_);
                     } else {
-                        frame_buffer_.clear();
+                        truncateFrameBuffer(0);
                     }
                 }
+                // H.264 FU 丢片：已拼装部分仍随帧输出（保持原行为），但不作为完整 NALU 提前交付
+                h264_fu_in_progress_ = false;
             }
         }
         seq_initialized_ = true;
@@ -439,8 +599,10 @@ private:
         if (is_h264) {
             uint8_t nal_type = data[0] & 0x1F;
             if (nal_type >= 1 && nal_type <= 23) {
+                const size_t nalu_offset = frame_buffer_.size();
                 appendAnnexBNalu(data, len);
                 if (nal_type == 5) frame_is_idr_ = true;
+                notifyNalu(nalu_offset, timestamp, marker);
             } else if (nal_type == 24) {
                 // STAP-A: [STAP-A hdr][nalu_size(2)][nalu]...
                 size_t off = 1;
@@ -451,9 +613,11 @@ private:
                         break;
                     }
                     uint8_t inner_type = data[off] & 0x1F;
+                    const size_t nalu_offset = frame_buffer_.size();
                     appendAnnexBNalu(data + off, nalu_size);
                     if (inner_type == 5) frame_is_idr_ = true;
                     off += nalu_size;
+                    notifyNalu(nalu_offset, timestamp, marker && off + 2 > len);
                 }
             } else if (nal_type == 25) {
                 // STAP-B: [STAP-B hdr][DON(2)][nalu_size(2)][nalu]...
@@ -466,15 +630,21 @@ private:
                         break;
                     }
                     uint8_t inner_type = data[off] & 0x1F;
+                    const size_t nalu_offset = frame_buffer_.size();
                     appendAnnexBNalu(data + off, nalu_size);
                     if (inner_type == 5) frame_is_idr_ = true;
                     off += nalu_size;
+                    notifyNalu(nalu_offset, timestamp, marker && off + 2 > len);
                 }
             } else if (nal_type == 28 && len >= 2) {
                 uint8_t fu_header = data[1];
                 bool start = (fu_header & 0x80) != 0;
+                bool end = (fu_header & 0x40) != 0;
                 uint8_t reconstructed_nal = (data[0] & 0xE0) | (fu_header & 0x1F);
                 if (start) {
+                    h264_fu_in_progress_ = true;
+                    h264_fu_start_offset_ = frame_buffer_.size();
+                    nalu_starts_.push_back(frame_buffer_.size());
                     static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
                     frame_buffer_.insert(frame_buffer_.end(), start_code, start_code + 4);
                     frame_buffer_.push_back(reconstructed_nal);
@@ -483,14 +653,20 @@ private:
                 if (len > 2) {
                     frame_buffer_.insert(frame_buffer_.end(), data + 2, data + len);
                 }
+                if (end && h264_fu_in_progress_) {
+                    h264_fu_in_progress_ = false;
+                    notifyNalu(h264_fu_start_offset_, timestamp, marker);
+                }
             }
         } else {
             // H.265
             if (len < 2) return;
             uint8_t nal_type = (data[0] >> 1) & 0x3F;
             if (nal_type != 49 && nal_type != 48 && nal_type != 50) {
+                const size_t nalu_offset = frame_buffer_.size();
                 appendAnnexBNalu(data, len);
                 if (isH265Irap(nal_type)) frame_is_idr_ = true;
+                notifyNalu(nalu_offset, timestamp, marker);
             } else if (nal_type == 48) {
                 // AP: [payload hdr(2)][nalu_size(2)][nalu]...
                 size_t off = 2;
@@ -501,9 +677,11 @@ private:
                         break;
                     }
                     uint8_t inner_type = (data[off] >> 1) & 0x3F;
+                    const size_t nalu_offset = frame_buffer_.size();
                     appendAnnexBNalu(data + off, nalu_size);
                     if (isH265Irap(inner_type)) frame_is_idr_ = true;
                     off += nalu_size;
+                    notifyNalu(nalu_offset, timestamp, marker && off + 2 > len);
                 }
             } else if (nal_type == 49 && len >= 3) {
                 uint8_t fu_indicator0 = data[0];
@@ -518,6 +696,7 @@ private:
                     h265_fu_drop_mode_ = false;
                     h265_fu_in_progress_ = true;
                     h265_fu_start_offset_ = frame_buffer_.size();
+                    nalu_starts_.push_back(frame_buffer_.size());
                     static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
                     frame_buffer_.insert(frame_buffer_.end(), start_code, start_code + 4);
                     frame_buffer_.push_back(orig0);
@@ -531,6 +710,7 @@ private:
                 }
                 if (end && h265_fu_in_progress_) {
                     h265_fu_in_progress_ = false;
+                    notifyNalu(h265_fu_start_offset_, timestamp, marker);
                 }
             }
         }
@@ -554,6 +734,8 @@ private:
     std::atomic<bool> running_{false};
     std::thread receive_thread_;
     FrameCallback callback_;
+    NaluCallback nalu_callback_;
+    int nalu_stream_index_ = 0;
 
     CodecType codec_ = CodecType::H264;
     uint8_t payload_type_ = 96;
@@ -562,7 +744,15 @@ private:
     uint32_t fps_ = 30;
 
     std::vector<uint8_t> frame_buffer_;
+    std::vector<size_t> nalu_starts_;          // 本帧各 NALU 的 4 字节前缀在 frame_buffer_ 中的偏移
+    FrameFormat output_format_ = FrameFormat::AnnexB;
+    uint32_t output_padding_ = 0;
+    uint32_t output_alignment_ = 0;
+    std::vector<uint8_t> inband_parameter_sets_;   // 带起始码的 VPS/SPS/PPS
+    std::vector<size_t> inband_parameter_set_starts_;
+    bool first_idr_seen_ = false;
     uint32_t frame_ts_ = 0;
+    RtpTimestampUnwrapper timestamp_unwrapper_;   // 32 位 RTP 时间戳回绕后 pts 继续递增
     bool frame_in_progress_ = false;
     bool frame_is_idr_ = false;
     bool seq_initialized_ = false;
@@ -570,6 +760,10 @@ private:
     bool h265_fu_in_progress_ = false;
     bool h265_fu_drop_mode_ = false;
     size_t h265_fu_start_offset_ = 0;
+    bool h264_fu_in_progress_ = false;
+    size_t h264_fu_start_offset_ = 0;
+    bool nalu_au_open_ = false;
+    uint32_t nalu_au_ts_ = 0;
     uint32_t jitter_buffer_packets_ = 32;
     std::map<uint16_t, std::vector<uint8_t>> reorder_buffer_;
     bool reorder_initialized_ = false;
@@ -578,6 +772,7 @@ private:
     std::atomic<uint64_t> packets_reordered_{0};
     std::atomic<uint64_t> packet_loss_events_{0};
     std::atomic<uint64_t> frames_output_{0};
+    std::atomic<uint64_t> rtcp_packets_received_{0};
 };
 
 // RtspClient::Impl 定义
@@ -595,7 +790,17 @@ public:
 
     RtspClientConfig config_;
     std::unique_ptr<Socket> control_socket_;
-    std::unique_ptr<RtpReceiver> rtp_receiver_;
+
+    // 一个 RTSP 会话内已 SETUP 的轨道（按 SETUP 顺序）。
+    // TCP 下各轨使用各自的 interleaved 通道对，共用控制连接与同一接收线程。
+    struct Track {
+        int stream_index = 0;
+        std::unique_ptr<RtpReceiver> receiver;
+        uint8_t rtp_channel = 0;
+        uint8_t rtcp_channel = 1;
+        std::string control_url;
+    };
+    std::vector<Track> tracks_;
     
     std::string server_url_;
     std::string request_url_;
@@ -615,8 +820,6 @@ public:
     std::string digest_qop_;
     uint32_t digest_nc_ = 0;
     bool use_tcp_transport_ = false;
-    uint8_t interleaved_rtp_channel_ = 0;
-    uint8_t interleaved_rtcp_channel_ = 1;
 
     SessionInfo session_info_;
     int cseq_ = 0;
@@ -628,14 +831,28 @@ public:
     std::atomic<ClientState> state_{ClientState::Idle};
     std::thread tcp_receive_thread_;
     std::atomic<bool> tcp_receive_running_{false};
+    // TCP 接收线程运行期间由它独占读控制连接：夹在 $ 包之间的 RTSP 响应（保活等）
+    // 拆出后放入这里，由发请求的线程按 CSeq 取走
+    std::mutex response_mutex_;
+    std::condition_variable response_cv_;
+    std::deque<std::string> demuxed_responses_;
+    // 读响应时越过响应末尾的字节（PLAY 响应后紧跟的 $ 包），TCP 接收线程启动时先处理它们
+    std::string control_excess_;
     std::atomic<uint64_t> auth_retries_{0};
+    std::atomic<uint64_t> redirects_followed_{0};
     
     FrameCallback frame_callback_;
+    TrackFrameCallback track_frame_callback_;
+    NaluCallback nalu_callback_;
     ErrorCallback error_callback_;
     
     std::queue<VideoFrame> frame_queue_;
     std::mutex queue_mutex_;
     std::condition_variable queue_cv_;
+    // 开启 playout_scheduler 时第一条轨道的帧先经它按呈现时刻释放，再进队列 / FrameCallback
+    std::unique_ptr<PlayoutScheduler> playout_;
+    // 在释放回调里重新 PLAY 时换下的旧调度器：其线程正在回调栈上，留到之后在别的线程析构（join）
+    std::unique_ptr<PlayoutScheduler> retired_playout_;
 
     bool isClosing() const {
         return state_.load() == ClientState::Closing;
@@ -699,13 +916,80 @@ public:
 
         request_url_ = "rtsp://" + server_host_ + ":" + std::to_string(server_port_) + server_path_;
         server_url_ = request_url_;
+        updateBasicAuthHeader();
+        
+        return true;
+    }
+
+    void updateBasicAuthHeader() {
         if (!auth_user_.empty()) {
             std::string token = auth_user_ + ":" + auth_pass_;
             basic_auth_header_ = "Basic " + base64Encode(reinterpret_cast<const uint8_t*>(token.data()), token.size());
         } else {
             basic_auth_header_.clear();
         }
-        
+    }
+
+    // 3xx 且带 Location 时返回状态码，否则返回 0
+    static int redirectStatus(const std::string& response, std::string& location) {
+        int status = 0;
+        if (response.compare(0, 5, "RTSP/") != 0 || std::sscanf(response.c_str(), "RTSP/%*s %d", &status) != 1) {
+            return 0;
+        }
+        if (status != 301 && status != 302 && status != 303 && status != 305 && status != 307) {
+            return 0;
+        }
+        const size_t header_end = response.find("\r\n\r\n");
+        std::string headers_lc = response.substr(0, header_end);
+        for (auto& c : headers_lc) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        size_t p = headers_lc.find("\r\nlocation:");
+        if (p == std::string::npos) {
+            return 0;
+        }
+        p += 11;
+        while (p < response.size() && (response[p] == ' ' || response[p] == '\t')) ++p;
+        const size_t end = response.find("\r\n", p);
+        location = response.substr(p, end == std::string::npos ? std::string::npos : end - p);
+        while (!location.empty() && std::isspace(static_cast<unsigned char>(location.back()))) location.pop_back();
+        return location.empty() ? 0 : status;
+    }
+
+    // 改连重定向目标（305：连代理，请求 URL 不变）。原凭据只在主机和端口都不变时沿用；
+    // 换了目标时只用 Location 自带的 userinfo，不把凭据发给别的主机
+    bool followRedirect(int status, const std::string& location) {
+        const std::string request_url = request_url_;
+        const std::string server_url = server_url_;
+        const std::string server_path = server_path_;
+        const std::string host = server_host_;
+        const uint16_t port = server_port_;
+        std::string user;
+        std::string pass;
+        user.swap(auth_user_);
+        pass.swap(auth_pass_);
+        if (!parseUrl(location)) {
+            return false;
+        }
+        if (auth_user_.empty() && server_host_ == host && server_port_ == port) {
+            auth_user_.swap(user);
+            auth_pass_.swap(pass);
+            updateBasicAuthHeader();
+        }
+        if (status == 305) {
+            request_url_ = request_url;
+            server_url_ = server_url;
+            server_path_ = server_path;
+        }
+        content_base_.clear();
+        use_digest_auth_ = false;
+        control_socket_->shutdownReadWrite();
+        control_socket_->close();
+        control_socket_ = std::make_unique<Socket>();
+        control_excess_.clear();
+        if (!control_socket_->connect(server_host_, server_port_, 10000)) {
+            return false;
+        }
+        redirects_followed_++;
+        RTSP_LOG_INFO("RTSP redirect " + std::to_string(status) + " -> " + location);
         return true;
     }
 
@@ -733,51 +1017,131 @@ public:
         return joinThreadWithTimeout(tcp_receive_thread_, timeout_ms);
     }
 
-    bool recvExact(uint8_t* out, size_t n, int timeout_ms) {
-        size_t off = 0;
-        while (off < n && tcp_receive_running_) {
-            ssize_t r = control_socket_->recv(out + off, n - off, timeout_ms);
-            if (r > 0) {
-                off += static_cast<size_t>(r);
-            } else if (r == 0) {
-                // Peer closed.
-                return false;
-            } else {
-                // Timeout or transient error.
-                continue;
-            }
-        }
-        return off == n;
-    }
-
+    // 控制连接上的 interleaved 流解复用：大块读入同一缓冲，就地拆出 $ 包（RTP/RTCP 通道直接
+    // 以缓冲内指针交给接收器，不复制）与 RTSP 消息（响应交给等待的请求，服务端请求忽略）
     void tcpReceiveLoop() {
+        constexpr size_t kReadBufferSize = 256 * 1024;   // 至少容纳一个最大 $ 包（4 + 65535）
+        constexpr size_t kMaxRtspMessage = 64 * 1024;
+        std::vector<uint8_t> buffer(kReadBufferSize);
+        size_t begin = 0;
+        size_t end = control_excess_.size();
+        memcpy(buffer.data(), control_excess_.data(), end);
+        control_excess_.clear();
+        bool pending = end > 0;   // 先处理读 PLAY 响应时多读的字节
         while (tcp_receive_running_) {
-            uint8_t b = 0;
-            if (!recvExact(&b, 1, 200)) {
-                continue;
+            if (!pending) {
+                if (end == buffer.size()) {
+                    memmove(buffer.data(), buffer.data() + begin, end - begin);
+                    end -= begin;
+                    begin = 0;
+                }
+                const ssize_t n = control_socket_->recv(buffer.data() + end, buffer.size() - end, 200);
+                if (n == 0) {
+                    break;  // 对端关闭
+                }
+                if (n < 0) {
+                    continue;  // 超时或瞬时错误
+                }
+                end += static_cast<size_t>(n);
             }
-            if (b != '$') {
-                continue;
+            pending = false;
+
+            while (begin < end) {
+                const uint8_t* p = buffer.data() + begin;
+                const size_t avail = end - begin;
+                if (p[0] == '$') {
+                    if (avail < 4) {
+                        break;
+                    }
+                    const size_t len = (static_cast<size_t>(p[2]) << 8) | p[3];
+                    if (avail < 4 + len) {
+                        break;
+                    }
+                    dispatchInterleaved(p[1], p + 4, len);
+                    begin += 4 + len;
+                    continue;
+                }
+
+                const std::string text(reinterpret_cast<const char*>(p), std::min(avail, kMaxRtspMessage));
+                const size_t header_end = text.find("\r\n\r\n");
+                if (header_end == std::string::npos) {
+                    if (avail >= kMaxRtspMessage) {
+                        // 既不是 $ 包也不是完整的 RTSP 消息：丢到下一个 $ 重新同步
+                        const void* next = memchr(p + 1, '$', avail - 1);
+                        begin = next ? static_cast<size_t>(static_cast<const uint8_t*>(next) - buffer.data()) : end;
+                        continue;
+                    }
+                    break;
+                }
+                size_t content_length = 0;
+                parseContentLength(text.substr(0, header_end + 4), &content_length);
+                const size_t total = header_end + 4 + content_length;
+                if (total > kMaxRtspMessage) {
+                    begin += header_end + 4;
+                    continue;
+                }
+                if (avail < total) {
+                    break;
+                }
+                if (text.compare(0, 5, "RTSP/") == 0) {
+                    std::lock_guard<std::mutex> lock(response_mutex_);
+                    demuxed_responses_.push_back(text.substr(0, total));
+                    response_cv_.notify_all();
+                }
+                begin += total;
             }
-            uint8_t hdr[3];
-            if (!recvExact(hdr, 3, 200)) {
-                continue;
+            if (begin == end) {
+                begin = 0;
+                end = 0;
             }
-            uint8_t channel = hdr[0];
-            uint16_t size = static_cast<uint16_t>((hdr[1] << 8) | hdr[2]);
-            if (size == 0) {
-                continue;
+        }
+        tcp_receive_running_ = false;
+        response_cv_.notify_all();
+    }
+
+    void dispatchInterleaved(uint8_t channel, const uint8_t* data, size_t len) {
+        for (auto& track : tracks_) {
+            if (channel == track.rtp_channel) {
+                track.receiver->ingestRtpPacket(data, len);
+                return;
             }
-            std::vector<uint8_t> payload(size);
-            if (!recvExact(payload.data(), payload.size(), 200)) {
-                continue;
+            if (channel == track.rtcp_channel) {
+                track.receiver->ingestRtcpPacket(data, len);
+                return;
             }
-            if (channel == interleaved_rtp_channel_ && rtp_receiver_) {
-                rtp_receiver_->ingestRtpPacket(payload.data(), payload.size());
+        }
+    }
+
+    // 等待 TCP 接收线程拆出 CSeq 匹配的响应；较早请求迟到的响应直接丢弃
+    bool waitDemuxedResponse(int cseq, std::string* response, int timeout_ms) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(0, timeout_ms));
+        std::unique_lock<std::mutex> lock(response_mutex_);
+        while (true) {
+            while (!demuxed_responses_.empty()) {
+                std::string candidate = std::move(demuxed_responses_.front());
+                demuxed_responses_.pop_front();
+                if (responseCSeq(candidate) == cseq) {
+                    *response = std::move(candidate);
+                    return true;
+                }
+            }
+            if (!tcp_receive_running_ ||
+                response_cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+                return false;
             }
         }
     }
 
+    static int responseCSeq(const std::string& response) {
+        static const std::regex cseq_re("CSeq\\s*:\\s*(\\d+)", std::regex::icase);
+        std::smatch m;
+        uint32_t value = 0;
+        if (!std::regex_search(response, m, cseq_re) || !parseUint32Safe(m[1].str(), value)) {
+            return -1;
+        }
+        return static_cast<int>(value);
+    }
+
     bool parseSdp(const std::string& sdp) {
         session_info_.media_streams.clear();
         
@@ -807,6 +1171,16 @@ public:
                 // When another media section starts (e.g. audio), stop mutating video fields.
                 current_media = nullptr;
             }
+            else if (line.rfind("a=range:npt=", 0) == 0) {
+                // 点播源的时长：a=range:npt=0-12.345（直播为 "0-" 或缺省）
+                const size_t dash = line.find('-', 12);
+                if (dash != std::string::npos && dash + 1 < line.size()) {
+                    const double end_s = std::strtod(line.c_str() + dash + 1, nullptr);
+                    if (end_s > 0.0) {
+                        session_info_.duration_ms = static_cast<uint64_t>(end_s * 1000.0 + 0.5);
+                    }
+                }
+            }
             else if (line.find("a=rtpmap:") == 0 && current_media) {
                 // static const 避免每次构造触发 libstdc++ ctype narrow 缓存竞争
                 static const std::regex rtpmap_regex("a=rtpmap:(\\d+)\\s+(\\w+)/(\\d+)");
@@ -860,7 +1234,7 @@ public:
                     try {
                         double fps_d = std::stod(match[1]);
                         if (fps_d > 0 && fps_d < 1e6) {
-                            current_media->fps = static_cast<uint32_t>(fps_d);
+                            current_media->fps = static_cast<uint32_t>(fps_d + 0.5);   // 29.97 -> 30
                         }
                     } catch (...) {
                         // 忽略畸形帧率字符串
@@ -894,6 +1268,16 @@ public:
         }
 
         for (auto& media : session_info_.media_streams) {
+            // sprop 中的 SPS 比 a=framesize / a=framerate 可靠：有则以其分辨率、VUI 帧率与 profile/level 为准
+            SpsInfo sps_info;
+            if (!media.sps.empty() && parseSps(media.codec, media.sps.data(), media.sps.size(), sps_info)) {
+                media.width = sps_info.width;
+                media.height = sps_info.height;
+                if (sps_info.fps > 0) media.fps = sps_info.fps;
+                media.profile_idc = sps_info.profile_idc;
+                media.level_idc = sps_info.level_idc;
+                media.high_tier = sps_info.high_tier;
+            }
             if (media.width == 0) media.width = 1920;
             if (media.height == 0) media.height = 1080;
             if (media.fps == 0) media.fps = 30;
@@ -929,7 +1313,11 @@ public:
             if (control_socket_->send((const uint8_t*)req_str.c_str(), req_str.size()) <= 0) {
                 return false;
             }
-            return recvRtspResponse(control_socket_.get(), &response, recv_timeout_ms);
+            // RTP over TCP 播放中，控制连接由接收线程读取
+            if (tcp_receive_running_) {
+                return waitDemuxedResponse(cseq_, &response, recv_timeout_ms);
+            }
+            return recvRtspResponse(control_socket_.get(), &response, recv_timeout_ms, &control_excess_);
         };
 
         if (!send_once(true)) return false;
@@ -1052,7 +1440,75 @@ public:
         return out.str();
     }
 
+    Track* findTrack(int stream_index) {
+        for (auto& track : tracks_) {
+            if (track.stream_index == stream_index) {
+                return &track;
+            }
+        }
+        return nullptr;
+    }
+
+    void startReceivers() {
+        if (tracks_.empty() || receiver_started_) {
+            return;
+        }
+        if (playout_ && playout_->onSchedulerThread()) {
+            retired_playout_ = std::move(playout_);
+        } else if (retired_playout_ && !retired_playout_->onSchedulerThread()) {
+            retired_playout_.reset();
+        }
+        if (config_.playout_scheduler) {
+            // 接收线程尚未启动，旧调度器（已 stop）此时可以安全替换
+            PlayoutConfig playout_config;
+            playout_config.min_delay_ms = config_.playout_min_delay_ms;
+            playout_config.max_delay_ms = std::max(config_.playout_min_delay_ms, config_.playout_max_delay_ms);
+            playout_config.percentile = config_.playout_jitter_percentile;
+            playout_config.late_drop_ms = config_.playout_late_drop_ms;
+            playout_.reset(new PlayoutScheduler(playout_config, [this](const VideoFrame& frame) {
+                deliverFrame(frame);
+            }));
+        }
+        if (use_tcp_transport_) {
+            tcp_receive_running_ = true;
+            tcp_receive_thread_ = startThread(ThreadRole::MediaReceive, "rtsp-tcp-recv", [this]() {
+                tcpReceiveLoop();
+            });
+        } else {
+            for (auto& track : tracks_) {
+                track.receiver->start();
+            }
+        }
+        receiver_started_ = true;
+    }
+
+    void onTrackFrame(int stream_index, const VideoFrame& frame) {
+        if (track_frame_callback_) {
+            track_frame_callback_(stream_index, frame);
+        }
+        // 兼容单流接口：队列与 FrameCallback 只接收第一个 SETUP 的轨道
+        if (!tracks_.empty() && tracks_.front().stream_index == stream_index) {
+            onFrame(frame);
+        }
+    }
+
     void onFrame(const VideoFrame& frame) {
+        if (playout_) {
+            const int64_t arrival_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            playout_->push(shareFrameManaged(frame), arrival_us);
+            return;
+        }
+        deliverFrame(frame);
+    }
+
+    void stopPlayout() {
+        if (playout_) {
+            playout_->stop();
+        }
+    }
+
+    void deliverFrame(const VideoFrame& frame) {
         {
             std::lock_guard<std::mutex> lock(queue_mutex_);
             if (frame_queue_.size() >= config_.buffer_size) {
@@ -1061,7 +1517,7 @@ public:
                 frame_queue_.pop();
             }
             
-            VideoFrame copy = cloneFrameManaged(frame);
+            VideoFrame copy = shareFrameManaged(frame);
             frame_queue_.push(copy);
         }
         queue_cv_.notify_one();
@@ -1096,6 +1552,7 @@ bool RtspClient::open(const std::string& url) {
     }
 
     impl_->control_socket_ = std::make_unique<Socket>();
+    impl_->control_excess_.clear();
     if (!impl_->control_socket_->connect(impl_->server_host_, impl_->server_port_, 10000)) {
         return false;
     }
@@ -1110,9 +1567,19 @@ bool RtspClient::describe() {
     if (impl_->isClosing()) return false;
     if (!impl_->connected_) return false;
     std::string response;
-    if (!impl_->sendRequest("DESCRIBE", impl_->request_url_,
-                            "Accept: application/sdp\r\n", "", response)) {
-        return false;
+    for (uint32_t hops = 0;; ++hops) {
+        if (!impl_->sendRequest("DESCRIBE", impl_->request_url_,
+                                "Accept: application/sdp\r\n", "", response)) {
+            return false;
+        }
+        std::string location;
+        const int status = impl_->redirectStatus(response, location);
+        if (status == 0) {
+            break;
+        }
+        if (hops >= impl_->config_.max_redirects || !impl_->followRedirect(status, location)) {
+            return false;
+        }
     }
 
     if (response.find("200 OK") == std::string::npos) {
@@ -1164,6 +1631,14 @@ void RtspClient::setFrameCallback(FrameCallback callback) {
     impl_->frame_callback_ = callback;
 }
 
+void RtspClient::setTrackFrameCallback(TrackFrameCallback callback) {
+    impl_->track_frame_callback_ = callback;
+}
+
+void RtspClient::setNaluCallback(NaluCallback callback) {
+    impl_->nalu_callback_ = callback;
+}
+
 void RtspClient::setErrorCallback(ErrorCallback callback) {
     impl_->error_callback_ = callback;
 }
@@ -1209,11 +1684,23 @@ bool RtspClient::setup(int stream_index) {
             }
         }
     }
+    // 上一会话（TEARDOWN/close 后）遗留的轨道在新会话开始时回收
+    if (impl_->session_id_.empty() && !impl_->receiver_started_) {
+        impl_->tracks_.clear();
+    }
+    // 同一会话内追加轨道：沿用首轨的传输方式，TCP 通道对按轨道序号递增
+    const bool joining_session = !impl_->tracks_.empty();
+    if (impl_->findTrack(stream_index) != nullptr) {
+        return true;
+    }
+    const uint8_t channel_base = static_cast<uint8_t>(impl_->tracks_.size() * 2);
+    std::unique_ptr<RtpReceiver> receiver;
+
     auto do_setup = [&](bool use_tcp, std::string& response_out) -> bool {
         uint16_t selected_rtp_port = 0;
         if (use_tcp) {
-            impl_->rtp_receiver_ = std::make_unique<RtpReceiver>();
-            impl_->rtp_receiver_->setJitterBufferPackets(impl_->config_.jitter_buffer_packets);
+            receiver = std::make_unique<RtpReceiver>();
+            receiver->setJitterBufferPackets(impl_->config_.jitter_buffer_packets);
         } else {
             bool bound = false;
             uint32_t start = impl_->config_.rtp_port_start;
@@ -1226,7 +1713,7 @@ bool RtspClient::setup(int stream_index) {
                 candidate->setJitterBufferPackets(impl_->config_.jitter_buffer_packets);
                 if (candidate->init(static_cast<uint16_t>(p), static_cast<uint16_t>(p + 1))) {
                     selected_rtp_port = static_cast<uint16_t>(p);
-                    impl_->rtp_receiver_ = std::move(candidate);
+                    receiver = std::move(candidate);
                     bound = true;
                     break;
                 }
@@ -1239,11 +1726,15 @@ bool RtspClient::setup(int stream_index) {
         std::ostringstream request;
         request.clear();
         if (use_tcp) {
-            request << "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n";
+            request << "Transport: RTP/AVP/TCP;unicast;interleaved="
+                    << static_cast<int>(channel_base) << "-" << static_cast<int>(channel_base + 1) << "\r\n";
         } else {
             request << "Transport: RTP/AVP;unicast;client_port="
                     << selected_rtp_port << "-" << (selected_rtp_port + 1) << "\r\n";
         }
+        if (joining_session && !impl_->session_id_.empty()) {
+            request << "Session: " << impl_->session_id_ << "\r\n";
+        }
         if (!impl_->sendRequest("SETUP", control_url, request.str(), "", response_out)) {
             return false;
         }
@@ -1254,9 +1745,9 @@ bool RtspClient::setup(int stream_index) {
     };
 
     std::string response;
-    bool use_tcp = impl_->config_.prefer_tcp_transport;
+    bool use_tcp = joining_session ? impl_->use_tcp_transport_ : impl_->config_.prefer_tcp_transport;
     bool ok = do_setup(use_tcp, response);
-    if (!ok && impl_->config_.fallback_to_tcp) {
+    if (!ok && impl_->config_.fallback_to_tcp && !joining_session) {
         const bool udp_can_fallback = response.empty() ||
             responseHasStatusCode(response, 400) ||
             responseHasStatusCode(response, 461) ||
@@ -1280,29 +1771,57 @@ bool RtspClient::setup(int stream_index) {
     if (std::regex_search(response, match, session_regex)) {
         impl_->session_id_ = match[1];
     }
+    Impl::Track track;
+    track.stream_index = stream_index;
+    track.rtp_channel = channel_base;
+    track.rtcp_channel = static_cast<uint8_t>(channel_base + 1);
+    track.control_url = control_url;
     if (impl_->use_tcp_transport_) {
         static const std::regex interleaved_regex("interleaved=(\\d+)-(\\d+)", std::regex::icase);
         std::smatch tm;
         if (std::regex_search(response, tm, interleaved_regex)) {
             uint32_t rtp_ch = 0, rtcp_ch = 0;
             if (parseUint32Safe(tm[1].str(), rtp_ch) && rtp_ch <= 255) {
-                impl_->interleaved_rtp_channel_ = static_cast<uint8_t>(rtp_ch);
+                track.rtp_channel = static_cast<uint8_t>(rtp_ch);
             }
             if (parseUint32Safe(tm[2].str(), rtcp_ch) && rtcp_ch <= 255) {
-                impl_->interleaved_rtcp_channel_ = static_cast<uint8_t>(rtcp_ch);
+                track.rtcp_channel = static_cast<uint8_t>(rtcp_ch);
             }
         }
     }
-    impl_->rtp_receiver_->setVideoInfo(media.codec, media.width, media.height, media.fps, static_cast<uint8_t>(media.payload_type));
-    impl_->rtp_receiver_->setCallback([this](const VideoFrame& frame) {
-        impl_->onFrame(frame);
+    receiver->setVideoInfo(media.codec, media.width, media.height, media.fps, static_cast<uint8_t>(media.payload_type));
+    receiver->setOutputFormat(impl_->config_.output_format, impl_->config_.output_padding,
+                              impl_->config_.output_alignment);
+    if (impl_->config_.inject_parameter_sets) {
+        receiver->setParameterSets(media.codec == CodecType::H265 ? media.vps : std::vector<uint8_t>(),
+                                   media.sps, media.pps);
+    }
+    receiver->setCallback([this, stream_index](const VideoFrame& frame) {
+        impl_->onTrackFrame(stream_index, frame);
     });
-    impl_->setup_control_url_ = control_url;
+    if (impl_->nalu_callback_) {
+        receiver->setNaluCallback(stream_index, impl_->nalu_callback_);
+    }
+    track.receiver = std::move(receiver);
+    impl_->tracks_.push_back(std::move(track));
+    if (!joining_session) {
+        impl_->setup_control_url_ = control_url;
+    }
 
     impl_->setState(Impl::ClientState::Setup);
     return true;
 }
 
+bool RtspClient::setupAll() {
+    if (impl_->session_info_.media_streams.empty()) return false;
+    for (size_t i = 0; i < impl_->session_info_.media_streams.size(); ++i) {
+        if (!setup(static_cast<int>(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool RtspClient::play(uint64_t start_time_ms) {
     if (impl_->isClosing()) return false;
     if (!impl_->connected_ || impl_->session_id_.empty()) return false;
@@ -1331,17 +1850,7 @@ bool RtspClient::play(uint64_t start_time_ms) {
     impl_->playing_ = true;
     impl_->stop_waiting_ = false;
     impl_->setState(Impl::ClientState::Playing);
-    if (impl_->rtp_receiver_ && !impl_->receiver_started_) {
-        if (impl_->use_tcp_transport_) {
-            impl_->tcp_receive_running_ = true;
-            impl_->tcp_receive_thread_ = std::thread([this]() {
-                impl_->tcpReceiveLoop();
-            });
-        } else {
-            impl_->rtp_receiver_->start();
-        }
-        impl_->receiver_started_ = true;
-    }
+    impl_->startReceivers();
     return true;
 }
 
@@ -1361,12 +1870,10 @@ bool RtspClient::pause() {
     std::string response;
     bool ok = impl_->sendRequest("PAUSE", impl_->request_url_, extra.str(), "", response);
     
+    // UDP 接收器保持运行：stop() 会关闭 SETUP 协商的端口，恢复播放时服务端
+    // 紧随 PLAY 响应发出的包会在重新绑定前丢失
     impl_->playing_ = false;
     impl_->wakeFrameWaiters();
-    if (!impl_->use_tcp_transport_ && impl_->rtp_receiver_ && impl_->receiver_started_) {
-        impl_->rtp_receiver_->stop();
-        impl_->receiver_started_ = false;
-    }
     if (ok && response.find("200 OK") != std::string::npos) {
         impl_->setState(Impl::ClientState::Setup);
         return true;
@@ -1395,21 +1902,22 @@ bool RtspClient::teardown() {
     impl_->session_id_.clear();
     impl_->setup_control_url_.clear();
     
-    if (impl_->rtp_receiver_) {
-        impl_->rtp_receiver_->stop();
-        impl_->receiver_started_ = false;
+    for (auto& track : impl_->tracks_) {
+        track.receiver->stop();
     }
+    impl_->stopPlayout();
+    impl_->tracks_.clear();
+    impl_->receiver_started_ = false;
     impl_->setState(Impl::ClientState::Opened);
     return true;
 }
 
 void RtspClient::receiveLoop() {
+    // 帧经回调送出，这里只等待停止；队列非空不算唤醒条件（否则持锁空转，收帧线程拿不到锁）
     std::unique_lock<std::mutex> lock(impl_->queue_mutex_);
-    while (!impl_->stop_waiting_ && impl_->playing_) {
-        impl_->queue_cv_.wait(lock, [this] {
-            return impl_->stop_waiting_ || !impl_->playing_ || !impl_->frame_queue_.empty();
-        });
-    }
+    impl_->queue_cv_.wait(lock, [this] {
+        return impl_->stop_waiting_ || !impl_->playing_;
+    });
 }
 
 bool RtspClient::receiveFrame(VideoFrame& frame, int timeout_ms) {
@@ -1476,9 +1984,9 @@ bool RtspClient::closeWithTimeout(uint32_t timeout_ms) {
         impl_->receiver_started_ = false;
     }
 
-    if (impl_->rtp_receiver_) {
+    for (auto& track : impl_->tracks_) {
         auto t0 = std::chrono::steady_clock::now();
-        if (!impl_->rtp_receiver_->stopWithTimeout(remain_ms())) {
+        if (!track.receiver->stopWithTimeout(remain_ms())) {
             ok = false;
             RTSP_LOG_ERROR("RtspClient close timeout: rtp_receive_thread still alive (blocking: udp recvFrom)");
         } else {
@@ -1499,6 +2007,7 @@ bool RtspClient::closeWithTimeout(uint32_t timeout_ms) {
     impl_->stop_waiting_ = true;
     impl_->session_id_.clear();
     impl_->setup_control_url_.clear();
+    impl_->stopPlayout();
     {
         std::lock_guard<std::mutex> lock(impl_->queue_mutex_);
         while (!impl_->frame_queue_.empty()) {
@@ -1530,40 +2039,36 @@ bool RtspClient::sendOptions() {
 bool RtspClient::sendGetParameter(const std::string& param) {
     if (impl_->isClosing()) return false;
     if (!impl_->connected_ || impl_->session_id_.empty()) return false;
-    bool restart_tcp_receiver = false;
-    if (impl_->use_tcp_transport_ && impl_->receiver_started_) {
-        if (!impl_->stopTcpReceiverThread(1000, false)) {
-            RTSP_LOG_ERROR("GET_PARAMETER timeout: tcp_receive_thread still alive");
-        }
-        impl_->receiver_started_ = false;
-        restart_tcp_receiver = impl_->playing_;
-    }
 
+    // RTP over TCP 播放中不停接收线程：响应由它从 interleaved 流中拆出
     std::ostringstream extra;
     extra << "Session: " << impl_->session_id_ << "\r\n";
     extra << "Content-Type: text/parameters\r\n";
     std::string response;
     bool ok = impl_->sendRequest("GET_PARAMETER", impl_->request_url_, extra.str(), param, response);
-    if (restart_tcp_receiver && impl_->rtp_receiver_) {
-        impl_->tcp_receive_running_ = true;
-        impl_->tcp_receive_thread_ = std::thread([this]() {
-            impl_->tcpReceiveLoop();
-        });
-        impl_->receiver_started_ = true;
-    }
     return ok && response.find("200 OK") != std::string::npos;
 }
 
 RtspClientStats RtspClient::getStats() const {
     RtspClientStats s;
     s.auth_retries = impl_->auth_retries_.load();
+    s.redirects_followed = impl_->redirects_followed_.load();
     s.using_tcp_transport = impl_->use_tcp_transport_;
-    if (impl_->rtp_receiver_) {
-        auto rs = impl_->rtp_receiver_->getStats();
-        s.rtp_packets_received = rs.packets_received;
-        s.rtp_packets_reordered = rs.packets_reordered;
-        s.rtp_packet_loss_events = rs.packet_loss_events;
-        s.frames_output = rs.frames_output;
+    for (const auto& track : impl_->tracks_) {
+        auto rs = track.receiver->getStats();
+        s.rtp_packets_received += rs.packets_received;
+        s.rtp_packets_reordered += rs.packets_reordered;
+        s.rtp_packet_loss_events += rs.packet_loss_events;
+        s.frames_output += rs.frames_output;
+        s.rtcp_packets_received += rs.rtcp_packets_received;
+    }
+    if (impl_->playout_) {
+        const PlayoutStats ps = impl_->playout_->stats();
+        s.playout_frames_released = ps.frames_released;
+        s.playout_frames_late = ps.frames_late;
+        s.playout_frames_dropped = ps.frames_dropped;
+        s.playout_target_delay_ms = ps.target_delay_ms;
+        s.playout_jitter_ms = ps.jitter_ms;
     }
     return s;
 }
@@ -1583,8 +2088,18 @@ void SimpleRtspPlayer::setErrorCallback(ErrorCallback callback) {
     error_callback_ = callback;
 }
 
+void SimpleRtspPlayer::setBufferMode(PlayerBufferMode mode) {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    buffer_mode_ = mode;
+}
+
 bool SimpleRtspPlayer::open(const std::string& url) {
     client_ = std::make_unique<RtspClient>();
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        waiting_for_idr_ = true;
+        stats_ = SimplePlayerStats();
+    }
     
     // 设置错误回调
     if (error_callback_) {
@@ -1622,16 +2137,13 @@ bool SimpleRtspPlayer::open(const std::string& url) {
         // 2. 同时缓存到内部缓冲区，供 readFrame() 使用
         {
             std::lock_guard<std::mutex> lock(buffer_mutex_);
-            if (frame_buffer_.size() < MAX_BUFFER_SIZE) {
-                VideoFrame copy = cloneFrameManaged(frame);
-                frame_buffer_.push_back(copy);
-            }
+            bufferFrame(frame);
             buffer_cv_.notify_one();
         }
     });
 
     running_ = true;
-    receive_thread_ = std::thread([this]() {
+    receive_thread_ = startThread(ThreadRole::MediaReceive, "rtsp-player", [this]() {
         if (!client_->play(0)) {
             if (error_callback_) {
                 error_callback_("PLAY failed");
@@ -1647,6 +2159,42 @@ bool SimpleRtspPlayer::open(const std::string& url) {
     return true;
 }
 
+void SimpleRtspPlayer::bufferFrame(const VideoFrame& frame) {
+    stats_.frames_received++;
+    if (buffer_mode_ == PlayerBufferMode::Queue) {
+        if (frame_buffer_.size() < MAX_BUFFER_SIZE) {
+            frame_buffer_.push_back(shareFrameManaged(frame));
+        } else {
+            stats_.frames_skipped++;
+        }
+        return;
+    }
+
+    // Mailbox：缓存里始终是"最近的 IDR + 其后的依赖帧"中尚未读取的部分
+    if (frame.type == FrameType::IDR) {
+        dropBufferedFrames();
+        waiting_for_idr_ = false;
+    } else if (waiting_for_idr_) {
+        stats_.frames_skipped++;
+        return;
+    } else if (frame_buffer_.size() >= MAX_BUFFER_SIZE) {
+        // 读取落后超过一个缓存且迟迟没有新 IDR：中间不能挑着丢，整段丢弃等下一个 IDR
+        dropBufferedFrames();
+        stats_.frames_skipped++;
+        waiting_for_idr_ = true;
+        return;
+    }
+    frame_buffer_.push_back(shareFrameManaged(frame));
+}
+
+void SimpleRtspPlayer::dropBufferedFrames() {
+    stats_.frames_skipped += frame_buffer_.size();
+    for (auto& f : frame_buffer_) {
+        releaseFrameData(f);
+    }
+    frame_buffer_.clear();
+}
+
 bool SimpleRtspPlayer::readFrame(VideoFrame& frame) {
     std::unique_lock<std::mutex> lock(buffer_mutex_);
     
@@ -1656,11 +2204,33 @@ bool SimpleRtspPlayer::readFrame(VideoFrame& frame) {
     
     if (frame_buffer_.empty()) return false;
     
-    frame = frame_buffer_.front();
-    frame_buffer_.erase(frame_buffer_.begin());
+    frame = std::move(frame_buffer_.front());
+    frame_buffer_.pop_front();
+    stats_.frames_read++;
     return true;
 }
 
+bool SimpleRtspPlayer::readLatestFrame(VideoFrame& frame, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+    if (buffer_mode_ != PlayerBufferMode::Mailbox) {
+        return false;
+    }
+    if (!buffer_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                             [this] { return !frame_buffer_.empty() || !running_; }) ||
+        frame_buffer_.empty()) {
+        return false;
+    }
+    frame = std::move(frame_buffer_.front());
+    frame_buffer_.pop_front();
+    stats_.frames_read++;
+    return true;
+}
+
+SimplePlayerStats SimpleRtspPlayer::getStats() const {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    return stats_;
+}
+
 void SimpleRtspPlayer::close() {
     (void)closeWithTimeout(2000);
 }
@@ -1669,12 +2239,13 @@ bool SimpleRtspPlayer::closeWithTimeout(uint32_t timeout_ms) {
     running_ = false;
     buffer_cv_.notify_all();
     
-    bool joined = joinThreadWithTimeout(receive_thread_, timeout_ms);
-    
+    // 先关客户端：它唤醒阻塞在 receiveLoop() 里的接收线程，随后才能 join
     if (client_) {
         client_->closeWithTimeout(timeout_ms);
     }
+    bool joined = joinThreadWithTimeout(receive_thread_, timeout_ms);
     
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
     for (auto& f : frame_buffer_) {
         releaseFrameData(f);
     }
@@ -10,6 +10,7 @@
 #include "../../third_party/httplib.h"
 
 #include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
 
 #include <atomic>
 #include <chrono>
@@ -221,7 +222,7 @@ bool SoapEndpoint::start(uint16_t http_port) {
     impl_->running_.store(true);
 
     // listen 是阻塞的；在后台线程里跑
-    impl_->server_thread_ = std::thread([this, http_port] {
+    impl_->server_thread_ = startThread(ThreadRole::Http, "onvif-soap", [this, http_port] {
         const bool ok = impl_->server_->listen("0.0.0.0", http_port);
         if (!ok) {
             RTSP_LOG_ERROR("ONVIF SOAP: failed to bind http port " + std::to_string(http_port));
@@ -5,6 +5,7 @@
 #endif
 
 #include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
 
 #include <atomic>
 #include <chrono>
@@ -265,7 +266,7 @@ bool WsDiscoveryResponder::start() {
     if (impl_->running_.load()) return false;
     if (!impl_->bindAndJoin()) return false;
     impl_->running_.store(true);
-    impl_->thread_ = std::thread([this] { impl_->receiveLoop(); });
+    impl_->thread_ = startThread(ThreadRole::Discovery, "onvif-discovery", [this] { impl_->receiveLoop(); });
     RTSP_LOG_INFO("WsDiscovery started (multicast " + std::string(kMulticastAddr) + ":3702)");
     return true;
 }
@@ -24,11 +24,16 @@ std::shared_ptr<std::vector<uint8_t>> makeManagedBuffer(const uint8_t* data, siz
 
 class RtspPublisher::Impl {
 public:
+    // ANNOUNCE 中的一路轨道；每轨独立的 RTP 发送端口对与打包器，共用一个 RTSP 会话
+    struct Track {
+        PublishMediaInfo media;
+        std::unique_ptr<RtpSender> rtp_sender;
+        std::unique_ptr<RtpPacker> rtp_packer;
+    };
+
     RtspPublishConfig config_;
     std::unique_ptr<Socket> control_socket_;
-    std::unique_ptr<RtpSender> rtp_sender_;
-    std::unique_ptr<RtpPacker> rtp_packer_;
-    PublishMediaInfo media_;
+    std::vector<Track> tracks_;
 
     std::string host_;
     uint16_t port_ = 554;
@@ -97,6 +102,17 @@ public:
         return recvRtspMessage(*control_socket_, &response, recv_timeout_ms);
     }
 
+    static std::string controlOf(const PublishMediaInfo& media, size_t index) {
+        return media.control_track.empty() ? "streamid=" + std::to_string(index) : media.control_track;
+    }
+
+    void resetTracks() {
+        for (auto& track : tracks_) {
+            track.rtp_packer.reset();
+            track.rtp_sender.reset();
+        }
+    }
+
     bool parseSessionAndPorts(const std::string& response) {
         std::smatch m;
         static const std::regex session_regex("Session:\\s*([^;\\r\\n]+)", std::regex::icase);
@@ -135,8 +151,17 @@ bool RtspPublisher::open(const std::string& url) {
 }
 
 bool RtspPublisher::announce(const PublishMediaInfo& media) {
-    if (!impl_->connected_) return false;
-    impl_->media_ = media;
+    return announce(std::vector<PublishMediaInfo>{media});
+}
+
+bool RtspPublisher::announce(const std::vector<PublishMediaInfo>& medias) {
+    if (!impl_->connected_ || medias.empty()) return false;
+    impl_->tracks_.clear();
+    impl_->tracks_.resize(medias.size());
+    for (size_t i = 0; i < medias.size(); ++i) {
+        impl_->tracks_[i].media = medias[i];
+        impl_->tracks_[i].media.control_track = Impl::controlOf(medias[i], i);
+    }
 
     SdpBuilder sdp;
     // 部分严格 RTSP 服务器会拒绝 c=IN IP4 0.0.0.0；优先用实际本地 IP
@@ -149,16 +174,19 @@ bool RtspPublisher::announce(const PublishMediaInfo& media) {
     }
     sdp.setConnection("IN", "IP4", conn_ip);
     const uint32_t clock_rate = 90000;
-    const std::string control = media.control_track.empty() ? "streamid=0" : media.control_track;
-    if (media.codec == CodecType::H264) {
-        const std::string sps_b64 = base64Encode(media.sps.data(), media.sps.size());
-        const std::string pps_b64 = base64Encode(media.pps.data(), media.pps.size());
-        sdp.addH264Media(control, 0, media.payload_type, clock_rate, sps_b64, pps_b64, media.width, media.height);
-    } else {
-        const std::string vps_b64 = base64Encode(media.vps.data(), media.vps.size());
-        const std::string sps_b64 = base64Encode(media.sps.data(), media.sps.size());
-        const std::string pps_b64 = base64Encode(media.pps.data(), media.pps.size());
-        sdp.addH265Media(control, 0, media.payload_type, clock_rate, vps_b64, sps_b64, pps_b64, media.width, media.height);
+    for (const auto& track : impl_->tracks_) {
+        const PublishMediaInfo& media = track.media;
+        const std::string& control = media.control_track;
+        if (media.codec == CodecType::H264) {
+            const std::string sps_b64 = base64Encode(media.sps.data(), media.sps.size());
+            const std::string pps_b64 = base64Encode(media.pps.data(), media.pps.size());
+            sdp.addH264Media(control, 0, media.payload_type, clock_rate, sps_b64, pps_b64, media.width, media.height);
+        } else {
+            const std::string vps_b64 = base64Encode(media.vps.data(), media.vps.size());
+            const std::string sps_b64 = base64Encode(media.sps.data(), media.sps.size());
+            const std::string pps_b64 = base64Encode(media.pps.data(), media.pps.size());
+            sdp.addH265Media(control, 0, media.payload_type, clock_rate, vps_b64, sps_b64, pps_b64, media.width, media.height);
+        }
     }
 
     std::string resp;
@@ -171,37 +199,45 @@ bool RtspPublisher::announce(const PublishMediaInfo& media) {
 
 bool RtspPublisher::setup() {
     if (!impl_->connected_ || !impl_->announced_) return false;
-    impl_->rtp_sender_ = std::make_unique<RtpSender>();
-    if (!impl_->rtp_sender_->init("0.0.0.0", impl_->config_.local_rtp_port)) return false;
-    const uint16_t local_rtp = impl_->rtp_sender_->getLocalPort();
-    const uint16_t local_rtcp = impl_->rtp_sender_->getLocalRtcpPort();
+    for (size_t i = 0; i < impl_->tracks_.size(); ++i) {
+        auto& track = impl_->tracks_[i];
+        track.rtp_sender = std::make_unique<RtpSender>();
+        // 各轨本地端口对按 local_rtp_port + 2*i 顺延
+        const uint16_t want_port = static_cast<uint16_t>(impl_->config_.local_rtp_port + 2 * i);
+        if (!track.rtp_sender->init("0.0.0.0", want_port)) return false;
+        const uint16_t local_rtp = track.rtp_sender->getLocalPort();
+        const uint16_t local_rtcp = track.rtp_sender->getLocalRtcpPort();
 
-    std::string resp;
-    std::ostringstream headers;
-    headers << "Transport: RTP/AVP;unicast;client_port=" << local_rtp << "-" << local_rtcp
-            << ";mode=record\r\n";
-    std::string track_url = impl_->request_url_ + "/" + (impl_->media_.control_track.empty() ? "streamid=0" : impl_->media_.control_track);
-    if (!impl_->sendRequest("SETUP", track_url, headers.str(), "", resp)) return false;
-    if (resp.find("200 OK") == std::string::npos) return false;
-    if (!impl_->parseSessionAndPorts(resp)) return false;
-    if (impl_->server_rtp_port_ == 0) return false;
-
-    impl_->rtp_sender_->setPeer(impl_->host_, impl_->server_rtp_port_,
-                                impl_->server_rtcp_port_ == 0 ? static_cast<uint16_t>(impl_->server_rtp_port_ + 1) : impl_->server_rtcp_port_);
-    if (impl_->media_.codec == CodecType::H264) {
-        impl_->rtp_packer_ = std::make_unique<H264RtpPacker>();
-    } else {
-        impl_->rtp_packer_ = std::make_unique<H265RtpPacker>();
-    }
-    impl_->rtp_packer_->setPayloadType(impl_->media_.payload_type);
-    // 每个 publisher 实例生成一个随机 SSRC，并联动到 rtp_sender 供 RTCP SR 使用
-    {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<uint32_t> dist(0x10000000u, 0x7FFFFFFFu);
-        const uint32_t ssrc = dist(gen);
-        impl_->rtp_packer_->setSsrc(ssrc);
-        impl_->rtp_sender_->setSsrc(ssrc);
+        std::string resp;
+        std::ostringstream headers;
+        headers << "Transport: RTP/AVP;unicast;client_port=" << local_rtp << "-" << local_rtcp
+                << ";mode=record\r\n";
+        // 首轨之后 sendRequest 会自动带上 Session，后续 SETUP 加入同一会话
+        std::string track_url = impl_->request_url_ + "/" + track.media.control_track;
+        impl_->server_rtp_port_ = 0;
+        impl_->server_rtcp_port_ = 0;
+        if (!impl_->sendRequest("SETUP", track_url, headers.str(), "", resp)) return false;
+        if (resp.find("200 OK") == std::string::npos) return false;
+        if (!impl_->parseSessionAndPorts(resp)) return false;
+        if (impl_->server_rtp_port_ == 0) return false;
+
+        track.rtp_sender->setPeer(impl_->host_, impl_->server_rtp_port_,
+                                  impl_->server_rtcp_port_ == 0 ? static_cast<uint16_t>(impl_->server_rtp_port_ + 1) : impl_->server_rtcp_port_);
+        if (track.media.codec == CodecType::H264) {
+            track.rtp_packer = std::make_unique<H264RtpPacker>();
+        } else {
+            track.rtp_packer = std::make_unique<H265RtpPacker>();
+        }
+        track.rtp_packer->setPayloadType(track.media.payload_type);
+        // 每轨生成一个随机 SSRC，并联动到 rtp_sender 供 RTCP SR 使用
+        {
+            std::random_device rd;
+            std::mt19937 gen(rd());
+            std::uniform_int_distribution<uint32_t> dist(0x10000000u, 0x7FFFFFFFu);
+            const uint32_t ssrc = dist(gen);
+            track.rtp_packer->setSsrc(ssrc);
+            track.rtp_sender->setSsrc(ssrc);
+        }
     }
     impl_->setup_done_ = true;
     return true;
@@ -217,16 +253,28 @@ bool RtspPublisher::record() {
 }
 
 bool RtspPublisher::pushFrame(const VideoFrame& frame) {
-    if (!impl_->recording_ || !impl_->rtp_packer_ || !impl_->rtp_sender_) return false;
-    auto packets = impl_->rtp_packer_->packFrame(frame);
+    return pushFrame(0, frame);
+}
+
+bool RtspPublisher::pushFrame(size_t track_index, const VideoFrame& frame) {
+    if (!impl_->recording_ || track_index >= impl_->tracks_.size()) return false;
+    auto& track = impl_->tracks_[track_index];
+    if (!track.rtp_packer || !track.rtp_sender) return false;
+    auto packets = track.rtp_packer->packFrame(frame);
     for (auto& p : packets) {
-        impl_->rtp_sender_->sendRtpPacket(p);
+        track.rtp_sender->sendRtpPacket(p);
         delete[] p.data;
     }
     return true;
 }
 
 bool RtspPublisher::pushH264Data(const uint8_t* data, size_t size, uint64_t pts, bool is_key) {
+    return pushH264Data(0, data, size, pts, is_key);
+}
+
+bool RtspPublisher::pushH264Data(size_t track_index, const uint8_t* data, size_t size, uint64_t pts, bool is_key) {
+    if (track_index >= impl_->tracks_.size()) return false;
+    const PublishMediaInfo& media = impl_->tracks_[track_index].media;
     VideoFrame frame{};
     frame.codec = CodecType::H264;
     frame.type = is_key ? FrameType::IDR : FrameType::P;
@@ -235,13 +283,19 @@ bool RtspPublisher::pushH264Data(const uint8_t* data, size_t size, uint64_t pts,
     frame.size = frame.managed_data->size();
     frame.pts = pts;
     frame.dts = pts;
-    frame.width = impl_->media_.width;
-    frame.height = impl_->media_.height;
-    frame.fps = impl_->media_.fps;
-    return pushFrame(frame);
+    frame.width = media.width;
+    frame.height = media.height;
+    frame.fps = media.fps;
+    return pushFrame(track_index, frame);
 }
 
 bool RtspPublisher::pushH265Data(const uint8_t* data, size_t size, uint64_t pts, bool is_key) {
+    return pushH265Data(0, data, size, pts, is_key);
+}
+
+bool RtspPublisher::pushH265Data(size_t track_index, const uint8_t* data, size_t size, uint64_t pts, bool is_key) {
+    if (track_index >= impl_->tracks_.size()) return false;
+    const PublishMediaInfo& media = impl_->tracks_[track_index].media;
     VideoFrame frame{};
     frame.codec = CodecType::H265;
     frame.type = is_key ? FrameType::IDR : FrameType::P;
@@ -250,10 +304,10 @@ bool RtspPublisher::pushH265Data(const uint8_t* data, size_t size, uint64_t pts,
     frame.size = frame.managed_data->size();
     frame.pts = pts;
     frame.dts = pts;
-    frame.width = impl_->media_.width;
-    frame.height = impl_->media_.height;
-    frame.fps = impl_->media_.fps;
-    return pushFrame(frame);
+    frame.width = media.width;
+    frame.height = media.height;
+    frame.fps = media.fps;
+    return pushFrame(track_index, frame);
 }
 
 bool RtspPublisher::teardown() {
@@ -265,8 +319,7 @@ bool RtspPublisher::teardown() {
     impl_->setup_done_ = false;
     impl_->announced_ = false;
     impl_->session_id_.clear();
-    impl_->rtp_packer_.reset();
-    impl_->rtp_sender_.reset();
+    impl_->resetTracks();
     return true;
 }
 
@@ -280,8 +333,7 @@ bool RtspPublisher::closeWithTimeout(uint32_t timeout_ms) {
         impl_->setup_done_ = false;
         impl_->announced_ = false;
         impl_->session_id_.clear();
-        impl_->rtp_packer_.reset();
-        impl_->rtp_sender_.reset();
+        impl_->resetTracks();
     }
     if (impl_->control_socket_) {
         impl_->control_socket_->shutdownReadWrite();
@@ -0,0 +1,523 @@
+#include "io_uring_backend.h"
+
+#include <rtsp-common/common.h>
+
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        // 多发 recv（6.0）是本实现用到的最新特性，以它判断头文件是否够新
+        #if defined(IORING_RECV_MULTISHOT) && defined(IORING_ENTER_EXT_ARG) && defined(IORING_CQE_F_MORE)
+            #define RTSP_HAVE_IO_URING 1
+        #endif
+    #endif
+#endif
+
+#ifdef RTSP_HAVE_IO_URING
+    #include <sys/mman.h>
+    #include <sys/socket.h>
+    #include <sys/syscall.h>
+    #include <netinet/in.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #include <signal.h>
+    #include <time.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace rtsp {
+
+void addThreadIoSyscalls(uint64_t count);   // socket.cpp
+
+namespace uring {
+
+#ifdef RTSP_HAVE_IO_URING
+
+namespace {
+
+constexpr unsigned kSendRingEntries = 64;      // 每次提交的最大报文数
+constexpr unsigned kRecvRingEntries = 4;       // 接收环只挂一个多发 recv
+constexpr unsigned kRecvCqEntries = 256;       // 一次等待最多取回的报文数
+constexpr unsigned kRecvBufferCount = 64;      // 提供缓冲环的缓冲个数（2 的幂）
+constexpr size_t kRecvBufferSize = 65536;      // 与 poll 路径一致，容纳任意 UDP 报文
+constexpr uint16_t kRecvBufferGroup = 0;
+
+int sysSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sysEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t arg_size) {
+    addThreadIoSyscalls(1);
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+int sysRegister(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// SQ/CQ 两个共享内存环与 SQE 数组
+class Ring {
+public:
+    ~Ring() {
+        if (sqes_) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) {
+            munmap(cq_ptr_, cq_size_);
+        }
+        if (sq_ptr_) {
+            munmap(sq_ptr_, sq_size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    bool init(unsigned entries, unsigned cq_entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        if (cq_entries > 0) {
+            params.flags |= IORING_SETUP_CQSIZE;
+            params.cq_entries = cq_entries;
+        }
+        fd_ = sysSetup(entries, &params);
+        if (fd_ < 0) {
+            return false;
+        }
+        if (!(params.features & IORING_FEAT_EXT_ARG)) {
+            return false;
+        }
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                       IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            sq_ptr_ = nullptr;
+            return false;
+        }
+        if (single_mmap) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                           IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) {
+                cq_ptr_ = nullptr;
+                return false;
+            }
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        char* cq = static_cast<char*>(cq_ptr_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_entries_ = params.sq_entries;
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        local_sq_tail_ = *sq_tail_;
+        return true;
+    }
+
+    int fd() const { return fd_; }
+    unsigned sqEntries() const { return sq_entries_; }
+
+    // 取一个空 SQE（已清零）；调用方保证一次提交的数量不超过 sqEntries()
+    io_uring_sqe* nextSqe() {
+        const unsigned index = local_sq_tail_ & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        local_sq_tail_++;
+        pending_++;
+        return sqe;
+    }
+
+    // 提交已准备的 SQE 并至少等待 wait_nr 个完成；timeout_ms < 0 不限时。
+    // 返回 >= 0 成功，-errno 失败（-ETIME 为超时）
+    int submitAndWait(unsigned wait_nr, int timeout_ms) {
+        __atomic_store_n(sq_tail_, local_sq_tail_, __ATOMIC_RELEASE);
+        unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+        __kernel_timespec ts;
+        io_uring_getevents_arg arg;
+        void* arg_ptr = nullptr;
+        size_t arg_size = 0;
+        if (wait_nr > 0 && timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+            std::memset(&arg, 0, sizeof(arg));
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            arg_ptr = &arg;
+            arg_size = sizeof(arg);
+        }
+        const unsigned to_submit = pending_;
+        const int ret = sysEnter(fd_, to_submit, wait_nr, flags, arg_ptr, arg_size);
+        if (ret < 0) {
+            return -errno;
+        }
+        pending_ -= std::min(pending_, static_cast<unsigned>(ret));
+        return ret;
+    }
+
+    // 依次处理已到达的 CQE，返回处理个数
+    template <typename Fn>
+    unsigned drain(Fn&& fn) {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned seen = 0;
+        while (head != tail) {
+            fn(cqes_[head & cq_mask_]);
+            head++;
+            seen++;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return seen;
+    }
+
+    bool hasCompletions() const {
+        return *cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    }
+
+private:
+    int fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_entries_ = 0;
+    unsigned local_sq_tail_ = 0;
+    unsigned pending_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+bool probeOnce() {
+    Ring ring;
+    if (!ring.init(kRecvRingEntries, 0)) {
+        return false;
+    }
+    const size_t probe_size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    std::vector<uint8_t> storage(probe_size, 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (sysRegister(ring.fd(), IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return false;
+    }
+    auto supported = [probe](unsigned op) {
+        return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    };
+    return supported(IORING_OP_SENDMSG) && supported(IORING_OP_RECV);
+}
+
+// 每线程的发送环与 msghdr/iovec 暂存
+struct SendContext {
+    Ring ring;
+    bool ready = false;
+    msghdr messages[kSendRingEntries];
+    iovec vectors[kSendRingEntries];
+    sockaddr_in peer;
+
+    SendContext() { ready = ring.init(kSendRingEntries, 0); }
+};
+
+} // namespace
+
+bool available() {
+    static const bool supported = probeOnce();
+    return supported;
+}
+
+int sendBatch(int fd, const UdpDatagram* datagrams, size_t count, const sockaddr_in& peer) {
+    if (!available()) {
+        return -1;
+    }
+    thread_local SendContext context;
+    if (!context.ready) {
+        return -1;
+    }
+    context.peer = peer;
+
+    size_t sent = 0;
+    while (sent < count) {
+        const unsigned batch = static_cast<unsigned>(std::min<size_t>(count - sent, context.ring.sqEntries()));
+        for (unsigned i = 0; i < batch; ++i) {
+            const UdpDatagram& datagram = datagrams[sent + i];
+            iovec& vec = context.vectors[i];
+            vec.iov_base = const_cast<uint8_t*>(datagram.data);
+            vec.iov_len = datagram.size;
+            msghdr& msg = context.messages[i];
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_name = &context.peer;
+            msg.msg_namelen = sizeof(context.peer);
+            msg.msg_iov = &vec;
+            msg.msg_iovlen = 1;
+
+            io_uring_sqe* sqe = context.ring.nextSqe();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(&msg);
+            sqe->len = 1;
+            sqe->user_data = i;
+            // 链接保证按序发出（阻塞 socket 上某个包被转入 io-wq 时后面的包不会抢先）
+            if (i + 1 < batch) {
+                sqe->flags |= IOSQE_IO_LINK;
+            }
+        }
+        const int ret = context.ring.submitAndWait(batch, -1);
+        if (ret < 0) {
+            return sent > 0 ? static_cast<int>(sent) : -1;
+        }
+        // 等齐本批的全部完成；链上某个失败后其余以 -ECANCELED 完成
+        unsigned completed = 0;
+        unsigned ok_prefix = batch;
+        while (completed < batch) {
+            completed += context.ring.drain([&](const io_uring_cqe& cqe) {
+                const unsigned index = static_cast<unsigned>(cqe.user_data);
+                if (index < batch && cqe.res != static_cast<int>(datagrams[sent + index].size)) {
+                    ok_prefix = std::min(ok_prefix, index);
+                }
+            });
+            if (completed < batch && context.ring.submitAndWait(1, -1) < 0) {
+                return -1;   // 环已不可用（极少见），还有未取回的完成，不能再复用暂存区
+            }
+        }
+        sent += ok_prefix;
+        if (ok_prefix < batch) {
+            break;
+        }
+    }
+    return static_cast<int>(sent);
+}
+
+class Receiver::Impl {
+public:
+    ~Impl() {
+        // 同步取消挂着的多发 recv 再关环：关环本身的清理是异步的，
+        // 不先取消的话 socket 文件会被短暂持有，端口不能立即重新绑定
+        if (ring && armed) {
+            cancelPending();
+        }
+        ring.reset();
+        if (buffer_ring) {
+            munmap(buffer_ring, buffer_ring_size);
+        }
+        if (buffers) {
+            munmap(buffers, kRecvBufferCount * kRecvBufferSize);
+        }
+    }
+
+    bool init(int socket_fd) {
+        fd = socket_fd;
+        ring.reset(new Ring());
+        if (!ring->init(kRecvRingEntries, kRecvCqEntries)) {
+            return false;
+        }
+        // 缓冲按需占用物理页：内核只写报文实际长度
+        void* memory = mmap(nullptr, kRecvBufferCount * kRecvBufferSize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        buffers = static_cast<uint8_t*>(memory);
+
+        buffer_ring_size = kRecvBufferCount * sizeof(io_uring_buf);
+        memory = mmap(nullptr, buffer_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        buffer_ring = static_cast<io_uring_buf*>(memory);
+
+        io_uring_buf_reg reg;
+        std::memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<uint64_t>(buffer_ring);
+        reg.ring_entries = kRecvBufferCount;
+        reg.bgid = kRecvBufferGroup;
+        if (sysRegister(ring->fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            return false;
+        }
+        for (uint16_t bid = 0; bid < kRecvBufferCount; ++bid) {
+            recycle(bid);
+        }
+        publishBuffers();
+        return true;
+    }
+
+    // 缓冲环的 tail 与第 0 个 io_uring_buf 的 resv 字段重叠（偏移 14）
+    uint16_t* ringTail() {
+        return reinterpret_cast<uint16_t*>(reinterpret_cast<uint8_t*>(buffer_ring) + 14);
+    }
+
+    void recycle(uint16_t bid) {
+        io_uring_buf& slot = buffer_ring[buffer_tail & (kRecvBufferCount - 1)];
+        slot.addr = reinterpret_cast<uint64_t>(buffers + static_cast<size_t>(bid) * kRecvBufferSize);
+        slot.len = static_cast<uint32_t>(kRecvBufferSize);
+        slot.bid = bid;
+        buffer_tail++;
+    }
+
+    void publishBuffers() {
+        __atomic_store_n(ringTail(), buffer_tail, __ATOMIC_RELEASE);
+    }
+
+    // 可从其他线程调用（io_uring_register 与 io_uring_enter 可并发）
+    void cancelPending() {
+        io_uring_sync_cancel_reg cancel;
+        std::memset(&cancel, 0, sizeof(cancel));
+        cancel.fd = fd;
+        cancel.flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        cancel.timeout.tv_sec = -1;
+        cancel.timeout.tv_nsec = -1;
+        (void)sysRegister(ring->fd(), IORING_REGISTER_SYNC_CANCEL, &cancel, 1);
+    }
+
+    void arm() {
+        io_uring_sqe* sqe = ring->nextSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kRecvBufferGroup;
+        armed = true;
+    }
+
+    int fd = -1;
+    std::unique_ptr<Ring> ring;
+    uint8_t* buffers = nullptr;
+    io_uring_buf* buffer_ring = nullptr;
+    size_t buffer_ring_size = 0;
+    uint16_t buffer_tail = 0;
+    bool armed = false;
+    bool ever_delivered = false;
+    std::atomic<bool> shut_down{false};
+};
+
+Receiver::Receiver() : impl_(new Impl()) {}
+Receiver::~Receiver() = default;
+
+std::unique_ptr<Receiver> Receiver::create(int fd) {
+    if (!available() || fd < 0) {
+        return nullptr;
+    }
+    std::unique_ptr<Receiver> receiver(new Receiver());
+    if (!receiver->impl_->init(fd)) {
+        return nullptr;
+    }
+    return receiver;
+}
+
+void Receiver::shutdown() {
+    impl_->shut_down = true;
+    impl_->cancelPending();
+}
+
+int Receiver::receive(const std::function<void(const uint8_t*, size_t)>& on_datagram, int timeout_ms) {
+    Impl& impl = *impl_;
+    if (impl.shut_down) {
+        return -1;
+    }
+    unsigned to_submit = 0;
+    if (!impl.armed) {
+        impl.arm();
+        to_submit = 1;
+    }
+    if (to_submit > 0 || !impl.ring->hasCompletions()) {
+        const int ret = impl.ring->submitAndWait(1, timeout_ms);
+        if (ret == -ETIME || ret == -EINTR) {
+            return 0;
+        }
+        if (ret < 0 && ret != -EBUSY) {
+            return -1;
+        }
+    }
+
+    int delivered = 0;
+    bool closed = false;
+    bool unsupported = false;
+    impl.ring->drain([&](const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            impl.armed = false;   // 多发已终止（缓冲耗尽/出错/关闭），下次调用重新武装
+        }
+        // 只要内核选用了缓冲（无论 res 为何）都要归还，否则缓冲环会逐渐耗尽
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            const uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe.res > 0) {
+                on_datagram(impl.buffers + static_cast<size_t>(bid) * kRecvBufferSize, static_cast<size_t>(cqe.res));
+                delivered++;
+                impl.ever_delivered = true;
+            }
+            impl.recycle(bid);
+        }
+        if (cqe.res >= 0) {
+            // 已投递；res == 0 是 UDP 空报文而非 EOF，与 poll 路径一样丢弃
+        } else if (cqe.res == -ECANCELED) {
+            closed = true;     // shutdown() 取消
+        } else if (cqe.res == -EINVAL && !impl.ever_delivered) {
+            unsupported = true;   // 内核不支持多发 recv（< 6.0）
+        } else if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+            closed = true;
+        }
+    });
+    impl.publishBuffers();
+    if (unsupported) {
+        return kUnsupported;
+    }
+    if (delivered == 0 && closed) {
+        return -1;
+    }
+    return delivered;
+}
+
+#else // !RTSP_HAVE_IO_URING
+
+bool available() {
+    return false;
+}
+
+int sendBatch(int, const UdpDatagram*, size_t, const sockaddr_in&) {
+    return -1;
+}
+
+class Receiver::Impl {};
+
+Receiver::Receiver() : impl_(new Impl()) {}
+Receiver::~Receiver() = default;
+
+std::unique_ptr<Receiver> Receiver::create(int) {
+    return nullptr;
+}
+
+void Receiver::shutdown() {}
+
+int Receiver::receive(const std::function<void(const uint8_t*, size_t)>&, int) {
+    return kUnsupported;
+}
+
+#endif // RTSP_HAVE_IO_URING
+
+} // namespace uring
+} // namespace rtsp
@@ -0,0 +1,48 @@
+#pragma once
+
+// Linux io_uring 的最小实现（裸系统调用，不依赖 liburing），供 Socket 的 UDP 批量收发使用：
+// - 发送：每线程一个环，一批报文一次提交（IOSQE_IO_LINK 保序），一次 io_uring_enter 等全部完成
+// - 接收：每个 socket 一个环，多发（multishot）recv + 提供缓冲环（provided buffer ring），
+//   一次武装持续收包，等待用 EXT_ARG 带超时
+// 内核或头文件不支持时 available() 返回 false，调用方回退到 poll 路径。
+
+#include <rtsp-common/socket.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+struct sockaddr_in;
+
+namespace rtsp {
+namespace uring {
+
+// 本进程是否可用（首次调用时探测：环创建、EXT_ARG、SENDMSG/RECV 操作码、缓冲环注册）
+bool available();
+
+// 用调用线程的发送环把 datagrams 依次发给 peer；返回按序成功发送的报文数，环不可用返回 -1
+int sendBatch(int fd, const UdpDatagram* datagrams, size_t count, const sockaddr_in& peer);
+
+class Receiver {
+public:
+    // 内核不支持（如缺少多发 recv）时返回空，调用方回退
+    static std::unique_ptr<Receiver> create(int fd);
+    ~Receiver();
+
+    Receiver(const Receiver&) = delete;
+    Receiver& operator=(const Receiver&) = delete;
+
+    // 语义同 Socket::recvBatch；返回 kUnsupported 表示运行期发现内核不支持，调用方应永久回退
+    static constexpr int kUnsupported = -2;
+    int receive(const std::function<void(const uint8_t*, size_t)>& on_datagram, int timeout_ms);
+    // 取消挂着的 recv 并让之后的 receive 返回 -1（UDP 的 shutdown 唤不醒多发 recv）；可跨线程调用
+    void shutdown();
+
+private:
+    Receiver();
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace uring
+} // namespace rtsp
@@ -1,6 +1,7 @@
 #include <rtsp-common/rtp_packer.h>
 #include <rtsp-common/common.h>
 #include <rtsp-common/socket.h>
+#include <algorithm>
 #include <cstring>
 
 namespace rtsp {
@@ -130,6 +131,111 @@ static std::vector<NaluUnit> parseNalusInternal(const uint8_t* data, size_t size
     return nalus;
 }
 
+// RtpPacker实现
+void RtpPacker::setMarker(RtpPacket& packet, bool marker) {
+    packet.marker = marker;
+    if (packet.data && packet.size >= 2) {
+        packet.data[1] = static_cast<uint8_t>((packet.data[1] & 0x7F) | (marker ? 0x80 : 0x00));
+    }
+}
+
+std::vector<RtpPacket> RtpPacker::packNalus(const VideoFrame& frame, bool end_of_access_unit) {
+    auto packets = packFrame(frame);
+    if (!packets.empty() && !end_of_access_unit) {
+        setMarker(packets.back(), false);
+    }
+    au_open_ = !end_of_access_unit;
+    return packets;
+}
+
+void RtpPacker::setParameterSets(const std::vector<uint8_t>& vps, const std::vector<uint8_t>& sps,
+                                 const std::vector<uint8_t>& pps) {
+    insert_parameter_sets_ = true;
+    parameter_sets_[0] = vps;
+    parameter_sets_[1] = sps;
+    parameter_sets_[2] = pps;
+}
+
+void RtpPacker::writeRtpHeader(uint8_t* p, uint16_t seq, uint32_t timestamp) const {
+    p[0] = 0x80;  // V=2, P=0, X=0, CC=0
+    p[1] = payload_type_;
+    p[2] = (seq >> 8) & 0xFF;
+    p[3] = seq & 0xFF;
+    p[4] = (timestamp >> 24) & 0xFF;
+    p[5] = (timestamp >> 16) & 0xFF;
+    p[6] = (timestamp >> 8) & 0xFF;
+    p[7] = timestamp & 0xFF;
+    p[8] = (ssrc_ >> 24) & 0xFF;
+    p[9] = (ssrc_ >> 16) & 0xFF;
+    p[10] = (ssrc_ >> 8) & 0xFF;
+    p[11] = ssrc_ & 0xFF;
+}
+
+bool RtpPacker::parameterSetsReady() const {
+    return !parameter_sets_[1].empty() && !parameter_sets_[2].empty();
+}
+
+void RtpPacker::cacheParameterSet(int slot, const uint8_t* nalu, size_t size) {
+    std::vector<uint8_t>& set = parameter_sets_[slot];
+    if (set.size() != size || memcmp(set.data(), nalu, size) != 0) {
+        set.assign(nalu, nalu + size);
+    }
+}
+
+void RtpPacker::packParameterSets(uint32_t timestamp, size_t mtu, std::vector<RtpPacket>& packets) {
+    size_t count = 0;
+    size_t payload_size = aggregationHeaderSize();
+    for (const auto& set : parameter_sets_) {
+        if (!set.empty()) {
+            count++;
+            payload_size += 2 + set.size();
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+
+    auto makePacket = [&](size_t size) {
+        RtpPacket packet;
+        packet.data = new uint8_t[12 + size];
+        packet.size = 12 + size;
+        packet.seq = getNextSeq();
+        packet.timestamp = timestamp;
+        packet.ssrc = ssrc_;
+        packet.marker = false;
+        writeRtpHeader(packet.data, packet.seq, timestamp);
+        return packet;
+    };
+
+    // 聚合包：聚合头 + 逐个（16 位长度 + NALU）
+    if (count > 1 && payload_size <= mtu) {
+        RtpPacket packet = makePacket(payload_size);
+        uint8_t* p = packet.data + 12;
+        writeAggregationHeader(p);
+        p += aggregationHeaderSize();
+        for (const auto& set : parameter_sets_) {
+            if (set.empty()) {
+                continue;
+            }
+            p[0] = static_cast<uint8_t>((set.size() >> 8) & 0xFF);
+            p[1] = static_cast<uint8_t>(set.size() & 0xFF);
+            memcpy(p + 2, set.data(), set.size());
+            p += 2 + set.size();
+        }
+        packets.push_back(packet);
+        return;
+    }
+
+    for (const auto& set : parameter_sets_) {
+        if (set.empty()) {
+            continue;
+        }
+        RtpPacket packet = makePacket(set.size());
+        memcpy(packet.data + 12, set.data(), set.size());
+        packets.push_back(packet);
+    }
+}
+
 // H264RtpPacker实现
 H264RtpPacker::H264RtpPacker() {
     ssrc_ = 0x12345678;  // 默认SSRC
@@ -144,8 +250,11 @@ std::vector<NaluUnit> H264RtpPacker::parseNalus(const uint8_t* data, size_t size
 
 std::vector<RtpPacket> H264RtpPacker::packFrame(const VideoFrame& frame) {
     std::vector<RtpPacket> packets;
+    if (!au_open_) {
+        au_has_parameter_sets_ = false;
+    }
     
-    uint32_t rtp_timestamp = convertToRtpTimestamp(frame.pts, clock_rate_);
+    uint32_t rtp_timestamp = convertUsToRtpTimestamp(framePtsUs(frame), clock_rate_);
     
     // 解析NALU
     auto nalus = parseNalus(frame.data, frame.size);
@@ -168,6 +277,20 @@ std::vector<RtpPacket> H264RtpPacker::packFrame(const VideoFrame& frame) {
         }
         
         if (nalu_size == 0) continue;
+
+        // 参数集补发：AU 自带 SPS 时只更新缓存，否则在 IDR 前补一次
+        if (insert_parameter_sets_) {
+            const uint8_t type = nalu_data[0] & 0x1F;
+            if (type == H264_NALU_SPS) {
+                cacheParameterSet(1, nalu_data, nalu_size);
+                au_has_parameter_sets_ = true;
+            } else if (type == H264_NALU_PPS) {
+                cacheParameterSet(2, nalu_data, nalu_size);
+            } else if (type == H264_NALU_IDR && !au_has_parameter_sets_ && parameterSetsReady()) {
+                packParameterSets(rtp_timestamp, mtu_, packets);
+                au_has_parameter_sets_ = true;
+            }
+        }
         
         // 小于MTU的NALU直接打包
         if (nalu_size <= mtu_) {
@@ -178,9 +301,9 @@ std::vector<RtpPacket> H264RtpPacker::packFrame(const VideoFrame& frame) {
         }
     }
     
-    // 设置最后一个包的marker位
+    // 仅 access unit 的最后一个包置 marker 位（RFC 6184 5.1）
     if (!packets.empty()) {
-        packets.back().marker = true;
+        setMarker(packets.back(), true);
     }
     
     return packets;
@@ -274,7 +397,7 @@ void H264RtpPacker::packFuA(const NaluUnit& nalu, uint32_t timestamp,
         packet.seq = getNextSeq();
         packet.timestamp = timestamp;
         packet.ssrc = ssrc_;
-        packet.marker = last;
+        packet.marker = false;  // 由 packFrame 在整个 AU 的最后一包上统一设置
         
         uint8_t* p = packet.data;
         // RTP头
@@ -310,6 +433,17 @@ void H264RtpPacker::packFuA(const NaluUnit& nalu, uint32_t timestamp,
     }
 }
 
+// STAP-A：F=0，NRI 取被聚合 NALU 中最大者（RFC 6184 5.7.1）
+void H264RtpPacker::writeAggregationHeader(uint8_t* p) const {
+    uint8_t nri = 0;
+    for (const auto& set : parameter_sets_) {
+        if (!set.empty()) {
+            nri = std::max<uint8_t>(nri, set[0] & 0x60);
+        }
+    }
+    p[0] = static_cast<uint8_t>(nri | 24);
+}
+
 // H265RtpPacker实现
 H265RtpPacker::H265RtpPacker() {
     ssrc_ = 0x12345678;
@@ -324,8 +458,11 @@ std::vector<NaluUnit> H265RtpPacker::parseNalus(const uint8_t* data, size_t size
 
 std::vector<RtpPacket> H265RtpPacker::packFrame(const VideoFrame& frame) {
     std::vector<RtpPacket> packets;
+    if (!au_open_) {
+        au_has_parameter_sets_ = false;
+    }
     
-    uint32_t rtp_timestamp = convertToRtpTimestamp(frame.pts, clock_rate_);
+    uint32_t rtp_timestamp = convertUsToRtpTimestamp(framePtsUs(frame), clock_rate_);
     
     auto nalus = parseNalus(frame.data, frame.size);
     
@@ -346,6 +483,22 @@ std::vector<RtpPacket> H265RtpPacker::packFrame(const VideoFrame& frame) {
         }
         
         if (nalu_size < 2) continue;
+
+        if (insert_parameter_sets_) {
+            const uint8_t type = (nalu_data[0] >> 1) & 0x3F;
+            if (type == H265_NALU_VPS) {
+                cacheParameterSet(0, nalu_data, nalu_size);
+            } else if (type == H265_NALU_SPS) {
+                cacheParameterSet(1, nalu_data, nalu_size);
+                au_has_parameter_sets_ = true;
+            } else if (type == H265_NALU_PPS) {
+                cacheParameterSet(2, nalu_data, nalu_size);
+            } else if (type >= H265_NALU_BLA_W_LP && type <= H265_NALU_RSV_IRAP_VCL23 &&
+                       !au_has_parameter_sets_ && parameterSetsReady()) {
+                packParameterSets(rtp_timestamp, mtu_, packets);
+                au_has_parameter_sets_ = true;
+            }
+        }
         
         if (nalu_size <= mtu_) {
             packSingleNalu(nalu, rtp_timestamp, packets);
@@ -355,12 +508,26 @@ std::vector<RtpPacket> H265RtpPacker::packFrame(const VideoFrame& frame) {
     }
     
     if (!packets.empty()) {
-        packets.back().marker = true;
+        setMarker(packets.back(), true);
     }
     
     return packets;
 }
 
+// AP：Type=48，LayerId 与 TID 取被聚合 NALU 中最小者（RFC 7798 4.4.2）
+void H265RtpPacker::writeAggregationHeader(uint8_t* p) const {
+    uint8_t layer_id = 0x3F;
+    uint8_t tid = 0x07;
+    for (const auto& set : parameter_sets_) {
+        if (set.size() >= 2) {
+            layer_id = std::min<uint8_t>(layer_id, static_cast<uint8_t>(((set[0] & 0x01) << 5) | (set[1] >> 3)));
+            tid = std::min<uint8_t>(tid, set[1] & 0x07);
+        }
+    }
+    p[0] = static_cast<uint8_t>((48 << 1) | (layer_id >> 5));
+    p[1] = static_cast<uint8_t>(((layer_id & 0x1F) << 3) | tid);
+}
+
 void H265RtpPacker::packSingleNalu(const NaluUnit& nalu, uint32_t timestamp,
                                     std::vector<RtpPacket>& packets) {
     const uint8_t* nalu_data = nalu.data;
@@ -450,7 +617,7 @@ void H265RtpPacker::packFu(const NaluUnit& nalu, uint32_t timestamp,
         packet.seq = getNextSeq();
         packet.timestamp = timestamp;
         packet.ssrc = ssrc_;
-        packet.marker = last;
+        packet.marker = false;  // 由 packFrame 在整个 AU 的最后一包上统一设置
         
         uint8_t* p = packet.data;
         // RTP头
@@ -488,6 +655,48 @@ void H265RtpPacker::packFu(const NaluUnit& nalu, uint32_t timestamp,
 }
 
 // RtpSender实现
+bool parseRtcpReportBlock(const uint8_t* data, size_t size, uint32_t media_ssrc,
+                          RtcpReportBlock& block) {
+    auto readU32 = [](const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    };
+    size_t off = 0;
+    while (data && off + 8 <= size) {
+        const uint8_t* pkt = data + off;
+        if (((pkt[0] >> 6) & 0x03) != 2) return false;
+        const uint8_t report_count = pkt[0] & 0x1F;
+        const uint8_t packet_type = pkt[1];
+        const size_t packet_len = (static_cast<size_t>((pkt[2] << 8) | pkt[3]) + 1) * 4;
+        if (off + packet_len > size) return false;
+
+        // RR: 头(4) + 发送者 SSRC(4)；SR 还多 20 字节发送者信息
+        size_t blocks_off = 0;
+        if (packet_type == 201) {
+            blocks_off = 8;
+        } else if (packet_type == 200) {
+            blocks_off = 28;
+        }
+        if (blocks_off != 0) {
+            for (uint8_t i = 0; i < report_count; ++i) {
+                const size_t b = blocks_off + static_cast<size_t>(i) * 24;
+                if (b + 24 > packet_len) break;
+                const uint8_t* rb = pkt + b;
+                if (readU32(rb) != media_ssrc) continue;
+                block.ssrc = media_ssrc;
+                block.fraction_lost = rb[4];
+                block.cumulative_lost = (static_cast<uint32_t>(rb[5]) << 16) |
+                                        (static_cast<uint32_t>(rb[6]) << 8) | rb[7];
+                block.highest_seq = readU32(rb + 8);
+                block.jitter = readU32(rb + 12);
+                return true;
+            }
+        }
+        off += packet_len;
+    }
+    return false;
+}
+
 class RtpSender::Impl {
 public:
     Socket rtp_socket_;
@@ -496,6 +705,7 @@ public:
     uint16_t peer_rtp_port_ = 0;
     uint16_t peer_rtcp_port_ = 0;
     uint32_t ssrc_ = 0x12345678;   // 默认值；应通过 setSsrc 与 RtpPacker 保持一致
+    std::vector<UdpDatagram> batch_;   // sendRtpPackets 的暂存，复用避免每帧分配
 };
 
 RtpSender::RtpSender() : impl_(std::make_unique<Impl>()) {}
@@ -546,12 +756,18 @@ bool RtpSender::sendRtpPacket(const RtpPacket& packet) {
 }
 
 bool RtpSender::sendRtpPackets(const std::vector<RtpPacket>& packets) {
-    for (const auto& packet : packets) {
-        if (!sendRtpPacket(packet)) {
-            return false;
-        }
+    if (!impl_) return false;
+    if (impl_->peer_rtp_port_ == 0) return false;
+    if (packets.empty()) return true;
+
+    std::vector<UdpDatagram>& datagrams = impl_->batch_;
+    datagrams.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        datagrams[i].data = packets[i].data;
+        datagrams[i].size = packets[i].size;
     }
-    return true;
+    return impl_->rtp_socket_.sendBatchTo(datagrams.data(), datagrams.size(),
+                                          impl_->peer_ip_, impl_->peer_rtp_port_) == packets.size();
 }
 
 bool RtpSender::sendSenderReport(uint32_t rtp_timestamp, uint64_t ntp_timestamp,
@@ -608,6 +824,38 @@ bool RtpSender::sendSenderReport(uint32_t rtp_timestamp, uint64_t ntp_timestamp,
     return sent == 28;
 }
 
+bool RtpSender::pollReceiverReport(RtcpReportBlock& block) {
+    if (!impl_) return false;
+    bool found = false;
+    uint8_t buffer[1500];
+    std::string from_ip;
+    uint16_t from_port = 0;
+    while (impl_->rtcp_socket_.waitReadable(0) > 0) {
+        ssize_t len = impl_->rtcp_socket_.recvFrom(buffer, sizeof(buffer), from_ip, from_port);
+        if (len <= 0) break;
+        RtcpReportBlock parsed;
+        if (parseRtcpReportBlock(buffer, static_cast<size_t>(len), impl_->ssrc_, parsed)) {
+            block = parsed;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void RtpSender::resetPeer() {
+    if (!impl_) return;
+    impl_->peer_ip_.clear();
+    impl_->peer_rtp_port_ = 0;
+    impl_->peer_rtcp_port_ = 0;
+    impl_->ssrc_ = 0x12345678;
+    uint8_t buffer[1500];
+    std::string from_ip;
+    uint16_t from_port = 0;
+    while (impl_->rtcp_socket_.waitReadable(0) > 0 &&
+           impl_->rtcp_socket_.recvFrom(buffer, sizeof(buffer), from_ip, from_port) > 0) {
+    }
+}
+
 uint16_t RtpSender::getLocalPort() const {
     return impl_->rtp_socket_.getLocalPort();
 }
@@ -18,13 +18,44 @@ public:
     // 打包一帧视频数据，返回多个RTP包
     virtual std::vector<RtpPacket> packFrame(const VideoFrame& frame) = 0;
 
+    // 打包 access unit 的一部分（一个或多个 slice NALU，Annex-B）。
+    // 仅当 end_of_access_unit 为 true 时在最后一个包上置 RTP marker 位，
+    // 同一 AU 的各部分应使用相同 pts（即相同 RTP 时间戳）。
+    std::vector<RtpPacket> packNalus(const VideoFrame& frame, bool end_of_access_unit);
+
+    // 开启参数集补发：AU 中没有 SPS 时，在第一个 IDR（H.265 为 IRAP）NALU 前补发缓存的
+    // VPS/SPS/PPS，能放进一个包时聚合为一个 STAP-A/AP。缓存以这里给出的为初值，
+    // 之后流中自带的参数集会更新缓存。参数为去掉起始码的 NALU，H.264 忽略 vps
+    void setParameterSets(const std::vector<uint8_t>& vps, const std::vector<uint8_t>& sps,
+                          const std::vector<uint8_t>& pps);
+
 protected:
     uint16_t getNextSeq() { return seq_++; }
+
+    // 同步 RtpPacket::marker 与 RTP 头中的 M 位
+    static void setMarker(RtpPacket& packet, bool marker);
+
+    // 写 12 字节 RTP 头
+    void writeRtpHeader(uint8_t* p, uint16_t seq, uint32_t timestamp) const;
+
+    // 参数集补发（setParameterSets 开启）。slot：0 = VPS、1 = SPS、2 = PPS
+    bool parameterSetsReady() const;
+    void cacheParameterSet(int slot, const uint8_t* nalu, size_t size);
+    // 以一个聚合包（超出 mtu 时逐个单 NALU 包）发出缓存的参数集；
+    // 聚合包头由子类给出：H.264 为 1 字节 STAP-A，H.265 为 2 字节 AP
+    void packParameterSets(uint32_t timestamp, size_t mtu, std::vector<RtpPacket>& packets);
+    virtual void writeAggregationHeader(uint8_t* p) const = 0;
+    virtual size_t aggregationHeaderSize() const = 0;
     
     uint32_t ssrc_ = 0;
     uint8_t payload_type_ = 96;
     uint32_t clock_rate_ = 90000;
     uint16_t seq_ = 0;
+
+    bool insert_parameter_sets_ = false;
+    std::vector<uint8_t> parameter_sets_[3];
+    bool au_open_ = false;                 // packNalus 的上一部分没有结束 AU
+    bool au_has_parameter_sets_ = false;   // 当前 AU 已带（或已补发）SPS
 };
 
 // H.264 RTP打包器 (RFC 6184)
@@ -38,6 +69,10 @@ public:
     // 设置MTU
     void setMtu(size_t mtu) { mtu_ = mtu; }
 
+protected:
+    void writeAggregationHeader(uint8_t* p) const override;
+    size_t aggregationHeaderSize() const override { return 1; }
+
 private:
     // 解析NALU单元
     std::vector<NaluUnit> parseNalus(const uint8_t* data, size_t size);
@@ -63,6 +98,10 @@ public:
     
     void setMtu(size_t mtu) { mtu_ = mtu; }
 
+protected:
+    void writeAggregationHeader(uint8_t* p) const override;
+    size_t aggregationHeaderSize() const override { return 2; }
+
 private:
     std::vector<NaluUnit> parseNalus(const uint8_t* data, size_t size);
     void packSingleNalu(const NaluUnit& nalu, uint32_t timestamp,
@@ -74,6 +113,19 @@ private:
     size_t mtu_ = 1400;
 };
 
+// RTCP RR/SR 中的一个报告块（RFC 3550 6.4.1）
+struct RtcpReportBlock {
+    uint32_t ssrc = 0;             // 被报告的媒体源 SSRC
+    uint8_t fraction_lost = 0;     // 上个报告周期的丢包率（x/256）
+    uint32_t cumulative_lost = 0;  // 累计丢包数（24bit）
+    uint32_t highest_seq = 0;      // 扩展最高序列号
+    uint32_t jitter = 0;           // 到达间隔抖动（RTP 时间戳单位）
+};
+
+// 在（复合）RTCP 包中查找针对 media_ssrc 的报告块
+bool parseRtcpReportBlock(const uint8_t* data, size_t size, uint32_t media_ssrc,
+                          RtcpReportBlock& block);
+
 // RTP包发送器
 class RtpSender {
 public:
@@ -90,13 +142,19 @@ public:
     // 发送RTP包
     bool sendRtpPacket(const RtpPacket& packet);
 
-    // 批量发送
+    // 批量发送（一帧的全部包一次提交，见 Socket::sendBatchTo）；全部发出返回 true
     bool sendRtpPackets(const std::vector<RtpPacket>& packets);
 
     // 发送RTCP包（简单的Sender Report）
     bool sendSenderReport(uint32_t rtp_timestamp, uint64_t ntp_timestamp,
                           uint32_t packet_count, uint32_t octet_count);
 
+    // 非阻塞读取对端发来的 RTCP，取最近一个针对本会话 SSRC 的报告块；无数据返回 false
+    bool pollReceiverReport(RtcpReportBlock& block);
+
+    // 清除对端与 SSRC，丢弃已收到的 RTCP：已绑定的端口对可直接给下一个会话复用
+    void resetPeer();
+
     uint16_t getLocalPort() const;
     uint16_t getLocalRtcpPort() const;
 
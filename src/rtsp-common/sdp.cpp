@@ -62,7 +62,8 @@ SdpBuilder& SdpBuilder::addAttribute(const std::string& name, const std::string&
 SdpBuilder& SdpBuilder::addH264Media(const std::string& control, uint16_t port,
                                       uint8_t payload_type, uint32_t clock_rate,
                                       const std::string& sps_base64, const std::string& pps_base64,
-                                      uint32_t width, uint32_t height) {
+                                      uint32_t width, uint32_t height,
+                                      const std::string& profile_level_id) {
     media_started_ = true;
     
     // m=video port RTP/AVP payload_type
@@ -73,6 +74,9 @@ SdpBuilder& SdpBuilder::addH264Media(const std::string& control, uint16_t port,
     
     // a=fmtp
     sdp_ << "a=fmtp:" << (int)payload_type << " packetization-mode=1";
+    if (!profile_level_id.empty()) {
+        sdp_ << ";profile-level-id=" << profile_level_id;
+    }
     if (!sps_base64.empty()) {
         sdp_ << ";sprop-parameter-sets=" << sps_base64 << "," << pps_base64;
     }
@@ -92,7 +96,8 @@ SdpBuilder& SdpBuilder::addH265Media(const std::string& control, uint16_t port,
                                       uint8_t payload_type, uint32_t clock_rate,
                                       const std::string& vps_base64, const std::string& sps_base64,
                                       const std::string& pps_base64,
-                                      uint32_t width, uint32_t height) {
+                                      uint32_t width, uint32_t height,
+                                      uint8_t profile_id, uint8_t level_id, bool high_tier) {
     media_started_ = true;
     
     // m=video port RTP/AVP payload_type
@@ -104,9 +109,15 @@ SdpBuilder& SdpBuilder::addH265Media(const std::string& control, uint16_t port,
     // a=fmtp
     sdp_ << "a=fmtp:" << (int)payload_type << " ";
     
-    // sprop-sps, sprop-pps, sprop-vps
+    // profile-id / tier-flag / level-id（RFC 7798 7.1），sprop-sps, sprop-pps, sprop-vps
     bool has_param = false;
+    if (profile_id != 0 && level_id != 0) {
+        sdp_ << "profile-id=" << (int)profile_id << ";tier-flag=" << (high_tier ? 1 : 0)
+             << ";level-id=" << (int)level_id;
+        has_param = true;
+    }
     if (!sps_base64.empty()) {
+        if (has_param) sdp_ << ";";
         sdp_ << "sprop-sps=" << sps_base64;
         has_param = true;
     }
@@ -201,6 +212,11 @@ bool SdpParser::parse(const std::string& sdp) {
             }
             continue;
         }
+        if (line.rfind("m=", 0) == 0) {
+            // 非视频 media section（audio/application）开始后，不再修改上一路视频的字段
+            current_media = nullptr;
+            continue;
+        }
 
         if (current_media == nullptr) {
             continue;
@@ -229,6 +245,8 @@ bool SdpParser::parse(const std::string& sdp) {
                     current_media->codec = CodecType::H265;
                 }
             }
+        } else if (line.rfind("a=control:", 0) == 0) {
+            current_media->control = line.substr(10);
         } else if (line.rfind("a=framesize:", 0) == 0) {
             static const std::regex size_regex(R"(a=framesize:\d+\s+(\d+)-(\d+))", std::regex::icase);
             std::smatch match;
@@ -306,6 +324,10 @@ SdpMediaInfo SdpParser::getVideoInfo() const {
     return info;
 }
 
+std::vector<SdpMediaInfo> SdpParser::getVideoInfos() const {
+    return media_infos_;
+}
+
 std::string SdpParser::getControlUrl(const std::string& base_url) const {
     // 查找a=control行
     size_t pos = sdp_.find("a=control:");
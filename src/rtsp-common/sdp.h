@@ -21,18 +21,20 @@ public:
     SdpBuilder& setTime(uint64_t start_time = 0, uint64_t stop_time = 0);
     SdpBuilder& addAttribute(const std::string& name, const std::string& value = "");
     
-    // 媒体级别 - H.264
+    // 媒体级别 - H.264。profile_level_id 为 SPS 第 1~3 字节的 6 位十六进制，空则不写
     SdpBuilder& addH264Media(const std::string& control, uint16_t port,
                              uint8_t payload_type, uint32_t clock_rate,
                              const std::string& sps_base64, const std::string& pps_base64,
-                             uint32_t width, uint32_t height);
+                             uint32_t width, uint32_t height,
+                             const std::string& profile_level_id = std::string());
     
-    // 媒体级别 - H.265
+    // 媒体级别 - H.265。profile_id / level_id 为 SPS 中的 general_profile_idc / general_level_idc，0 则不写
     SdpBuilder& addH265Media(const std::string& control, uint16_t port,
                              uint8_t payload_type, uint32_t clock_rate,
                              const std::string& vps_base64, const std::string& sps_base64,
                              const std::string& pps_base64,
-                             uint32_t width, uint32_t height);
+                             uint32_t width, uint32_t height,
+                             uint8_t profile_id = 0, uint8_t level_id = 0, bool high_tier = false);
     
     // 构建SDP字符串
     std::string build() const;
@@ -58,6 +60,8 @@ public:
     bool hasVideo() const;
     bool hasAudio() const;
     SdpMediaInfo getVideoInfo() const;
+    // 全部视频 media section（按 SDP 中出现顺序），用于多轨 ANNOUNCE
+    std::vector<SdpMediaInfo> getVideoInfos() const;
     
     // 获取控制URL
     std::string getControlUrl(const std::string& base_url) const;
@@ -7,13 +7,17 @@
 
 #include <rtsp-common/socket.h>
 #include <rtsp-common/common.h>
+#include "io_uring_backend.h"
+#include "thread_policy.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <chrono>
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <mutex>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -68,6 +72,67 @@ public:
 
 static NetworkInit g_network_init;
 
+namespace {
+
+thread_local uint64_t t_io_syscalls = 0;
+
+// -1 表示尚未从环境变量初始化
+std::atomic<int> g_io_backend{-1};
+
+IoBackend resolveIoBackend(IoBackend backend) {
+    if (backend == IoBackend::Auto) {
+        return uring::available() ? IoBackend::IoUring : IoBackend::Poll;
+    }
+    return backend;
+}
+
+IoBackend initialIoBackend() {
+    const char* env = std::getenv("RTSP_IO_BACKEND");
+    const std::string name = env ? env : "auto";
+    if (name == "poll") {
+        return IoBackend::Poll;
+    }
+    if (name == "io_uring" && !uring::available()) {
+        RTSP_LOG_WARNING("RTSP_IO_BACKEND=io_uring but io_uring is unavailable, using poll");
+    }
+    return resolveIoBackend(IoBackend::Auto);
+}
+
+// recvmmsg 一次最多取回的报文数；每个槽按最大 UDP 报文分配
+constexpr size_t kRecvBatchSlots = 8;
+constexpr size_t kRecvSlotSize = 65536;
+// recvBatchNow 单次的报文数上限（调用方自带缓冲）
+constexpr size_t kRecvBatchSlotsMax = 64;
+constexpr size_t kSendBatchMax = 64;
+
+} // namespace
+
+void addThreadIoSyscalls(uint64_t count) {
+    t_io_syscalls += count;
+}
+
+uint64_t threadIoSyscalls() {
+    return t_io_syscalls;
+}
+
+bool setIoBackend(IoBackend backend) {
+    if (backend == IoBackend::IoUring && !uring::available()) {
+        return false;
+    }
+    g_io_backend.store(static_cast<int>(resolveIoBackend(backend)), std::memory_order_relaxed);
+    return true;
+}
+
+IoBackend getIoBackend() {
+    int value = g_io_backend.load(std::memory_order_relaxed);
+    if (value < 0) {
+        int expected = -1;
+        g_io_backend.compare_exchange_strong(expected, static_cast<int>(initialIoBackend()));
+        value = g_io_backend.load(std::memory_order_relaxed);
+    }
+    return static_cast<IoBackend>(value);
+}
+
 // Socket实现
 class Socket::Impl {
 public:
@@ -79,6 +144,14 @@ public:
     std::string peer_ip_;
     uint16_t peer_port_ = 0;
 
+    // io_uring 接收器（首次 recvBatch 时创建）。close 可能与收包线程并发，
+    // 收包期间持有 shared_ptr，环在本次等待返回后才释放
+    std::mutex receiver_mutex_;
+    std::shared_ptr<uring::Receiver> receiver_;
+    bool receiver_unsupported_ = false;
+    // Poll 后端 recvmmsg 的接收区（首次使用时分配，未写入的页不占物理内存）
+    std::unique_ptr<uint8_t[]> batch_buffer_;
+
     Impl() = default;
     explicit Impl(int fd) : fd_(fd) {
         if (fd >= 0) {
@@ -102,12 +175,49 @@ public:
 #else
                 ::close(cur);
 #endif
+                dropReceiver();
                 return;
             }
             // cur 已更新为当前值；若仍 >=0 循环继续
         }
     }
 
+    void dropReceiver() {
+        std::shared_ptr<uring::Receiver> receiver;
+        {
+            std::lock_guard<std::mutex> lock(receiver_mutex_);
+            receiver.swap(receiver_);
+        }
+    }
+
+    std::shared_ptr<uring::Receiver> uringReceiver(int fd) {
+        std::lock_guard<std::mutex> lock(receiver_mutex_);
+        if (!receiver_ && !receiver_unsupported_) {
+            receiver_ = uring::Receiver::create(fd);
+            receiver_unsupported_ = !receiver_;
+        }
+        return receiver_;
+    }
+
+    void shutdownReceiver() {
+        std::shared_ptr<uring::Receiver> receiver;
+        {
+            std::lock_guard<std::mutex> lock(receiver_mutex_);
+            receiver = receiver_;
+        }
+        if (receiver) {
+            receiver->shutdown();
+        }
+    }
+
+    void disableReceiver() {
+        {
+            std::lock_guard<std::mutex> lock(receiver_mutex_);
+            receiver_unsupported_ = true;
+        }
+        dropReceiver();
+    }
+
     void updateLocalAddr() {
         if (fd_ < 0) return;
         struct sockaddr_storage addr;
@@ -260,14 +370,24 @@ bool Socket::connect(const std::string& ip, uint16_t port, int timeout_ms) {
     return true;
 }
 
-bool Socket::bindUdp(const std::string& ip, uint16_t port) {
+bool Socket::bindUdp(const std::string& ip, uint16_t port, bool reuse_port) {
     int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (fd < 0) return false;
 
     impl_->fd_ = fd;
-    if (!setReuseAddr(true)) {
+    // 不设 SO_REUSEADDR：UDP 没有 TIME_WAIT，设了反而让同进程的多个客户端/服务端
+    // 绑到同一端口（Linux 上单播只投递给其中一个），端口探测失效。
+    if (reuse_port) {
+#ifdef SO_REUSEPORT
+        int opt = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const char*)&opt, sizeof(opt)) < 0) {
+            impl_->close();
+            return false;
+        }
+#else
         impl_->close();
         return false;
+#endif
     }
 
     struct sockaddr_in addr;
@@ -294,16 +414,202 @@ ssize_t Socket::sendTo(const uint8_t* data, size_t size, const std::string& ip,
     addr.sin_port = htons(port);
     inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
 
+    addThreadIoSyscalls(1);
     return sendto(impl_->fd_, (const char*)data, size, 0, 
                   (struct sockaddr*)&addr, sizeof(addr));
 }
 
+size_t Socket::sendBatchTo(const UdpDatagram* datagrams, size_t count, const std::string& ip, uint16_t port) {
+    const int fd = impl_->fd_.load(std::memory_order_acquire);
+    if (fd < 0 || count == 0) return 0;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
+
+    if (getIoBackend() == IoBackend::IoUring) {
+        const int sent = uring::sendBatch(fd, datagrams, count, addr);
+        if (sent >= 0) {
+            return static_cast<size_t>(sent);
+        }
+    }
+
+    size_t sent = 0;
+#ifdef __linux__
+    struct mmsghdr messages[kSendBatchMax];
+    struct iovec vectors[kSendBatchMax];
+    while (sent < count) {
+        const size_t batch = std::min(count - sent, kSendBatchMax);
+        memset(messages, 0, sizeof(struct mmsghdr) * batch);
+        for (size_t i = 0; i < batch; ++i) {
+            vectors[i].iov_base = const_cast<uint8_t*>(datagrams[sent + i].data);
+            vectors[i].iov_len = datagrams[sent + i].size;
+            messages[i].msg_hdr.msg_name = &addr;
+            messages[i].msg_hdr.msg_namelen = sizeof(addr);
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        addThreadIoSyscalls(1);
+        const int ret = sendmmsg(fd, messages, static_cast<unsigned>(batch), 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        sent += static_cast<size_t>(ret);
+        if (static_cast<size_t>(ret) < batch) {
+            break;
+        }
+    }
+#else
+    for (; sent < count; ++sent) {
+        addThreadIoSyscalls(1);
+        const ssize_t ret = sendto(fd, (const char*)datagrams[sent].data, datagrams[sent].size, 0,
+                                   (struct sockaddr*)&addr, sizeof(addr));
+        if (ret != static_cast<ssize_t>(datagrams[sent].size)) {
+            break;
+        }
+    }
+#endif
+    return sent;
+}
+
+int Socket::recvBatch(const std::function<void(const uint8_t*, size_t)>& on_datagram, int timeout_ms) {
+    const int fd = impl_->fd_.load(std::memory_order_acquire);
+    if (fd < 0) return -1;
+
+    if (getIoBackend() == IoBackend::IoUring) {
+        std::shared_ptr<uring::Receiver> receiver = impl_->uringReceiver(fd);
+        if (receiver) {
+            const int ret = receiver->receive(on_datagram, timeout_ms);
+            if (ret != uring::Receiver::kUnsupported) {
+                return ret;
+            }
+            RTSP_LOG_WARNING("io_uring multishot recv unsupported, falling back to poll");
+            impl_->disableReceiver();
+        }
+    } else {
+        // 切回 Poll：挂着的多发 recv 会抢走报文，先撤掉
+        impl_->dropReceiver();
+    }
+
+    const int ready = waitReadable(timeout_ms);
+    if (ready <= 0) return ready;
+    if (!impl_->batch_buffer_) {
+        impl_->batch_buffer_.reset(new uint8_t[kRecvBatchSlots * kRecvSlotSize]);
+    }
+    uint8_t* buffers = impl_->batch_buffer_.get();
+
+#ifdef __linux__
+    struct mmsghdr messages[kRecvBatchSlots];
+    struct iovec vectors[kRecvBatchSlots];
+    memset(messages, 0, sizeof(messages));
+    for (size_t i = 0; i < kRecvBatchSlots; ++i) {
+        vectors[i].iov_base = buffers + i * kRecvSlotSize;
+        vectors[i].iov_len = kRecvSlotSize;
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    addThreadIoSyscalls(1);
+    const int ret = recvmmsg(fd, messages, static_cast<unsigned>(kRecvBatchSlots), MSG_DONTWAIT, nullptr);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    int delivered = 0;
+    for (int i = 0; i < ret; ++i) {
+        if (messages[i].msg_len > 0) {
+            on_datagram(buffers + static_cast<size_t>(i) * kRecvSlotSize, messages[i].msg_len);
+            delivered++;
+        }
+    }
+    return delivered;
+#else
+    std::string from_ip;
+    uint16_t from_port = 0;
+    const ssize_t len = recvFrom(buffers, kRecvSlotSize, from_ip, from_port);
+    if (len < 0) return -1;
+    if (len > 0) {
+        on_datagram(buffers, static_cast<size_t>(len));
+        return 1;
+    }
+    return 0;
+#endif
+}
+
+int Socket::recvBatchNow(uint8_t* buffer, size_t slot_size, size_t slots,
+                         const std::function<void(const uint8_t*, size_t, const UdpSource&)>& on_datagram) {
+    const int fd = impl_->fd_.load(std::memory_order_acquire);
+    if (fd < 0) return -1;
+    slots = std::min(slots, kRecvBatchSlotsMax);
+
+#ifdef __linux__
+    struct mmsghdr messages[kRecvBatchSlotsMax];
+    struct iovec vectors[kRecvBatchSlotsMax];
+    struct sockaddr_in addrs[kRecvBatchSlotsMax];
+    memset(messages, 0, sizeof(messages[0]) * slots);
+    for (size_t i = 0; i < slots; ++i) {
+        vectors[i].iov_base = buffer + i * slot_size;
+        vectors[i].iov_len = slot_size;
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &addrs[i];
+        messages[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    }
+    addThreadIoSyscalls(1);
+    const int ret = recvmmsg(fd, messages, static_cast<unsigned>(slots), MSG_DONTWAIT, nullptr);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    int delivered = 0;
+    for (int i = 0; i < ret; ++i) {
+        if (messages[i].msg_len > 0) {
+            UdpSource source;
+            source.ip = ntohl(addrs[i].sin_addr.s_addr);
+            source.port = ntohs(addrs[i].sin_port);
+            on_datagram(buffer + static_cast<size_t>(i) * slot_size, messages[i].msg_len, source);
+            delivered++;
+        }
+    }
+    return delivered;
+#else
+    int delivered = 0;
+    for (size_t i = 0; i < slots; ++i) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        addThreadIoSyscalls(1);
+        const ssize_t len = recvfrom(fd, (char*)buffer, static_cast<int>(slot_size), 0,
+                                     (struct sockaddr*)&addr, &addr_len);
+        if (len <= 0) {
+            break;
+        }
+        UdpSource source;
+        source.ip = ntohl(addr.sin_addr.s_addr);
+        source.port = ntohs(addr.sin_port);
+        on_datagram(buffer, static_cast<size_t>(len), source);
+        delivered++;
+    }
+    return delivered;
+#endif
+}
+
+bool makeUdpSource(const std::string& ip, uint16_t port, UdpSource* out) {
+    struct in_addr addr;
+    if (!out || inet_pton(AF_INET, ip.c_str(), &addr) != 1) {
+        return false;
+    }
+    out->ip = ntohl(addr.s_addr);
+    out->port = port;
+    return true;
+}
+
 ssize_t Socket::recvFrom(uint8_t* buffer, size_t size, std::string& from_ip, uint16_t& from_port) {
     if (impl_->fd_ < 0) return -1;
 
     struct sockaddr_in addr;
     socklen_t addr_len = sizeof(addr);
     
+    addThreadIoSyscalls(1);
     ssize_t ret = recvfrom(impl_->fd_, (char*)buffer, size, 0,
                            (struct sockaddr*)&addr, &addr_len);
     
@@ -414,12 +720,46 @@ ssize_t Socket::recv(uint8_t* buffer, size_t size, int timeout_ms) {
     return ::recv(impl_->fd_, (char*)buffer, size, 0);
 }
 
+ssize_t Socket::sendSome(const uint8_t* data, size_t size) {
+    if (impl_->fd_ < 0) return -1;
+    if (size == 0) return 0;
+#ifdef _WIN32
+    ssize_t r = ::send(impl_->fd_, reinterpret_cast<const char*>(data), static_cast<int>(size), 0);
+    if (r < 0) {
+        return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+    }
+#else
+    ssize_t r = ::send(impl_->fd_, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (r < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+#endif
+    return r;
+}
+
+ssize_t Socket::recvSome(uint8_t* buffer, size_t size) {
+    if (impl_->fd_ < 0) return -1;
+#ifdef _WIN32
+    ssize_t r = ::recv(impl_->fd_, reinterpret_cast<char*>(buffer), static_cast<int>(size), 0);
+    if (r < 0) {
+        return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+    }
+#else
+    ssize_t r = ::recv(impl_->fd_, buffer, size, MSG_DONTWAIT);
+    if (r < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+#endif
+    return r == 0 ? -1 : r;
+}
+
 void Socket::close() {
     impl_->close();
 }
 
 bool Socket::shutdownReadWrite() {
     if (impl_->fd_ < 0) return false;
+    impl_->shutdownReceiver();
 #ifdef _WIN32
     return ::shutdown(impl_->fd_, SD_BOTH) == 0;
 #else
@@ -474,6 +814,7 @@ int Socket::waitReadable(int timeout_ms) const {
     pfd.fd = impl_->fd_;
     pfd.events = POLLIN;
     pfd.revents = 0;
+    addThreadIoSyscalls(1);
     int pr = poll(&pfd, 1, timeout_ms);
     if (pr < 0) return -1;
     if (pr == 0) return 0;
@@ -693,6 +1034,15 @@ bool Selector::isWritable(int fd) const {
     return false;
 }
 
+bool Selector::hasError(int fd) const {
+    for (const auto& pfd : impl_->fds_) {
+        if (pfd.fd == fd) {
+            return (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+        }
+    }
+    return false;
+}
+
 // TcpServer实现
 class TcpServer::Impl {
 public:
@@ -734,7 +1084,7 @@ bool TcpServer::start(const std::string& ip, uint16_t port) {
     }
 
     impl_->running_ = true;
-    impl_->thread_ = std::thread([this]() {
+    impl_->thread_ = startThread(ThreadRole::Connection, "rtsp-accept", [this]() {
         impl_->runLoop();
     });
 
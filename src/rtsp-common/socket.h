@@ -13,6 +13,25 @@
 
 namespace rtsp {
 
+// UDP 批量发送的一个报文
+struct UdpDatagram {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// UDP 报文来源（IPv4，主机字节序），共享端口按来源分流用
+struct UdpSource {
+    uint32_t ip = 0;
+    uint16_t port = 0;
+    bool operator==(const UdpSource& other) const { return ip == other.ip && port == other.port; }
+};
+
+// 点分十进制 IPv4 转 UdpSource；格式不对返回 false
+bool makeUdpSource(const std::string& ip, uint16_t port, UdpSource* out);
+
+// 本线程在 Socket 收发路径上发起的系统调用数（基准测试用）
+uint64_t threadIoSyscalls();
+
 // 跨平台socket封装
 class Socket {
 public:
@@ -33,9 +52,21 @@ public:
     bool connect(const std::string& ip, uint16_t port, int timeout_ms = 5000);
     
     // UDP
-    bool bindUdp(const std::string& ip, uint16_t port);
+    // reuse_port：设置 SO_REUSEPORT，多个 socket 绑同一端口由内核按四元组分摊（同一来源总落在同一个上）
+    bool bindUdp(const std::string& ip, uint16_t port, bool reuse_port = false);
     ssize_t sendTo(const uint8_t* data, size_t size, const std::string& ip, uint16_t port);
     ssize_t recvFrom(uint8_t* buffer, size_t size, std::string& from_ip, uint16_t& from_port);
+    // 把 datagrams 依次发给同一对端（如一帧打包出的全部 RTP 包），按当前 I/O 后端一次提交：
+    // io_uring 为一次 io_uring_enter，Poll 为 sendmmsg（每 64 个一次）。返回按序成功发送的报文数
+    size_t sendBatchTo(const UdpDatagram* datagrams, size_t count, const std::string& ip, uint16_t port);
+    // 等待最多 timeout_ms 并取回当前已到达的全部报文，每个报文回调一次（数据仅在回调内有效）。
+    // 返回交付的报文数；超时 0；错误、shutdown 或已关闭 -1
+    int recvBatch(const std::function<void(const uint8_t*, size_t)>& on_datagram, int timeout_ms);
+    // 不等待、不走 io_uring：由外部事件循环（epoll）判定可读后调用，用 recvmmsg 取回至多 slots 个报文
+    // 到调用方提供的 buffer（slots * slot_size 字节），连同来源地址逐个回调。
+    // 返回交付的报文数；暂无数据 0；错误或已关闭 -1
+    int recvBatchNow(uint8_t* buffer, size_t slot_size, size_t slots,
+                     const std::function<void(const uint8_t*, size_t, const UdpSource&)>& on_datagram);
 
     // 通用
     ssize_t send(const uint8_t* data, size_t size);
@@ -44,6 +75,10 @@ public:
     // 避免 TCP 对端不读时阻塞主调用链（RTSP interleaved 模式下必需）。
     ssize_t sendAll(const uint8_t* data, size_t size, int timeout_ms);
     ssize_t recv(uint8_t* buffer, size_t size, int timeout_ms = -1);
+    // 非阻塞收发（单线程事件循环用）：返回本次传输的字节数，暂时不可读/写返回 0，
+    // 出错或对端关闭返回 -1。Windows 上须先 setNonBlocking(true)
+    ssize_t sendSome(const uint8_t* data, size_t size);
+    ssize_t recvSome(uint8_t* buffer, size_t size);
 
     void close();
     bool shutdownReadWrite();
@@ -88,6 +123,8 @@ public:
     
     bool isReadable(int fd) const;
     bool isWritable(int fd) const;
+    // 出错或对端挂断（POLLERR/POLLHUP），此时不一定同时可读
+    bool hasError(int fd) const;
 
 private:
     class Impl;
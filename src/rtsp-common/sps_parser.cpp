@@ -0,0 +1,438 @@
+#include <rtsp-common/sps_parser.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace rtsp {
+
+namespace {
+
+// RBSP 位读取器：构造时去掉防竞争字节（00 00 03），越界后 ok() 为 false、读数恒为 0
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) {
+        rbsp_.reserve(size);
+        size_t zeros = 0;
+        for (size_t i = 0; i < size; ++i) {
+            if (zeros >= 2 && data[i] == 0x03) {
+                zeros = 0;
+                continue;
+            }
+            zeros = data[i] == 0 ? zeros + 1 : 0;
+            rbsp_.push_back(data[i]);
+        }
+    }
+
+    bool ok() const { return ok_; }
+
+    uint32_t bits(int n) {
+        uint32_t value = 0;
+        for (int i = 0; i < n; ++i) {
+            if (pos_ >= rbsp_.size() * 8) {
+                ok_ = false;
+                return 0;
+            }
+            value = (value << 1) | ((rbsp_[pos_ >> 3] >> (7 - (pos_ & 7))) & 1);
+            pos_++;
+        }
+        return value;
+    }
+
+    bool flag() { return bits(1) != 0; }
+
+    void skip(size_t n) {
+        pos_ += n;
+        if (pos_ > rbsp_.size() * 8) {
+            ok_ = false;
+        }
+    }
+
+    // ue(v)
+    uint32_t ue() {
+        int leading_zeros = 0;
+        while (ok_ && bits(1) == 0) {
+            if (++leading_zeros > 31) {
+                ok_ = false;
+                return 0;
+            }
+        }
+        if (!ok_) {
+            return 0;
+        }
+        return static_cast<uint32_t>((1ull << leading_zeros) - 1 + bits(leading_zeros));
+    }
+
+    // se(v)
+    int32_t se() {
+        const uint32_t k = ue();
+        return (k & 1) ? static_cast<int32_t>((k + 1) / 2) : -static_cast<int32_t>(k / 2);
+    }
+
+private:
+    std::vector<uint8_t> rbsp_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+uint32_t roundedFps(uint32_t time_scale, uint64_t ticks_per_frame) {
+    if (time_scale == 0 || ticks_per_frame == 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>((time_scale + ticks_per_frame / 2) / ticks_per_frame);
+}
+
+// H.264 7.3.2.1.1.1 scaling_list()
+void skipH264ScalingList(BitReader& r, int size) {
+    int last = 8;
+    int next = 8;
+    for (int j = 0; j < size && r.ok(); ++j) {
+        if (next != 0) {
+            next = (last + r.se() + 256) % 256;
+        }
+        last = next == 0 ? last : next;
+    }
+}
+
+// H.264 E.1.1 中帧率所需的前半段
+uint32_t parseH264VuiFps(BitReader& r) {
+    if (r.flag()) {                      // aspect_ratio_info_present_flag
+        if (r.bits(8) == 255) {          // Extended_SAR
+            r.skip(32);
+        }
+    }
+    if (r.flag()) {                      // overscan_info_present_flag
+        r.skip(1);
+    }
+    if (r.flag()) {                      // video_signal_type_present_flag
+        r.skip(4);
+        if (r.flag()) {                  // colour_description_present_flag
+            r.skip(24);
+        }
+    }
+    if (r.flag()) {                      // chroma_loc_info_present_flag
+        r.ue();
+        r.ue();
+    }
+    if (!r.flag()) {                     // timing_info_present_flag
+        return 0;
+    }
+    const uint32_t num_units_in_tick = r.bits(32);
+    const uint32_t time_scale = r.bits(32);
+    // 帧率 = time_scale / (2 * num_units_in_tick)（一帧两个场周期）
+    return r.ok() ? roundedFps(time_scale, 2ull * num_units_in_tick) : 0;
+}
+
+// H.265 7.3.3 profile_tier_level(1, max_sub_layers_minus1)
+void parseH265ProfileTierLevel(BitReader& r, uint32_t max_sub_layers_minus1, SpsInfo& info) {
+    r.skip(2);                           // general_profile_space
+    info.high_tier = r.flag();
+    info.profile_idc = static_cast<uint8_t>(r.bits(5));
+    r.skip(32 + 48);                     // compatibility flags + constraint flags
+    info.level_idc = static_cast<uint8_t>(r.bits(8));
+
+    bool profile_present[8] = {};
+    bool level_present[8] = {};
+    for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+        profile_present[i] = r.flag();
+        level_present[i] = r.flag();
+    }
+    if (max_sub_layers_minus1 > 0) {
+        r.skip(2 * (8 - max_sub_layers_minus1));
+    }
+    for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+        if (profile_present[i]) {
+            r.skip(88);
+        }
+        if (level_present[i]) {
+            r.skip(8);
+        }
+    }
+}
+
+// H.265 7.3.4 scaling_list_data()
+void skipH265ScalingListData(BitReader& r) {
+    for (int size_id = 0; size_id < 4 && r.ok(); ++size_id) {
+        for (int matrix_id = 0; matrix_id < 6; matrix_id += (size_id == 3) ? 3 : 1) {
+            if (!r.flag()) {             // scaling_list_pred_mode_flag
+                r.ue();                  // scaling_list_pred_matrix_id_delta
+                continue;
+            }
+            const int coef_num = std::min(64, 1 << (4 + (size_id << 1)));
+            if (size_id > 1) {
+                r.se();                  // scaling_list_dc_coef_minus8
+            }
+            for (int i = 0; i < coef_num; ++i) {
+                r.se();
+            }
+        }
+    }
+}
+
+// H.265 7.3.7 st_ref_pic_set(idx)；num_delta_pocs 记录各集合的 NumDeltaPocs 供后续集合预测
+bool skipH265StRefPicSet(BitReader& r, uint32_t idx, std::vector<uint32_t>& num_delta_pocs) {
+    bool inter_ref_pic_set_prediction = idx != 0 && r.flag();
+    if (inter_ref_pic_set_prediction) {
+        r.skip(1);                       // delta_rps_sign
+        r.ue();                          // abs_delta_rps_minus1
+        const uint32_t ref = num_delta_pocs[idx - 1];   // SPS 内 delta_idx_minus1 恒为 0
+        uint32_t count = 0;
+        for (uint32_t j = 0; j <= ref && r.ok(); ++j) {
+            const bool used_by_curr_pic = r.flag();
+            const bool use_delta = used_by_curr_pic || r.flag();
+            count += use_delta ? 1 : 0;
+        }
+        num_delta_pocs[idx] = count;
+    } else {
+        const uint32_t num_negative = r.ue();
+        const uint32_t num_positive = r.ue();
+        if (num_negative > 16 || num_positive > 16) {
+            return false;
+        }
+        for (uint32_t i = 0; i < num_negative + num_positive && r.ok(); ++i) {
+            r.ue();                      // delta_poc_sX_minus1
+            r.skip(1);                   // used_by_curr_pic_sX_flag
+        }
+        num_delta_pocs[idx] = num_negative + num_positive;
+    }
+    return r.ok();
+}
+
+// H.265 E.2.1 中帧率所需的前半段
+uint32_t parseH265VuiFps(BitReader& r) {
+    if (r.flag()) {                      // aspect_ratio_info_present_flag
+        if (r.bits(8) == 255) {
+            r.skip(32);
+        }
+    }
+    if (r.flag()) {                      // overscan_info_present_flag
+        r.skip(1);
+    }
+    if (r.flag()) {                      // video_signal_type_present_flag
+        r.skip(4);
+        if (r.flag()) {
+            r.skip(24);
+        }
+    }
+    if (r.flag()) {                      // chroma_loc_info_present_flag
+        r.ue();
+        r.ue();
+    }
+    r.skip(3);                           // neutral_chroma / field_seq / frame_field_info_present
+    if (r.flag()) {                      // default_display_window_flag
+        r.ue();
+        r.ue();
+        r.ue();
+        r.ue();
+    }
+    if (!r.flag()) {                     // vui_timing_info_present_flag
+        return 0;
+    }
+    const uint32_t num_units_in_tick = r.bits(32);
+    const uint32_t time_scale = r.bits(32);
+    return r.ok() ? roundedFps(time_scale, num_units_in_tick) : 0;
+}
+
+} // namespace
+
+bool parseH264Sps(const uint8_t* nalu, size_t size, SpsInfo& info) {
+    if (!nalu || size < 4 || (nalu[0] & 0x1F) != 7) {
+        return false;
+    }
+    BitReader r(nalu + 1, size - 1);
+    SpsInfo out;
+    out.profile_idc = static_cast<uint8_t>(r.bits(8));
+    out.constraint_flags = static_cast<uint8_t>(r.bits(8));
+    out.level_idc = static_cast<uint8_t>(r.bits(8));
+    r.ue();                              // seq_parameter_set_id
+
+    uint32_t chroma_format_idc = 1;
+    bool separate_colour_plane = false;
+    switch (out.profile_idc) {
+    case 100: case 110: case 122: case 244: case 44: case 83:
+    case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+        chroma_format_idc = r.ue();
+        if (chroma_format_idc > 3) {
+            return false;
+        }
+        if (chroma_format_idc == 3) {
+            separate_colour_plane = r.flag();
+        }
+        r.ue();                          // bit_depth_luma_minus8
+        r.ue();                          // bit_depth_chroma_minus8
+        r.skip(1);                       // qpprime_y_zero_transform_bypass_flag
+        if (r.flag()) {                  // seq_scaling_matrix_present_flag
+            const int lists = chroma_format_idc != 3 ? 8 : 12;
+            for (int i = 0; i < lists && r.ok(); ++i) {
+                if (r.flag()) {
+                    skipH264ScalingList(r, i < 6 ? 16 : 64);
+                }
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    r.ue();                              // log2_max_frame_num_minus4
+    const uint32_t pic_order_cnt_type = r.ue();
+    if (pic_order_cnt_type == 0) {
+        r.ue();                          // log2_max_pic_order_cnt_lsb_minus4
+    } else if (pic_order_cnt_type == 1) {
+        r.skip(1);                       // delta_pic_order_always_zero_flag
+        r.se();
+        r.se();
+        const uint32_t cycle = r.ue();
+        if (cycle > 255) {
+            return false;
+        }
+        for (uint32_t i = 0; i < cycle && r.ok(); ++i) {
+            r.se();
+        }
+    }
+    r.ue();                              // max_num_ref_frames
+    r.skip(1);                           // gaps_in_frame_num_value_allowed_flag
+    const uint32_t width_in_mbs = r.ue() + 1;
+    const uint32_t height_in_map_units = r.ue() + 1;
+    const bool frame_mbs_only = r.flag();
+    if (!frame_mbs_only) {
+        r.skip(1);                       // mb_adaptive_frame_field_flag
+    }
+    r.skip(1);                           // direct_8x8_inference_flag
+    uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (r.flag()) {                      // frame_cropping_flag
+        crop_left = r.ue();
+        crop_right = r.ue();
+        crop_top = r.ue();
+        crop_bottom = r.ue();
+    }
+    if (!r.ok()) {
+        return false;
+    }
+
+    // 7.4.2.1.1：裁剪单位取决于 ChromaArrayType 与场/帧编码
+    const uint32_t chroma_array_type = separate_colour_plane ? 0 : chroma_format_idc;
+    const uint32_t sub_width_c = (chroma_array_type == 1 || chroma_array_type == 2) ? 2 : 1;
+    const uint32_t sub_height_c = chroma_array_type == 1 ? 2 : 1;
+    const uint32_t crop_unit_x = chroma_array_type == 0 ? 1 : sub_width_c;
+    const uint32_t crop_unit_y = (chroma_array_type == 0 ? 1 : sub_height_c) * (frame_mbs_only ? 1 : 2);
+    const uint64_t width = static_cast<uint64_t>(width_in_mbs) * 16;
+    const uint64_t height = static_cast<uint64_t>(height_in_map_units) * 16 * (frame_mbs_only ? 1 : 2);
+    const uint64_t crop_x = static_cast<uint64_t>(crop_unit_x) * (crop_left + static_cast<uint64_t>(crop_right));
+    const uint64_t crop_y = static_cast<uint64_t>(crop_unit_y) * (crop_top + static_cast<uint64_t>(crop_bottom));
+    if (crop_x >= width || crop_y >= height || width > 16384 || height > 16384) {
+        return false;
+    }
+    out.width = static_cast<uint32_t>(width - crop_x);
+    out.height = static_cast<uint32_t>(height - crop_y);
+
+    if (r.flag()) {                      // vui_parameters_present_flag
+        out.fps = parseH264VuiFps(r);
+    }
+    info = out;
+    return true;
+}
+
+bool parseH265Sps(const uint8_t* nalu, size_t size, SpsInfo& info) {
+    if (!nalu || size < 4 || ((nalu[0] >> 1) & 0x3F) != 33) {
+        return false;
+    }
+    BitReader r(nalu + 2, size - 2);
+    SpsInfo out;
+    r.skip(4);                           // sps_video_parameter_set_id
+    const uint32_t max_sub_layers_minus1 = r.bits(3);
+    r.skip(1);                           // sps_temporal_id_nesting_flag
+    if (max_sub_layers_minus1 > 6) {
+        return false;
+    }
+    parseH265ProfileTierLevel(r, max_sub_layers_minus1, out);
+    r.ue();                              // sps_seq_parameter_set_id
+    const uint32_t chroma_format_idc = r.ue();
+    if (chroma_format_idc > 3) {
+        return false;
+    }
+    bool separate_colour_plane = false;
+    if (chroma_format_idc == 3) {
+        separate_colour_plane = r.flag();
+    }
+    const uint32_t pic_width = r.ue();
+    const uint32_t pic_height = r.ue();
+    uint32_t conf_left = 0, conf_right = 0, conf_top = 0, conf_bottom = 0;
+    if (r.flag()) {                      // conformance_window_flag
+        conf_left = r.ue();
+        conf_right = r.ue();
+        conf_top = r.ue();
+        conf_bottom = r.ue();
+    }
+    if (!r.ok()) {
+        return false;
+    }
+
+    // 一致性窗口以色度样点为单位（6.2 SubWidthC/SubHeightC）
+    const uint32_t chroma_array_type = separate_colour_plane ? 0 : chroma_format_idc;
+    const uint32_t sub_width_c = (chroma_array_type == 1 || chroma_array_type == 2) ? 2 : 1;
+    const uint32_t sub_height_c = chroma_array_type == 1 ? 2 : 1;
+    const uint64_t crop_x = static_cast<uint64_t>(sub_width_c) * (conf_left + static_cast<uint64_t>(conf_right));
+    const uint64_t crop_y = static_cast<uint64_t>(sub_height_c) * (conf_top + static_cast<uint64_t>(conf_bottom));
+    if (pic_width == 0 || pic_height == 0 || crop_x >= pic_width || crop_y >= pic_height ||
+        pic_width > 16888 || pic_height > 16888) {
+        return false;
+    }
+    out.width = static_cast<uint32_t>(pic_width - crop_x);
+    out.height = static_cast<uint32_t>(pic_height - crop_y);
+
+    // 以下只为走到 VUI 取帧率；中途失败时分辨率与 profile/level 仍然有效
+    info = out;
+    r.ue();                              // bit_depth_luma_minus8
+    r.ue();                              // bit_depth_chroma_minus8
+    const uint32_t log2_max_poc_lsb = r.ue() + 4;
+    const bool sub_layer_ordering_info_present = r.flag();
+    for (uint32_t i = sub_layer_ordering_info_present ? 0 : max_sub_layers_minus1;
+         i <= max_sub_layers_minus1; ++i) {
+        r.ue();
+        r.ue();
+        r.ue();
+    }
+    for (int i = 0; i < 6; ++i) {
+        r.ue();                          // log2_min_luma_coding_block_size_minus3 ... max_transform_hierarchy_depth_intra
+    }
+    if (r.flag() && r.flag()) {          // scaling_list_enabled_flag && sps_scaling_list_data_present_flag
+        skipH265ScalingListData(r);
+    }
+    r.skip(2);                           // amp_enabled_flag / sample_adaptive_offset_enabled_flag
+    if (r.flag()) {                      // pcm_enabled_flag
+        r.skip(8);
+        r.ue();
+        r.ue();
+        r.skip(1);
+    }
+    const uint32_t num_short_term_ref_pic_sets = r.ue();
+    if (!r.ok() || num_short_term_ref_pic_sets > 64 || log2_max_poc_lsb > 16) {
+        return true;
+    }
+    std::vector<uint32_t> num_delta_pocs(num_short_term_ref_pic_sets + 1, 0);
+    for (uint32_t i = 0; i < num_short_term_ref_pic_sets; ++i) {
+        if (!skipH265StRefPicSet(r, i, num_delta_pocs)) {
+            return true;
+        }
+    }
+    if (r.flag()) {                      // long_term_ref_pics_present_flag
+        const uint32_t num_long_term = r.ue();
+        if (num_long_term > 32) {
+            return true;
+        }
+        for (uint32_t i = 0; i < num_long_term; ++i) {
+            r.skip(log2_max_poc_lsb + 1);
+        }
+    }
+    r.skip(2);                           // sps_temporal_mvp_enabled_flag / strong_intra_smoothing_enabled_flag
+    if (r.ok() && r.flag()) {            // vui_parameters_present_flag
+        info.fps = parseH265VuiFps(r);
+    }
+    return true;
+}
+
+bool parseSps(CodecType codec, const uint8_t* nalu, size_t size, SpsInfo& info) {
+    return codec == CodecType::H264 ? parseH264Sps(nalu, size, info) : parseH265Sps(nalu, size, info);
+}
+
+} // namespace rtsp
@@ -0,0 +1,28 @@
+#pragma once
+
+// H.264 / H.265 SPS 解析：从参数集本身得出真实分辨率（已扣除裁剪窗口）、VUI 帧率与 profile/level，
+// 供 SDP、路径快照、ONVIF profile 与客户端 MediaInfo 使用。只在参数集变化时调用，不在逐帧路径上。
+
+#include <rtsp-common/common.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rtsp {
+
+struct SpsInfo {
+    uint32_t width = 0;                // 亮度像素宽度（已扣除 frame cropping / conformance window）
+    uint32_t height = 0;
+    uint32_t fps = 0;                  // VUI timing 给出的帧率（四舍五入），未给出为 0
+    uint8_t profile_idc = 0;           // H.264 profile_idc / H.265 general_profile_idc
+    uint8_t constraint_flags = 0;      // H.264 constraint_set0..5 标志字节（profile-level-id 中间字节）
+    uint8_t level_idc = 0;             // H.264 level_idc / H.265 general_level_idc
+    bool high_tier = false;            // H.265 general_tier_flag
+};
+
+// nalu 为去掉起始码的 SPS NALU（含 NALU 头，可含防竞争字节）。解析失败或越界返回 false
+bool parseH264Sps(const uint8_t* nalu, size_t size, SpsInfo& info);
+bool parseH265Sps(const uint8_t* nalu, size_t size, SpsInfo& info);
+bool parseSps(CodecType codec, const uint8_t* nalu, size_t size, SpsInfo& info);
+
+} // namespace rtsp
@@ -0,0 +1,102 @@
+#include <rtsp-common/thread_policy.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <linux/mempolicy.h>
+#elif defined(__APPLE__)
+    #include <pthread.h>
+#endif
+
+namespace rtsp {
+
+namespace {
+
+std::mutex g_policy_mutex;
+ThreadPolicy g_policy;
+
+const ThreadRolePolicy& rolePolicy(const ThreadPolicy& policy, ThreadRole role) {
+    switch (role) {
+        case ThreadRole::Connection: return policy.connection;
+        case ThreadRole::MediaSend: return policy.media_send;
+        case ThreadRole::MediaReceive: return policy.media_receive;
+        case ThreadRole::Background: return policy.background;
+        case ThreadRole::Http: return policy.http;
+        case ThreadRole::Discovery: return policy.discovery;
+    }
+    return policy.background;
+}
+
+void setCurrentThreadName(const char* name) {
+    char truncated[16];
+    std::strncpy(truncated, name, sizeof(truncated) - 1);
+    truncated[sizeof(truncated) - 1] = '\0';
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), truncated);
+#elif defined(__APPLE__)
+    pthread_setname_np(truncated);
+#else
+    (void)truncated;
+#endif
+}
+
+} // namespace
+
+void setThreadPolicy(const ThreadPolicy& policy) {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    g_policy = policy;
+}
+
+ThreadPolicy getThreadPolicy() {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    return g_policy;
+}
+
+void applyThreadPolicy(ThreadRole role, const char* name) {
+    ThreadPolicy policy = getThreadPolicy();
+    if (policy.set_names && name) {
+        setCurrentThreadName(name);
+    }
+    const ThreadRolePolicy& placement = rolePolicy(policy, role);
+
+#if defined(__linux__)
+    if (!placement.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : placement.cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            RTSP_LOG_WARNING(std::string("Thread affinity failed for ") + (name ? name : "thread") + ": " +
+                             std::strerror(err));
+        } else if (policy.numa_local_memory) {
+            // 绑核之后按所在节点分配；不支持 NUMA 的内核返回 ENOSYS，忽略即可
+            (void)syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0);
+        }
+    }
+    if (placement.fifo_priority > 0) {
+        sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = std::min(placement.fifo_priority, sched_get_priority_max(SCHED_FIFO));
+        const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            RTSP_LOG_WARNING(std::string("SCHED_FIFO failed for ") + (name ? name : "thread") + ": " +
+                             std::strerror(err));
+        }
+    }
+#else
+    (void)placement;
+#endif
+}
+
+} // namespace rtsp
@@ -0,0 +1,28 @@
+#pragma once
+
+// SDK 内部线程的唯一创建入口：新线程先按 ThreadPolicy 的角色设置命名、CPU 绑定、
+// 本地内存策略与 SCHED_FIFO 优先级，再运行线程体，保证策略在线程分配任何缓冲之前生效。
+
+#include <rtsp-common/common.h>
+
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace rtsp {
+
+// 在调用线程上应用策略；name 超过 15 字节时截断（Linux 线程名上限）
+void applyThreadPolicy(ThreadRole role, const char* name);
+
+// name 须为静态字符串；fn 可以是只能移动的可调用对象
+template <typename Fn>
+std::thread startThread(ThreadRole role, const char* name, Fn&& fn) {
+    return std::thread(
+        [role, name](typename std::decay<Fn>::type body) {
+            applyThreadPolicy(role, name);
+            body();
+        },
+        std::forward<Fn>(fn));
+}
+
+} // namespace rtsp
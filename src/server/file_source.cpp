@@ -0,0 +1,681 @@
+#include "file_source.h"
+
+#include <rtsp-common/common.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace rtsp {
+
+namespace {
+
+constexpr uint32_t kIndexMagic = 0x52534958;  // "RSIX"
+constexpr uint32_t kIndexVersion = 2;   // 2：时间戳改为微秒，头部增加 fps_den
+
+uint32_t readU16(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 8) | p[1];
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+uint64_t readU64(const uint8_t* p) {
+    return (static_cast<uint64_t>(readU32(p)) << 32) | readU32(p + 4);
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 24));
+    out.push_back(static_cast<uint8_t>(v >> 16));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void putU64(std::vector<uint8_t>& out, uint64_t v) {
+    putU32(out, static_cast<uint32_t>(v >> 32));
+    putU32(out, static_cast<uint32_t>(v));
+}
+
+void putBytes(std::vector<uint8_t>& out, const std::vector<uint8_t>& bytes) {
+    putU32(out, static_cast<uint32_t>(bytes.size()));
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+// 顺序读取索引文件，越界后 ok 置 false
+struct IndexReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    IndexReader(const uint8_t* d, size_t n) : data(d), size(n) {}
+
+    bool need(size_t n) {
+        if (!ok || size - pos < n) {
+            ok = false;
+        }
+        return ok;
+    }
+    uint8_t u8() { return need(1) ? data[pos++] : 0; }
+    uint32_t u32() {
+        if (!need(4)) return 0;
+        pos += 4;
+        return readU32(data + pos - 4);
+    }
+    uint64_t u64() {
+        if (!need(8)) return 0;
+        pos += 8;
+        return readU64(data + pos - 8);
+    }
+    std::vector<uint8_t> bytes() {
+        const uint32_t n = u32();
+        if (!need(n)) return {};
+        pos += n;
+        return std::vector<uint8_t>(data + pos - n, data + pos);
+    }
+};
+
+// ISO BMFF box：[start, end)，负载从 payload 开始
+struct Box {
+    char type[5] = {0};
+    size_t start = 0;
+    size_t payload = 0;
+    size_t end = 0;
+};
+
+bool readBox(const uint8_t* data, size_t limit, size_t pos, Box& box) {
+    if (pos + 8 > limit) {
+        return false;
+    }
+    uint64_t size = readU32(data + pos);
+    size_t header = 8;
+    if (size == 1) {
+        if (pos + 16 > limit) return false;
+        size = readU64(data + pos + 8);
+        header = 16;
+    } else if (size == 0) {
+        size = limit - pos;
+    }
+    if (size < header || size > limit - pos) {
+        return false;
+    }
+    std::memcpy(box.type, data + pos + 4, 4);
+    box.start = pos;
+    box.payload = pos + header;
+    box.end = pos + static_cast<size_t>(size);
+    return true;
+}
+
+bool findChild(const uint8_t* data, size_t begin, size_t end, const char* type, Box& out) {
+    Box box;
+    for (size_t pos = begin; readBox(data, end, pos, box); pos = box.end) {
+        if (std::memcmp(box.type, type, 4) == 0) {
+            out = box;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isH264AuStart(uint8_t type) {
+    return type == 6 || type == 7 || type == 8 || type == 9 || (type >= 14 && type <= 18);
+}
+
+bool isH265AuStart(uint8_t type) {
+    return (type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44) ||
+           (type >= 48 && type <= 55);
+}
+
+} // namespace
+
+FileSource::~FileSource() {
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_handle_) CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    if (file_handle_) CloseHandle(static_cast<HANDLE>(file_handle_));
+#else
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+}
+
+std::shared_ptr<FileSource> FileSource::open(const FilePathConfig& config) {
+    std::shared_ptr<FileSource> source(new FileSource());
+    if (!source->map(config.file)) {
+        RTSP_LOG_ERROR("Failed to map file: " + config.file);
+        return nullptr;
+    }
+    source->fmp4_ = source->size_ >= 8 && std::memcmp(source->data_ + 4, "ftyp", 4) == 0;
+
+    const std::string index_file = config.file + ".idx";
+    source->index_loaded_ = source->loadIndex(index_file, config);
+    if (!source->index_loaded_) {
+        const bool built = source->fmp4_ ? source->buildFmp4Index() : source->buildAnnexBIndex(config);
+        if (!built) {
+            RTSP_LOG_ERROR("No playable access units in file: " + config.file);
+            return nullptr;
+        }
+        if (config.write_index) {
+            source->saveIndex(index_file, config);
+        }
+    }
+
+    PathConfig& path_config = source->path_config_;
+    path_config.path = config.path;
+    if (path_config.fps == 0) {
+        path_config.fps = config.fps;
+    }
+    if (path_config.width == 0 || path_config.height == 0) {
+        path_config.width = config.width;
+        path_config.height = config.height;
+    }
+    if (source->fmp4_) {
+        static const uint8_t kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+        auto sets = std::make_shared<std::vector<uint8_t>>();
+        const std::vector<uint8_t>* parts[] = {&path_config.vps, &path_config.sps, &path_config.pps};
+        for (const auto* part : parts) {
+            if (!part->empty()) {
+                sets->insert(sets->end(), kStartCode, kStartCode + 4);
+                sets->insert(sets->end(), part->begin(), part->end());
+            }
+        }
+        source->parameter_sets_ = sets;
+    }
+    const FileIndexEntry& last = source->entries_.back();
+    source->duration_ms_ = (std::max(last.pts_us, last.dts_us) + 1000000 / std::max<uint32_t>(1, path_config.fps)) / 1000;
+    return source;
+}
+
+bool FileSource::map(const std::string& file) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(file.c_str(), &st) != 0) return false;
+    HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    file_handle_ = handle;
+    if (st.st_size <= 0) return false;
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) return false;
+    mapping_handle_ = mapping;
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) return false;
+    data_ = static_cast<const uint8_t*>(view);
+    size_ = static_cast<size_t>(st.st_size);
+    mtime_ = static_cast<int64_t>(st.st_mtime);
+    return true;
+#else
+    const int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // 映射建立后不再需要 fd
+    if (addr == MAP_FAILED) return false;
+    data_ = static_cast<const uint8_t*>(addr);
+    size_ = static_cast<size_t>(st.st_size);
+    mtime_ = static_cast<int64_t>(st.st_mtime);
+    return true;
+#endif
+}
+
+bool FileSource::buildAnnexBIndex(const FilePathConfig& config) {
+    const CodecType codec = config.codec;
+    const uint32_t fps = config.fps > 0 ? config.fps : 25;
+    const uint32_t fps_den = config.fps > 0 && config.fps_den > 0 ? config.fps_den : 1;
+    path_config_.codec = codec;
+    path_config_.fps = std::max<uint32_t>(1, (fps + fps_den / 2) / fps_den);
+
+    auto nextStartCode = [this](size_t from, size_t& begin, size_t& payload) {
+        for (size_t i = from; i + 3 <= size_; ++i) {
+            if (data_[i] == 0 && data_[i + 1] == 0 && data_[i + 2] == 1) {
+                begin = (i > from && data_[i - 1] == 0) ? i - 1 : i;
+                payload = i + 3;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    bool au_open = false;
+    bool au_has_vcl = false;
+    bool au_idr = false;
+    size_t au_begin = 0;
+    auto finishAu = [&](size_t end) {
+        if (au_open && au_has_vcl) {
+            FileIndexEntry entry;
+            entry.offset = au_begin;
+            entry.size = static_cast<uint32_t>(end - au_begin);
+            // 每帧由序号直接算出（n * fps_den / fps 秒），不累加取整后的帧时长
+            entry.pts_us = static_cast<uint64_t>(entries_.size()) * fps_den * 1000000 / fps;
+            entry.dts_us = entry.pts_us;
+            entry.is_idr = au_idr;
+            entries_.push_back(entry);
+        }
+        au_open = false;
+        au_has_vcl = false;
+        au_idr = false;
+    };
+
+    size_t begin = 0;
+    size_t payload = 0;
+    if (!nextStartCode(0, begin, payload)) {
+        return false;
+    }
+    while (true) {
+        size_t next_begin = 0;
+        size_t next_payload = 0;
+        const bool more = nextStartCode(payload, next_begin, next_payload);
+        const size_t end = more ? next_begin : size_;
+        if (payload < end) {
+            const uint8_t* nalu = data_ + payload;
+            const size_t nalu_size = end - payload;
+            bool vcl = false;
+            bool first_slice = false;
+            bool idr = false;
+            bool au_delimiter = false;
+            std::vector<uint8_t>* parameter_set = nullptr;
+            if (codec == CodecType::H264) {
+                const uint8_t type = nalu[0] & 0x1F;
+                vcl = type >= 1 && type <= 5;
+                idr = type == 5;
+                // first_mb_in_slice == 0 时 ue(v) 编码的首位为 1
+                first_slice = vcl && nalu_size > 1 && (nalu[1] & 0x80) != 0;
+                au_delimiter = isH264AuStart(type);
+                if (type == 7 && path_config_.sps.empty()) parameter_set = &path_config_.sps;
+                if (type == 8 && path_config_.pps.empty()) parameter_set = &path_config_.pps;
+            } else {
+                const uint8_t type = (nalu[0] >> 1) & 0x3F;
+                vcl = type <= 31;
+                idr = type >= 16 && type <= 21;
+                first_slice = vcl && nalu_size > 2 && (nalu[2] & 0x80) != 0;  // first_slice_segment_in_pic_flag
+                au_delimiter = isH265AuStart(type);
+                if (type == 32 && path_config_.vps.empty()) parameter_set = &path_config_.vps;
+                if (type == 33 && path_config_.sps.empty()) parameter_set = &path_config_.sps;
+                if (type == 34 && path_config_.pps.empty()) parameter_set = &path_config_.pps;
+            }
+            if (parameter_set) {
+                parameter_set->assign(nalu, nalu + nalu_size);
+            }
+            if (au_has_vcl && (au_delimiter || first_slice)) {
+                finishAu(begin);
+            }
+            if (!au_open) {
+                au_open = true;
+                au_begin = begin;
+            }
+            au_has_vcl = au_has_vcl || vcl;
+            au_idr = au_idr || idr;
+        }
+        if (!more) {
+            break;
+        }
+        begin = next_begin;
+        payload = next_payload;
+    }
+    finishAu(size_);
+    return !entries_.empty();
+}
+
+bool FileSource::buildFmp4Index() {
+    const uint8_t* d = data_;
+    Box moov;
+    if (!findChild(d, 0, size_, "moov", moov)) {
+        return false;
+    }
+
+    // 取第一条视频轨
+    uint32_t track_id = 0;
+    uint32_t timescale = 0;
+    uint32_t default_duration = 0;
+    uint32_t default_size = 0;
+    uint32_t default_flags = 0;
+    Box trak;
+    for (size_t pos = moov.payload; readBox(d, moov.end, pos, trak); pos = trak.end) {
+        if (std::memcmp(trak.type, "trak", 4) != 0) continue;
+        Box tkhd, mdia, mdhd, hdlr, minf, stbl, stsd;
+        if (!findChild(d, trak.payload, trak.end, "tkhd", tkhd) ||
+            !findChild(d, trak.payload, trak.end, "mdia", mdia) ||
+            !findChild(d, mdia.payload, mdia.end, "mdhd", mdhd) ||
+            !findChild(d, mdia.payload, mdia.end, "hdlr", hdlr) ||
+            hdlr.payload + 12 > hdlr.end || std::memcmp(d + hdlr.payload + 8, "vide", 4) != 0 ||
+            !findChild(d, mdia.payload, mdia.end, "minf", minf) ||
+            !findChild(d, minf.payload, minf.end, "stbl", stbl) ||
+            !findChild(d, stbl.payload, stbl.end, "stsd", stsd)) {
+            continue;
+        }
+        const bool tkhd_v1 = d[tkhd.payload] == 1;
+        const size_t tkhd_fields = tkhd.payload + 4 + (tkhd_v1 ? 32 : 20);
+        if (tkhd_fields + 16 + 36 + 8 > tkhd.end) continue;
+        track_id = readU32(d + tkhd.payload + 4 + (tkhd_v1 ? 16 : 8));
+        path_config_.width = readU32(d + tkhd_fields + 16 + 36) >> 16;
+        path_config_.height = readU32(d + tkhd_fields + 16 + 36 + 4) >> 16;
+        const bool mdhd_v1 = d[mdhd.payload] == 1;
+        timescale = readU32(d + mdhd.payload + 4 + (mdhd_v1 ? 16 : 8));
+
+        // stsd：fullbox + entry_count，随后是 avc1/hvc1 样本描述，其 78 字节固定字段后为子 box
+        Box entry;
+        if (!readBox(d, stsd.end, stsd.payload + 8, entry) || entry.payload + 78 > entry.end) continue;
+        Box config;
+        if (std::memcmp(entry.type, "avc1", 4) == 0 || std::memcmp(entry.type, "avc3", 4) == 0) {
+            if (!findChild(d, entry.payload + 78, entry.end, "avcC", config) || config.payload + 7 > config.end) continue;
+            path_config_.codec = CodecType::H264;
+            nal_length_size_ = (d[config.payload + 4] & 0x03) + 1u;
+            size_t p = config.payload + 5;
+            for (int list = 0; list < 2; ++list) {
+                if (p >= config.end) break;
+                const uint32_t count = list == 0 ? (d[p] & 0x1Fu) : d[p];
+                p++;
+                for (uint32_t i = 0; i < count && p + 2 <= config.end; ++i) {
+                    const uint32_t len = readU16(d + p);
+                    p += 2;
+                    if (p + len > config.end) break;
+                    auto& target = list == 0 ? path_config_.sps : path_config_.pps;
+                    if (target.empty()) target.assign(d + p, d + p + len);
+                    p += len;
+                }
+            }
+        } else if (std::memcmp(entry.type, "hvc1", 4) == 0 || std::memcmp(entry.type, "hev1", 4) == 0) {
+            if (!findChild(d, entry.payload + 78, entry.end, "hvcC", config) || config.payload + 23 > config.end) continue;
+            path_config_.codec = CodecType::H265;
+            nal_length_size_ = (d[config.payload + 21] & 0x03) + 1u;
+            const uint32_t arrays = d[config.payload + 22];
+            size_t p = config.payload + 23;
+            for (uint32_t a = 0; a < arrays && p + 3 <= config.end; ++a) {
+                const uint8_t type = d[p] & 0x3F;
+                const uint32_t count = readU16(d + p + 1);
+                p += 3;
+                for (uint32_t i = 0; i < count && p + 2 <= config.end; ++i) {
+                    const uint32_t len = readU16(d + p);
+                    p += 2;
+                    if (p + len > config.end) break;
+                    std::vector<uint8_t>* target = type == 32 ? &path_config_.vps
+                                                 : type == 33 ? &path_config_.sps
+                                                 : type == 34 ? &path_config_.pps : nullptr;
+                    if (target && target->empty()) target->assign(d + p, d + p + len);
+                    p += len;
+                }
+            }
+        } else {
+            continue;
+        }
+        break;
+    }
+    if (track_id == 0 || timescale == 0 || path_config_.sps.empty()) {
+        return false;
+    }
+
+    Box mvex, trex;
+    if (findChild(d, moov.payload, moov.end, "mvex", mvex)) {
+        for (size_t pos = mvex.payload; readBox(d, mvex.end, pos, trex); pos = trex.end) {
+            if (std::memcmp(trex.type, "trex", 4) == 0 && trex.payload + 24 <= trex.end &&
+                readU32(d + trex.payload + 4) == track_id) {
+                default_duration = readU32(d + trex.payload + 12);
+                default_size = readU32(d + trex.payload + 16);
+                default_flags = readU32(d + trex.payload + 20);
+            }
+        }
+    }
+
+    uint64_t decode_time = 0;
+    Box moof;
+    for (size_t pos = 0; readBox(d, size_, pos, moof); pos = moof.end) {
+        if (std::memcmp(moof.type, "moof", 4) != 0) continue;
+        Box traf;
+        for (size_t tpos = moof.payload; readBox(d, moof.end, tpos, traf); tpos = traf.end) {
+            if (std::memcmp(traf.type, "traf", 4) != 0) continue;
+            Box tfhd;
+            if (!findChild(d, traf.payload, traf.end, "tfhd", tfhd) || tfhd.payload + 8 > tfhd.end) continue;
+            const uint32_t tfhd_flags = readU32(d + tfhd.payload) & 0xFFFFFF;
+            if (readU32(d + tfhd.payload + 4) != track_id) continue;
+            size_t p = tfhd.payload + 8;
+            uint64_t base_offset = moof.start;
+            uint32_t duration = default_duration;
+            uint32_t sample_size = default_size;
+            uint32_t flags = default_flags;
+            if (tfhd_flags & 0x000001) { base_offset = readU64(d + p); p += 8; }
+            if (tfhd_flags & 0x000002) { p += 4; }
+            if (tfhd_flags & 0x000008) { duration = readU32(d + p); p += 4; }
+            if (tfhd_flags & 0x000010) { sample_size = readU32(d + p); p += 4; }
+            if (tfhd_flags & 0x000020) { flags = readU32(d + p); p += 4; }
+
+            Box tfdt;
+            if (findChild(d, traf.payload, traf.end, "tfdt", tfdt) && tfdt.payload + 8 <= tfdt.end) {
+                const bool v1 = d[tfdt.payload] == 1;
+                decode_time = v1 ? readU64(d + tfdt.payload + 4) : readU32(d + tfdt.payload + 4);
+            }
+
+            uint64_t data_end = base_offset;
+            Box trun;
+            for (size_t rpos = traf.payload; readBox(d, traf.end, rpos, trun); rpos = trun.end) {
+                if (std::memcmp(trun.type, "trun", 4) != 0 || trun.payload + 8 > trun.end) continue;
+                const uint32_t trun_flags = readU32(d + trun.payload) & 0xFFFFFF;
+                const uint32_t count = readU32(d + trun.payload + 4);
+                size_t q = trun.payload + 8;
+                uint64_t offset = data_end;
+                if (trun_flags & 0x001) {
+                    offset = base_offset + static_cast<int32_t>(readU32(d + q));
+                    q += 4;
+                }
+                uint32_t first_flags = flags;
+                const bool has_first_flags = (trun_flags & 0x004) != 0;
+                if (has_first_flags) { first_flags = readU32(d + q); q += 4; }
+                const size_t per_sample = 4u * (((trun_flags & 0x100) ? 1 : 0) + ((trun_flags & 0x200) ? 1 : 0) +
+                                                ((trun_flags & 0x400) ? 1 : 0) + ((trun_flags & 0x800) ? 1 : 0));
+                for (uint32_t i = 0; i < count && q + per_sample <= trun.end; ++i) {
+                    uint32_t s_duration = duration;
+                    uint32_t s_size = sample_size;
+                    uint32_t s_flags = (i == 0 && has_first_flags) ? first_flags : flags;
+                    int64_t cto = 0;
+                    if (trun_flags & 0x100) { s_duration = readU32(d + q); q += 4; }
+                    if (trun_flags & 0x200) { s_size = readU32(d + q); q += 4; }
+                    if (trun_flags & 0x400) { s_flags = readU32(d + q); q += 4; }
+                    if (trun_flags & 0x800) { cto = static_cast<int32_t>(readU32(d + q)); q += 4; }
+                    if (offset + s_size > size_) {
+                        break;
+                    }
+                    FileIndexEntry entry;
+                    entry.offset = offset;
+                    entry.size = s_size;
+                    entry.dts_us = rtpTimestampToUs(decode_time, timescale);
+                    const int64_t pts = static_cast<int64_t>(decode_time) + cto;
+                    entry.pts_us = pts > 0 ? rtpTimestampToUs(static_cast<uint64_t>(pts), timescale) : 0;
+                    entry.is_idr = (s_flags & 0x00010000) == 0;  // sample_is_non_sync_sample
+                    entries_.push_back(entry);
+                    offset += s_size;
+                    decode_time += s_duration;
+                }
+                data_end = offset;
+            }
+        }
+    }
+    if (entries_.size() > 1) {
+        const uint64_t span = entries_.back().dts_us - entries_.front().dts_us;
+        path_config_.fps = span > 0 ? static_cast<uint32_t>(((entries_.size() - 1) * 1000000 + span / 2) / span) : 0;
+    }
+    return !entries_.empty();
+}
+
+bool FileSource::loadIndex(const std::string& index_file, const FilePathConfig& config) {
+    FILE* fp = std::fopen(index_file.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    std::vector<uint8_t> buf;
+    uint8_t chunk[64 * 1024];
+    size_t n = 0;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        buf.insert(buf.end(), chunk, chunk + n);
+    }
+    std::fclose(fp);
+
+    IndexReader r(buf.data(), buf.size());
+    if (r.u32() != kIndexMagic || r.u32() != kIndexVersion || r.u64() != size_ ||
+        static_cast<int64_t>(r.u64()) != mtime_ || (r.u8() != 0) != fmp4_) {
+        return false;
+    }
+    const CodecType codec = r.u8() == 0 ? CodecType::H264 : CodecType::H265;
+    const uint32_t fps = r.u32();
+    const uint32_t fps_num = r.u32();
+    const uint32_t fps_den = r.u32();
+    // Annex-B 的 pts 由帧率推算：编码或帧率变了就得重建
+    if (!fmp4_ && (codec != config.codec || fps_num != (config.fps > 0 ? config.fps : 25) ||
+                   fps_den != (config.fps > 0 && config.fps_den > 0 ? config.fps_den : 1))) {
+        return false;
+    }
+    PathConfig loaded;
+    loaded.codec = codec;
+    loaded.fps = fps;
+    nal_length_size_ = r.u8();
+    loaded.width = r.u32();
+    loaded.height = r.u32();
+    loaded.vps = r.bytes();
+    loaded.sps = r.bytes();
+    loaded.pps = r.bytes();
+    const uint32_t count = r.u32();
+    if (!r.ok || count == 0 || buf.size() - r.pos < static_cast<size_t>(count) * 29) {
+        return false;
+    }
+    std::vector<FileIndexEntry> entries(count);
+    for (auto& entry : entries) {
+        entry.offset = r.u64();
+        entry.size = r.u32();
+        entry.pts_us = r.u64();
+        entry.dts_us = r.u64();
+        entry.is_idr = r.u8() != 0;
+        if (entry.offset + entry.size > size_) {
+            return false;
+        }
+    }
+    if (!r.ok) {
+        return false;
+    }
+    path_config_ = std::move(loaded);
+    entries_ = std::move(entries);
+    return true;
+}
+
+void FileSource::saveIndex(const std::string& index_file, const FilePathConfig& config) const {
+    std::vector<uint8_t> out;
+    out.reserve(64 + entries_.size() * 29);
+    putU32(out, kIndexMagic);
+    putU32(out, kIndexVersion);
+    putU64(out, size_);
+    putU64(out, static_cast<uint64_t>(mtime_));
+    out.push_back(fmp4_ ? 1 : 0);
+    out.push_back(path_config_.codec == CodecType::H264 ? 0 : 1);
+    putU32(out, path_config_.fps);
+    // 建索引时的有理帧率（仅 Annex-B 有意义），加载时与配置比对
+    putU32(out, fmp4_ ? 0 : (config.fps > 0 ? config.fps : 25));
+    putU32(out, fmp4_ ? 0 : (config.fps > 0 && config.fps_den > 0 ? config.fps_den : 1));
+    out.push_back(static_cast<uint8_t>(nal_length_size_));
+    putU32(out, path_config_.width);
+    putU32(out, path_config_.height);
+    putBytes(out, path_config_.vps);
+    putBytes(out, path_config_.sps);
+    putBytes(out, path_config_.pps);
+    putU32(out, static_cast<uint32_t>(entries_.size()));
+    for (const auto& entry : entries_) {
+        putU64(out, entry.offset);
+        putU32(out, entry.size);
+        putU64(out, entry.pts_us);
+        putU64(out, entry.dts_us);
+        out.push_back(entry.is_idr ? 1 : 0);
+    }
+
+    FILE* fp = std::fopen(index_file.c_str(), "wb");
+    if (!fp) {
+        RTSP_LOG_WARNING("Cannot write file index: " + index_file);
+        return;
+    }
+    const bool ok = std::fwrite(out.data(), 1, out.size(), fp) == out.size();
+    std::fclose(fp);
+    if (!ok) {
+        RTSP_LOG_WARNING("Failed to write file index: " + index_file);
+        std::remove(index_file.c_str());
+    }
+}
+
+size_t FileSource::seekIndex(uint64_t npt_ms) const {
+    size_t best = entries_.size();
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (!entries_[i].is_idr) continue;
+        if (best == entries_.size() || entries_[i].dts_us <= npt_ms * 1000) {
+            best = i;
+        }
+        if (entries_[i].dts_us > npt_ms * 1000) break;
+    }
+    return best == entries_.size() ? 0 : best;
+}
+
+VideoFrame FileSource::makeUnit(const uint8_t* data, size_t size, const FileIndexEntry& entry) const {
+    VideoFrame unit = {};
+    unit.codec = path_config_.codec;
+    unit.type = entry.is_idr ? FrameType::IDR : FrameType::P;
+    unit.data = const_cast<uint8_t*>(data);
+    unit.size = size;
+    unit.pts_us = entry.pts_us;
+    unit.dts_us = entry.dts_us;
+    unit.pts = entry.pts_us / 1000;
+    unit.dts = entry.dts_us / 1000;
+    unit.width = path_config_.width;
+    unit.height = path_config_.height;
+    unit.fps = path_config_.fps;
+    // 在途帧持有 FileSource，延长映射的生命周期；数据不归 managed_data 管
+    unit.data_owner = shared_from_this();
+    return unit;
+}
+
+void FileSource::accessUnit(size_t index, std::vector<VideoFrame>& units) const {
+    units.clear();
+    if (index >= entries_.size()) {
+        return;
+    }
+    const FileIndexEntry& entry = entries_[index];
+    const uint8_t* begin = data_ + entry.offset;
+    if (!fmp4_) {
+        units.push_back(makeUnit(begin, entry.size, entry));
+        return;
+    }
+
+    if (entry.is_idr && parameter_sets_ && !parameter_sets_->empty()) {
+        VideoFrame sets = makeUnit(parameter_sets_->data(), parameter_sets_->size(), entry);
+        sets.managed_data = parameter_sets_;
+        sets.data_owner.reset();
+        units.push_back(sets);
+    }
+    // 样本内为 [长度][NALU]...，逐个 NALU 作为不带起始码的发送单元
+    size_t pos = 0;
+    while (pos + nal_length_size_ <= entry.size) {
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < nal_length_size_; ++i) {
+            len = (len << 8) | begin[pos + i];
+        }
+        pos += nal_length_size_;
+        if (len == 0 || len > entry.size - pos) {
+            break;
+        }
+        units.push_back(makeUnit(begin + pos, len, entry));
+        pos += len;
+    }
+}
+
+} // namespace rtsp
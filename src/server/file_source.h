@@ -0,0 +1,82 @@
+#pragma once
+
+// 文件点播源：录像文件只读映射进内存，建一次 AU 索引（IDR 位置与时间戳），
+// 索引持久化到 <file>.idx 旁路文件，下次加载直接复用。
+//
+// 支持两种文件：
+//   - Annex-B 裸流（.h264/.h265）：按 AU 边界切分，pts 由帧序号与 fps 推算
+//   - fragmented MP4（如 startRecording 录制的文件）：解析 moov 的 avcC/hvcC 与各 moof/trun
+//
+// 发送时帧直接指向映射区（data_owner 持有 FileSource 以维持映射，不拷贝数据），
+// 同一文件的所有观看会话共享页缓存，打包前没有任何拷贝。
+
+#include <rtsp-server/rtsp_server.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rtsp {
+
+struct FileIndexEntry {
+    uint64_t offset = 0;   // AU（Annex-B）或样本（fMP4，长度前缀）在文件中的偏移
+    uint32_t size = 0;
+    uint64_t pts_us = 0;   // 微秒，29.97fps 等非整毫秒帧间隔不取整
+    uint64_t dts_us = 0;   // 按解码顺序单调，用于排程
+    bool is_idr = false;
+};
+
+class FileSource : public std::enable_shared_from_this<FileSource> {
+public:
+    ~FileSource();
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    // 映射文件并加载（或建立）索引；失败返回空
+    static std::shared_ptr<FileSource> open(const FilePathConfig& config);
+
+    // DESCRIBE/SETUP 用的路径配置（编码、参数集、分辨率来自文件）
+    const PathConfig& pathConfig() const { return path_config_; }
+    const std::vector<FileIndexEntry>& entries() const { return entries_; }
+    uint64_t durationMs() const { return duration_ms_; }
+    // 索引是否由旁路文件加载（而非本次扫描建立）
+    bool indexLoaded() const { return index_loaded_; }
+
+    // 起播位置：pts 不晚于 npt_ms 的最后一个 IDR（没有则取第一个 IDR）
+    size_t seekIndex(uint64_t npt_ms) const;
+
+    // 第 index 个 AU 的发送单元，最后一个即 AU 结束。fMP4 的 IDR 前补参数集。
+    void accessUnit(size_t index, std::vector<VideoFrame>& units) const;
+
+private:
+    FileSource() = default;
+
+    bool map(const std::string& file);
+    bool buildAnnexBIndex(const FilePathConfig& config);
+    bool buildFmp4Index();
+    bool loadIndex(const std::string& index_file, const FilePathConfig& config);
+    void saveIndex(const std::string& index_file, const FilePathConfig& config) const;
+    VideoFrame makeUnit(const uint8_t* data, size_t size, const FileIndexEntry& entry) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#endif
+    int64_t mtime_ = 0;
+
+    bool fmp4_ = false;
+    uint32_t nal_length_size_ = 4;   // fMP4 样本的 NALU 长度字段字节数
+    PathConfig path_config_;
+    std::vector<FileIndexEntry> entries_;
+    uint64_t duration_ms_ = 0;
+    bool index_loaded_ = false;
+
+    // fMP4 IDR 前补发的 Annex-B 参数集
+    std::shared_ptr<std::vector<uint8_t>> parameter_sets_;
+};
+
+} // namespace rtsp
@@ -0,0 +1,348 @@
+#include "fmp4_muxer.h"
+
+#include <rtmp/avc_config_record.h>
+#include <rtmp/hevc_config_record.h>
+
+#include <cstring>
+
+namespace rtsp {
+
+namespace {
+
+void put8(std::vector<uint8_t>& b, uint8_t v) {
+    b.push_back(v);
+}
+
+void put16(std::vector<uint8_t>& b, uint16_t v) {
+    b.push_back(static_cast<uint8_t>(v >> 8));
+    b.push_back(static_cast<uint8_t>(v));
+}
+
+void put32(std::vector<uint8_t>& b, uint32_t v) {
+    b.push_back(static_cast<uint8_t>(v >> 24));
+    b.push_back(static_cast<uint8_t>(v >> 16));
+    b.push_back(static_cast<uint8_t>(v >> 8));
+    b.push_back(static_cast<uint8_t>(v));
+}
+
+void put64(std::vector<uint8_t>& b, uint64_t v) {
+    put32(b, static_cast<uint32_t>(v >> 32));
+    put32(b, static_cast<uint32_t>(v));
+}
+
+void putZeros(std::vector<uint8_t>& b, size_t n) {
+    b.insert(b.end(), n, 0);
+}
+
+void patch32(std::vector<uint8_t>& b, size_t pos, uint32_t v) {
+    b[pos] = static_cast<uint8_t>(v >> 24);
+    b[pos + 1] = static_cast<uint8_t>(v >> 16);
+    b[pos + 2] = static_cast<uint8_t>(v >> 8);
+    b[pos + 3] = static_cast<uint8_t>(v);
+}
+
+// 先写 size 占位，endBox 时回填
+size_t beginBox(std::vector<uint8_t>& b, const char* type) {
+    const size_t pos = b.size();
+    put32(b, 0);
+    b.insert(b.end(), type, type + 4);
+    return pos;
+}
+
+size_t beginFullBox(std::vector<uint8_t>& b, const char* type, uint8_t version, uint32_t flags) {
+    const size_t pos = beginBox(b, type);
+    put8(b, version);
+    b.push_back(static_cast<uint8_t>(flags >> 16));
+    b.push_back(static_cast<uint8_t>(flags >> 8));
+    b.push_back(static_cast<uint8_t>(flags));
+    return pos;
+}
+
+void endBox(std::vector<uint8_t>& b, size_t pos) {
+    patch32(b, pos, static_cast<uint32_t>(b.size() - pos));
+}
+
+void putMatrix(std::vector<uint8_t>& b) {
+    static const uint32_t kUnity[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+    for (uint32_t v : kUnity) {
+        put32(b, v);
+    }
+}
+
+// 逐个回调 Annex-B 中的 NALU（不含起始码）；无起始码时整段视为一个 NALU
+template <typename Fn>
+void forEachNalu(const uint8_t* data, size_t size, Fn&& fn) {
+    if (!data || size == 0) {
+        return;
+    }
+    size_t nalu_start = 0;
+    bool in_nalu = false;
+    size_t i = 0;
+    while (i + 3 <= size) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            if (in_nalu) {
+                size_t end = i;
+                if (end > nalu_start && data[end - 1] == 0) {
+                    --end;  // 4 字节起始码的前导 0
+                }
+                if (end > nalu_start) {
+                    fn(data + nalu_start, end - nalu_start);
+                }
+            }
+            i += 3;
+            nalu_start = i;
+            in_nalu = true;
+            continue;
+        }
+        ++i;
+    }
+    if (!in_nalu) {
+        fn(data, size);
+    } else if (size > nalu_start) {
+        fn(data + nalu_start, size - nalu_start);
+    }
+}
+
+// 参数集已在 avcC/hvcC 中，AUD 对 MP4 无意义：写 mdat 时跳过
+bool skipInSample(CodecType codec, const uint8_t* nalu) {
+    if (codec == CodecType::H264) {
+        const uint8_t type = nalu[0] & 0x1F;
+        return type == 7 || type == 8 || type == 9;
+    }
+    const uint8_t type = (nalu[0] >> 1) & 0x3F;
+    return type >= 32 && type <= 35;
+}
+
+constexpr uint32_t kSampleFlagsSync = 0x02000000;     // sample_depends_on=2
+constexpr uint32_t kSampleFlagsNonSync = 0x01010000;  // sample_depends_on=1, is_non_sync_sample=1
+
+} // namespace
+
+void Fmp4Muxer::collectParameterSets(const VideoFrame& part, TrackInfo& track) {
+    forEachNalu(part.data, part.size, [&](const uint8_t* nalu, size_t size) {
+        if (track.codec == CodecType::H264) {
+            const uint8_t type = nalu[0] & 0x1F;
+            if (type == 7) track.sps.assign(nalu, nalu + size);
+            if (type == 8) track.pps.assign(nalu, nalu + size);
+        } else {
+            const uint8_t type = (nalu[0] >> 1) & 0x3F;
+            if (type == 32) track.vps.assign(nalu, nalu + size);
+            if (type == 33) track.sps.assign(nalu, nalu + size);
+            if (type == 34) track.pps.assign(nalu, nalu + size);
+        }
+    });
+}
+
+void Fmp4Muxer::setTrack(const TrackInfo& track) {
+    track_ = track;
+}
+
+bool Fmp4Muxer::buildInitSegment(std::vector<uint8_t>& out) const {
+    std::vector<uint8_t> config_record;
+    if (track_.codec == CodecType::H264) {
+        config_record = buildAvcDecoderConfigRecord(track_.sps, track_.pps);
+    } else if (!track_.sps.empty() && !track_.pps.empty()) {
+        config_record = buildHevcDecoderConfigRecord(track_.vps, track_.sps, track_.pps);
+    }
+    if (config_record.empty()) {
+        return false;
+    }
+
+    size_t ftyp = beginBox(out, "ftyp");
+    out.insert(out.end(), {'i', 's', 'o', 'm'});
+    put32(out, 0x200);
+    out.insert(out.end(), {'i', 's', 'o', 'm', 'i', 's', 'o', '6', 'm', 'p', '4', '1'});
+    endBox(out, ftyp);
+
+    size_t moov = beginBox(out, "moov");
+    {
+        size_t mvhd = beginFullBox(out, "mvhd", 0, 0);
+        put32(out, 0);            // creation_time
+        put32(out, 0);            // modification_time
+        put32(out, 1000);         // timescale
+        put32(out, 0);            // duration（分片文件为 0）
+        put32(out, 0x00010000);   // rate 1.0
+        put16(out, 0x0100);       // volume 1.0
+        putZeros(out, 10);
+        putMatrix(out);
+        putZeros(out, 24);        // pre_defined
+        put32(out, 2);            // next_track_ID
+        endBox(out, mvhd);
+
+        size_t trak = beginBox(out, "trak");
+        {
+            size_t tkhd = beginFullBox(out, "tkhd", 0, 0x000003);  // enabled | in_movie
+            put32(out, 0);
+            put32(out, 0);
+            put32(out, 1);        // track_ID
+            put32(out, 0);
+            put32(out, 0);        // duration
+            putZeros(out, 8);
+            put16(out, 0);        // layer
+            put16(out, 0);        // alternate_group
+            put16(out, 0);        // volume（视频轨为 0）
+            put16(out, 0);
+            putMatrix(out);
+            put32(out, track_.width << 16);
+            put32(out, track_.height << 16);
+            endBox(out, tkhd);
+
+            size_t mdia = beginBox(out, "mdia");
+            {
+                size_t mdhd = beginFullBox(out, "mdhd", 0, 0);
+                put32(out, 0);
+                put32(out, 0);
+                put32(out, kTimescale);
+                put32(out, 0);
+                put16(out, 0x55C4);  // language "und"
+                put16(out, 0);
+                endBox(out, mdhd);
+
+                size_t hdlr = beginFullBox(out, "hdlr", 0, 0);
+                put32(out, 0);
+                out.insert(out.end(), {'v', 'i', 'd', 'e'});
+                putZeros(out, 12);
+                static const char kName[] = "VideoHandler";
+                out.insert(out.end(), kName, kName + sizeof(kName));  // 含结尾 '\0'
+                endBox(out, hdlr);
+
+                size_t minf = beginBox(out, "minf");
+                {
+                    size_t vmhd = beginFullBox(out, "vmhd", 0, 1);
+                    putZeros(out, 8);  // graphicsmode + opcolor
+                    endBox(out, vmhd);
+
+                    size_t dinf = beginBox(out, "dinf");
+                    size_t dref = beginFullBox(out, "dref", 0, 0);
+                    put32(out, 1);
+                    endBox(out, beginFullBox(out, "url ", 0, 1));  // 媒体数据在同一文件
+                    endBox(out, dref);
+                    endBox(out, dinf);
+
+                    size_t stbl = beginBox(out, "stbl");
+                    {
+                        size_t stsd = beginFullBox(out, "stsd", 0, 0);
+                        put32(out, 1);
+                        size_t entry = beginBox(out, track_.codec == CodecType::H264 ? "avc1" : "hvc1");
+                        putZeros(out, 6);
+                        put16(out, 1);            // data_reference_index
+                        putZeros(out, 16);        // pre_defined + reserved
+                        put16(out, static_cast<uint16_t>(track_.width));
+                        put16(out, static_cast<uint16_t>(track_.height));
+                        put32(out, 0x00480000);   // 72 dpi
+                        put32(out, 0x00480000);
+                        put32(out, 0);
+                        put16(out, 1);            // frame_count
+                        putZeros(out, 32);        // compressorname
+                        put16(out, 0x0018);       // depth
+                        put16(out, 0xFFFF);       // pre_defined = -1
+                        size_t config = beginBox(out, track_.codec == CodecType::H264 ? "avcC" : "hvcC");
+                        out.insert(out.end(), config_record.begin(), config_record.end());
+                        endBox(out, config);
+                        endBox(out, entry);
+                        endBox(out, stsd);
+
+                        // 样本表留空，样本信息全部在 moof 里
+                        size_t stts = beginFullBox(out, "stts", 0, 0);
+                        put32(out, 0);
+                        endBox(out, stts);
+                        size_t stsc = beginFullBox(out, "stsc", 0, 0);
+                        put32(out, 0);
+                        endBox(out, stsc);
+                        size_t stsz = beginFullBox(out, "stsz", 0, 0);
+                        put32(out, 0);
+                        put32(out, 0);
+                        endBox(out, stsz);
+                        size_t stco = beginFullBox(out, "stco", 0, 0);
+                        put32(out, 0);
+                        endBox(out, stco);
+                    }
+                    endBox(out, stbl);
+                }
+                endBox(out, minf);
+            }
+            endBox(out, mdia);
+        }
+        endBox(out, trak);
+
+        size_t mvex = beginBox(out, "mvex");
+        size_t trex = beginFullBox(out, "trex", 0, 0);
+        put32(out, 1);    // track_ID
+        put32(out, 1);    // default_sample_description_index
+        put32(out, 0);
+        put32(out, 0);
+        put32(out, 0);
+        endBox(out, trex);
+        endBox(out, mvex);
+    }
+    endBox(out, moov);
+    return true;
+}
+
+void Fmp4Muxer::buildFragment(const std::vector<Fmp4Sample>& samples, uint64_t base_decode_time,
+                              std::vector<uint8_t>& out) {
+    if (samples.empty()) {
+        return;
+    }
+
+    // 第一遍只算每个样本写成长度前缀后的大小，moof 需要先于 mdat 写出
+    sample_sizes_.clear();
+    uint64_t mdat_payload = 0;
+    for (const auto& sample : samples) {
+        uint32_t size = 0;
+        for (const auto& part : sample.parts) {
+            forEachNalu(part.data, part.size, [&](const uint8_t* nalu, size_t nalu_size) {
+                if (!skipInSample(track_.codec, nalu)) {
+                    size += static_cast<uint32_t>(4 + nalu_size);
+                }
+            });
+        }
+        sample_sizes_.push_back(size);
+        mdat_payload += size;
+    }
+
+    const size_t moof = beginBox(out, "moof");
+    size_t mfhd = beginFullBox(out, "mfhd", 0, 0);
+    put32(out, ++sequence_number_);
+    endBox(out, mfhd);
+
+    size_t traf = beginBox(out, "traf");
+    size_t tfhd = beginFullBox(out, "tfhd", 0, 0x020000);  // default-base-is-moof
+    put32(out, 1);
+    endBox(out, tfhd);
+    size_t tfdt = beginFullBox(out, "tfdt", 1, 0);
+    put64(out, base_decode_time);
+    endBox(out, tfdt);
+    // data-offset | sample-duration | sample-size | sample-flags
+    size_t trun = beginFullBox(out, "trun", 0, 0x000701);
+    put32(out, static_cast<uint32_t>(samples.size()));
+    const size_t data_offset_pos = out.size();
+    put32(out, 0);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        put32(out, samples[i].duration);
+        put32(out, sample_sizes_[i]);
+        put32(out, samples[i].is_sync ? kSampleFlagsSync : kSampleFlagsNonSync);
+    }
+    endBox(out, trun);
+    endBox(out, traf);
+    endBox(out, moof);
+    // data_offset 相对 moof 起点，指向 mdat 负载
+    patch32(out, data_offset_pos, static_cast<uint32_t>(out.size() - moof + 8));
+
+    put32(out, static_cast<uint32_t>(8 + mdat_payload));
+    out.insert(out.end(), {'m', 'd', 'a', 't'});
+    out.reserve(out.size() + static_cast<size_t>(mdat_payload));
+    for (const auto& sample : samples) {
+        for (const auto& part : sample.parts) {
+            forEachNalu(part.data, part.size, [&](const uint8_t* nalu, size_t nalu_size) {
+                if (skipInSample(track_.codec, nalu)) {
+                    return;
+                }
+                put32(out, static_cast<uint32_t>(nalu_size));
+                out.insert(out.end(), nalu, nalu + nalu_size);
+            });
+        }
+    }
+}
+
+} // namespace rtsp
@@ -0,0 +1,59 @@
+#pragma once
+
+// 单视频轨 fragmented MP4（ISO/IEC 14496-12）封装器，供录像与 HLS（CMAF）使用。
+//
+// 输出布局：
+//   init segment : ftyp + moov（avc1/avcC 或 hvc1/hvcC，mvex/trex）
+//   fragment     : moof(mfhd + traf(tfhd + tfdt + trun)) + mdat
+//
+// 样本以 Annex-B 片段输入（同一 AU 可由多个 slice 片段组成，直接引用共享帧缓冲），
+// 写入 mdat 时转为 4 字节长度前缀，并去掉已在 avcC/hvcC 中的参数集与 AUD。
+// 所有 box 直接写进调用方提供、可复用容量的缓冲区，一个 fragment 对应一次连续写盘。
+
+#include <rtsp-common/common.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace rtsp {
+
+struct Fmp4Sample {
+    std::vector<VideoFrame> parts;   // Annex-B 片段（共享引用计数缓冲，不拷贝）
+    uint32_t duration = 0;           // 90kHz
+    bool is_sync = false;
+};
+
+class Fmp4Muxer {
+public:
+    static constexpr uint32_t kTimescale = 90000;
+
+    struct TrackInfo {
+        CodecType codec = CodecType::H264;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> vps;   // 不含起始码
+        std::vector<uint8_t> sps;
+        std::vector<uint8_t> pps;
+    };
+
+    // 把 Annex-B 片段中的 VPS/SPS/PPS 记入 track（已有的被覆盖）
+    static void collectParameterSets(const VideoFrame& part, TrackInfo& track);
+
+    void setTrack(const TrackInfo& track);
+    const TrackInfo& track() const { return track_; }
+
+    // 生成 ftyp + moov 追加到 out；缺少 SPS/PPS 时返回 false
+    bool buildInitSegment(std::vector<uint8_t>& out) const;
+
+    // 将 samples 打成一个 moof + mdat 追加到 out。
+    // base_decode_time 为首个样本的解码时间（kTimescale 单位）。
+    void buildFragment(const std::vector<Fmp4Sample>& samples, uint64_t base_decode_time,
+                       std::vector<uint8_t>& out);
+
+private:
+    TrackInfo track_;
+    uint32_t sequence_number_ = 0;
+    std::vector<uint32_t> sample_sizes_;  // buildFragment 复用
+};
+
+} // namespace rtsp
@@ -0,0 +1,361 @@
+#include "hls_packager.h"
+
+#include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+
+namespace rtsp {
+
+namespace {
+
+// 播放列表里只给最近这么多个段列出部分段（更早的段只列完整段）
+constexpr uint64_t kPartListedSegments = 3;
+// 待切片数据超过该值即丢弃到下一个 IDR，切片线程跟不上时内存不无限增长
+constexpr uint64_t kMaxBacklogBytes = 32 * 1024 * 1024;
+
+std::string formatSeconds(double seconds) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.3f", seconds);
+    return buf;
+}
+
+double toSeconds(uint64_t ticks) {
+    return static_cast<double>(ticks) / Fmp4Muxer::kTimescale;
+}
+
+} // namespace
+
+HlsPackager::HlsPackager(const std::string& path, const PathConfig& path_config, const HlsConfig& config)
+    : path_(path), path_config_(path_config), config_(config) {}
+
+HlsPackager::~HlsPackager() {
+    stop();
+}
+
+void HlsPackager::start() {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (running_ || worker_.joinable()) {
+        return;
+    }
+    running_ = true;
+    worker_ = startThread(ThreadRole::Background, "rtsp-hls", [this] { packagerLoop(); });
+}
+
+void HlsPackager::onFrame(const VideoFrame& frame, bool end_of_au) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!running_) {
+            return;
+        }
+        QueuedUnit unit;
+        unit.frame = frame;
+        unit.end_of_au = end_of_au;
+        queue_.push_back(std::move(unit));
+        backlog_bytes_.fetch_add(frame.size, std::memory_order_relaxed);
+    }
+    queue_cv_.notify_one();
+}
+
+void HlsPackager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        running_ = false;
+    }
+    queue_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+}
+
+void HlsPackager::packagerLoop() {
+    std::deque<QueuedUnit> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+            if (!running_) {
+                queue_.clear();
+                return;
+            }
+            batch.swap(queue_);
+        }
+        for (const auto& unit : batch) {
+            backlog_bytes_.fetch_sub(unit.frame.size, std::memory_order_relaxed);
+            assemble(unit.frame, unit.end_of_au);
+        }
+        batch.clear();
+    }
+}
+
+void HlsPackager::assemble(const VideoFrame& frame, bool end_of_au) {
+    if (assembling_.parts.empty()) {
+        assembling_.pts_us = framePtsUs(frame);
+    }
+    assembling_.parts.push_back(frame);
+    assembling_.is_sync = assembling_.is_sync || frame.type == FrameType::IDR;
+    if (!end_of_au) {
+        return;
+    }
+    AccessUnit au = std::move(assembling_);
+    assembling_ = AccessUnit();
+    // 积压超限：整 AU 丢弃到下一个 IDR，已生成的段保持可解码
+    if (backlog_bytes_.load(std::memory_order_relaxed) > kMaxBacklogBytes || (dropping_ && !au.is_sync)) {
+        dropping_ = true;
+        return;
+    }
+    dropping_ = false;
+    handleAccessUnit(std::move(au));
+}
+
+void HlsPackager::interrupt() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        interrupts_++;
+    }
+    cv_.notify_all();
+}
+
+void HlsPackager::handleAccessUnit(AccessUnit au) {
+    if (!started_ && !au.is_sync) {
+        return;  // 第一个段从 IDR 开始
+    }
+
+    uint64_t last_ms = 0;
+    if (!pending_.empty()) {
+        AccessUnit& last = pending_.back();
+        if (au.pts_us > last.pts_us && au.pts_us - last.pts_us <= 10000000) {
+            // 两端各自换算到 90kHz 再相减，逐样本时长的取整误差不会累积
+            last.duration = convertUsToRtpTimestamp(au.pts_us, Fmp4Muxer::kTimescale) -
+                            convertUsToRtpTimestamp(last.pts_us, Fmp4Muxer::kTimescale);
+        }
+        last_ms = last.duration / (Fmp4Muxer::kTimescale / 1000);
+        pending_ms_ += last_ms;
+    }
+
+    if (au.is_sync) {
+        flushPart();
+        Fmp4Muxer::TrackInfo track;
+        track.codec = path_config_.codec;
+        track.width = path_config_.width;
+        track.height = path_config_.height;
+        for (const auto& part : au.parts) {
+            Fmp4Muxer::collectParameterSets(part, track);
+        }
+        const Fmp4Muxer::TrackInfo& current = muxer_.track();
+        if (track.sps.empty() || track.pps.empty()) {
+            const bool has_current = !current.sps.empty() && !current.pps.empty();
+            track.vps = has_current ? current.vps : path_config_.vps;
+            track.sps = has_current ? current.sps : path_config_.sps;
+            track.pps = has_current ? current.pps : path_config_.pps;
+        }
+        if (track.sps.empty() || track.pps.empty()) {
+            if (!started_) {
+                RTSP_LOG_WARNING("HLS skipped IDR without SPS/PPS on path: " + path_);
+                return;
+            }
+        } else if (!started_ || track.sps != current.sps || track.pps != current.pps ||
+                   track.vps != current.vps) {
+            muxer_.setTrack(track);
+            auto init = std::make_shared<std::vector<uint8_t>>();
+            muxer_.buildInitSegment(*init);
+            std::lock_guard<std::mutex> lock(mutex_);
+            init_ = std::move(init);
+        }
+
+        bool cut = !started_;
+        if (!cut) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cut = segments_.back().duration >=
+                  static_cast<uint64_t>(config_.segment_duration_ms) * (Fmp4Muxer::kTimescale / 1000);
+        }
+        if (cut) {
+            startSegment();
+        }
+        started_ = true;
+    } else if (last_ms > 0 && pending_ms_ + last_ms > config_.part_duration_ms) {
+        // 再加一帧就超过 PART-TARGET：先封装已攒的部分
+        flushPart();
+    }
+
+    au.duration = Fmp4Muxer::kTimescale / std::max<uint32_t>(1, path_config_.fps);
+    pending_.push_back(std::move(au));
+}
+
+void HlsPackager::flushPart() {
+    if (pending_.empty()) {
+        return;
+    }
+    samples_.clear();
+    uint64_t duration = 0;
+    for (auto& au : pending_) {
+        Fmp4Sample sample;
+        sample.parts = std::move(au.parts);
+        sample.duration = au.duration;
+        sample.is_sync = au.is_sync;
+        duration += au.duration;
+        samples_.push_back(std::move(sample));
+    }
+
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    muxer_.buildFragment(samples_, decode_time_, *data);
+    decode_time_ += duration;
+
+    Part part;
+    part.data = std::move(data);
+    part.duration = duration;
+    part.independent = pending_.front().is_sync;
+    pending_.clear();
+    pending_ms_ = 0;
+    samples_.clear();  // 释放对帧缓冲的引用
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Segment& segment = segments_.back();
+        segment.duration += part.duration;
+        segment.parts.push_back(std::move(part));
+    }
+    cv_.notify_all();
+}
+
+void HlsPackager::startSegment() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!segments_.empty()) {
+            segments_.back().complete = true;
+            max_segment_duration_ = std::max(max_segment_duration_, segments_.back().duration);
+        }
+        Segment segment;
+        segment.msn = next_msn_++;
+        segments_.push_back(std::move(segment));
+        while (segments_.size() > static_cast<size_t>(config_.segment_count) + 1) {
+            segments_.pop_front();
+        }
+    }
+    cv_.notify_all();
+}
+
+const HlsPackager::Segment* HlsPackager::findLocked(uint64_t msn) const {
+    if (segments_.empty() || msn < segments_.front().msn || msn > segments_.back().msn) {
+        return nullptr;
+    }
+    return &segments_[static_cast<size_t>(msn - segments_.front().msn)];
+}
+
+bool HlsPackager::availableLocked(uint64_t msn, int64_t part) const {
+    if (segments_.empty()) {
+        return false;
+    }
+    const Segment& last = segments_.back();
+    if (msn < last.msn) {
+        return true;  // 更早的段都已完整
+    }
+    if (msn > last.msn) {
+        return false;
+    }
+    return part >= 0 && last.parts.size() > static_cast<size_t>(part);
+}
+
+int HlsPackager::playlist(int64_t msn, int64_t part, std::string& out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (msn >= 0) {
+        if (!segments_.empty() && static_cast<uint64_t>(msn) > segments_.back().msn + 2) {
+            return 400;
+        }
+        const auto timeout = std::chrono::milliseconds(3 * static_cast<int64_t>(config_.segment_duration_ms));
+        const uint64_t interrupts = interrupts_;
+        cv_.wait_for(lock, timeout, [&] {
+            return stopped_ || interrupts_ != interrupts || availableLocked(static_cast<uint64_t>(msn), part);
+        });
+    }
+    if (stopped_ || !init_ || segments_.empty() ||
+        (segments_.size() == 1 && segments_.back().parts.empty())) {
+        return 404;
+    }
+
+    const double target = std::max(toSeconds(max_segment_duration_), config_.segment_duration_ms / 1000.0);
+    const double part_target = config_.part_duration_ms / 1000.0;
+    const Segment& last = segments_.back();
+
+    out.clear();
+    out += "#EXTM3U\n";
+    out += "#EXT-X-VERSION:9\n";
+    out += "#EXT-X-TARGETDURATION:" + std::to_string(static_cast<int>(std::ceil(target))) + "\n";
+    out += "#EXT-X-PART-INF:PART-TARGET=" + formatSeconds(part_target) + "\n";
+    out += "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" + formatSeconds(3 * part_target) + "\n";
+    out += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(segments_.front().msn) + "\n";
+    out += "#EXT-X-MAP:URI=\"init.mp4\"\n";
+    for (const Segment& segment : segments_) {
+        if (segment.msn + kPartListedSegments > last.msn) {
+            for (size_t i = 0; i < segment.parts.size(); ++i) {
+                out += "#EXT-X-PART:DURATION=" + formatSeconds(toSeconds(segment.parts[i].duration)) +
+                       ",URI=\"part" + std::to_string(segment.msn) + "." + std::to_string(i) + ".m4s\"";
+                if (segment.parts[i].independent) {
+                    out += ",INDEPENDENT=YES";
+                }
+                out += "\n";
+            }
+        }
+        if (segment.complete) {
+            out += "#EXTINF:" + formatSeconds(toSeconds(segment.duration)) + ",\n";
+            out += "seg" + std::to_string(segment.msn) + ".m4s\n";
+        }
+    }
+    out += "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part" + std::to_string(last.msn) + "." +
+           std::to_string(last.parts.size()) + ".m4s\"\n";
+    return 200;
+}
+
+HlsPackager::Buffer HlsPackager::initSegment() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stopped_ ? nullptr : init_;
+}
+
+bool HlsPackager::segment(uint64_t msn, std::vector<Buffer>& parts) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Segment* segment = findLocked(msn);
+    if (stopped_ || !segment || !segment->complete) {
+        return false;
+    }
+    parts.clear();
+    for (const auto& part : segment->parts) {
+        parts.push_back(part.data);
+    }
+    return true;
+}
+
+HlsPackager::Buffer HlsPackager::part(uint64_t msn, uint32_t index) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 只为即将生成的部分段（当前段的下一个，或下一段的第一个）挂起请求
+    const bool upcoming = !segments_.empty() &&
+        ((msn == segments_.back().msn && index == segments_.back().parts.size()) ||
+         (msn == segments_.back().msn + 1 && index == 0));
+    if (upcoming) {
+        const auto timeout = std::chrono::milliseconds(
+            std::max<int64_t>(1000, 3 * static_cast<int64_t>(config_.part_duration_ms)));
+        const uint64_t interrupts = interrupts_;
+        cv_.wait_for(lock, timeout, [&] {
+            if (stopped_ || interrupts_ != interrupts) {
+                return true;
+            }
+            const Segment* segment = findLocked(msn);
+            return segment && (segment->parts.size() > index || segment->complete);
+        });
+    }
+    const Segment* segment = findLocked(msn);
+    if (stopped_ || !segment || index >= segment->parts.size()) {
+        return nullptr;
+    }
+    return segment->parts[index].data;
+}
+
+} // namespace rtsp
@@ -0,0 +1,119 @@
+#pragma once
+
+// HLS / LL-HLS 切片器：MediaPath 广播时把共享帧交给 onFrame（只入队、不拷贝），
+// 独立切片线程按 AU 边界攒够 part_duration_ms 封成一个 CMAF 部分段（moof + mdat），IDR 处切完整段。
+// 段存储在内存里，每个部分段一块不可变的共享缓冲：完整段就是各部分段的拼接，
+// HTTP 响应直接引用这些缓冲，不为单个请求拷贝。
+//
+// 播放列表按 LL-HLS（RFC 8216bis）生成：EXT-X-PART / EXT-X-PRELOAD-HINT，
+// 带 _HLS_msn/_HLS_part 的请求阻塞到对应部分段生成后再返回。
+
+#include "fmp4_muxer.h"
+
+#include <rtsp-server/rtsp_server.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rtsp {
+
+class HlsPackager {
+public:
+    using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+
+    HlsPackager(const std::string& path, const PathConfig& path_config, const HlsConfig& config);
+    ~HlsPackager();
+
+    HlsPackager(const HlsPackager&) = delete;
+    HlsPackager& operator=(const HlsPackager&) = delete;
+
+    // 启动切片线程
+    void start();
+
+    // 由 MediaPath 在 sessions_mutex 之外按广播顺序调用。frame 须为托管缓冲，
+    // 这里只增加引用计数入队，封装在切片线程完成
+    void onFrame(const VideoFrame& frame, bool end_of_au);
+    // 停止切片线程（未切完的单元丢弃），唤醒所有阻塞中的请求，之后的请求返回 404
+    void stop();
+    // 只唤醒当前阻塞中的请求（HTTP 服务停止时用），切片照常进行
+    void interrupt();
+
+    // 生成播放列表；msn >= 0 时阻塞到该段（part >= 0 时为该部分段）出现或超时。
+    // 返回 HTTP 状态码：200、400（请求的位置超前太多）、404（尚无可播内容）
+    int playlist(int64_t msn, int64_t part, std::string& out);
+    Buffer initSegment() const;
+    // 完整段：各部分段的共享缓冲，依次拼接即段内容
+    bool segment(uint64_t msn, std::vector<Buffer>& parts) const;
+    // 部分段：preload hint 指向的下一个部分段会阻塞到生成为止
+    Buffer part(uint64_t msn, uint32_t index);
+
+private:
+    struct AccessUnit {
+        std::vector<VideoFrame> parts;
+        uint64_t pts_us = 0;
+        uint32_t duration = 0;   // 90kHz，下一个 AU 到达时确定
+        bool is_sync = false;
+    };
+    struct Part {
+        Buffer data;
+        uint64_t duration = 0;   // 90kHz
+        bool independent = false;
+    };
+    struct Segment {
+        uint64_t msn = 0;
+        std::vector<Part> parts;
+        uint64_t duration = 0;   // 90kHz
+        bool complete = false;
+    };
+    struct QueuedUnit {
+        VideoFrame frame;
+        bool end_of_au = true;
+    };
+
+    void packagerLoop();
+    void assemble(const VideoFrame& frame, bool end_of_au);
+    void handleAccessUnit(AccessUnit au);
+    void flushPart();
+    void startSegment();
+    bool availableLocked(uint64_t msn, int64_t part) const;
+    const Segment* findLocked(uint64_t msn) const;
+
+    const std::string path_;
+    const PathConfig path_config_;
+    const HlsConfig config_;
+
+    std::mutex queue_mutex_;            // 保护 queue_ / running_
+    std::condition_variable queue_cv_;
+    std::deque<QueuedUnit> queue_;
+    bool running_ = false;
+    std::atomic<uint64_t> backlog_bytes_{0};
+    std::thread worker_;
+
+    // 以下仅切片线程访问
+    AccessUnit assembling_;
+    bool dropping_ = false;             // 切片跟不上，丢弃到下一个 IDR
+    std::vector<AccessUnit> pending_;   // 当前部分段尚未封装的 AU
+    uint64_t pending_ms_ = 0;
+    bool started_ = false;              // 是否已从 IDR 开始
+    Fmp4Muxer muxer_;
+    uint64_t decode_time_ = 0;          // 90kHz
+    std::vector<Fmp4Sample> samples_;   // flushPart 复用
+
+    mutable std::mutex mutex_;          // 保护以下字段
+    std::condition_variable cv_;
+    std::deque<Segment> segments_;      // 最后一个是正在生成的段
+    Buffer init_;
+    uint64_t next_msn_ = 0;
+    uint64_t max_segment_duration_ = 0;
+    bool stopped_ = false;
+    uint64_t interrupts_ = 0;
+};
+
+} // namespace rtsp
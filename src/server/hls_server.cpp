@@ -0,0 +1,226 @@
+#include "hls_server.h"
+#include "hls_packager.h"
+
+#if defined(_WIN32) && !defined(NOMINMAX)
+    #define NOMINMAX
+#endif
+
+#include "../../third_party/httplib.h"
+
+#include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rtsp {
+
+namespace {
+
+// 阻塞式播放列表重载与 preload hint 会各自占住一个线程直到部分段生成
+constexpr size_t kMinHttpThreads = 8;
+constexpr size_t kMaxHttpThreads = 256;
+
+// 从 pos 开始解析十进制数字，pos 移到数字之后；没有数字返回 false
+bool parseNumber(const std::string& text, size_t& pos, uint64_t& value) {
+    const size_t begin = pos;
+    value = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+        value = value * 10 + static_cast<uint64_t>(text[pos] - '0');
+        ++pos;
+    }
+    return pos > begin;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// "seg<msn>.m4s"
+bool parseSegmentName(const std::string& name, uint64_t& msn) {
+    if (name.compare(0, 3, "seg") != 0 || !endsWith(name, ".m4s")) {
+        return false;
+    }
+    size_t pos = 3;
+    return parseNumber(name, pos, msn) && pos == name.size() - 4;
+}
+
+// "part<msn>.<index>.m4s"
+bool parsePartName(const std::string& name, uint64_t& msn, uint64_t& index) {
+    if (name.compare(0, 4, "part") != 0 || !endsWith(name, ".m4s")) {
+        return false;
+    }
+    size_t pos = 4;
+    if (!parseNumber(name, pos, msn) || pos >= name.size() || name[pos] != '.') {
+        return false;
+    }
+    ++pos;
+    return parseNumber(name, pos, index) && pos == name.size() - 4;
+}
+
+// 响应体直接引用共享缓冲，按 offset 逐块写出
+void sendBuffers(httplib::Response& res, std::vector<HlsPackager::Buffer> buffers) {
+    size_t total = 0;
+    for (const auto& buffer : buffers) {
+        total += buffer->size();
+    }
+    res.set_content_provider(total, "video/mp4",
+        [buffers](size_t offset, size_t length, httplib::DataSink& sink) {
+            for (const auto& buffer : buffers) {
+                if (offset >= buffer->size()) {
+                    offset -= buffer->size();
+                    continue;
+                }
+                const size_t n = std::min(length, buffer->size() - offset);
+                return sink.write(reinterpret_cast<const char*>(buffer->data() + offset), n);
+            }
+            return false;
+        });
+}
+
+} // namespace
+
+class HlsServer::Impl {
+public:
+    std::unique_ptr<httplib::Server> server_;
+    std::thread server_thread_;
+    std::atomic<bool> running_{false};
+
+    std::mutex packagers_mutex_;
+    std::map<std::string, std::shared_ptr<HlsPackager>> packagers_;
+
+    std::shared_ptr<HlsPackager> find(const std::string& path) {
+        std::lock_guard<std::mutex> lock(packagers_mutex_);
+        auto it = packagers_.find(path);
+        return it == packagers_.end() ? nullptr : it->second;
+    }
+
+    void handle(const httplib::Request& req, httplib::Response& res) {
+        auto packager = find(req.matches[1].str());
+        const std::string name = req.matches[2].str();
+        if (!packager) {
+            res.status = 404;
+            return;
+        }
+
+        if (name == "index.m3u8") {
+            int64_t msn = -1;
+            int64_t part = -1;
+            if (req.has_param("_HLS_msn")) {
+                msn = std::strtoll(req.get_param_value("_HLS_msn").c_str(), nullptr, 10);
+            }
+            if (req.has_param("_HLS_part")) {
+                part = std::strtoll(req.get_param_value("_HLS_part").c_str(), nullptr, 10);
+            }
+            if ((part >= 0 && msn < 0) || (req.has_param("_HLS_msn") && msn < 0)) {
+                res.status = 400;
+                return;
+            }
+            std::string playlist;
+            res.status = packager->playlist(msn, part, playlist);
+            if (res.status == 200) {
+                res.set_header("Cache-Control", "no-cache");
+                res.set_content(std::move(playlist), "application/vnd.apple.mpegurl");
+            }
+            return;
+        }
+
+        uint64_t msn = 0;
+        uint64_t index = 0;
+        std::vector<HlsPackager::Buffer> buffers;
+        if (name == "init.mp4") {
+            auto init = packager->initSegment();
+            if (init) {
+                buffers.push_back(std::move(init));
+            }
+        } else if (parseSegmentName(name, msn)) {
+            packager->segment(msn, buffers);
+        } else if (parsePartName(name, msn, index)) {
+            auto part = packager->part(msn, static_cast<uint32_t>(index));
+            if (part) {
+                buffers.push_back(std::move(part));
+            }
+        }
+        if (buffers.empty()) {
+            res.status = 404;
+            return;
+        }
+        sendBuffers(res, std::move(buffers));
+    }
+};
+
+HlsServer::HlsServer() : impl_(new Impl()) {}
+
+HlsServer::~HlsServer() {
+    stop();
+}
+
+bool HlsServer::start(const std::string& host, uint16_t port) {
+    if (impl_->running_.load()) {
+        return false;
+    }
+    auto server = std::unique_ptr<httplib::Server>(new httplib::Server());
+    server->new_task_queue = [] { return new httplib::ThreadPool(kMinHttpThreads, kMaxHttpThreads); };
+    server->Get(R"((/.*)/([^/]+))", [this](const httplib::Request& req, httplib::Response& res) {
+        impl_->handle(req, res);
+    });
+    if (!server->bind_to_port(host, port)) {
+        RTSP_LOG_ERROR("HLS: failed to bind http port " + std::to_string(port));
+        return false;
+    }
+
+    impl_->server_ = std::move(server);
+    impl_->running_.store(true);
+    impl_->server_thread_ = startThread(ThreadRole::Http, "rtsp-hls", [this] {
+        impl_->server_->listen_after_bind();
+    });
+    RTSP_LOG_INFO("HLS server listening on " + host + ":" + std::to_string(port));
+    return true;
+}
+
+void HlsServer::stop() {
+    impl_->running_.store(false);
+    {
+        // 阻塞中的播放列表/部分段请求占着工作线程，先唤醒，否则 stop 要等到它们超时
+        std::lock_guard<std::mutex> lock(impl_->packagers_mutex_);
+        for (auto& entry : impl_->packagers_) {
+            entry.second->interrupt();
+        }
+    }
+    if (impl_->server_) {
+        impl_->server_->stop();
+    }
+    if (impl_->server_thread_.joinable()) {
+        impl_->server_thread_.join();
+    }
+    impl_->server_.reset();
+}
+
+bool HlsServer::isRunning() const {
+    return impl_->running_.load();
+}
+
+void HlsServer::addPackager(const std::string& path, std::shared_ptr<HlsPackager> packager) {
+    std::lock_guard<std::mutex> lock(impl_->packagers_mutex_);
+    impl_->packagers_[path] = std::move(packager);
+}
+
+std::shared_ptr<HlsPackager> HlsServer::removePackager(const std::string& path) {
+    std::lock_guard<std::mutex> lock(impl_->packagers_mutex_);
+    auto it = impl_->packagers_.find(path);
+    if (it == impl_->packagers_.end()) {
+        return nullptr;
+    }
+    auto packager = std::move(it->second);
+    impl_->packagers_.erase(it);
+    return packager;
+}
+
+} // namespace rtsp
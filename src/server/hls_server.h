@@ -0,0 +1,39 @@
+#pragma once
+
+// HLS 的 HTTP 服务：用 cpp-httplib 承载，按 URL 前缀把请求分给各路径的切片器。
+//   <path>/index.m3u8[?_HLS_msn=N[&_HLS_part=M]]
+//   <path>/init.mp4
+//   <path>/seg<msn>.m4s
+//   <path>/part<msn>.<index>.m4s
+// 段与部分段的响应直接引用切片器里的共享缓冲（content provider 逐块写出）。
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace rtsp {
+
+class HlsPackager;
+
+class HlsServer {
+public:
+    HlsServer();
+    ~HlsServer();
+
+    HlsServer(const HlsServer&) = delete;
+    HlsServer& operator=(const HlsServer&) = delete;
+
+    bool start(const std::string& host, uint16_t port);
+    void stop();
+    bool isRunning() const;
+
+    // 切片器登记与服务启停无关：服务启动前登记的路径同样可以访问
+    void addPackager(const std::string& path, std::shared_ptr<HlsPackager> packager);
+    std::shared_ptr<HlsPackager> removePackager(const std::string& path);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace rtsp
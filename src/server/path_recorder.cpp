@@ -0,0 +1,307 @@
+#include "path_recorder.h"
+
+#include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
+
+#include <chrono>
+#include <ctime>
+#include <utility>
+
+namespace rtsp {
+
+namespace {
+
+// GOP 很长时不必攒满整个 GOP 才写：pending 超过该值先写出一个 fragment
+constexpr size_t kMaxFragmentBytes = 4 * 1024 * 1024;
+
+std::string segmentFileName(const std::string& directory, const std::string& path, uint32_t index) {
+    std::string name;
+    for (char ch : path) {
+        if (ch == '/' || ch == '\\') {
+            if (!name.empty()) {
+                name.push_back('_');
+            }
+        } else {
+            name.push_back(ch);
+        }
+    }
+    if (name.empty()) {
+        name = "stream";
+    }
+
+    const std::time_t now = std::time(nullptr);
+    std::tm tm_buf{};
+#ifdef _WIN32
+    localtime_s(&tm_buf, &now);
+#else
+    localtime_r(&now, &tm_buf);
+#endif
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_buf);
+    char seq[16];
+    std::snprintf(seq, sizeof(seq), "%06u", index);
+
+    std::string file = directory;
+    if (!file.empty() && file.back() != '/' && file.back() != '\\') {
+        file.push_back('/');
+    }
+    return file + name + "_" + stamp + "_" + seq + ".mp4";
+}
+
+} // namespace
+
+PathRecorder::PathRecorder(const std::string& path, const PathConfig& path_config,
+                           const RecordConfig& config)
+    : path_(path), path_config_(path_config), config_(config) {}
+
+PathRecorder::~PathRecorder() {
+    stop();
+}
+
+bool PathRecorder::start() {
+    if (config_.directory.empty()) {
+        RTSP_LOG_ERROR("Record directory is empty for path: " + path_);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return false;
+    }
+    running_ = true;
+    writer_ = startThread(ThreadRole::Background, "rtsp-record", [this] { writerLoop(); });
+    return true;
+}
+
+void PathRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+void PathRecorder::onFrame(const VideoFrame& frame, bool end_of_au) {
+    if (assembling_.parts.empty()) {
+        assembling_.pts_us = framePtsUs(frame);
+    }
+    assembling_.parts.push_back(frame);
+    assembling_.is_sync = assembling_.is_sync || frame.type == FrameType::IDR;
+    assembling_.bytes += frame.size;
+    if (!end_of_au) {
+        return;
+    }
+
+    AccessUnit au = std::move(assembling_);
+    assembling_ = AccessUnit();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+        return;
+    }
+    const uint64_t backlog = backlog_bytes_.load(std::memory_order_relaxed);
+    if ((dropping_ && !au.is_sync) || backlog + au.bytes > config_.max_backlog_bytes) {
+        // 写盘跟不上：丢弃到下一个 IDR，保证写出的 GOP 完整可解码
+        dropping_ = true;
+        stats_.frames_dropped++;
+        return;
+    }
+    dropping_ = false;
+    const uint64_t new_backlog = backlog_bytes_.fetch_add(au.bytes, std::memory_order_relaxed) + au.bytes;
+    if (new_backlog > stats_.max_backlog_bytes) {
+        stats_.max_backlog_bytes = new_backlog;
+    }
+    queue_.push_back(std::move(au));
+    cv_.notify_one();
+}
+
+RecordStats PathRecorder::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RecordStats out = stats_;
+    out.backlog_bytes = backlog_bytes_.load(std::memory_order_relaxed);
+    return out;
+}
+
+void PathRecorder::writerLoop() {
+    std::deque<AccessUnit> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !queue_.empty() || !running_; });
+            if (queue_.empty() && !running_) {
+                break;
+            }
+            batch.swap(queue_);
+        }
+        for (auto& au : batch) {
+            handleAccessUnit(au);
+        }
+        batch.clear();
+    }
+
+    // 最后一个样本没有后继帧，按帧率估计时长
+    flushFragment(pending_.size());
+    closeSegment();
+}
+
+void PathRecorder::handleAccessUnit(AccessUnit& au) {
+    if (!file_ && !au.is_sync) {
+        // 段文件总是从 IDR 开始
+        backlog_bytes_.fetch_sub(au.bytes, std::memory_order_relaxed);
+        return;
+    }
+
+    if (!pending_.empty()) {
+        const uint64_t last_pts_us = pending_.back().pts_us;
+        if (au.pts_us > last_pts_us && au.pts_us - last_pts_us <= 10000000) {
+            pending_durations_.back() = convertUsToRtpTimestamp(au.pts_us, Fmp4Muxer::kTimescale) -
+                                        convertUsToRtpTimestamp(last_pts_us, Fmp4Muxer::kTimescale);
+        }
+    }
+
+    if (au.is_sync) {
+        flushFragment(pending_.size());
+
+        Fmp4Muxer::TrackInfo track;
+        extractParameterSets(au, track);
+        const Fmp4Muxer::TrackInfo& current = muxer_.track();
+        const bool changed = file_ && (track.sps != current.sps || track.pps != current.pps ||
+                                       track.vps != current.vps);
+        const uint64_t segment_limit =
+            static_cast<uint64_t>(config_.segment_duration_ms) * (Fmp4Muxer::kTimescale / 1000);
+        if (!file_ || changed || segment_decode_time_ >= segment_limit) {
+            closeSegment();
+            if (!openSegment(track)) {
+                backlog_bytes_.fetch_sub(au.bytes, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    pending_bytes_ += au.bytes;
+    pending_.push_back(std::move(au));
+    pending_durations_.push_back(defaultDuration());
+    if (pending_bytes_ >= kMaxFragmentBytes && pending_.size() > 1) {
+        flushFragment(pending_.size() - 1);
+    }
+}
+
+bool PathRecorder::extractParameterSets(const AccessUnit& au, Fmp4Muxer::TrackInfo& track) const {
+    track.codec = path_config_.codec;
+    track.width = path_config_.width;
+    track.height = path_config_.height;
+    for (const auto& part : au.parts) {
+        Fmp4Muxer::collectParameterSets(part, track);
+    }
+    // IDR 未自带参数集时沿用上一段的，再退回路径配置
+    if (track.sps.empty() || track.pps.empty()) {
+        const Fmp4Muxer::TrackInfo& current = muxer_.track();
+        const bool has_current = !current.sps.empty() && !current.pps.empty();
+        track.vps = has_current ? current.vps : path_config_.vps;
+        track.sps = has_current ? current.sps : path_config_.sps;
+        track.pps = has_current ? current.pps : path_config_.pps;
+    }
+    return !track.sps.empty() && !track.pps.empty();
+}
+
+bool PathRecorder::openSegment(const Fmp4Muxer::TrackInfo& track) {
+    const std::string file_name = segmentFileName(config_.directory, path_, segment_index_++);
+    Fmp4Muxer muxer;
+    muxer.setTrack(track);
+    out_.clear();
+    if (!muxer.buildInitSegment(out_)) {
+        RTSP_LOG_WARNING("Record skipped IDR without SPS/PPS on path: " + path_);
+        return false;
+    }
+    file_ = std::fopen(file_name.c_str(), "wb");
+    if (!file_) {
+        RTSP_LOG_ERROR("Failed to open record file: " + file_name);
+        return false;
+    }
+    // fragment 已在 out_ 里拼成整块，关掉 stdio 缓冲避免多一次拷贝
+    std::setvbuf(file_, nullptr, _IONBF, 0);
+    muxer_ = std::move(muxer);
+    segment_decode_time_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.current_file = file_name;
+    }
+    RTSP_LOG_INFO("Recording " + path_ + " to " + file_name);
+    return writeBuffer();
+}
+
+void PathRecorder::closeSegment() {
+    if (!file_) {
+        return;
+    }
+    std::fclose(file_);
+    file_ = nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.segments_completed++;
+}
+
+void PathRecorder::flushFragment(size_t count) {
+    if (count == 0 || !file_) {
+        return;
+    }
+    samples_.clear();
+    size_t bytes = 0;
+    uint64_t duration = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Fmp4Sample sample;
+        sample.parts = std::move(pending_[i].parts);
+        sample.duration = pending_durations_[i];
+        sample.is_sync = pending_[i].is_sync;
+        samples_.push_back(std::move(sample));
+        bytes += pending_[i].bytes;
+        duration += pending_durations_[i];
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(count));
+    pending_durations_.erase(pending_durations_.begin(),
+                             pending_durations_.begin() + static_cast<std::ptrdiff_t>(count));
+    pending_bytes_ -= bytes;
+
+    out_.clear();
+    muxer_.buildFragment(samples_, segment_decode_time_, out_);
+    segment_decode_time_ += duration;
+    samples_.clear();  // 释放共享帧引用
+    backlog_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+
+    if (writeBuffer()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.frames_written += count;
+    }
+}
+
+bool PathRecorder::writeBuffer() {
+    if (!file_ || out_.empty()) {
+        return false;
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    const size_t written = std::fwrite(out_.data(), 1, out_.size(), file_);
+    const bool ok = written == out_.size() && std::fflush(file_) == 0;
+    const uint64_t latency_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count());
+    if (!ok) {
+        RTSP_LOG_ERROR("Record write failed on path: " + path_);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.bytes_written += written;
+    stats_.last_write_latency_us = latency_us;
+    if (latency_us > stats_.max_write_latency_us) {
+        stats_.max_write_latency_us = latency_us;
+    }
+    total_write_latency_us_ += latency_us;
+    write_count_++;
+    stats_.avg_write_latency_us = total_write_latency_us_ / write_count_;
+    return ok;
+}
+
+uint32_t PathRecorder::defaultDuration() const {
+    return Fmp4Muxer::kTimescale / (path_config_.fps > 0 ? path_config_.fps : 25);
+}
+
+} // namespace rtsp
@@ -0,0 +1,87 @@
+#pragma once
+
+// 路径录像器：MediaPath 广播时把共享帧交给 onFrame（只入队、不拷贝、不碰磁盘），
+// 独立写线程按 GOP 封装 fMP4 fragment，一次 fwrite 写出，并在 IDR 处切分段文件。
+
+#include "fmp4_muxer.h"
+
+#include <rtsp-server/rtsp_server.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rtsp {
+
+class PathRecorder {
+public:
+    PathRecorder(const std::string& path, const PathConfig& path_config, const RecordConfig& config);
+    ~PathRecorder();
+
+    PathRecorder(const PathRecorder&) = delete;
+    PathRecorder& operator=(const PathRecorder&) = delete;
+
+    bool start();
+    // 写完已入队的数据、关闭当前段文件后返回
+    void stop();
+
+    // 由 MediaPath 在 sessions_mutex 下调用（调用是串行的）。frame 须为托管缓冲，
+    // 这里只增加引用计数；AU 结束时整体入队，积压超限则丢弃直到下一个 IDR。
+    void onFrame(const VideoFrame& frame, bool end_of_au);
+
+    RecordStats stats() const;
+
+private:
+    struct AccessUnit {
+        std::vector<VideoFrame> parts;
+        uint64_t pts_us = 0;   // 微秒，样本时长按差值换算为 90kHz，不受毫秒取整影响
+        bool is_sync = false;
+        size_t bytes = 0;
+    };
+
+    void writerLoop();
+    void handleAccessUnit(AccessUnit& au);
+    bool extractParameterSets(const AccessUnit& au, Fmp4Muxer::TrackInfo& track) const;
+    bool openSegment(const Fmp4Muxer::TrackInfo& track);
+    void closeSegment();
+    // 把 pending_ 的前 count 个样本写成一个 fragment
+    void flushFragment(size_t count);
+    bool writeBuffer();
+    uint32_t defaultDuration() const;
+
+    const std::string path_;
+    const PathConfig path_config_;
+    const RecordConfig config_;
+
+    // 入队侧（onFrame 串行调用，无需加锁）
+    AccessUnit assembling_;
+    bool dropping_ = false;
+
+    mutable std::mutex mutex_;              // 保护 queue_ / running_ / stats_
+    std::condition_variable cv_;
+    std::deque<AccessUnit> queue_;
+    bool running_ = false;
+    RecordStats stats_;
+    uint64_t total_write_latency_us_ = 0;
+    uint64_t write_count_ = 0;
+    std::atomic<uint64_t> backlog_bytes_{0};
+    std::thread writer_;
+
+    // 以下仅写线程访问
+    Fmp4Muxer muxer_;
+    FILE* file_ = nullptr;
+    uint32_t segment_index_ = 0;
+    uint64_t segment_decode_time_ = 0;      // 当前段已写样本的累计时长（90kHz）
+    std::vector<AccessUnit> pending_;       // 当前 GOP 尚未写出的 AU
+    std::vector<uint32_t> pending_durations_;
+    size_t pending_bytes_ = 0;
+    std::vector<Fmp4Sample> samples_;       // flushFragment 复用
+    std::vector<uint8_t> out_;              // box 与 mdat 组装缓冲，容量复用
+};
+
+} // namespace rtsp
@@ -0,0 +1,111 @@
+#include "playback_scheduler.h"
+
+#include <rtsp-common/thread_policy.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace rtsp {
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+PlaybackScheduler::PlaybackScheduler() : slots_(kSlots) {
+    current_tick_ = nowNs() / kTickNs;
+    thread_ = startThread(ThreadRole::MediaSend, "rtsp-playback", [this] { loop(); });
+}
+
+PlaybackScheduler::~PlaybackScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void PlaybackScheduler::schedule(const std::shared_ptr<PlaybackTask>& task, int64_t due_ns,
+                                 uint64_t generation) {
+    Timer timer;
+    timer.task = task;
+    timer.due_ns = due_ns;
+    timer.generation = generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_ == 0) {
+            // 空闲期间时间轮不转，从当前时刻接着走
+            current_tick_ = nowNs() / kTickNs;
+        }
+        insertLocked(std::move(timer));
+    }
+    cv_.notify_one();
+}
+
+void PlaybackScheduler::insertLocked(Timer timer) {
+    // 已过期的放进下一个待处理格；超过一圈的在槽位里等到真正到期
+    const int64_t tick = std::max(timer.due_ns / kTickNs, current_tick_);
+    slots_[static_cast<size_t>(tick) % kSlots].push_back(std::move(timer));
+    pending_++;
+}
+
+void PlaybackScheduler::loop() {
+    std::vector<Timer> fired;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (pending_ == 0) {
+            cv_.wait(lock, [this] { return !running_ || pending_ > 0; });
+            continue;
+        }
+
+        const int64_t now_tick = nowNs() / kTickNs;
+        while (current_tick_ <= now_tick) {
+            auto& slot = slots_[static_cast<size_t>(current_tick_) % kSlots];
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i].due_ns / kTickNs <= current_tick_) {
+                    fired.push_back(std::move(slot[i]));
+                    slot[i] = std::move(slot.back());
+                    slot.pop_back();
+                    pending_--;
+                } else {
+                    ++i;
+                }
+            }
+            current_tick_++;
+        }
+
+        if (!fired.empty()) {
+            lock.unlock();
+            for (auto& timer : fired) {
+                auto task = timer.task.lock();
+                if (!task) {
+                    continue;
+                }
+                const int64_t next = task->onTimer(nowNs(), timer.generation);
+                if (next >= 0) {
+                    timer.due_ns = next;
+                    lock.lock();
+                    insertLocked(std::move(timer));
+                    lock.unlock();
+                }
+            }
+            fired.clear();
+            lock.lock();
+            continue;
+        }
+
+        const auto next_tick = std::chrono::steady_clock::time_point(
+            std::chrono::nanoseconds(current_tick_ * kTickNs));
+        cv_.wait_until(lock, next_tick);
+    }
+}
+
+} // namespace rtsp
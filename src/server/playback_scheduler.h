@@ -0,0 +1,57 @@
+#pragma once
+
+// 点播排程：所有文件播放会话共用一个线程与一个时间轮（1ms 一格），
+// 不为每个观看者单独开定时线程。任务按到期时间挂在对应槽位，
+// 触发时由任务自己推送到期帧并返回下一次到期时间。
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rtsp {
+
+class PlaybackTask {
+public:
+    virtual ~PlaybackTask() = default;
+    // now_ns 为 steady_clock 纳秒；返回下一次到期时间，<0 表示不再排程。
+    // generation 与排程时一致才有效（seek/暂停后旧定时自然作废）。
+    virtual int64_t onTimer(int64_t now_ns, uint64_t generation) = 0;
+};
+
+class PlaybackScheduler {
+public:
+    static constexpr int64_t kTickNs = 1000000;
+    static constexpr size_t kSlots = 1024;
+
+    PlaybackScheduler();
+    ~PlaybackScheduler();
+
+    PlaybackScheduler(const PlaybackScheduler&) = delete;
+    PlaybackScheduler& operator=(const PlaybackScheduler&) = delete;
+
+    // 任务只以弱引用挂在时间轮上，会话销毁后定时自动失效
+    void schedule(const std::shared_ptr<PlaybackTask>& task, int64_t due_ns, uint64_t generation);
+
+private:
+    struct Timer {
+        std::weak_ptr<PlaybackTask> task;
+        int64_t due_ns = 0;
+        uint64_t generation = 0;
+    };
+
+    void loop();
+    void insertLocked(Timer timer);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::vector<Timer>> slots_;
+    int64_t current_tick_ = 0;   // 下一个待处理的格
+    size_t pending_ = 0;
+    bool running_ = true;
+    std::thread thread_;
+};
+
+} // namespace rtsp
@@ -0,0 +1,97 @@
+#include "redirect_policy.h"
+
+#include <cmath>
+#include <limits>
+
+namespace rtsp {
+
+namespace {
+
+uint64_t fnv1a(const std::string& text) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char ch : text) {
+        hash ^= ch;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 64 位哈希再做一次 splitmix 混合，映射到 (0, 1)
+double unitInterval(uint64_t hash) {
+    hash += 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    hash ^= hash >> 31;
+    return (static_cast<double>(hash >> 11) + 0.5) / 9007199254740992.0;  // 2^53
+}
+
+} // namespace
+
+RedirectPolicy::RedirectPolicy(const RedirectConfig& config)
+    : config_(config), current_weights_(config.peers.size(), 0) {}
+
+bool RedirectPolicy::overloaded(const ServerLoad& load) const {
+    return (config_.max_sessions > 0 && load.sessions >= config_.max_sessions) ||
+           (config_.max_egress_bps > 0 && load.egress_bps >= config_.max_egress_bps) ||
+           (config_.max_queued_units > 0 && load.queued_units >= config_.max_queued_units) ||
+           (config_.max_cpu_usage > 0.0 && load.cpu_usage >= config_.max_cpu_usage);
+}
+
+bool RedirectPolicy::decide(const std::string& path, const std::string& target, const ServerLoad& load,
+                            std::string& location) {
+    if (!overloaded(load)) {
+        return false;
+    }
+    const int index = pickPeer(path);
+    if (index < 0) {
+        return false;
+    }
+    std::string base = config_.peers[static_cast<size_t>(index)].url;
+    while (!base.empty() && base.back() == '/') {
+        base.pop_back();
+    }
+    location = config_.status_code == 305 ? base : base + target;
+    return true;
+}
+
+int RedirectPolicy::pickPeer(const std::string& path) {
+    int best = -1;
+    if (config_.selection == RedirectPeerSelection::ConsistentHash) {
+        // rendezvous 加权：score = -w / ln(u)，u 由 (节点, 路径) 哈希得到
+        double best_score = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < config_.peers.size(); ++i) {
+            const RedirectPeer& peer = config_.peers[i];
+            if (peer.weight == 0) {
+                continue;
+            }
+            const double u = unitInterval(fnv1a(peer.url + "\n" + path));
+            const double score = -static_cast<double>(peer.weight) / std::log(u);
+            if (score > best_score) {
+                best_score = score;
+                best = static_cast<int>(i);
+            }
+        }
+        return best;
+    }
+
+    // 平滑加权轮询（nginx 算法）：各节点加上自身权重，选最大者并减去总权重
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t total = 0;
+    for (size_t i = 0; i < config_.peers.size(); ++i) {
+        const int64_t weight = config_.peers[i].weight;
+        if (weight == 0) {
+            continue;
+        }
+        current_weights_[i] += weight;
+        total += weight;
+        if (best < 0 || current_weights_[i] > current_weights_[static_cast<size_t>(best)]) {
+            best = static_cast<int>(i);
+        }
+    }
+    if (best >= 0) {
+        current_weights_[static_cast<size_t>(best)] -= total;
+    }
+    return best;
+}
+
+} // namespace rtsp
@@ -0,0 +1,38 @@
+#pragma once
+
+// 负载感知重定向策略：根据本节点负载判断是否过载，过载时按路径从同级节点中选一个。
+// 一致性哈希用 rendezvous（HRW）加权打分，节点增减只影响落在该节点上的路径；
+// 哈希用 FNV-1a，保证不同进程/节点对同一路径选出同一个同级节点。
+
+#include <rtsp-server/rtsp_server.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rtsp {
+
+class RedirectPolicy {
+public:
+    explicit RedirectPolicy(const RedirectConfig& config);
+
+    bool overloaded(const ServerLoad& load) const;
+    // 过载且有可用节点时返回 true，location 为 302 的目标地址（节点地址 + target）
+    // 或 305 的代理地址（节点地址本身）。target 为请求 URL 中 host 之后的部分（含查询串）。
+    bool decide(const std::string& path, const std::string& target, const ServerLoad& load,
+                std::string& location);
+
+    int statusCode() const { return config_.status_code; }
+
+private:
+    // 无可用节点返回 -1
+    int pickPeer(const std::string& path);
+
+    const RedirectConfig config_;
+
+    std::mutex mutex_;                  // 保护平滑加权轮询的当前权重
+    std::vector<int64_t> current_weights_;
+};
+
+} // namespace rtsp
@@ -0,0 +1,218 @@
+#include "relay_source.h"
+
+#include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
+
+#include <chrono>
+#include <utility>
+
+namespace rtsp {
+
+namespace {
+
+// 拉流期间检查观看者数与上游断流的间隔
+constexpr int64_t kPollIntervalMs = 100;
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+RelaySource::RelaySource(const RelayPathConfig& config, Callbacks callbacks)
+    : config_(config), callbacks_(std::move(callbacks)) {}
+
+RelaySource::~RelaySource() {
+    stop();
+}
+
+void RelaySource::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (worker_.joinable() || stopping_) {
+        return;
+    }
+    worker_ = startThread(ThreadRole::Background, "rtsp-relay", [this] { run(); });
+}
+
+void RelaySource::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable() && worker_.get_id() != std::this_thread::get_id()) {
+        worker_.join();
+    }
+}
+
+void RelaySource::wake() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        demand_ = true;
+    }
+    cv_.notify_all();
+}
+
+bool RelaySource::described() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!described_) {
+        retry_now_ = true;
+        cv_.notify_all();
+    }
+    return described_;
+}
+
+RelayStats RelaySource::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+RtspClientConfig RelaySource::clientConfig() const {
+    RtspClientConfig config;
+    config.prefer_tcp_transport = config_.prefer_tcp_transport;
+    config.buffer_size = 1;   // 帧走回调，不从队列读
+    return config;
+}
+
+void RelaySource::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (!described_) {
+            lock.unlock();
+            const bool ok = prefetch();
+            lock.lock();
+            if (ok) {
+                described_ = true;
+                stats_.described = true;
+                cv_.notify_all();
+            } else {
+                stats_.upstream_failures++;
+                waitRetry(lock);
+            }
+            continue;
+        }
+
+        cv_.wait(lock, [this] { return stopping_ || demand_; });
+        if (stopping_) {
+            break;
+        }
+        if (!pull(lock)) {
+            // 上游失败或断流：退避后若仍有观看者则重连
+            waitRetry(lock);
+            lock.unlock();
+            const size_t viewers = callbacks_.viewers();
+            lock.lock();
+            demand_ = demand_ || viewers > 0;
+        }
+    }
+}
+
+bool RelaySource::prefetch() {
+    RtspClient client;
+    client.setConfig(clientConfig());
+    const bool ok = client.open(config_.url) && client.describe();
+    const SessionInfo info = client.getSessionInfo();
+    client.close();
+    if (!ok || info.media_streams.empty()) {
+        RTSP_LOG_WARNING("Relay DESCRIBE failed for path: " + config_.path);
+        return false;
+    }
+    callbacks_.on_describe(info.media_streams.front());
+    RTSP_LOG_INFO("Relay parameters cached for path: " + config_.path);
+    return true;
+}
+
+bool RelaySource::pull(std::unique_lock<std::mutex>& lock) {
+    demand_ = false;
+    lock.unlock();
+
+    RtspClient client;
+    client.setConfig(clientConfig());
+    // 每次拉流从第一个 IDR 开始转发，之前的帧观看者无法解码；
+    // close() 返回后不再回调，按引用捕获局部变量是安全的
+    bool synced = false;
+    client.setFrameCallback([this, &synced](const VideoFrame& frame) {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            last_frame_ms_ = nowMs();
+            synced = synced || frame.type == FrameType::IDR;
+            if (!synced) {
+                return;
+            }
+            stats_.frames_relayed++;
+            stats_.bytes_relayed += frame.size;
+        }
+        callbacks_.on_frame(frame);
+    });
+    bool ok = client.open(config_.url) && client.describe() && client.setup(0);
+    if (ok) {
+        const SessionInfo info = client.getSessionInfo();
+        if (!info.media_streams.empty()) {
+            callbacks_.on_describe(info.media_streams.front());
+        }
+        ok = client.play(0);
+    }
+
+    lock.lock();
+    if (!ok) {
+        stats_.upstream_failures++;
+        lock.unlock();
+        client.close();
+        lock.lock();
+        RTSP_LOG_WARNING("Relay upstream failed for path: " + config_.path);
+        return false;
+    }
+    stats_.upstream_connects++;
+    stats_.upstream_active = true;
+    last_frame_ms_ = nowMs();
+    RTSP_LOG_INFO("Relay upstream started for path: " + config_.path);
+
+    bool healthy = true;
+    int64_t idle_since_ms = -1;
+    while (!stopping_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(kPollIntervalMs), [this] { return stopping_; });
+        if (stopping_) {
+            break;
+        }
+        const int64_t now = nowMs();
+        if (now - last_frame_ms_ > static_cast<int64_t>(config_.upstream_timeout_ms)) {
+            RTSP_LOG_WARNING("Relay upstream stalled for path: " + config_.path);
+            stats_.upstream_failures++;
+            healthy = false;
+            break;
+        }
+        // 先清 demand_ 再数观看者：数完之后才加入的观看者会重新置位，空闲断开后立即重连
+        demand_ = false;
+        lock.unlock();
+        const size_t viewers = callbacks_.viewers();
+        lock.lock();
+        if (viewers > 0) {
+            idle_since_ms = -1;
+        } else if (idle_since_ms < 0) {
+            idle_since_ms = now;
+        } else if (now - idle_since_ms >= static_cast<int64_t>(config_.idle_timeout_ms)) {
+            break;
+        }
+    }
+
+    lock.unlock();
+    client.close();   // 返回后不再有帧回调
+    // TEARDOWN 完成后才报告断开，观察到 upstream_active == false 时上游会话已经关闭
+    lock.lock();
+    stats_.upstream_active = false;
+    lock.unlock();
+    callbacks_.on_upstream_stopped();
+    RTSP_LOG_INFO("Relay upstream stopped for path: " + config_.path);
+    lock.lock();
+    return healthy;
+}
+
+void RelaySource::waitRetry(std::unique_lock<std::mutex>& lock) {
+    cv_.wait_for(lock, std::chrono::milliseconds(config_.retry_interval_ms),
+                 [this] { return stopping_ || retry_now_; });
+    retry_now_ = false;
+}
+
+} // namespace rtsp
@@ -0,0 +1,68 @@
+#pragma once
+
+// 拉流转发（边缘代理）：每个转发路径至多一个上游 RtspClient。
+// 添加路径后先做一次 DESCRIBE 缓存编码与参数集，之后观看者的 DESCRIBE 直接用缓存应答；
+// 第一个观看者 SETUP 时才建立上游拉流，收到的帧交给路径广播（每帧只拷贝一次，
+// 与直接推流共用同一条广播路径），最后一个观看者离开并超过 idle_timeout_ms 后断开上游。
+
+#include <rtsp-client/rtsp_client.h>
+#include <rtsp-server/rtsp_server.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace rtsp {
+
+class RelaySource {
+public:
+    struct Callbacks {
+        std::function<void(const MediaInfo&)> on_describe;  // 上游 DESCRIBE 结果（预取与每次拉流开始时）
+        std::function<void(const VideoFrame&)> on_frame;    // 上游帧，在客户端接收线程上调用
+        std::function<void()> on_upstream_stopped;          // 上游拉流结束（空闲断开/断流）
+        std::function<size_t()> viewers;                    // 当前观看会话数
+    };
+
+    RelaySource(const RelayPathConfig& config, Callbacks callbacks);
+    ~RelaySource();
+
+    RelaySource(const RelaySource&) = delete;
+    RelaySource& operator=(const RelaySource&) = delete;
+
+    void start();
+    // 断开上游并等待工作线程退出（进行中的上游请求受其自身超时约束）；之后不再有回调
+    void stop();
+
+    // 有观看者加入：没有上游时立即建立
+    void wake();
+    // 预取的 DESCRIBE 是否已完成；未完成时催工作线程立即重试一次（跳过退避），不等待
+    bool described();
+
+    RelayStats stats() const;
+
+private:
+    void run();
+    bool prefetch();
+    // 拉流直到空闲超时、断流或 stop；返回是否成功建立过上游
+    bool pull(std::unique_lock<std::mutex>& lock);
+    void waitRetry(std::unique_lock<std::mutex>& lock);
+    RtspClientConfig clientConfig() const;
+
+    const RelayPathConfig config_;
+    const Callbacks callbacks_;
+
+    mutable std::mutex mutex_;          // 保护以下字段
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    bool demand_ = false;               // 有观看者加入，待建立上游
+    bool retry_now_ = false;            // 有 DESCRIBE 因预取未完成被拒，跳过退避
+    bool described_ = false;
+    RelayStats stats_;
+    int64_t last_frame_ms_ = 0;    // 最近一次收到上游帧的时刻（steady clock）
+    std::thread worker_;
+};
+
+} // namespace rtsp
@@ -0,0 +1,374 @@
+#include "rtp_ingest.h"
+
+#include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef __linux__
+    #include <errno.h>
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+#endif
+
+namespace rtsp {
+
+namespace {
+
+// 每个循环线程一块接收区：kSlots 个最大 UDP 报文槽，只有写入的页才占物理内存
+constexpr size_t kSlots = 16;
+constexpr size_t kSlotSize = 65536;
+// 一个 socket 一次可读事件最多连取几批，避免一个高码率推流者饿死同线程的其他 socket
+constexpr int kMaxRoundsPerEvent = 4;
+// 注册 id 低 8 位是循环线程下标
+constexpr size_t kMaxLoops = 64;
+constexpr uint64_t kWakeId = 0;
+
+uint32_t readSsrc(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[8]) << 24) |
+           (static_cast<uint32_t>(data[9]) << 16) |
+           (static_cast<uint32_t>(data[10]) << 8) |
+           static_cast<uint32_t>(data[11]);
+}
+
+} // namespace
+
+struct RtpIngestPool::Loop {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<uint64_t, Entry> entries;
+    uint64_t busy = 0;             // 正在处理的注册 id（0 = 空闲）
+    bool busy_shared = false;      // 正在处理的是共享端口 socket
+    uint64_t batches = 0;          // 已处理完的可读事件数，移除共享来源时据此等待
+    bool running = true;
+    std::unique_ptr<uint8_t[]> buffer;
+#ifdef __linux__
+    int epoll_fd = -1;
+    int wake_fd = -1;
+#endif
+};
+
+RtpIngestPool::RtpIngestPool(size_t threads) {
+    threads = std::min(std::max<size_t>(1, threads), kMaxLoops);
+    loops_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        std::unique_ptr<Loop> loop(new Loop());
+        loop->buffer.reset(new uint8_t[kSlots * kSlotSize]);
+#ifdef __linux__
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epoll_fd >= 0 && loop->wake_fd >= 0) {
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.u64 = kWakeId;
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &event);
+        } else {
+            RTSP_LOG_ERROR("RTP ingest: failed to create epoll instance");
+        }
+#endif
+        loops_.push_back(std::move(loop));
+    }
+    for (auto& loop : loops_) {
+        Loop* raw = loop.get();
+        loop->thread = startThread(ThreadRole::MediaReceive, "rtsp-ingest", [this, raw] { run(*raw); });
+    }
+}
+
+RtpIngestPool::~RtpIngestPool() {
+    for (auto& loop : loops_) {
+        {
+            std::lock_guard<std::mutex> lock(loop->mutex);
+            loop->running = false;
+        }
+        loop->cv.notify_all();
+#ifdef __linux__
+        if (loop->wake_fd >= 0) {
+            const uint64_t one = 1;
+            (void)!::write(loop->wake_fd, &one, sizeof(one));
+        }
+#endif
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+#ifdef __linux__
+        if (loop->epoll_fd >= 0) {
+            ::close(loop->epoll_fd);
+        }
+        if (loop->wake_fd >= 0) {
+            ::close(loop->wake_fd);
+        }
+#endif
+    }
+}
+
+bool RtpIngestPool::bindShared(const std::string& ip, uint16_t rtp_port) {
+    if (shared_rtp_port_ != 0 || rtp_port == 0) {
+        return false;
+    }
+    std::vector<uint64_t> ids;
+    const auto fail = [&]() {
+        for (uint64_t id : ids) {
+            removeSocket(id);
+        }
+        shared_sockets_.clear();
+        return false;
+    };
+
+    // RTP：每个循环线程一个 socket；平台不支持 SO_REUSEPORT 时只绑一个
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        std::unique_ptr<Socket> socket(new Socket());
+        bool bound = socket->bindUdp(ip, rtp_port, loops_.size() > 1);
+        if (!bound && i == 0) {
+            socket.reset(new Socket());
+            bound = socket->bindUdp(ip, rtp_port);
+        }
+        if (!bound) {
+            if (i == 0) {
+                return fail();
+            }
+            RTSP_LOG_WARNING("RTP ingest: SO_REUSEPORT unavailable, shared port served by " +
+                             std::to_string(i) + " thread(s)");
+            break;
+        }
+        socket->setRecvBufferSize(4 * 1024 * 1024);
+        Entry entry;
+        entry.socket = socket.get();
+        entry.shared = true;
+        const uint64_t id = registerEntry(i, entry);
+        if (id == 0) {
+            return fail();
+        }
+        ids.push_back(id);
+        shared_sockets_.push_back(std::move(socket));
+    }
+
+    // RTCP：读出后丢弃，避免内核缓冲堆满
+    std::unique_ptr<Socket> rtcp(new Socket());
+    if (!rtcp->bindUdp(ip, static_cast<uint16_t>(rtp_port + 1))) {
+        return fail();
+    }
+    Entry entry;
+    entry.socket = rtcp.get();
+    const uint64_t id = registerEntry(0, entry);
+    if (id == 0) {
+        return fail();
+    }
+    shared_sockets_.push_back(std::move(rtcp));
+    shared_rtp_port_ = rtp_port;
+    return true;
+}
+
+uint64_t RtpIngestPool::addSocket(Socket* socket, RtpIngestSink* sink) {
+    if (!socket || !socket->isValid()) {
+        return 0;
+    }
+    Entry entry;
+    entry.socket = socket;
+    entry.sink = sink;
+    return registerEntry(next_loop_.fetch_add(1) % loops_.size(), entry);
+}
+
+uint64_t RtpIngestPool::registerEntry(size_t index, const Entry& entry) {
+    Loop& loop = *loops_[index];
+    const uint64_t id = (next_id_.fetch_add(1) << 8) | index;
+    std::lock_guard<std::mutex> lock(loop.mutex);
+    if (!loop.running) {
+        return 0;
+    }
+    loop.entries[id] = entry;
+#ifdef __linux__
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if (loop.epoll_fd < 0 || epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, entry.socket->getFd(), &event) != 0) {
+        loop.entries.erase(id);
+        return 0;
+    }
+#endif
+    loop.cv.notify_all();
+    return id;
+}
+
+void RtpIngestPool::removeSocket(uint64_t id) {
+    if (id == 0) {
+        return;
+    }
+    Loop& loop = *loops_[(id & 0xFF) % loops_.size()];
+    std::unique_lock<std::mutex> lock(loop.mutex);
+    auto it = loop.entries.find(id);
+    if (it == loop.entries.end()) {
+        return;
+    }
+#ifdef __linux__
+    if (loop.epoll_fd >= 0) {
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, it->second.socket->getFd(), nullptr);
+    }
+#endif
+    loop.entries.erase(it);
+    if (std::this_thread::get_id() != loop.thread.get_id()) {
+        loop.cv.wait(lock, [&loop, id] { return loop.busy != id; });
+    }
+}
+
+bool RtpIngestPool::addSource(const UdpSource& source, RtpIngestSink* sink) {
+    if (shared_rtp_port_ == 0 || !sink) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    SourceEntry entry;
+    entry.sink = sink;
+    return sources_.emplace(source, entry).second;
+}
+
+void RtpIngestPool::removeSource(const UdpSource& source) {
+    {
+        std::lock_guard<std::mutex> lock(sources_mutex_);
+        if (sources_.erase(source) == 0) {
+            return;
+        }
+    }
+    // 共享 socket 上正在处理的那一批可能已经查到这个 sink，等它处理完
+    for (auto& loop : loops_) {
+        std::unique_lock<std::mutex> lock(loop->mutex);
+        if (std::this_thread::get_id() == loop->thread.get_id()) {
+            continue;
+        }
+        const uint64_t batches = loop->batches;
+        Loop* raw = loop.get();
+        loop->cv.wait(lock, [raw, batches] { return !raw->busy_shared || raw->batches != batches; });
+    }
+}
+
+void RtpIngestPool::dispatchShared(const uint8_t* data, size_t len, const UdpSource& source) {
+    if (len < 12) {
+        return;
+    }
+    const uint32_t ssrc = readSsrc(data);
+    RtpIngestSink* sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(sources_mutex_);
+        auto it = sources_.find(source);
+        if (it == sources_.end()) {
+            return;
+        }
+        SourceEntry& entry = it->second;
+        if (!entry.ssrc_locked) {
+            entry.ssrc = ssrc;
+            entry.ssrc_locked = true;
+        } else if (entry.ssrc != ssrc) {
+            return;
+        }
+        sink = entry.sink;
+    }
+    sink->onRtpPacket(data, len);
+}
+
+void RtpIngestPool::drain(Loop& loop, const Entry& entry) {
+    const auto on_datagram = [this, &entry](const uint8_t* data, size_t len, const UdpSource& source) {
+        if (entry.shared) {
+            dispatchShared(data, len, source);
+        } else if (entry.sink) {
+            entry.sink->onRtpPacket(data, len);
+        }
+    };
+    for (int round = 0; round < kMaxRoundsPerEvent; ++round) {
+        const int received = entry.socket->recvBatchNow(loop.buffer.get(), kSlotSize, kSlots, on_datagram);
+        if (received < static_cast<int>(kSlots)) {
+            break;
+        }
+    }
+}
+
+void RtpIngestPool::run(Loop& loop) {
+#ifdef __linux__
+    struct epoll_event events[64];
+    while (true) {
+        const int ready = epoll_wait(loop.epoll_fd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            RTSP_LOG_ERROR("RTP ingest: epoll_wait failed");
+            return;
+        }
+        for (int i = 0; i < ready; ++i) {
+            const uint64_t id = events[i].data.u64;
+            Entry entry;
+            {
+                std::lock_guard<std::mutex> lock(loop.mutex);
+                if (!loop.running) {
+                    return;
+                }
+                auto it = loop.entries.find(id);
+                if (id == kWakeId || it == loop.entries.end()) {
+                    continue;
+                }
+                entry = it->second;
+                loop.busy = id;
+                loop.busy_shared = entry.shared;
+            }
+            drain(loop, entry);
+            {
+                std::lock_guard<std::mutex> lock(loop.mutex);
+                loop.busy = 0;
+                loop.busy_shared = false;
+                loop.batches++;
+            }
+            loop.cv.notify_all();
+        }
+    }
+#else
+    // 无 epoll 的平台：每轮按注册表重建 Selector（推流者数量大时应在 Linux 上部署）
+    while (true) {
+        std::vector<std::pair<uint64_t, Entry>> snapshot;
+        {
+            std::unique_lock<std::mutex> lock(loop.mutex);
+            loop.cv.wait_for(lock, std::chrono::milliseconds(50),
+                             [&loop] { return !loop.running || !loop.entries.empty(); });
+            if (!loop.running) {
+                return;
+            }
+            snapshot.assign(loop.entries.begin(), loop.entries.end());
+        }
+        if (snapshot.empty()) {
+            continue;
+        }
+        Selector selector;
+        for (const auto& item : snapshot) {
+            selector.addRead(item.second.socket->getFd());
+        }
+        if (selector.wait(50) <= 0) {
+            continue;
+        }
+        for (const auto& item : snapshot) {
+            {
+                std::lock_guard<std::mutex> lock(loop.mutex);
+                if (!loop.running) {
+                    return;
+                }
+                if (loop.entries.find(item.first) == loop.entries.end() ||
+                    !selector.isReadable(item.second.socket->getFd())) {
+                    continue;
+                }
+                loop.busy = item.first;
+                loop.busy_shared = item.second.shared;
+            }
+            drain(loop, item.second);
+            {
+                std::lock_guard<std::mutex> lock(loop.mutex);
+                loop.busy = 0;
+                loop.busy_shared = false;
+                loop.batches++;
+            }
+            loop.cv.notify_all();
+        }
+    }
+#endif
+}
+
+} // namespace rtsp
@@ -0,0 +1,86 @@
+#pragma once
+
+// 推流（RECORD）收流事件循环：固定数量的 rtsp-ingest 线程用 epoll 等待全部推流者的 UDP socket，
+// 可读时一次 recvmmsg 取回一批报文交给对应的接收器，推流者再多也不增加线程。
+// 可选共享端口：所有推流者发往同一个 RTP 端口（每个循环线程一个 SO_REUSEPORT socket，
+// 内核按四元组分摊），按来源地址分流，首包锁定 SSRC，之后 SSRC 不符的报文丢弃。
+
+#include <rtsp-common/socket.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace rtsp {
+
+class RtpIngestSink {
+public:
+    virtual ~RtpIngestSink() = default;
+    // 在循环线程上逐个交付 RTP 报文（数据仅在回调内有效）。同一 sink 同一时刻只在一个线程上被调用
+    virtual void onRtpPacket(const uint8_t* data, size_t len) = 0;
+};
+
+class RtpIngestPool {
+public:
+    explicit RtpIngestPool(size_t threads);
+    ~RtpIngestPool();
+
+    RtpIngestPool(const RtpIngestPool&) = delete;
+    RtpIngestPool& operator=(const RtpIngestPool&) = delete;
+
+    // 启用共享端口：每个循环线程在 rtp_port 上绑一个 SO_REUSEPORT socket，另绑 rtp_port + 1 收 RTCP（读后丢弃）
+    bool bindShared(const std::string& ip, uint16_t rtp_port);
+    uint16_t sharedRtpPort() const { return shared_rtp_port_; }
+
+    // 独立 socket：socket 须保持有效直到 removeSocket 返回；sink 为空表示读取后丢弃（RTCP）。
+    // 返回注册 id，失败返回 0
+    uint64_t addSocket(Socket* socket, RtpIngestSink* sink);
+    // 共享端口上的一个来源；同一来源重复注册返回 false
+    bool addSource(const UdpSource& source, RtpIngestSink* sink);
+    // 两者返回后不会再回调对应的 sink（进行中的回调已结束）
+    void removeSocket(uint64_t id);
+    void removeSource(const UdpSource& source);
+
+    size_t threadCount() const { return loops_.size(); }
+
+private:
+    struct Loop;
+    struct Entry {
+        Socket* socket = nullptr;
+        RtpIngestSink* sink = nullptr;
+        bool shared = false;           // 共享端口 socket：按来源分流
+    };
+    struct SourceHash {
+        size_t operator()(const UdpSource& source) const {
+            return (static_cast<size_t>(source.ip) << 16) ^ source.port;
+        }
+    };
+    struct SourceEntry {
+        RtpIngestSink* sink = nullptr;
+        uint32_t ssrc = 0;
+        bool ssrc_locked = false;
+    };
+
+    void run(Loop& loop);
+    void drain(Loop& loop, const Entry& entry);
+    void dispatchShared(const uint8_t* data, size_t len, const UdpSource& source);
+    uint64_t registerEntry(size_t index, const Entry& entry);
+
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<uint64_t> next_id_{1};
+    std::atomic<size_t> next_loop_{0};
+    uint16_t shared_rtp_port_ = 0;
+    std::vector<std::unique_ptr<Socket>> shared_sockets_;
+
+    std::mutex sources_mutex_;
+    std::unordered_map<UdpSource, SourceEntry, SourceHash> sources_;
+};
+
+} // namespace rtsp
@@ -2,8 +2,20 @@
 #include <rtsp-common/rtsp_request.h>
 #include <rtsp-common/sdp.h>
 #include <rtsp-common/rtp_packer.h>
+#include <rtsp-common/sps_parser.h>
 #include <rtsp-common/socket.h>
 #include <rtsp-common/common.h>
+#include <rtsp-common/thread_policy.h>
+#include "path_recorder.h"
+#include "file_source.h"
+#include "playback_scheduler.h"
+#include "timeshift_buffer.h"
+#include "hls_packager.h"
+#include "hls_server.h"
+#include "relay_source.h"
+#include "redirect_policy.h"
+#include "send_worker_pool.h"
+#include "rtp_ingest.h"
 
 #include <map>
 #include <set>
@@ -14,14 +26,17 @@
 #include <chrono>
 #include <sstream>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
 #include <condition_variable>
 #include <queue>
+#include <deque>
 #include <vector>
 #include <regex>
 #include <unordered_map>
-#include <future>
 #include <random>
 #include <iomanip>
+#include <ctime>
 
 namespace rtsp {
 
@@ -86,24 +101,45 @@ bool assignIfChanged(std::vector<uint8_t>& dst, const uint8_t* src, size_t src_s
     return true;
 }
 
+// 刷新路径配置中由 SPS 得出的字段；只在 SPS 变化时调用，解析失败时保持原值
+void applySpsInfo(PathConfig& config) {
+    SpsInfo info;
+    if (config.sps.empty() || !parseSps(config.codec, config.sps.data(), config.sps.size(), info)) {
+        return;
+    }
+    config.width = info.width;
+    config.height = info.height;
+    if (info.fps > 0) {
+        config.fps = info.fps;
+    }
+    config.profile_idc = info.profile_idc;
+    config.level_idc = info.level_idc;
+    config.high_tier = info.high_tier;
+}
+
 bool autoExtractH264ParameterSets(PathConfig& config, const uint8_t* data, size_t size) {
     bool updated = false;
+    bool sps_changed = false;
     forEachAnnexBNalu(data, size, [&](const uint8_t* nalu, size_t nalu_size) {
         if (nalu_size == 0) {
             return;
         }
         const uint8_t type = nalu[0] & 0x1F;
         if (type == 7) {
-            updated = assignIfChanged(config.sps, nalu, nalu_size) || updated;
+            sps_changed = assignIfChanged(config.sps, nalu, nalu_size) || sps_changed;
         } else if (type == 8) {
             updated = assignIfChanged(config.pps, nalu, nalu_size) || updated;
         }
     });
-    return updated;
+    if (sps_changed) {
+        applySpsInfo(config);
+    }
+    return updated || sps_changed;
 }
 
 bool autoExtractH265ParameterSets(PathConfig& config, const uint8_t* data, size_t size) {
     bool updated = false;
+    bool sps_changed = false;
     forEachAnnexBNalu(data, size, [&](const uint8_t* nalu, size_t nalu_size) {
         if (nalu_size < 2) {
             return;
@@ -112,12 +148,83 @@ bool autoExtractH265ParameterSets(PathConfig& config, const uint8_t* data, size_
         if (type == 32) {
             updated = assignIfChanged(config.vps, nalu, nalu_size) || updated;
         } else if (type == 33) {
-            updated = assignIfChanged(config.sps, nalu, nalu_size) || updated;
+            sps_changed = assignIfChanged(config.sps, nalu, nalu_size) || sps_changed;
         } else if (type == 34) {
             updated = assignIfChanged(config.pps, nalu, nalu_size) || updated;
         }
     });
-    return updated;
+    if (sps_changed) {
+        applySpsInfo(config);
+    }
+    return updated || sps_changed;
+}
+
+// AU 中是否已带 SPS（H.264 type 7 / H.265 type 33）
+bool containsSps(CodecType codec, const uint8_t* data, size_t size) {
+    bool found = false;
+    forEachAnnexBNalu(data, size, [&](const uint8_t* nalu, size_t nalu_size) {
+        if (found || nalu_size == 0) {
+            return;
+        }
+        const uint8_t type = codec == CodecType::H264 ? (nalu[0] & 0x1F) : ((nalu[0] >> 1) & 0x3F);
+        found = codec == CodecType::H264 ? type == 7 : type == 33;
+    });
+    return found;
+}
+
+// 订阅过滤按 AU 中的 VCL NALU 分类：IDR/IRAP、参考帧、非参考帧（H.264 nal_ref_idc == 0，
+// H.265 子层非参考类型），不含 VCL 的片段（参数集、SEI、AUD）留给后续片段判定
+enum class UnitClass {
+    Key,
+    Reference,
+    NonReference,
+    NoVcl
+};
+
+UnitClass classifyUnit(const VideoFrame& unit) {
+    bool key = false;
+    bool reference = false;
+    bool non_reference = false;
+    forEachAnnexBNalu(unit.data, unit.size, [&](const uint8_t* nalu, size_t nalu_size) {
+        if (nalu_size == 0) {
+            return;
+        }
+        if (unit.codec == CodecType::H265) {
+            const uint8_t type = (nalu[0] >> 1) & 0x3F;
+            if (type >= 16 && type <= 23) {
+                key = true;
+            } else if (type <= 15) {
+                (type % 2 == 0 ? non_reference : reference) = true;
+            }
+        } else {
+            const uint8_t type = nalu[0] & 0x1F;
+            if (type == 5) {
+                key = true;
+            } else if (type >= 1 && type <= 4) {
+                ((nalu[0] & 0x60) == 0 ? non_reference : reference) = true;
+            }
+        }
+    });
+    if (key || unit.type == FrameType::IDR) {
+        return UnitClass::Key;
+    }
+    if (reference) {
+        return UnitClass::Reference;
+    }
+    return non_reference ? UnitClass::NonReference : UnitClass::NoVcl;
+}
+
+// 将路径配置中的 VPS/SPS/PPS 以 Annex-B 追加到 out
+void appendParameterSets(const PathConfig& config, std::vector<uint8_t>& out) {
+    static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+    const std::vector<uint8_t>* sets[] = {&config.vps, &config.sps, &config.pps};
+    for (const auto* set : sets) {
+        if (set->empty() || (set == &config.vps && config.codec != CodecType::H265)) {
+            continue;
+        }
+        out.insert(out.end(), start_code, start_code + 4);
+        out.insert(out.end(), set->begin(), set->end());
+    }
 }
 
 std::shared_ptr<std::vector<uint8_t>> makeManagedBuffer(const uint8_t* data, size_t size) {
@@ -128,30 +235,54 @@ std::shared_ptr<std::vector<uint8_t>> makeManagedBuffer(const uint8_t* data, siz
     return buf;
 }
 
+// 毫秒与微秒两组时间戳互相补齐，以推流方给出的更精确的一组为准
+void normalizeTimestamps(VideoFrame& frame) {
+    frame.pts_us = framePtsUs(frame);
+    frame.dts_us = frameDtsUs(frame);
+    frame.pts = frame.pts_us / 1000;
+    frame.dts = frame.dts_us / 1000;
+}
+
 VideoFrame cloneFrameManaged(const VideoFrame& src) {
     VideoFrame copy = src;
+    normalizeTimestamps(copy);
     copy.managed_data = makeManagedBuffer(src.data, src.size);
     copy.data = copy.managed_data->empty() ? nullptr : copy.managed_data->data();
     copy.size = copy.managed_data->size();
     return copy;
 }
 
-bool joinThreadWithTimeout(std::thread& t, uint32_t timeout_ms) {
+// 线程退出信号：线程函数返回前 set()。限时 join 先在这里等，到时线程已退出就 join，
+// 否则 detach——不必为每次限时 join 另起一个 joiner 线程
+struct ThreadExit {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool exited = false;
+
+    void set() {
+        std::lock_guard<std::mutex> lock(mutex);
+        exited = true;
+        cv.notify_all();
+    }
+
+    bool isSet() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return exited;
+    }
+};
+
+bool joinThreadWithTimeout(std::thread& t, const std::shared_ptr<ThreadExit>& exit, uint32_t timeout_ms) {
     if (!t.joinable()) return true;
-    std::thread owned = std::move(t);
-    std::promise<void> done;
-    auto fut = done.get_future();
-    std::thread joiner([owned = std::move(owned), done = std::move(done)]() mutable {
-        if (owned.joinable()) {
-            owned.join();
-        }
-        done.set_value();
-    });
-    if (fut.wait_for(std::chrono::milliseconds(timeout_ms)) == std::future_status::ready) {
-        joiner.join();
+    bool exited = true;
+    if (exit) {
+        std::unique_lock<std::mutex> lock(exit->mutex);
+        exited = exit->cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] { return exit->exited; });
+    }
+    if (exited) {
+        t.join();
         return true;
     }
-    joiner.detach();
+    t.detach();
     return false;
 }
 
@@ -168,17 +299,78 @@ std::string toLowerCopy(std::string text) {
     return text;
 }
 
+std::string trimCopy(const std::string& text) {
+    const size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    const size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+// URL 中 '?' 之后的查询串，没有则为空
+std::string urlQuery(const std::string& url) {
+    const size_t q = url.find('?');
+    return q == std::string::npos ? std::string() : url.substr(q + 1);
+}
+
 bool isRecordTransport(const std::string& transport) {
     return toLowerCopy(transport).find("mode=record") != std::string::npos;
 }
 
-class PublishRtpReceiver {
+// 解析 "npt=12.5-" / "npt=0-30" 的起点；"npt=now-" 或无 Range 返回 false
+bool parseNptStart(const std::string& range, uint64_t& start_ms) {
+    const std::string lower = toLowerCopy(range);
+    const size_t pos = lower.find("npt=");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    const char* begin = lower.c_str() + pos + 4;
+    char* end = nullptr;
+    const double seconds = std::strtod(begin, &end);
+    if (end == begin || seconds < 0.0) {
+        return false;
+    }
+    start_ms = static_cast<uint64_t>(seconds * 1000.0 + 0.5);
+    return true;
+}
+
+// 时移路径的 Range：npt=<秒> 从缓冲最老的 IDR 起算，npt=now-<秒> 为比直播晚若干秒。
+// 单独的 npt=now- 即看直播，返回 false
+bool parseTimeShiftNpt(const std::string& range, uint64_t& offset_ms, bool& from_live) {
+    const std::string lower = toLowerCopy(range);
+    const size_t pos = lower.find("npt=");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    from_live = lower.compare(pos + 4, 4, "now-") == 0;
+    if (!from_live) {
+        return parseNptStart(range, offset_ms);
+    }
+    const char* begin = lower.c_str() + pos + 8;
+    char* end = nullptr;
+    const double seconds = std::strtod(begin, &end);
+    if (end == begin || seconds < 0.0) {
+        return false;
+    }
+    offset_ms = static_cast<uint64_t>(seconds * 1000.0 + 0.5);
+    return true;
+}
+
+std::string formatNpt(uint64_t ms) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(ms) / 1000.0);
+    return buf;
+}
+
+class PublishRtpReceiver : public RtpIngestSink {
 public:
     using FrameCallback = std::function<void(const VideoFrame&)>;
 
-    PublishRtpReceiver() = default;
-    ~PublishRtpReceiver() { stop(); }
+    explicit PublishRtpReceiver(std::shared_ptr<RtpIngestPool> pool) : pool_(std::move(pool)) {}
+    ~PublishRtpReceiver() override { stop(); }
 
+    // 独立端口：本接收器自己的一对 socket，由收流事件循环等待
     bool init(uint16_t rtp_port, uint16_t rtcp_port) {
         if (!rtp_socket_.bindUdp("0.0.0.0", rtp_port)) {
             return false;
@@ -194,42 +386,58 @@ public:
         return true;
     }
 
-    void start() {
-        if (running_) {
-            return;
+    // 共享端口：不绑 socket，RECORD 后按推流者的来源地址从共享端口分流过来
+    bool initShared(const UdpSource& source) {
+        if (pool_->sharedRtpPort() == 0) {
+            return false;
         }
-        running_ = true;
-        receive_thread_ = std::thread([this]() { receiveLoop(); });
+        shared_source_ = source;
+        shared_ = true;
+        rtp_port_ = pool_->sharedRtpPort();
+        rtcp_port_ = static_cast<uint16_t>(rtp_port_ + 1);
+        return true;
     }
 
-    bool stopWithTimeout(uint32_t timeout_ms) {
-        if (!running_ && !receive_thread_.joinable()) {
+    bool start() {
+        if (running_) {
             return true;
         }
-
-        running_ = false;
-        rtp_socket_.shutdownReadWrite();
-        rtcp_socket_.shutdownReadWrite();
-        if (rtp_port_ != 0) {
-            Socket wake_socket;
-            if (wake_socket.bindUdp("0.0.0.0", 0)) {
-                uint8_t marker = 0;
-                wake_socket.sendTo(&marker, 1, "127.0.0.1", rtp_port_);
+        running_ = true;
+        if (shared_) {
+            if (!pool_->addSource(shared_source_, this)) {
+                running_ = false;
+                return false;
             }
+            return true;
         }
-
-        const bool joined = joinThreadWithTimeout(receive_thread_, timeout_ms);
-        rtp_socket_.close();
-        rtcp_socket_.close();
-        clearCurrentFrameState();
-        reorder_buffer_.clear();
-        seq_initialized_ = false;
-        reorder_initialized_ = false;
-        return joined;
+        rtp_id_ = pool_->addSocket(&rtp_socket_, this);
+        rtcp_id_ = pool_->addSocket(&rtcp_socket_, nullptr);   // RTCP 读出后丢弃
+        if (rtp_id_ == 0) {
+            stop();
+            return false;
+        }
+        return true;
     }
 
     void stop() {
-        (void)stopWithTimeout(2000);
+        // 注销返回后事件循环不会再回调本对象
+        if (shared_) {
+            if (running_) {
+                pool_->removeSource(shared_source_);
+            }
+        } else {
+            pool_->removeSocket(rtp_id_);
+            pool_->removeSocket(rtcp_id_);
+            rtp_id_ = 0;
+            rtcp_id_ = 0;
+            rtp_socket_.close();
+            rtcp_socket_.close();
+        }
+        running_ = false;
+        clearCurrentFrameState();
+        resetReorder();
+        seq_initialized_ = false;
+        timestamp_unwrapper_.reset();
     }
 
     void setCallback(FrameCallback callback) {
@@ -247,6 +455,10 @@ public:
     uint16_t getRtpPort() const { return rtp_port_; }
     uint16_t getRtcpPort() const { return rtcp_port_; }
 
+    void onRtpPacket(const uint8_t* data, size_t len) override {
+        ingestRtpPacket(data, len);
+    }
+
 private:
     static uint32_t parseRtpTimestampFromRaw(const uint8_t* data, size_t len) {
         if (!data || len < 8) {
@@ -258,10 +470,8 @@ private:
                static_cast<uint32_t>(data[7]);
     }
 
-    static uint32_t parseRtpTimestampFromPacket(const std::vector<uint8_t>& packet) {
-        return parseRtpTimestampFromRaw(packet.data(), packet.size());
-    }
-
+    // 固定大小的重排环：按 seq 落槽，槽内缓冲复用，不随报文分配。
+    // 按序到达且环为空时直接处理，不拷贝
     void ingestRtpPacket(const uint8_t* data, size_t len) {
         if (!data || len < 12) {
             return;
@@ -275,48 +485,88 @@ private:
             reorder_initialized_ = true;
         }
 
-        reorder_buffer_[seq] = std::vector<uint8_t>(data, data + len);
+        const int16_t ahead = static_cast<int16_t>(seq - expected_seq_);
+        if (ahead < 0) {
+            return;   // 迟到或重复：之后的包已经交付
+        }
+        if (ahead == 0 && reorder_count_ == 0) {
+            processRtpPacket(data, len);
+            expected_seq_ = static_cast<uint16_t>(expected_seq_ + 1);
+            return;
+        }
+        if (static_cast<size_t>(ahead) >= kReorderSlots) {
+            // 超出环的跨度：放弃缺口，先按序交付已缓存的，再从这个包继续
+            while (reorder_count_ > 0) {
+                skipToBuffered();
+                drainReorder();
+            }
+            expected_seq_ = seq;
+            processRtpPacket(data, len);
+            expected_seq_ = static_cast<uint16_t>(expected_seq_ + 1);
+            return;
+        }
+
+        ReorderSlot& slot = reorder_ring_[seq & (kReorderSlots - 1)];
+        if (slot.filled) {
+            return;   // 重复
+        }
+        slot.data.assign(data, data + len);
+        slot.filled = true;
+        reorder_count_++;
+        drainReorder();
+
+        if (reorder_count_ > jitter_buffer_packets_) {
+            skipToBuffered();
+            drainReorder();
+        }
 
-        while (true) {
-            auto it = reorder_buffer_.find(expected_seq_);
-            if (it == reorder_buffer_.end()) {
+        if (reorder_count_ > 0) {
+            // 缺口之后已经开始了新的一帧：不再等缺口
+            const uint16_t first = skipDistance();
+            const ReorderSlot& earliest =
+                reorder_ring_[static_cast<uint16_t>(expected_seq_ + first) & (kReorderSlots - 1)];
+            if (ts != parseRtpTimestampFromRaw(earliest.data.data(), earliest.data.size())) {
+                skipToBuffered();
+                drainReorder();
+            }
+        }
+    }
+
+    void drainReorder() {
+        while (reorder_count_ > 0) {
+            ReorderSlot& slot = reorder_ring_[expected_seq_ & (kReorderSlots - 1)];
+            if (!slot.filled) {
                 break;
             }
-            processRtpPacket(it->second.data(), it->second.size());
-            reorder_buffer_.erase(it);
+            processRtpPacket(slot.data.data(), slot.data.size());
+            slot.filled = false;
+            reorder_count_--;
             expected_seq_ = static_cast<uint16_t>(expected_seq_ + 1);
         }
+    }
 
-        if (reorder_buffer_.size() > jitter_buffer_packets_) {
-            auto it = reorder_buffer_.begin();
-            expected_seq_ = it->first;
-            while (true) {
-                auto run = reorder_buffer_.find(expected_seq_);
-                if (run == reorder_buffer_.end()) {
-                    break;
-                }
-                processRtpPacket(run->second.data(), run->second.size());
-                reorder_buffer_.erase(run);
-                expected_seq_ = static_cast<uint16_t>(expected_seq_ + 1);
+    // expected_seq_ 到最早一个已缓存包的距离（环非空时调用）
+    uint16_t skipDistance() const {
+        for (uint16_t i = 0; i < kReorderSlots; ++i) {
+            if (reorder_ring_[static_cast<uint16_t>(expected_seq_ + i) & (kReorderSlots - 1)].filled) {
+                return i;
             }
         }
+        return 0;
+    }
 
-        if (!reorder_buffer_.empty() && reorder_buffer_.find(expected_seq_) == reorder_buffer_.end()) {
-            auto first_it = reorder_buffer_.begin();
-            const uint32_t first_ts = parseRtpTimestampFromPacket(first_it->second);
-            if (ts != first_ts) {
-                expected_seq_ = first_it->first;
-                while (true) {
-                    auto run = reorder_buffer_.find(expected_seq_);
-                    if (run == reorder_buffer_.end()) {
-                        break;
-                    }
-                    processRtpPacket(run->second.data(), run->second.size());
-                    reorder_buffer_.erase(run);
-                    expected_seq_ = static_cast<uint16_t>(expected_seq_ + 1);
-                }
-            }
+    void skipToBuffered() {
+        if (reorder_count_ > 0) {
+            expected_seq_ = static_cast<uint16_t>(expected_seq_ + skipDistance());
+        }
+    }
+
+    void resetReorder() {
+        for (auto& slot : reorder_ring_) {
+            slot.filled = false;
         }
+        reorder_count_ = 0;
+        reorder_initialized_ = false;
     }
 
     void appendAnnexBNalu(const uint8_t* nalu, size_t len) {
@@ -345,15 +595,21 @@ private:
 
         VideoFrame frame{};
         frame.codec = codec_;
-        frame.pts = timestamp / 90;
+        frame.pts_us = rtpTimestampToUs(timestamp_unwrapper_.unwrap(timestamp), 90000);
+        frame.dts_us = frame.pts_us;
+        frame.pts = frame.pts_us / 1000;
         frame.dts = frame.pts;
         frame.width = width_;
         frame.height = height_;
         frame.fps = fps_;
         frame.type = frame_is_idr_ ? FrameType::IDR : FrameType::P;
-        frame.managed_data = makeManagedBuffer(frame_buffer_.data(), frame_buffer_.size());
-        frame.data = frame.managed_data->empty() ? nullptr : frame.managed_data->data();
+        // 组帧缓冲直接交给帧，广播时不再拷贝；下一帧按这一帧的大小预留
+        const size_t frame_size = frame_buffer_.size();
+        frame.managed_data = std::make_shared<std::vector<uint8_t>>(std::move(frame_buffer_));
+        frame.data = frame.managed_data->data();
         frame.size = frame.managed_data->size();
+        frame_buffer_ = std::vector<uint8_t>();
+        frame_buffer_.reserve(frame_size);
 
         if (callback_) {
             callback_(frame);
@@ -361,24 +617,6 @@ private:
         clearCurrentFrameState();
     }
 
-    void receiveLoop() {
-        uint8_t buffer[65536];
-        std::string from_ip;
-        uint16_t from_port = 0;
-
-        // socket 为非阻塞（init 里设置），用 waitReadable 200ms 替代 1ms 忙等，
-        // 空闲时几乎零 CPU。停止由 shutdownReadWrite + 自发包唤醒（见 stopWithTimeout）
-        while (running_) {
-            int r = rtp_socket_.waitReadable(200);
-            if (!running_) break;
-            if (r <= 0) continue;
-            const ssize_t len = rtp_socket_.recvFrom(buffer, sizeof(buffer), from_ip, from_port);
-            if (len > 0) {
-                ingestRtpPacket(buffer, static_cast<size_t>(len));
-            }
-        }
-    }
-
     void processRtpPacket(const uint8_t* data, size_t len) {
         if (len < 12) {
             return;
@@ -596,12 +834,22 @@ private:
         }
     }
 
+    struct ReorderSlot {
+        std::vector<uint8_t> data;
+        bool filled = false;
+    };
+    static constexpr uint16_t kReorderSlots = 64;   // 2 的幂
+
+    std::shared_ptr<RtpIngestPool> pool_;
     Socket rtp_socket_;
     Socket rtcp_socket_;
+    uint64_t rtp_id_ = 0;
+    uint64_t rtcp_id_ = 0;
+    bool shared_ = false;
+    UdpSource shared_source_;
     uint16_t rtp_port_ = 0;
     uint16_t rtcp_port_ = 0;
-    std::atomic<bool> running_{false};
-    std::thread receive_thread_;
+    bool running_ = false;
     FrameCallback callback_;
 
     CodecType codec_ = CodecType::H264;
@@ -612,6 +860,7 @@ private:
 
     std::vector<uint8_t> frame_buffer_;
     uint32_t frame_ts_ = 0;
+    RtpTimestampUnwrapper timestamp_unwrapper_;   // 32 位 RTP 时间戳回绕后 pts 继续递增
     bool frame_in_progress_ = false;
     bool frame_is_idr_ = false;
     bool seq_initialized_ = false;
@@ -620,43 +869,82 @@ private:
     bool h265_fu_drop_mode_ = false;
     size_t h265_fu_start_offset_ = 0;
     uint32_t jitter_buffer_packets_ = 32;
-    std::map<uint16_t, std::vector<uint8_t>> reorder_buffer_;
+    ReorderSlot reorder_ring_[kReorderSlots];
+    uint32_t reorder_count_ = 0;
     bool reorder_initialized_ = false;
     uint16_t expected_seq_ = 0;
 };
 
-bool parseAnnouncedPathConfig(const std::string& path,
-                              const std::string& sdp,
-                              PathConfig* config,
-                              uint8_t* payload_type) {
-    if (config == nullptr || payload_type == nullptr) {
+// ANNOUNCE 中的一路视频轨。多轨推流时第 0 轨写入 ANNOUNCE 的路径本身，
+// 其余各轨写入 "<path>/<control>" 子路径（与推流端 SETUP 该轨用的 URL 一致），
+// 拉流端按子路径即可单独播放主/子码流。
+struct AnnouncedTrack {
+    std::string control;
+    std::string path;
+    PathConfig config;
+    uint8_t payload_type = 96;
+};
+
+std::string trackControlTail(const std::string& control) {
+    std::string tail = control;
+    const size_t q = tail.find('?');
+    if (q != std::string::npos) {
+        tail = tail.substr(0, q);
+    }
+    while (!tail.empty() && tail.back() == '/') {
+        tail.pop_back();
+    }
+    const size_t slash = tail.find_last_of('/');
+    if (slash != std::string::npos) {
+        tail = tail.substr(slash + 1);
+    }
+    return tail;
+}
+
+bool parseAnnouncedTracks(const std::string& path,
+                          const std::string& sdp,
+                          std::vector<AnnouncedTrack>* tracks) {
+    if (tracks == nullptr) {
         return false;
     }
+    tracks->clear();
 
     SdpParser parser;
     if (!parser.parse(sdp) || !parser.hasVideo()) {
         return false;
     }
 
-    const SdpMediaInfo video = parser.getVideoInfo();
-    const std::string payload_name_upper = toLowerCopy(video.payload_name);
-    const bool is_h264 = payload_name_upper.find("264") != std::string::npos;
-    const bool is_h265 = payload_name_upper.find("265") != std::string::npos ||
-                         payload_name_upper.find("hevc") != std::string::npos;
-    if ((!is_h264 && !is_h265) || video.payload_type == 0 || video.clock_rate == 0) {
-        return false;
-    }
+    const auto videos = parser.getVideoInfos();
+    for (size_t i = 0; i < videos.size(); ++i) {
+        const SdpMediaInfo& video = videos[i];
+        const std::string payload_name_upper = toLowerCopy(video.payload_name);
+        const bool is_h264 = payload_name_upper.find("264") != std::string::npos;
+        const bool is_h265 = payload_name_upper.find("265") != std::string::npos ||
+                             payload_name_upper.find("hevc") != std::string::npos;
+        if ((!is_h264 && !is_h265) || video.payload_type == 0 || video.clock_rate == 0) {
+            return false;
+        }
 
-    config->path = path;
-    config->codec = is_h265 ? CodecType::H265 : CodecType::H264;
-    config->width = video.width != 0 ? video.width : 1920;
-    config->height = video.height != 0 ? video.height : 1080;
-    config->fps = video.fps != 0 ? video.fps : 30;
-    config->sps = video.sps.empty() ? std::vector<uint8_t>() : base64Decode(video.sps);
-    config->pps = video.pps.empty() ? std::vector<uint8_t>() : base64Decode(video.pps);
-    config->vps = video.vps.empty() ? std::vector<uint8_t>() : base64Decode(video.vps);
-    *payload_type = video.payload_type;
-    return true;
+        AnnouncedTrack track;
+        track.control = trackControlTail(video.control);
+        if (track.control.empty()) {
+            track.control = "streamid=" + std::to_string(i);
+        }
+        track.path = (i == 0) ? path : (path == "/" ? "/" : path + "/") + track.control;
+        PathConfig& config = track.config;
+        config.path = track.path;
+        config.codec = is_h265 ? CodecType::H265 : CodecType::H264;
+        config.width = video.width != 0 ? video.width : 1920;
+        config.height = video.height != 0 ? video.height : 1080;
+        config.fps = video.fps != 0 ? video.fps : 30;
+        config.sps = video.sps.empty() ? std::vector<uint8_t>() : base64Decode(video.sps);
+        config.pps = video.pps.empty() ? std::vector<uint8_t>() : base64Decode(video.pps);
+        config.vps = video.vps.empty() ? std::vector<uint8_t>() : base64Decode(video.vps);
+        applySpsInfo(config);
+        track.payload_type = video.payload_type;
+        tracks->push_back(std::move(track));
+    }
+    return !tracks->empty();
 }
 
 struct ServerRegistry {
@@ -788,6 +1076,13 @@ struct ServerStatsAtomic {
     std::atomic<uint64_t> frames_pushed{0};
     std::atomic<uint64_t> rtp_packets_sent{0};
     std::atomic<uint64_t> rtp_bytes_sent{0};
+    std::atomic<uint64_t> rendition_switches{0};
+    std::atomic<uint64_t> redirects{0};
+    std::atomic<uint64_t> subscription_frames_dropped{0};
+    std::atomic<uint64_t> admission_rejected_sessions{0};
+    std::atomic<uint64_t> admission_rejected_path{0};
+    std::atomic<uint64_t> admission_rejected_ip{0};
+    std::atomic<uint64_t> admission_rejected_bandwidth{0};
 };
 
 enum class SessionRole {
@@ -795,32 +1090,321 @@ enum class SessionRole {
     Publisher
 };
 
+struct MediaPath;
+struct FilePlayback;
+struct TimeShiftPlayback;
+
+// 码率组播放会话的选档状态。会话同时挂在组内各档位 MediaPath 上，
+// 只转发当前档位；需要切换时记下目标档位，等目标档位的 IDR 到达再切。
+struct RenditionState {
+    std::vector<const MediaPath*> sources;  // 档位 0 为最高码率
+    RenditionGroupConfig policy;
+
+    std::mutex mutex;                    // 保护以下字段
+    size_t current = 0;
+    size_t target = 0;
+    bool started = false;                // 当前档位是否已从 AU 起点开始转发
+    bool current_in_au = false;          // 当前档位上一次转发停在 AU 中间
+    int64_t pts_offset_us = 0;           // 切换后为保持时间戳连续而叠加的偏移（微秒）
+    uint64_t last_pts_us = 0;
+    bool has_last_pts = false;
+    uint8_t fraction_lost = 0;           // 最近一次 RTCP RR 的丢包率
+    int64_t fraction_lost_ns = 0;        // 该 RR 的到达时刻，过了 loss_report_max_age_ms 不再计入
+    int64_t last_rr_poll_ns = 0;         // UDP 会话上次读 RTCP socket 的时刻
+    int64_t last_congested_ns = 0;
+    int64_t last_switch_ns = 0;
+};
+
+// 观看会话的订阅模式：URL 查询串（?mode=idr、?every=N、?maxfps=N）或 SETUP 的 X-Subscription 头。
+// 入队前按整 AU 取舍，丢掉的帧不入队也不打包，RTP 序列号保持连续，时间戳仍由 pts 换算。
+// every / maxfps 共用一个令牌桶：参考帧有令牌即发，非参考帧还要与上一发出帧间隔够才发，
+// 因此先丢非参考帧；参考帧一旦丢掉，解码链已断，直到下一个 IDR 前都不再发送。
+// 桶只存 1 个令牌，不攒突发：发送间隔跟着补充速率走，而不是先连发一秒再停住。
+// 全参考帧的 GOP（IPPP，没有可丢的非参考帧）在限速下只能发出开头几帧随后断链，
+// 因此上一个 GOP 全是参考帧且断过链时，本 GOP 显式退化为只发 IDR（见 admit）。
+struct SubscriptionFilter {
+    enum class Mode {
+        All,
+        IdrOnly,
+        EveryNth,
+        MaxFps
+    };
+    Mode mode = Mode::All;
+    uint32_t every = 1;                  // EveryNth：平均每 N 帧发 1 帧
+    uint32_t max_fps = 0;                // MaxFps：按 pts 计的帧率上限
+
+    static constexpr double kCapacity = 1.0;   // 令牌桶容量
+
+    std::mutex mutex;                    // 保护以下字段
+    double tokens = 0;
+    bool waiting_idr = true;             // 解码链已断（或刚开始），只等 IDR
+    bool gop_has_non_reference = false;  // 当前 GOP 出现过非参考帧
+    bool gop_broken = false;             // 当前 GOP 有参考帧因令牌不足被丢（或在退化下本会被丢）
+    bool idr_fallback = false;           // 本 GOP 退化为只发 IDR
+    bool has_pts = false;
+    uint64_t last_pts = 0;
+    bool has_sent = false;
+    uint64_t last_sent_pts = 0;
+    uint32_t frames_since_sent = 0;
+    bool in_au = false;                  // 上一单元没有结束 AU
+    bool au_decided = false;             // 当前 AU 已判定（按 au_admitted 处理剩余片段）
+    bool au_admitted = false;
+    std::vector<VideoFrame> held;        // AU 开头尚无 VCL 的片段，等判定后一起入队或丢弃
+
+    // 解析 "mode=idr&every=4&maxfps=5"（& 或 ; 分隔，未知键忽略）；数值非法返回 false
+    bool parse(const std::string& spec) {
+        size_t begin = 0;
+        while (begin <= spec.size()) {
+            size_t end = spec.find_first_of("&;", begin);
+            if (end == std::string::npos) {
+                end = spec.size();
+            }
+            const std::string item = trimCopy(spec.substr(begin, end - begin));
+            begin = end + 1;
+            const size_t eq = item.find('=');
+            if (eq == std::string::npos) {
+                continue;
+            }
+            const std::string key = toLowerCopy(trimCopy(item.substr(0, eq)));
+            const std::string value = toLowerCopy(trimCopy(item.substr(eq + 1)));
+            uint32_t number = 0;
+            if (key == "mode") {
+                if (value == "idr") {
+                    mode = Mode::IdrOnly;
+                } else if (value != "all") {
+                    return false;
+                }
+            } else if (key == "every") {
+                if (!parseUint32Safe(value, number) || number == 0) {
+                    return false;
+                }
+                if (mode != Mode::IdrOnly && number > 1) {
+                    mode = Mode::EveryNth;
+                    every = number;
+                }
+            } else if (key == "maxfps") {
+                if (!parseUint32Safe(value, number) || number == 0) {
+                    return false;
+                }
+                if (mode != Mode::IdrOnly) {
+                    mode = Mode::MaxFps;
+                    max_fps = number;
+                }
+            }
+        }
+        return true;
+    }
+
+    // SETUP 时调用
+    void start() {
+        tokens = kCapacity;
+    }
+
+    // AU 级判定（调用方持有 mutex）
+    bool admit(UnitClass cls, uint64_t pts) {
+        if (mode == Mode::EveryNth) {
+            tokens = std::min(kCapacity, tokens + 1.0 / every);
+        } else if (mode == Mode::MaxFps && has_pts && pts > last_pts) {
+            tokens = std::min(kCapacity, tokens + static_cast<double>(pts - last_pts) * max_fps / 1000.0);
+        }
+        has_pts = true;
+        last_pts = pts;
+        frames_since_sent++;
+
+        if (cls == UnitClass::Key) {
+            // 上一个 GOP 没有非参考帧可丢、参考帧又跟不上令牌：本 GOP 只发 IDR，
+            // 间隔均匀，而不是每个 GOP 先发几帧再冻住
+            idr_fallback = mode != Mode::IdrOnly && !gop_has_non_reference && gop_broken;
+            gop_has_non_reference = false;
+            gop_broken = false;
+        } else if (cls == UnitClass::NonReference) {
+            gop_has_non_reference = true;
+        } else if (cls == UnitClass::Reference && idr_fallback) {
+            // 退化期间照常扣令牌（不发），据此判断下一个 GOP 是否仍需退化
+            if (tokens >= 1.0) {
+                tokens -= 1.0;
+            } else {
+                gop_broken = true;
+            }
+            waiting_idr = true;
+            return false;
+        }
+
+        bool send = false;
+        if (cls == UnitClass::Key) {
+            waiting_idr = false;
+            send = true;
+        } else if (mode == Mode::IdrOnly || waiting_idr || cls == UnitClass::NoVcl) {
+            send = false;
+        } else if (tokens >= 1.0) {
+            if (cls == UnitClass::Reference) {
+                send = true;
+            } else if (mode == Mode::EveryNth) {
+                send = frames_since_sent >= every;
+            } else {
+                send = !has_sent || pts >= last_sent_pts + 1000 / max_fps;
+            }
+        } else if (cls == UnitClass::Reference) {
+            waiting_idr = true;
+            gop_broken = true;
+        }
+        if (send) {
+            tokens = std::max(-kCapacity, tokens - 1.0);
+            has_sent = true;
+            last_sent_pts = pts;
+            frames_since_sent = 0;
+        }
+        return send;
+    }
+};
+
+// 一个控制连接的待发数据：RTSP 响应与 interleaved RTP 都先追加到这里，非阻塞写出，
+// 任何发送都不会阻塞调用线程。单线程模式由事件循环在 socket 可写时写出；多线程模式由
+// 发送 worker 追加后就地写出，剩余部分由连接线程接着写（两者都持连接的发送锁）
+struct ConnectionOutput {
+    static constexpr size_t kMaxPending = 512 * 1024;  // 超过后 interleaved 会话按整 AU 丢帧
+    std::string data;
+    int64_t stalled_since_ns = 0;   // 有待发数据却一个字节也写不出去的起始时刻；0 表示在前进
+
+    // 写出尽量多的待发数据，写不动即返回；连接出错返回 false
+    bool flushTo(Socket& socket) {
+        size_t sent = 0;
+        bool ok = true;
+        while (sent < data.size()) {
+            const ssize_t n = socket.sendSome(reinterpret_cast<const uint8_t*>(data.data()) + sent,
+                                              data.size() - sent);
+            if (n < 0) {
+                ok = false;
+                break;
+            }
+            if (n == 0) {
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        data.erase(0, sent);
+        if (sent > 0 || data.empty()) {
+            stalled_since_ns = 0;
+        } else if (stalled_since_ns == 0) {
+            stalled_since_ns = steadyNowNs();
+        }
+        return ok;
+    }
+};
+
+// 已绑定的 RTP/RTCP 端口对：会话结束后放回，新的 UDP SETUP 直接取用，
+// 省去两次 bind 与端口冲突重试；超出容量的直接关闭
+class RtpSenderPool {
+public:
+    explicit RtpSenderPool(size_t capacity) : capacity_(capacity) {}
+
+    std::unique_ptr<RtpSender> acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.empty()) {
+            return nullptr;
+        }
+        std::unique_ptr<RtpSender> sender = std::move(idle_.back());
+        idle_.pop_back();
+        return sender;
+    }
+
+    void release(std::unique_ptr<RtpSender> sender) {
+        sender->resetPeer();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < capacity_) {
+            idle_.push_back(std::move(sender));
+        }
+    }
+
+private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<RtpSender>> idle_;
+};
+
+// 会话间复用的资源：Impl 持有，连接建立会话时挂到会话上
+struct SessionPools {
+    std::shared_ptr<SendWorkerPool> send_workers;   // 单线程模式为空
+    std::shared_ptr<RtpSenderPool> senders;         // udp_port_pool_size 为 0 时为空
+    size_t ingest_threads = 1;
+
+    // 推流收流事件循环：第一个推流 SETUP 时创建；启用共享端口时随 start() 创建
+    std::shared_ptr<RtpIngestPool> ingestPool() {
+        std::lock_guard<std::mutex> lock(ingest_mutex);
+        if (!ingest) {
+            ingest = std::make_shared<RtpIngestPool>(ingest_threads);
+        }
+        return ingest;
+    }
+
+    std::mutex ingest_mutex;
+    std::shared_ptr<RtpIngestPool> ingest;
+};
+
 // 客户端会话
-struct ClientSession {
+struct ClientSession : public SendTask, public std::enable_shared_from_this<ClientSession> {
     std::string session_id;
     std::string path;
     std::string client_ip;
+    std::string local_ip;                // 控制连接的本地地址，准入控制按此区分网卡
     SessionRole role = SessionRole::Player;
     uint16_t client_rtp_port = 0;
     uint16_t client_rtcp_port = 0;
 
     std::unique_ptr<RtpSender> rtp_sender;
+    std::shared_ptr<RtpSenderPool> sender_pool;   // 会话结束时 rtp_sender 放回这里
     std::unique_ptr<RtpPacker> rtp_packer;
-    std::unique_ptr<PublishRtpReceiver> rtp_receiver;
-    uint8_t publisher_payload_type = 96;
+    // Publisher：按 ANNOUNCE 轨道顺序，每轨一个接收器（未 SETUP 的轨为空）
+    std::vector<AnnouncedTrack> announced_tracks;
+    std::vector<std::unique_ptr<PublishRtpReceiver>> rtp_receivers;
+    // Publisher：ANNOUNCE 为第 1 轨起新建的子路径，会话结束时随之移除（主路径保留，与单轨推流一致）
+    std::vector<std::shared_ptr<MediaPath>> announced_paths;
     bool use_tcp_interleaved = false;
     uint8_t interleaved_rtp_channel = 0;
+    uint32_t ssrc = 0;
     std::shared_ptr<Socket> control_socket;
     std::shared_ptr<std::mutex> control_send_mutex;
+    // 控制连接的待发缓冲（interleaved 包追加到这里，持 control_send_mutex）
+    std::shared_ptr<ConnectionOutput> control_output;
+    // 多线程模式：追加后由发送 worker 就地非阻塞写出；单线程模式由事件循环写出
+    bool flush_control_output = false;
+    bool send_at_au_start = true;        // 下一个待发单元是否为 AU 起点（同一时刻只有一个线程在发）
+    bool dropping_au = false;            // 正在丢弃的 AU（待发缓冲积压超限）
     
     std::atomic<bool> playing{false};
-    std::thread send_thread;
+    // 多线程模式下由共享的发送工作池发送；单线程模式为空（事件循环 drainQueue）
+    std::weak_ptr<SendWorkerPool> send_pool;
     
-    // 帧队列
+    // 帧队列。元素可以是整帧，也可以是 pushNalu 推入的 AU 片段；
+    // end_of_au 决定打包时最后一包是否置 marker。
+    struct QueuedUnit {
+        VideoFrame frame;
+        bool end_of_au = true;
+    };
     std::mutex queue_mutex;
-    std::condition_variable queue_cv;
-    std::queue<VideoFrame> frame_queue;
-    static constexpr size_t MAX_QUEUE_SIZE = 30;
+    std::condition_variable queue_cv;   // send_scheduled 清零时通知 stop()
+    std::deque<QueuedUnit> frame_queue;
+    size_t queued_access_units = 0;  // 队列中完整 AU 的个数（按 end_of_au 计）
+    bool sending_in_au = false;      // 发送方已取走某 AU 的前几个单元，队首是它的剩余部分（queue_mutex 保护）
+    bool send_scheduled = false;     // 已投递到发送工作池、尚未发完（queue_mutex 保护）
+    bool send_held = false;          // PLAY 响应写出前只入队不投递（queue_mutex 保护）
+    static constexpr size_t MAX_QUEUE_SIZE = 30;  // 以 AU 计
+
+    // 由 MediaPath::sessions_mutex 保护：会话在某个 AU 中途开始播放时，
+    // 跳过该 AU 剩余的 slice，从下一个 AU 起发送
+    bool awaiting_au_start = true;
+    // 由 MediaPath::sessions_mutex 保护：正在从时移缓冲回看，不接收直播广播
+    bool time_shifted = false;
+
+    // 码率组会话的选档状态；普通会话为空
+    std::unique_ptr<RenditionState> rendition;
+    // 订阅模式（只发 IDR / 抽帧 / 限帧率）；完整订阅为空
+    std::unique_ptr<SubscriptionFilter> subscription;
+
+    // 文件点播会话的播放进度；直播会话为空
+    std::shared_ptr<FilePlayback> file_playback;
+    // 时移路径上的回看进度（首次 PAUSE 或带 Range 的 PLAY 时建立）
+    std::shared_ptr<TimeShiftPlayback> timeshift_playback;
     
     std::atomic<uint32_t> packet_count{0};
     std::atomic<uint32_t> octet_count{0};
@@ -834,139 +1418,501 @@ struct ClientSession {
     
     ~ClientSession() {
         stop();
+        if (rtp_sender && sender_pool) {
+            sender_pool->release(std::move(rtp_sender));
+        }
     }
     
+    // 停止发送：等正在为本会话发送的 worker 发完当前单元（或排在就绪队列里的投递被取走）
     void stop() {
         playing = false;
-        queue_cv.notify_all();
-        if (send_thread.joinable()) {
-            send_thread.join();
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return !send_scheduled; });
         }
-        if (rtp_receiver) {
-            rtp_receiver->stop();
+        for (auto& receiver : rtp_receivers) {
+            if (receiver) {
+                receiver->stop();
+            }
         }
-        
-        // 清理队列
+        clearQueue();
+    }
+
+    void clearQueue() {
         std::lock_guard<std::mutex> lock(queue_mutex);
         while (!frame_queue.empty()) {
-            auto& frame = frame_queue.front();
-            freeVideoFrame(frame);
-            frame_queue.pop();
+            freeVideoFrame(frame_queue.front().frame);
+            frame_queue.pop_front();
         }
+        queued_access_units = 0;
+        sending_in_au = false;
     }
     
-    bool pushFrame(const VideoFrame& frame) {
+    bool pushFrame(const VideoFrame& frame, bool end_of_au = true) {
+        return pushSharedFrame(cloneFrameManaged(frame), end_of_au);
+    }
+
+    // frame 须为托管缓冲：入队只增加引用计数，同一次广播的各会话共享一份数据
+    bool pushSharedFrame(const VideoFrame& frame, bool end_of_au = true) {
         if (role != SessionRole::Player) {
             return false;
         }
+        if (subscription) {
+            return pushFiltered(frame, end_of_au);
+        }
+        return enqueueShared(frame, end_of_au);
+    }
 
-        std::lock_guard<std::mutex> lock(queue_mutex);
-        if (frame_queue.size() >= MAX_QUEUE_SIZE) {
-            // 队列满，丢弃最旧的帧
-            auto& old = frame_queue.front();
-            freeVideoFrame(old);
-            frame_queue.pop();
+    // 订阅过滤：在 AU 的第一个含 VCL 的片段处判定，整 AU 入队或整 AU 丢弃
+    bool pushFiltered(const VideoFrame& frame, bool end_of_au) {
+        SubscriptionFilter& filter = *subscription;
+        std::lock_guard<std::mutex> lock(filter.mutex);
+        if (!filter.in_au) {
+            filter.au_decided = false;
         }
-        
-        // 复制帧
-        VideoFrame copy = cloneFrameManaged(frame);
-        
-        frame_queue.push(copy);
-        queue_cv.notify_one();
-        return true;
+        filter.in_au = !end_of_au;
+        if (!filter.au_decided) {
+            const UnitClass cls = classifyUnit(frame);
+            if (cls == UnitClass::NoVcl && !end_of_au) {
+                filter.held.push_back(frame);
+                return true;
+            }
+            filter.au_decided = true;
+            filter.au_admitted = filter.admit(cls, frame.pts);
+            if (!filter.au_admitted && stats) {
+                stats->subscription_frames_dropped++;
+            }
+            for (auto& held : filter.held) {
+                if (filter.au_admitted) {
+                    enqueueShared(held, false);
+                }
+                freeVideoFrame(held);
+            }
+            filter.held.clear();
+        }
+        return filter.au_admitted ? enqueueShared(frame, end_of_au) : true;
     }
-    
-    void sendLoop() {
-        while (playing) {
-            VideoFrame frame;
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                queue_cv.wait(lock, [this] { return !frame_queue.empty() || !playing; });
-                
-                if (!playing) break;
-                if (frame_queue.empty()) continue;
-                
-                frame = frame_queue.front();
-                frame_queue.pop();
+
+    bool enqueueShared(const VideoFrame& frame, bool end_of_au) {
+        bool post = false;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (queued_access_units >= MAX_QUEUE_SIZE) {
+                dropOldestPendingAuLocked();
             }
             
-            // 打包并发送
-            if (rtp_packer && (use_tcp_interleaved || rtp_sender)) {
-                auto packets = rtp_packer->packFrame(frame);
-                
-                // interleaved 模式下，若对端不读导致 send 阻塞，必须有超时——否则
-                // sendLoop 永远卡住，任何 session stop / 服务端 shutdown 都会挂死。
-                constexpr int kInterleavedSendTimeoutMs = 2000;
-                bool send_failed = false;
-                for (const auto& packet : packets) {
-                    if (use_tcp_interleaved) {
-                        if (control_socket && control_socket->isValid() && control_send_mutex) {
-                            std::vector<uint8_t> interleaved(4 + packet.size);
-                            interleaved[0] = '$';
-                            interleaved[1] = interleaved_rtp_channel;
-                            interleaved[2] = static_cast<uint8_t>((packet.size >> 8) & 0xFF);
-                            interleaved[3] = static_cast<uint8_t>(packet.size & 0xFF);
-                            memcpy(interleaved.data() + 4, packet.data, packet.size);
-                            ssize_t sent = 0;
-                            {
-                                std::lock_guard<std::mutex> sock_lock(*control_send_mutex);
-                                sent = control_socket->sendAll(interleaved.data(),
-                                                               interleaved.size(),
-                                                               kInterleavedSendTimeoutMs);
-                            }
-                            if (sent != static_cast<ssize_t>(interleaved.size())) {
-                                RTSP_LOG_WARNING("interleaved send timeout/failed, dropping session send loop");
-                                send_failed = true;
-                                // 关闭 socket 可让 RtspConnection::handle 的 recv 退出进而清理会话
-                                if (control_socket) control_socket->shutdownReadWrite();
-                            }
-                        }
-                    } else if (rtp_sender) {
-                        rtp_sender->sendRtpPacket(packet);
-                    }
-                    packet_count++;
-                    octet_count += packet.size;
-                    if (stats) {
-                        stats->rtp_packets_sent++;
-                        stats->rtp_bytes_sent += packet.size;
-                    }
-                    delete[] packet.data;
-                    if (send_failed) {
-                        // 释放剩余 packet 内存
-                        continue;
-                    }
-                }
-                if (send_failed) {
-                    // 发送失败：立刻退出 sendLoop，避免继续堆积帧内存
-                    playing = false;
-                    queue_cv.notify_all();
-                    freeVideoFrame(frame);
-                    break;
-                }
-                last_activity_ns.store(steadyNowNs(), std::memory_order_relaxed);
-                
-                // RTCP SR is only valid for UDP sender sessions.
-                if (!use_tcp_interleaved && rtp_sender && (packet_count % 100 == 0)) {
-                    auto now = std::chrono::system_clock::now();
-                    auto epoch = now.time_since_epoch();
-                    uint64_t ntp_ts = std::chrono::duration_cast<std::chrono::seconds>(epoch).count();
-                    ntp_ts = (ntp_ts + 2208988800u) << 32;  // NTP epoch offset
-                    
-                    uint32_t rtp_ts = convertToRtpTimestamp(frame.pts, 90000);
-                    rtp_sender->sendSenderReport(rtp_ts, ntp_ts, packet_count.load(), octet_count.load());
-                }
+            QueuedUnit unit;
+            unit.frame = frame;
+            unit.end_of_au = end_of_au;
+            if (end_of_au) {
+                queued_access_units++;
             }
             
-            freeVideoFrame(frame);
+            frame_queue.push_back(std::move(unit));
+            post = claimSendLocked();
         }
+        if (post) {
+            postSend();
+        }
+        return true;
     }
-};
-
-// 媒体路径
-struct MediaPath {
-    std::string path;
 
-    // config 在 config_mutex 保护下访问：DESCRIBE 读，pushH264Data/pushH265Data
+    // 队列满时整 AU 丢弃最旧的一个，避免发出缺 slice 的半帧。发送方正发到某 AU 中途时，
+    // 队首是该 AU 的剩余 slice，不能动，改丢其后第一个尚未开始发送的 AU（调用方持有 queue_mutex）
+    void dropOldestPendingAuLocked() {
+        auto first = frame_queue.begin();
+        if (sending_in_au) {
+            while (first != frame_queue.end() && !(first++)->end_of_au) {
+            }
+        }
+        for (auto last = first; last != frame_queue.end();) {
+            if ((last++)->end_of_au) {
+                for (auto it = first; it != last; ++it) {
+                    freeVideoFrame(it->frame);
+                }
+                frame_queue.erase(first, last);
+                queued_access_units--;
+                return;
+            }
+        }
+    }
+
+    // PLAY 响应写出前置位：此后到达的帧照常入队，但先不交给发送工作池
+    void holdSend() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        send_held = true;
+    }
+
+    // PLAY 之后把 SETUP 以来已入队的帧交给发送工作池（同时解除 holdSend）
+    void scheduleSend() {
+        bool post = false;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            send_held = false;
+            post = claimSendLocked();
+        }
+        if (post) {
+            postSend();
+        }
+    }
+
+    // 有待发数据且尚未投递时占用投递权（调用方持有 queue_mutex，随后在锁外 postSend）
+    bool claimSendLocked() {
+        if (send_scheduled || send_held || !playing || frame_queue.empty() || send_pool.expired()) {
+            return false;
+        }
+        send_scheduled = true;
+        return true;
+    }
+
+    void postSend() {
+        if (auto pool = send_pool.lock()) {
+            pool->post(shared_from_this());
+        } else {
+            onCancel();
+        }
+    }
+
+    // 工作池回调：发一个 AU（到 end_of_au 为止），还有待发的返回 true 重新排队
+    bool onSend() override {
+        while (true) {
+            VideoFrame frame;
+            bool end_of_au = true;
+            size_t backlog = 0;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                if (!playing || frame_queue.empty()) {
+                    send_scheduled = false;
+                    queue_cv.notify_all();
+                    return false;
+                }
+                frame = frame_queue.front().frame;
+                end_of_au = frame_queue.front().end_of_au;
+                frame_queue.pop_front();
+                sending_in_au = !end_of_au;
+                if (end_of_au) {
+                    queued_access_units--;
+                }
+                backlog = queued_access_units;
+            }
+
+            const bool sent = skipInterleavedUnit(end_of_au) || sendUnit(frame, end_of_au, backlog);
+            freeVideoFrame(frame);
+            if (!sent) {
+                // 发送失败：停止该会话的发送，避免继续堆积帧内存
+                playing = false;
+            }
+            if (!sent || end_of_au) {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                if (playing && !frame_queue.empty()) {
+                    return true;
+                }
+                send_scheduled = false;
+                queue_cv.notify_all();
+                return false;
+            }
+        }
+    }
+
+    void onCancel() override {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        send_scheduled = false;
+        queue_cv.notify_all();
+    }
+
+    // 在 AU 起点判定一次：控制连接的待发数据积压超过上限时，interleaved 会话丢弃整个 AU，
+    // 不发缺 slice 的半帧；UDP 会话不受影响
+    bool skipInterleavedUnit(bool end_of_au) {
+        if (send_at_au_start) {
+            dropping_au = false;
+            if (use_tcp_interleaved && control_output) {
+                std::lock_guard<std::mutex> lock(*control_send_mutex);
+                dropping_au = control_output->data.size() >= ConnectionOutput::kMaxPending;
+            }
+        }
+        send_at_au_start = end_of_au;
+        return dropping_au;
+    }
+
+    // 单线程模式：在调用线程上发完队列中已有的单元
+    void drainQueue() {
+        while (playing) {
+            VideoFrame frame;
+            bool end_of_au = true;
+            size_t backlog = 0;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                if (frame_queue.empty()) {
+                    return;
+                }
+                frame = frame_queue.front().frame;
+                end_of_au = frame_queue.front().end_of_au;
+                frame_queue.pop_front();
+                sending_in_au = !end_of_au;
+                if (end_of_au) {
+                    queued_access_units--;
+                }
+                backlog = queued_access_units;
+            }
+
+            const bool sent = skipInterleavedUnit(end_of_au) || sendUnit(frame, end_of_au, backlog);
+            freeVideoFrame(frame);
+            if (!sent) {
+                playing = false;
+                return;
+            }
+        }
+    }
+
+    // 打包并发送一个单元；interleaved 连接出错返回 false（调用方停止该会话的发送）
+    bool sendUnit(const VideoFrame& frame, bool end_of_au, size_t backlog) {
+        if (rtp_packer && (use_tcp_interleaved || rtp_sender)) {
+            auto packets = rtp_packer->packNalus(frame, end_of_au);
+            
+            bool send_failed = false;
+            // UDP：一帧的全部包按当前 I/O 后端一次提交
+            if (!use_tcp_interleaved && rtp_sender) {
+                rtp_sender->sendRtpPackets(packets);
+            }
+            if (use_tcp_interleaved && control_output && !writeInterleaved(packets)) {
+                RTSP_LOG_WARNING("interleaved send failed, dropping session send loop");
+                send_failed = true;
+                // 关闭 socket 可让 RtspConnection::handle 的 recv 退出进而清理会话
+                if (control_socket) control_socket->shutdownReadWrite();
+            }
+            for (const auto& packet : packets) {
+                packet_count++;
+                octet_count += packet.size;
+                if (stats) {
+                    stats->rtp_packets_sent++;
+                    stats->rtp_bytes_sent += packet.size;
+                }
+                // 失败后仍走完循环，释放剩余 packet 内存
+                delete[] packet.data;
+            }
+            if (send_failed) {
+                return false;
+            }
+            last_activity_ns.store(steadyNowNs(), std::memory_order_relaxed);
+            
+            // RTCP SR is only valid for UDP sender sessions.
+            if (!use_tcp_interleaved && rtp_sender && (packet_count % 100 == 0)) {
+                auto now = std::chrono::system_clock::now();
+                auto epoch = now.time_since_epoch();
+                uint64_t ntp_ts = std::chrono::duration_cast<std::chrono::seconds>(epoch).count();
+                ntp_ts = (ntp_ts + 2208988800u) << 32;  // NTP epoch offset
+                
+                uint32_t rtp_ts = convertUsToRtpTimestamp(framePtsUs(frame), 90000);
+                rtp_sender->sendSenderReport(rtp_ts, ntp_ts, packet_count.load(), octet_count.load());
+            }
+        }
+
+        if (rendition && end_of_au) {
+            pollReceiverReport();
+            updateRenditionTarget(backlog);
+        }
+        return true;
+    }
+
+    // interleaved：整个单元追加到控制连接的待发缓冲。发送 worker 只做非阻塞写，对端不读时
+    // 数据留在缓冲里（积压超限后整 AU 丢弃），worker 不会被一个慢连接占住
+    bool writeInterleaved(const std::vector<RtpPacket>& packets) {
+        std::lock_guard<std::mutex> lock(*control_send_mutex);
+        for (const auto& packet : packets) {
+            const uint8_t header[4] = {'$', interleaved_rtp_channel,
+                                       static_cast<uint8_t>((packet.size >> 8) & 0xFF),
+                                       static_cast<uint8_t>(packet.size & 0xFF)};
+            control_output->data.append(reinterpret_cast<const char*>(header), sizeof(header));
+            control_output->data.append(reinterpret_cast<const char*>(packet.data), packet.size);
+        }
+        if (!flush_control_output) {
+            return true;
+        }
+        return control_socket && control_output->flushTo(*control_socket);
+    }
+
+    // UDP 码率组会话：RR 几秒才来一个，RTCP socket 最多每 kReceiverReportPollMs 读一次，
+    // 不为每个 AU 多一次系统调用
+    void pollReceiverReport() {
+        static constexpr int64_t kReceiverReportPollMs = 200;
+        if (!rtp_sender) {
+            return;
+        }
+        const int64_t now_ns = steadyNowNs();
+        {
+            std::lock_guard<std::mutex> lock(rendition->mutex);
+            if (now_ns - rendition->last_rr_poll_ns < kReceiverReportPollMs * 1000000) {
+                return;
+            }
+            rendition->last_rr_poll_ns = now_ns;
+        }
+        RtcpReportBlock report;
+        if (rtp_sender->pollReceiverReport(report)) {
+            std::lock_guard<std::mutex> lock(rendition->mutex);
+            rendition->fraction_lost = report.fraction_lost;
+            rendition->fraction_lost_ns = now_ns;
+        }
+    }
+
+    // 收到 RTCP RR（UDP 在发送时限频轮询，TCP 由控制连接的 interleaved 通道送来）
+    void onReceiverReport(const RtcpReportBlock& report) {
+        if (!rendition) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(rendition->mutex);
+            rendition->fraction_lost = report.fraction_lost;
+            rendition->fraction_lost_ns = steadyNowNs();
+        }
+        size_t backlog = 0;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            backlog = queued_access_units;
+        }
+        updateRenditionTarget(backlog);
+    }
+
+    // 依据队列积压与丢包率决定目标档位：拥塞立即降一档，持续空闲 upgrade_hold_ms 才升一档。
+    // 对端不再发 RR 时，过期的丢包率视为 0，不会一直卡住升档
+    void updateRenditionTarget(size_t backlog) {
+        RenditionState& r = *rendition;
+        const int64_t now_ns = steadyNowNs();
+        const int64_t hold_ns = static_cast<int64_t>(r.policy.upgrade_hold_ms) * 1000000;
+        const int64_t max_age_ns = static_cast<int64_t>(r.policy.loss_report_max_age_ms) * 1000000;
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (r.fraction_lost > 0 && now_ns - r.fraction_lost_ns >= max_age_ns) {
+            r.fraction_lost = 0;
+        }
+        const bool lossy = r.policy.downgrade_fraction_lost > 0 &&
+                           r.fraction_lost >= r.policy.downgrade_fraction_lost;
+        if (backlog >= r.policy.downgrade_backlog_aus || lossy) {
+            r.last_congested_ns = now_ns;
+            r.target = std::min(r.current + 1, r.sources.size() - 1);
+            return;
+        }
+        if (backlog > r.policy.upgrade_backlog_aus || r.fraction_lost > 0) {
+            r.last_congested_ns = now_ns;
+            return;
+        }
+        if (r.target == r.current && r.current > 0 &&
+            now_ns - r.last_congested_ns >= hold_ns && now_ns - r.last_switch_ns >= hold_ns) {
+            r.target = r.current - 1;
+        }
+    }
+
+    // 码率组会话接收某个档位广播来的片段（调用方持有该档位的 sessions_mutex）
+    void deliverRendition(const MediaPath* source, const VideoFrame& unit, bool au_start, bool end_of_au);
+};
+
+// 文件点播会话的播放进度：挂在共享排程器上，按 dts 节奏把到期 AU 推入会话队列
+struct FilePlayback : public PlaybackTask {
+    std::shared_ptr<FileSource> source;
+    std::weak_ptr<ClientSession> session;
+
+    std::mutex mutex;                    // 保护以下字段
+    size_t next_index = 0;
+    int64_t start_ns = 0;                // next_index 起播时刻
+    uint64_t start_dts_us = 0;
+    bool running = false;
+    uint64_t generation = 0;
+    std::vector<VideoFrame> units;       // onTimer 复用
+
+    // 从第 index 个 AU 开始播放，返回本次排程的 generation
+    uint64_t start(size_t index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto& entries = source->entries();
+        next_index = index < entries.size() ? index : 0;
+        start_ns = steadyNowNs();
+        start_dts_us = entries[next_index].dts_us;
+        running = true;
+        return ++generation;
+    }
+
+    // 返回暂停位置（下次无 Range 的 PLAY 从这里继续）
+    size_t pause() {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        ++generation;
+        return next_index;
+    }
+
+    int64_t onTimer(int64_t now_ns, uint64_t timer_generation) override {
+        auto target = session.lock();
+        if (!target) {
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || timer_generation != generation) {
+            return -1;
+        }
+        const auto& entries = source->entries();
+        while (next_index < entries.size()) {
+            const FileIndexEntry& entry = entries[next_index];
+            const int64_t due_ns = start_ns + (static_cast<int64_t>(entry.dts_us) -
+                                               static_cast<int64_t>(start_dts_us)) * 1000;
+            if (due_ns > now_ns) {
+                return due_ns;
+            }
+            source->accessUnit(next_index, units);
+            for (size_t i = 0; i < units.size(); ++i) {
+                target->pushSharedFrame(units[i], i + 1 == units.size());
+            }
+            units.clear();
+            next_index++;
+        }
+        running = false;
+        return -1;
+    }
+};
+
+// 媒体路径
+// 观看会话计数：MediaPath 登记/移除观看会话时维护，重定向与准入判断直接读取，
+// 不必持 paths_mutex_ 遍历所有会话
+struct ViewerCounters {
+    std::atomic<uint32_t> total{0};
+
+    std::mutex mutex;                    // 保护以下分项计数（不再嵌套其他锁）
+    std::unordered_map<std::string, uint32_t> per_path;
+    std::unordered_map<std::string, uint32_t> per_ip;
+    std::map<std::pair<std::string, std::string>, uint32_t> per_path_interface;   // (路径, 本地地址)
+
+    void add(const ClientSession& session) {
+        total.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        per_path[session.path]++;
+        per_ip[session.client_ip]++;
+        per_path_interface[std::make_pair(session.path, session.local_ip)]++;
+    }
+
+    void remove(const ClientSession& session) {
+        total.fetch_sub(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        decrement(per_path, session.path);
+        decrement(per_ip, session.client_ip);
+        decrement(per_path_interface, std::make_pair(session.path, session.local_ip));
+    }
+
+    template <typename Map, typename Key>
+    static void decrement(Map& counts, const Key& key) {
+        auto it = counts.find(key);
+        if (it != counts.end() && --it->second == 0) {
+            counts.erase(it);
+        }
+    }
+
+    template <typename Map, typename Key>
+    static uint32_t lookup(const Map& counts, const Key& key) {
+        auto it = counts.find(key);
+        return it == counts.end() ? 0 : it->second;
+    }
+};
+
+struct MediaPath {
+    std::string path;
+    // 服务端共享的观看计数（创建时设置，之后不再修改）
+    std::shared_ptr<ViewerCounters> viewer_counters;
+
+    // config 在 config_mutex 保护下访问：DESCRIBE 读，pushH264Data/pushH265Data
     // 以及 Publisher 的 RTP 接收回调会写 sps/pps/vps。并发读写 std::vector 是 UB。
     mutable std::mutex config_mutex;
     PathConfig config;
@@ -978,198 +1924,556 @@ struct MediaPath {
     std::mutex latest_frame_mutex;
     VideoFrame latest_frame;
     bool has_latest_frame = false;
+    // pushNalu 逐 slice 推送时当前 AU 已广播的片段（latest_frame_mutex 保护），只持引用不拷贝；
+    // AU 结束时若含 IDR 才拼成一帧写入 latest_frame，保证 IDR 缓存总是完整帧
+    std::vector<VideoFrame> pending_au;
+    bool pending_au_idr = false;
+    // 上一次广播的片段是否停在 AU 中间（sessions_mutex 保护）
+    bool in_access_unit = false;
+
+    // 码率组：本路径不直接推流，会话挂到各档位路径上（创建后不再修改）
+    std::vector<std::shared_ptr<MediaPath>> renditions;
+    RenditionGroupConfig rendition_policy;
+
+    // 录像器（sessions_mutex 保护），与会话一样接收广播的共享帧
+    std::shared_ptr<PathRecorder> recorder;
+    // HLS 切片器（sessions_mutex 保护），同样直接接收广播的共享帧
+    std::shared_ptr<HlsPackager> hls;
+
+    // 文件点播：本路径不接受推流，各会话在 PLAY 时各自建立播放进度（创建后不再修改）
+    std::shared_ptr<FileSource> file_source;
+    std::shared_ptr<PlaybackScheduler> scheduler;
+
+    // 直播时移缓冲（创建后不再修改）；append 在 sessions_mutex 下调用，
+    // 回看会话据此判断是否已追上直播
+    std::shared_ptr<TimeShiftBuffer> timeshift;
+
+    // 拉流转发：帧来自上游拉流，按观看者有无建立/断开（创建后不再修改）
+    std::shared_ptr<RelaySource> relay;
+
+    // 实测码率：广播时累加帧字节，清理线程约每秒折算为 bitrate_bps（文件点播在创建时写入平均码率）
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bitrate_bps{0};
+    uint64_t bitrate_sample_bytes = 0;   // 采样基准，仅清理线程访问
+    int64_t bitrate_sample_ns = 0;
+
+    // 直播路径（推流或转发）：可录像、可 HLS、可作码率组档位
+    bool isLive() const { return renditions.empty() && !file_source; }
+    // 码率组、文件与转发路径的帧来源不是推流
+    bool acceptsPush() const { return isLive() && !relay; }
+
+    // 在 config_mutex 下读取配置快照（供 DESCRIBE/SETUP 等只读路径使用）。
+    // 码率组对外描述最高档位。
+    // 新观看者预计带来的出口码率；码率组按最高档计
+    uint64_t viewerBitrate() const {
+        return renditions.empty() ? bitrate_bps.load() : renditions.front()->bitrate_bps.load();
+    }
 
-    // 在 config_mutex 下读取配置快照（供 DESCRIBE/SETUP 等只读路径使用）
     PathConfig snapshotConfig() const {
+        if (!renditions.empty()) {
+            PathConfig top = renditions.front()->snapshotConfig();
+            top.path = path;
+            return top;
+        }
         std::lock_guard<std::mutex> lock(config_mutex);
         return config;
     }
     
     void broadcastFrame(const VideoFrame& frame) {
+        // 只拷贝一次，IDR 缓存、各会话队列与录像器共享同一份缓冲
+        broadcastSharedFrame(cloneFrameManaged(frame));
+    }
+
+    // shared 的数据已由 managed_data 持有且之后不再改写（如推流收流组好的帧），直接共享不拷贝
+    void broadcastSharedFrame(const VideoFrame& shared) {
+        bytes_in.fetch_add(shared.size, std::memory_order_relaxed);
+
         // 更新最新帧
         {
             std::lock_guard<std::mutex> lock(latest_frame_mutex);
             freeVideoFrame(latest_frame);
-            latest_frame = cloneFrameManaged(frame);
+            latest_frame = shared;
             has_latest_frame = true;
+            pending_au.clear();
+            pending_au_idr = false;
         }
         
         // 广播到所有客户端
-        std::lock_guard<std::mutex> lock(sessions_mutex);
+        std::shared_ptr<HlsPackager> packager;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            in_access_unit = false;
+            for (auto& session_pair : sessions) {
+                auto& session = session_pair.second;
+                if (session->playing && !session->time_shifted) {
+                    if (session->rendition) {
+                        session->deliverRendition(this, shared, true, true);
+                        continue;
+                    }
+                    session->awaiting_au_start = false;
+                    session->pushSharedFrame(shared);
+                }
+            }
+            if (recorder) {
+                recorder->onFrame(shared, true);
+            }
+            if (timeshift) {
+                timeshift->append(shared, true);
+            }
+            packager = hls;
+        }
+        // 切片器在自己的线程封装，入队也放到会话锁之外
+        if (packager) {
+            packager->onFrame(shared, true);
+        }
+    }
+
+    // 广播 AU 的一个片段（一个或多个 slice NALU），到达即发，不等整帧
+    void broadcastNalu(const VideoFrame& fragment, bool end_of_au) {
+        const VideoFrame unit = cloneFrameManaged(fragment);
+        bytes_in.fetch_add(unit.size, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(latest_frame_mutex);
+            if (unit.data && unit.size > 0) {
+                pending_au.push_back(unit);
+            }
+            pending_au_idr = pending_au_idr || unit.type == FrameType::IDR;
+            if (end_of_au) {
+                // 只有新加入的会话会用到 latest_frame，且只用 IDR：非 IDR 的 AU 不拼帧，只作废旧缓存
+                freeVideoFrame(latest_frame);
+                latest_frame = VideoFrame{};
+                has_latest_frame = false;
+                if (pending_au_idr) {
+                    size_t total = 0;
+                    for (const auto& part : pending_au) {
+                        total += part.size;
+                    }
+                    auto joined = std::make_shared<std::vector<uint8_t>>();
+                    joined->reserve(total);
+                    for (const auto& part : pending_au) {
+                        joined->insert(joined->end(), part.data, part.data + part.size);
+                    }
+                    latest_frame = unit;
+                    latest_frame.type = FrameType::IDR;
+                    latest_frame.managed_data = joined;
+                    latest_frame.data = joined->empty() ? nullptr : joined->data();
+                    latest_frame.size = joined->size();
+                    has_latest_frame = true;
+                }
+                pending_au.clear();
+                pending_au_idr = false;
+            }
+        }
+
+        std::shared_ptr<HlsPackager> packager;
+        std::unique_lock<std::mutex> lock(sessions_mutex);
+        const bool au_start = !in_access_unit;
+        in_access_unit = !end_of_au;
         for (auto& session_pair : sessions) {
             auto& session = session_pair.second;
-            if (session->playing) {
-                session->pushFrame(frame);
+            if (session->rendition) {
+                if (session->playing) {
+                    session->deliverRendition(this, unit, au_start, end_of_au);
+                }
+                continue;
+            }
+            if (!session->playing) {
+                session->awaiting_au_start = true;
+                continue;
+            }
+            if (session->time_shifted) {
+                continue;
+            }
+            if (session->awaiting_au_start) {
+                if (!au_start) {
+                    // 中途加入：丢掉本 AU 剩余片段，AU 结束后从下一个开始
+                    session->awaiting_au_start = !end_of_au;
+                    continue;
+                }
+                session->awaiting_au_start = false;
             }
+            session->pushSharedFrame(unit, end_of_au);
+        }
+        if (recorder) {
+            recorder->onFrame(unit, end_of_au);
+        }
+        if (timeshift) {
+            timeshift->append(unit, end_of_au);
+        }
+        packager = hls;
+        lock.unlock();
+        if (packager) {
+            packager->onFrame(unit, end_of_au);
         }
     }
     
     void addSession(const std::string& session_id, std::shared_ptr<ClientSession> session) {
+        if (!renditions.empty()) {
+            addRenditionSession(session_id, session);
+            return;
+        }
         // 避免锁序倒置：broadcastFrame 顺序为 latest_frame_mutex -> sessions_mutex，
-        // 此处先在 latest_frame_mutex 下克隆帧到本地变量，释放后再拿 sessions_mutex。
+        // 此处先在 latest_frame_mutex 下取帧引用到本地变量，释放后再拿 sessions_mutex。
         VideoFrame cached_idr{};
         bool has_cached_idr = false;
         {
             std::lock_guard<std::mutex> lf_lock(latest_frame_mutex);
             if (has_latest_frame && latest_frame.type == FrameType::IDR) {
-                cached_idr = cloneFrameManaged(latest_frame);
+                cached_idr = latest_frame;
                 has_cached_idr = true;
             }
         }
         {
             std::lock_guard<std::mutex> lock(sessions_mutex);
-            sessions[session_id] = session;
+            if (sessions.emplace(session_id, session).second) {
+                onViewerAdded(*session);
+            }
+            if (has_cached_idr && session->rendition) {
+                session->deliverRendition(this, cached_idr, true, true);
+            }
         }
         if (has_cached_idr) {
-            session->pushFrame(cached_idr);
+            if (!session->rendition) {
+                session->pushSharedFrame(cached_idr);
+            }
             freeVideoFrame(cached_idr);
         }
+        if (relay) {
+            relay->wake();
+        }
+    }
+
+    // 码率组会话：挂到每个档位上接收广播，组路径自身只做会话登记（超时清理/TEARDOWN）
+    void addRenditionSession(const std::string& session_id, std::shared_ptr<ClientSession> session) {
+        auto state = std::unique_ptr<RenditionState>(new RenditionState());
+        for (const auto& rendition : renditions) {
+            state->sources.push_back(rendition.get());
+        }
+        state->policy = rendition_policy;
+        state->last_congested_ns = steadyNowNs();
+        state->last_switch_ns = state->last_congested_ns;
+        session->rendition = std::move(state);
+
+        for (auto& rendition : renditions) {
+            rendition->addSession(session_id, session);
+        }
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        if (sessions.emplace(session_id, session).second) {
+            onViewerAdded(*session);
+        }
     }
     
     void removeSession(const std::string& session_id) {
-        std::lock_guard<std::mutex> lock(sessions_mutex);
-        auto it = sessions.find(session_id);
-        if (it != sessions.end()) {
-            it->second->stop();
-            sessions.erase(it);
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            auto it = sessions.find(session_id);
+            if (it != sessions.end()) {
+                it->second->stop();
+                onViewerRemoved(*it->second);
+                sessions.erase(it);
+            }
+        }
+        for (auto& rendition : renditions) {
+            rendition->removeSession(session_id);
         }
     }
     
+    // 只计本路径自己的观看会话：码率组会话同时挂在各档位上，只在组路径上计一次
+    // （调用方持有 sessions_mutex，每个会话登记与移除各一次）
+    void onViewerAdded(const ClientSession& session) {
+        if (viewer_counters && session.role == SessionRole::Player && session.path == path) {
+            viewer_counters->add(session);
+        }
+    }
+
+    void onViewerRemoved(const ClientSession& session) {
+        if (viewer_counters && session.role == SessionRole::Player && session.path == path) {
+            viewer_counters->remove(session);
+        }
+    }
+
+    // 帧来源中断（如转发上游断开）：旧 IDR 不再发给之后加入的会话
+    void clearLatestFrame() {
+        std::lock_guard<std::mutex> lock(latest_frame_mutex);
+        freeVideoFrame(latest_frame);
+        latest_frame = VideoFrame{};
+        has_latest_frame = false;
+        pending_au.clear();
+        pending_au_idr = false;
+    }
+
     ~MediaPath() {
-        std::lock_guard<std::mutex> lock(sessions_mutex);
-        for (auto& session_pair : sessions) {
-            auto& session = session_pair.second;
-            session->stop();
+        if (relay) {
+            relay->stop();
+        }
+        std::vector<std::string> session_ids;
+        std::shared_ptr<PathRecorder> stopped_recorder;
+        std::shared_ptr<HlsPackager> stopped_hls;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            stopped_recorder = std::move(recorder);
+            stopped_hls = std::move(hls);
+            for (auto& session_pair : sessions) {
+                auto& session = session_pair.second;
+                session->stop();
+                onViewerRemoved(*session);
+                session_ids.push_back(session_pair.first);
+            }
+            sessions.clear();
+        }
+        for (auto& rendition : renditions) {
+            for (const auto& session_id : session_ids) {
+                rendition->removeSession(session_id);
+            }
+        }
+        if (stopped_recorder) {
+            stopped_recorder->stop();
+        }
+        if (stopped_hls) {
+            stopped_hls->stop();
         }
-        sessions.clear();
         
         freeVideoFrame(latest_frame);
     }
 };
 
-// RTSP连接处理
-class RtspConnection {
-public:
-    RtspConnection(std::shared_ptr<Socket> socket,
-                   std::map<std::string, std::shared_ptr<MediaPath>>& paths,
-                   std::mutex& paths_mutex,
-                   RtspServerConfig& config,
-                   RtspServer::ClientConnectCallback& connect_cb,
-                   RtspServer::ClientDisconnectCallback& disconnect_cb,
-                   ServerStatsAtomic& stats)
-        : socket_(std::move(socket)),
-          paths_(paths),
-          paths_mutex_(paths_mutex),
-          config_(config),
-          connect_cb_(connect_cb),
-          disconnect_cb_(disconnect_cb),
-          send_mutex_(std::make_shared<std::mutex>()),
-          stats_(stats),
-          digest_nonce_(config.auth_nonce.empty() ? "nonce-" + generateNonce() : config.auth_nonce),
-          digest_nonce_created_(std::chrono::steady_clock::now()) {}
-    
-    void handle() {
-        // 请求/累积缓冲上限（防 slowloris 和恶意 Content-Length 耗尽内存）：
-        // 单个 RTSP header 最多 32KB，单个 body 最多 64KB（RTSP 控制层不需要大 body），
-        // 累积缓冲区最多 192KB（够容纳最大 header+body+一个 interleaved 包）。
-        constexpr size_t kMaxRtspHeader = 32 * 1024;
-        constexpr size_t kMaxRtspBody = 64 * 1024;
-        constexpr size_t kMaxBufferTotal = 192 * 1024;
+// 推流会话结束（TEARDOWN、断连、超时）：移除 ANNOUNCE 为它新建的子路径。
+// 可重复调用，只有第一次生效；路径仍是当初那个对象时才摘除，路径在 paths_mutex 之外析构
+void releaseAnnouncedPaths(std::map<std::string, std::shared_ptr<MediaPath>>& paths, std::mutex& paths_mutex,
+                           ClientSession& session) {
+    std::vector<std::shared_ptr<MediaPath>> removed;
+    std::lock_guard<std::mutex> lock(paths_mutex);
+    removed.swap(session.announced_paths);
+    for (const auto& path : removed) {
+        auto it = paths.find(path->path);
+        if (it != paths.end() && it->second == path) {
+            paths.erase(it);
+        }
+    }
+}
 
-        std::string buffer;
-        buffer.reserve(4096);
+// 时移回看：从路径的时移缓冲按 pts 节奏（可加速）补发，读到缓冲末尾时在
+// sessions_mutex 下切回直播广播，切换点前后的单元不漏也不重。
+struct TimeShiftPlayback : public PlaybackTask {
+    std::shared_ptr<TimeShiftBuffer> buffer;
+    std::weak_ptr<MediaPath> path;
+    std::weak_ptr<ClientSession> session;
+    double speed = 1.0;                  // 回看倍速，>1 时逐渐追上直播
+
+    std::mutex mutex;                    // 保护以下字段
+    uint64_t position = 0;               // 下一个要发送的单元
+    bool running = false;
+    uint64_t generation = 0;
+    bool rebase = false;                 // 下一个单元作为节奏起点
+    int64_t start_ns = 0;
+    uint64_t start_pts = 0;
+    int64_t last_due_ns = 0;
+    bool has_resume = false;             // PAUSE 记下的续播位置
+    uint64_t resume_position = 0;
+
+    uint64_t start(uint64_t from) {
+        std::lock_guard<std::mutex> lock(mutex);
+        position = from;
+        running = true;
+        rebase = true;
+        has_resume = false;
+        return ++generation;
+    }
 
-        uint8_t temp[4096];
-        while (socket_->isValid()) {
-            ssize_t n = socket_->recv(temp, sizeof(temp), 1000);
-            if (n > 0) {
-                buffer.append((char*)temp, n);
-                if (buffer.size() > kMaxBufferTotal) {
-                    RTSP_LOG_WARNING("RTSP buffer exceeded limit, closing connection");
-                    break;
-                }
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        ++generation;
+    }
 
-                // TCP interleaved mode: the client may send interleaved RTP/RTCP packets (start with '$')
-                // on the control socket. If we try to parse these bytes as RTSP text, we may emit bogus
-                // RTSP responses and make players (ffmpeg/ffplay) tear down the session.
-                //
-                // We only need to consume/ignore these packets to keep the RTSP request parser in sync.
-                while (!buffer.empty()) {
-                    if (buffer[0] == '$') {
-                        if (buffer.size() < 4) {
-                            break;  // wait more data
-                        }
-                        const std::uint16_t len =
-                            (static_cast<std::uint8_t>(buffer[2]) << 8U) |
-                            static_cast<std::uint8_t>(buffer[3]);
-                        const std::size_t total = 4U + static_cast<std::size_t>(len);
-                        if (buffer.size() < total) {
-                            break;  // wait more data
-                        }
-                        buffer.erase(0, total);
-                        if (session_) {
-                            session_->last_activity_ns.store(steadyNowNs(), std::memory_order_relaxed);
-                        }
-                        continue;
-                    }
+    // 回看中暂停记当前进度，直播中暂停记直播位置
+    void pause() {
+        std::lock_guard<std::mutex> lock(mutex);
+        resume_position = running ? position : buffer->livePosition();
+        has_resume = true;
+        running = false;
+        ++generation;
+    }
 
-                    // 检查是否收到完整请求
-                    const size_t pos = buffer.find("\r\n\r\n");
-                    if (pos == std::string::npos) {
-                        // 未找到 header 结束，检查是否已超过 header 上限（slowloris 防护）
-                        if (buffer.size() > kMaxRtspHeader) {
-                            RTSP_LOG_WARNING("RTSP header exceeded limit, closing connection");
-                            buffer.clear();
-                            socket_->shutdownReadWrite();
-                        }
-                        break;
-                    }
-                    const size_t header_end = pos + 4;
-                    if (header_end > kMaxRtspHeader) {
-                        RTSP_LOG_WARNING("RTSP header too large, closing connection");
-                        buffer.clear();
-                        socket_->shutdownReadWrite();
-                        break;
-                    }
+    bool takeResumePosition(uint64_t& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!has_resume) {
+            return false;
+        }
+        out = resume_position;
+        has_resume = false;
+        return true;
+    }
 
-                    size_t content_length = 0;
-
-                    // 解析Content-Length
-                    std::string header = buffer.substr(0, header_end);
-                    std::string header_lower = header;
-                    std::transform(header_lower.begin(), header_lower.end(), header_lower.begin(), ::tolower);
-                    size_t cl_pos = header_lower.find("content-length:");
-                    if (cl_pos != std::string::npos) {
-                        size_t cl_end = header_lower.find("\r\n", cl_pos);
-                        if (cl_end != std::string::npos) {
-                            std::string cl_str = header.substr(cl_pos + 15, cl_end - cl_pos - 15);
-                            uint64_t cl_val = 0;
-                            if (!parseUint64Safe(cl_str, cl_val)) {
-                                RTSP_LOG_WARNING("RTSP invalid Content-Length, closing connection");
-                                buffer.clear();
-                                socket_->shutdownReadWrite();
-                                break;
-                            }
-                            if (cl_val > kMaxRtspBody) {
-                                RTSP_LOG_WARNING("RTSP Content-Length too large, closing connection");
-                                buffer.clear();
-                                socket_->shutdownReadWrite();
-                                break;
-                            }
-                            content_length = static_cast<size_t>(cl_val);
-                        }
-                    }
+    int64_t onTimer(int64_t now_ns, uint64_t timer_generation) override;
+};
 
-                    // 检查是否有足够的主体数据
-                    if (buffer.size() < header_end + content_length) {
-                        break;
-                    }
+int64_t TimeShiftPlayback::onTimer(int64_t now_ns, uint64_t timer_generation) {
+    auto target = session.lock();
+    auto media_path = path.lock();
+    if (!target || !media_path) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running || timer_generation != generation) {
+        return -1;
+    }
+    for (;;) {
+        VideoFrame unit{};
+        bool end_of_au = true;
+        if (!buffer->read(position, unit, end_of_au)) {
+            const uint64_t oldest = buffer->oldestPosition();
+            if (position < oldest) {
+                // 进度已被淘汰：从最老的 GOP 继续
+                position = oldest;
+                rebase = true;
+                continue;
+            }
+            // 追上直播：广播在 sessions_mutex 下写缓冲，这里在同一把锁下确认并切换
+            std::lock_guard<std::mutex> sessions_lock(media_path->sessions_mutex);
+            if (position < buffer->livePosition()) {
+                continue;
+            }
+            target->time_shifted = false;
+            target->awaiting_au_start = false;
+            running = false;
+            return -1;
+        }
+
+        if (rebase) {
+            start_ns = now_ns;
+            start_pts = unit.pts;
+            last_due_ns = now_ns;
+            rebase = false;
+        }
+        const double offset_ms = static_cast<double>(static_cast<int64_t>(unit.pts - start_pts)) / speed;
+        const int64_t due_ns = std::max(last_due_ns, start_ns + static_cast<int64_t>(offset_ms * 1000000.0));
+        if (due_ns > now_ns) {
+            return due_ns;
+        }
+        last_due_ns = due_ns;
+        target->pushSharedFrame(unit, end_of_au);
+        position++;
+    }
+}
+
+void ClientSession::deliverRendition(const MediaPath* source, const VideoFrame& unit,
+                                     bool au_start, bool end_of_au) {
+    RenditionState& r = *rendition;
+    std::lock_guard<std::mutex> lock(r.mutex);
+    const auto it = std::find(r.sources.begin(), r.sources.end(), source);
+    if (it == r.sources.end()) {
+        return;
+    }
+    const size_t index = static_cast<size_t>(it - r.sources.begin());
+
+    VideoFrame out = unit;
+    std::vector<uint8_t> with_parameter_sets;
+    if (index == r.current) {
+        if (!r.started) {
+            // 中途加入：从当前档位的下一个 AU 起点开始
+            if (!au_start) {
+                return;
+            }
+            r.started = true;
+        }
+    } else {
+        // 只在目标档位的 IDR 起点、且当前档位没有发到一半的 AU 时切换
+        if (index != r.target || r.current_in_au || !au_start || unit.type != FrameType::IDR) {
+            return;
+        }
+        const PathConfig config = source->snapshotConfig();
+        r.current = index;
+        r.started = true;
+        r.last_switch_ns = steadyNowNs();
+        if (stats) {
+            stats->rendition_switches++;
+        }
+        // 时间戳续接：各档位同源同时钟时偏移不变；否则（或与已发 AU 撞时间戳）重定基准
+        if (r.has_last_pts) {
+            const uint64_t frame_us = config.fps > 0 ? 1000000 / config.fps : 40000;
+            const int64_t adjusted = static_cast<int64_t>(framePtsUs(unit)) + r.pts_offset_us;
+            const int64_t last = static_cast<int64_t>(r.last_pts_us);
+            if (adjusted <= last || adjusted > last + 1000000) {
+                r.pts_offset_us = last + static_cast<int64_t>(frame_us) - static_cast<int64_t>(framePtsUs(unit));
+            }
+        }
+        // 新档位分辨率可能不同：IDR 未自带参数集时补上该档位的 SPS/PPS(/VPS)
+        if (!containsSps(config.codec, unit.data, unit.size)) {
+            appendParameterSets(config, with_parameter_sets);
+            with_parameter_sets.insert(with_parameter_sets.end(), unit.data, unit.data + unit.size);
+            out.data = with_parameter_sets.data();
+            out.size = with_parameter_sets.size();
+            out.managed_data.reset();
+            out.data_owner.reset();
+        }
+    }
+
+    out.pts_us = static_cast<uint64_t>(static_cast<int64_t>(framePtsUs(unit)) + r.pts_offset_us);
+    out.dts_us = out.pts_us;
+    out.pts = out.pts_us / 1000;
+    out.dts = out.pts;
+    r.last_pts_us = out.pts_us;
+    r.has_last_pts = true;
+    r.current_in_au = !end_of_au;
+    if (with_parameter_sets.empty()) {
+        pushSharedFrame(out, end_of_au);
+    } else {
+        pushFrame(out, end_of_au);
+    }
+}
 
-                    // 处理请求
-                    std::string request_data = buffer.substr(0, header_end + content_length);
-                    buffer.erase(0, header_end + content_length);
+// 重定向判断：返回 0 在本节点服务，否则为 3xx 状态码并给出 Location。
+// target 为请求 URL 中 host 之后的部分（含查询串）
+using RedirectCheck = std::function<int(const std::string& path, const std::string& target,
+                                        std::string& location)>;
 
-                    processRequest(request_data);
+// 准入判断：调用方持有 paths_mutex_；返回 false 表示拒绝（原因已计入统计）
+using AdmissionCheck = std::function<bool(const std::string& path, const std::string& client_ip,
+                                          const std::string& local_ip)>;
+
+// RTSP连接处理
+class RtspConnection {
+public:
+    RtspConnection(std::shared_ptr<Socket> socket,
+                   std::map<std::string, std::shared_ptr<MediaPath>>& paths,
+                   std::mutex& paths_mutex,
+                   RtspServerConfig& config,
+                   RtspServer::ClientConnectCallback& connect_cb,
+                   RtspServer::ClientDisconnectCallback& disconnect_cb,
+                   ServerStatsAtomic& stats,
+                   RedirectCheck redirect_check,
+                   AdmissionCheck admission_check,
+                   std::shared_ptr<SessionPools> pools,
+                   std::shared_ptr<ViewerCounters> viewer_counters,
+                   std::shared_ptr<ConnectionOutput> output = nullptr)
+        : socket_(std::move(socket)),
+          paths_(paths),
+          paths_mutex_(paths_mutex),
+          config_(config),
+          connect_cb_(connect_cb),
+          disconnect_cb_(disconnect_cb),
+          send_mutex_(std::make_shared<std::mutex>()),
+          stats_(stats),
+          redirect_check_(std::move(redirect_check)),
+          admission_check_(std::move(admission_check)),
+          pools_(std::move(pools)),
+          viewer_counters_(std::move(viewer_counters)),
+          output_(std::move(output)),
+          pending_(output_ ? nullptr : std::make_shared<ConnectionOutput>()),
+          digest_nonce_(config.auth_nonce.empty() ? "nonce-" + generateNonce() : config.auth_nonce),
+          digest_nonce_created_(std::chrono::steady_clock::now()) {}
+    
+    void handle() {
+        // 待发缓冲里还有发送 worker 写不完的数据时缩短等待，由连接线程接着写出
+        constexpr int kPendingRetryMs = 10;
+        uint8_t temp[4096];
+        while (socket_->isValid()) {
+            const int wait_ms = flushPending() ? kPendingRetryMs : 1000;
+            ssize_t n = socket_->recv(temp, sizeof(temp), wait_ms);
+            if (n > 0) {
+                if (!consume(temp, static_cast<size_t>(n))) {
+                    break;
                 }
             } else if (n == 0) {
                 // 连接关闭
@@ -1177,7 +2481,121 @@ public:
             }
             // n < 0 是超时，继续循环
         }
-        
+        releaseSession();
+    }
+
+    // 处理收到的字节：拆出完整的 RTSP 请求与 interleaved 包并逐个处理。
+    // 缓冲超限时返回 false，调用方关闭连接
+    bool consume(const uint8_t* data, size_t size) {
+        // 请求/累积缓冲上限（防 slowloris 和恶意 Content-Length 耗尽内存）：
+        // 单个 RTSP header 最多 32KB，单个 body 最多 64KB（RTSP 控制层不需要大 body），
+        // 累积缓冲区最多 192KB（够容纳最大 header+body+一个 interleaved 包）。
+        constexpr size_t kMaxRtspHeader = 32 * 1024;
+        constexpr size_t kMaxRtspBody = 64 * 1024;
+        constexpr size_t kMaxBufferTotal = 192 * 1024;
+
+        buffer_.append(reinterpret_cast<const char*>(data), size);
+        if (buffer_.size() > kMaxBufferTotal) {
+            RTSP_LOG_WARNING("RTSP buffer_ exceeded limit, closing connection");
+            return false;
+        }
+        // TCP interleaved mode: the client may send interleaved RTP/RTCP packets (start with '$')
+        // on the control socket. If we try to parse these bytes as RTSP text, we may emit bogus
+        // RTSP responses and make players (ffmpeg/ffplay) tear down the session.
+        //
+        // We only need to consume/ignore these packets to keep the RTSP request parser in sync.
+        while (!buffer_.empty()) {
+            if (buffer_[0] == '$') {
+                if (buffer_.size() < 4) {
+                    break;  // wait more data
+                }
+                const std::uint16_t len =
+                    (static_cast<std::uint8_t>(buffer_[2]) << 8U) |
+                    static_cast<std::uint8_t>(buffer_[3]);
+                const std::size_t total = 4U + static_cast<std::size_t>(len);
+                if (buffer_.size() < total) {
+                    break;  // wait more data
+                }
+                // 播放端在 RTCP 通道回送的 RR：码率组会话据此选档
+                const uint8_t channel = static_cast<uint8_t>(buffer_[1]);
+                if (session_ && session_->rendition &&
+                    channel == static_cast<uint8_t>(session_->interleaved_rtp_channel + 1)) {
+                    RtcpReportBlock report;
+                    if (parseRtcpReportBlock(reinterpret_cast<const uint8_t*>(buffer_.data()) + 4,
+                                             len, session_->ssrc, report)) {
+                        session_->onReceiverReport(report);
+                    }
+                }
+                buffer_.erase(0, total);
+                if (session_) {
+                    session_->last_activity_ns.store(steadyNowNs(), std::memory_order_relaxed);
+                }
+                continue;
+            }
+
+            // 检查是否收到完整请求
+            const size_t pos = buffer_.find("\r\n\r\n");
+            if (pos == std::string::npos) {
+                // 未找到 header 结束，检查是否已超过 header 上限（slowloris 防护）
+                if (buffer_.size() > kMaxRtspHeader) {
+                    RTSP_LOG_WARNING("RTSP header exceeded limit, closing connection");
+                    buffer_.clear();
+                    socket_->shutdownReadWrite();
+                }
+                break;
+            }
+            const size_t header_end = pos + 4;
+            if (header_end > kMaxRtspHeader) {
+                RTSP_LOG_WARNING("RTSP header too large, closing connection");
+                buffer_.clear();
+                socket_->shutdownReadWrite();
+                break;
+            }
+
+            size_t content_length = 0;
+
+            // 解析Content-Length
+            std::string header = buffer_.substr(0, header_end);
+            std::string header_lower = header;
+            std::transform(header_lower.begin(), header_lower.end(), header_lower.begin(), ::tolower);
+            size_t cl_pos = header_lower.find("content-length:");
+            if (cl_pos != std::string::npos) {
+                size_t cl_end = header_lower.find("\r\n", cl_pos);
+                if (cl_end != std::string::npos) {
+                    std::string cl_str = header.substr(cl_pos + 15, cl_end - cl_pos - 15);
+                    uint64_t cl_val = 0;
+                    if (!parseUint64Safe(cl_str, cl_val)) {
+                        RTSP_LOG_WARNING("RTSP invalid Content-Length, closing connection");
+                        buffer_.clear();
+                        socket_->shutdownReadWrite();
+                        break;
+                    }
+                    if (cl_val > kMaxRtspBody) {
+                        RTSP_LOG_WARNING("RTSP Content-Length too large, closing connection");
+                        buffer_.clear();
+                        socket_->shutdownReadWrite();
+                        break;
+                    }
+                    content_length = static_cast<size_t>(cl_val);
+                }
+            }
+
+            // 检查是否有足够的主体数据
+            if (buffer_.size() < header_end + content_length) {
+                break;
+            }
+
+            // 处理请求
+            std::string request_data = buffer_.substr(0, header_end + content_length);
+            buffer_.erase(0, header_end + content_length);
+
+            processRequest(request_data);
+        }
+        return true;
+    }
+
+    // 连接结束：把会话从路径上摘下并回调断开
+    void releaseSession() {
         // 清理会话：paths_ 访问必须在 paths_mutex_ 下，避免与 addPath/removePath 竞争
         if (session_) {
             std::shared_ptr<MediaPath> media_path;
@@ -1191,12 +2609,15 @@ public:
             if (media_path) {
                 media_path->removeSession(session_->session_id);
             }
+            releaseAnnouncedPaths(paths_, paths_mutex_, *session_);
             if (disconnect_cb_ && session_->role == SessionRole::Player) {
                 disconnect_cb_(session_->path, session_->client_ip);
             }
         }
     }
 
+    const std::shared_ptr<ClientSession>& session() const { return session_; }
+
 private:
     void processRequest(const std::string& data) {
         RtspRequest request;
@@ -1265,15 +2686,25 @@ private:
     
     void handleDescribe(const RtspRequest& request, int cseq) {
         std::string path = extractPathFromUrl(request.getPath());
-        
-        std::lock_guard<std::mutex> lock(paths_mutex_);
-        auto it = paths_.find(path);
-        if (it == paths_.end()) {
+        // 客户端按 Content-Base（不带查询串）拼 SETUP URL，订阅参数从这里带过去
+        describe_query_ = urlQuery(request.getUri());
+
+        std::shared_ptr<MediaPath> media_path = findPath(path);
+        if (!media_path) {
             sendResponse(RtspResponse::createError(cseq, 404, "Not Found"));
             return;
         }
-        
-        auto& media_path = it->second;
+        if (redirectIfOverloaded(request, cseq, path)) {
+            return;
+        }
+        // 转发路径用预取的上游参数应答；预取尚未完成时不在连接线程上等上游，
+        // 503 + Retry-After 让客户端稍后重试
+        if (media_path->relay && !media_path->relay->described()) {
+            RtspResponse response = RtspResponse::createError(cseq, 503, "Service Unavailable");
+            response.setHeader("Retry-After", "1");
+            sendResponse(response);
+            return;
+        }
         // 在 config_mutex 下取一份快照，之后对 SDP 构建都基于这份不变快照，
         // 避免与 Publisher 的 RTP 接收回调 / pushH26xData 的写入竞争。
         const PathConfig config = media_path->snapshotConfig();
@@ -1296,6 +2727,9 @@ private:
             .setSessionName("RTSP Stream")
             .setTime();
         sdp.setConnection("IN", "IP4", sdp_ip);
+        if (media_path->file_source) {
+            sdp.addAttribute("range", "npt=0-" + formatNpt(media_path->file_source->durationMs()));
+        }
         
         // 计算payload type
         uint8_t payload_type = (config.codec == CodecType::H264) ? 96 : 97;
@@ -1308,11 +2742,19 @@ private:
         std::string control = "stream";
         
         if (config.codec == CodecType::H264) {
+            // profile-level-id 直接取 SPS 的 profile_idc / constraint 标志 / level_idc 三个字节
+            std::string profile_level_id;
+            if (config.sps.size() >= 4) {
+                char hex[7];
+                std::snprintf(hex, sizeof(hex), "%02X%02X%02X", config.sps[1], config.sps[2], config.sps[3]);
+                profile_level_id = hex;
+            }
             sdp.addH264Media(control, 0, payload_type, clock_rate,
-                            sps_b64, pps_b64, config.width, config.height);
+                            sps_b64, pps_b64, config.width, config.height, profile_level_id);
         } else {
             sdp.addH265Media(control, 0, payload_type, clock_rate,
-                            vps_b64, sps_b64, pps_b64, config.width, config.height);
+                            vps_b64, sps_b64, pps_b64, config.width, config.height,
+                            config.profile_idc, config.level_idc, config.high_tier);
         }
 
         // 构造 DESCRIBE 响应，附带 Content-Base 头让不同客户端对相对 control URL
@@ -1333,6 +2775,11 @@ private:
     }
 
     void handleAnnounce(const RtspRequest& request, int cseq) {
+        // 推流的 RTP 接收需要独立线程，单线程模式只服务播放端
+        if (output_) {
+            sendResponse(RtspResponse::createError(cseq, 501, "Not Implemented"));
+            return;
+        }
         if (session_) {
             sendResponse(RtspResponse::createError(cseq, 459, "Aggregate Operation Not Allowed"));
             return;
@@ -1340,43 +2787,52 @@ private:
 
         std::string path = extractPathFromUrl(request.getPath());
 
-        PathConfig announced_config{};
-        uint8_t payload_type = 96;
-        if (!parseAnnouncedPathConfig(path, request.getBody(), &announced_config, &payload_type)) {
+        std::vector<AnnouncedTrack> tracks;
+        if (!parseAnnouncedTracks(path, request.getBody(), &tracks)) {
             sendResponse(RtspResponse::createError(cseq, 400, "Bad Request"));
             return;
         }
 
-        {
+        std::vector<std::shared_ptr<MediaPath>> created_sub_paths;
+        for (const auto& track : tracks) {
             std::shared_ptr<MediaPath> media_path;
+            bool created = false;
             {
                 std::lock_guard<std::mutex> lock(paths_mutex_);
-                auto it = paths_.find(path);
+                auto it = paths_.find(track.path);
                 if (it == paths_.end()) {
                     media_path = std::make_shared<MediaPath>();
-                    media_path->path = path;
+                    media_path->path = track.path;
+                    media_path->viewer_counters = viewer_counters_;
                     // 新路径此时只有当前线程持有引用，无需加 config_mutex
-                    media_path->config = announced_config;
-                    paths_[path] = media_path;
+                    media_path->config = track.config;
+                    paths_[track.path] = media_path;
+                    created = true;
+                    if (track.path != path) {
+                        created_sub_paths.push_back(media_path);
+                    }
                 } else {
                     media_path = it->second;
                 }
             }
             // 已存在的路径需要在 config_mutex 下更新，避免与 DESCRIBE 读冲突
-            if (media_path) {
+            if (media_path && !created) {
                 std::lock_guard<std::mutex> cfg_lock(media_path->config_mutex);
-                media_path->config.codec = announced_config.codec;
-                media_path->config.width = announced_config.width;
-                media_path->config.height = announced_config.height;
-                media_path->config.fps = announced_config.fps;
-                if (!announced_config.sps.empty()) {
-                    media_path->config.sps = announced_config.sps;
+                media_path->config.codec = track.config.codec;
+                media_path->config.width = track.config.width;
+                media_path->config.height = track.config.height;
+                media_path->config.fps = track.config.fps;
+                media_path->config.profile_idc = track.config.profile_idc;
+                media_path->config.level_idc = track.config.level_idc;
+                media_path->config.high_tier = track.config.high_tier;
+                if (!track.config.sps.empty()) {
+                    media_path->config.sps = track.config.sps;
                 }
-                if (!announced_config.pps.empty()) {
-                    media_path->config.pps = announced_config.pps;
+                if (!track.config.pps.empty()) {
+                    media_path->config.pps = track.config.pps;
                 }
-                if (!announced_config.vps.empty()) {
-                    media_path->config.vps = announced_config.vps;
+                if (!track.config.vps.empty()) {
+                    media_path->config.vps = track.config.vps;
                 }
             }
         }
@@ -1388,7 +2844,9 @@ private:
         session_->role = SessionRole::Publisher;
         session_->control_socket = socket_;
         session_->control_send_mutex = send_mutex_;
-        session_->publisher_payload_type = payload_type;
+        session_->rtp_receivers.resize(tracks.size());
+        session_->announced_tracks = std::move(tracks);
+        session_->announced_paths = std::move(created_sub_paths);
 
         RtspResponse response = RtspResponse::createOk(cseq);
         response.setSession(session_->session_id);
@@ -1407,14 +2865,15 @@ private:
             path = path.substr(0, slash_pos);
         }
 
-        std::lock_guard<std::mutex> lock(paths_mutex_);
-        auto it = paths_.find(path);
-        if (it == paths_.end()) {
+        // 未经 DESCRIBE 直接 SETUP 的观看者也要过负载判断（统计负载要拿 paths_mutex_，放在锁外）
+        std::shared_ptr<MediaPath> media_path = findPath(path);
+        if (!media_path) {
             sendResponse(RtspResponse::createError(cseq, 404, "Not Found"));
             return;
         }
-
-        auto& media_path = it->second;
+        if (!admitted_ && redirectIfOverloaded(request, cseq, path)) {
+            return;
+        }
 
         std::string transport = request.getTransport();
         const bool use_tcp = (transport.find("RTP/AVP/TCP") != std::string::npos ||
@@ -1428,32 +2887,69 @@ private:
             return;
         }
 
+        // 订阅模式：SETUP URL 的查询串 > X-Subscription 头 > 本连接 DESCRIBE URL 的查询串
+        std::unique_ptr<SubscriptionFilter> subscription(new SubscriptionFilter());
+        std::string subscription_spec = urlQuery(request.getUri());
+        if (subscription_spec.empty()) {
+            subscription_spec = request.getHeader("X-Subscription");
+        }
+        if (subscription_spec.empty()) {
+            subscription_spec = describe_query_;
+        }
+        if (!subscription->parse(subscription_spec)) {
+            sendResponse(RtspResponse::createError(cseq, 400, "Bad Request"));
+            return;
+        }
+
+        // 准入控制在取端口、创建会话之前做，超限的请求不占任何资源
+        const std::string client_ip = socket_->getPeerIp();
+        const std::string local_ip = socket_->getLocalIp();
+        bool admitted = true;
+        if (admission_check_) {
+            std::lock_guard<std::mutex> lock(paths_mutex_);
+            admitted = admission_check_(path, client_ip, local_ip);
+        }
+        if (!admitted) {
+            sendResponse(RtspResponse::createError(cseq, 453, "Not Enough Bandwidth"));
+            return;
+        }
+
         session_ = std::make_shared<ClientSession>();
         session_->session_id = generateSessionId();
         session_->path = path;
-        session_->client_ip = socket_->getPeerIp();
+        session_->client_ip = client_ip;
+        session_->local_ip = local_ip;
         session_->role = SessionRole::Player;
         session_->client_rtp_port = static_cast<uint16_t>(client_rtp_port);
         session_->client_rtcp_port = static_cast<uint16_t>(client_rtcp_port != 0 ? client_rtcp_port : client_rtp_port + 1);
         session_->use_tcp_interleaved = use_tcp;
         session_->control_socket = socket_;
         session_->control_send_mutex = send_mutex_;
+        session_->control_output = output_ ? output_ : pending_;
+        session_->flush_control_output = !output_;
         session_->stats = &stats_;
+        if (pools_ && !output_) {
+            session_->send_pool = pools_->send_workers;
+        }
         
-        // 创建RTP发送器
+        // 创建RTP发送器：优先复用已结束会话留下的端口对
         if (!use_tcp) {
-            session_->rtp_sender = std::make_unique<RtpSender>();
-            bool sender_ready = false;
-            for (int attempt = 0; attempt < 32; ++attempt) {
+            if (pools_ && pools_->senders) {
+                session_->sender_pool = pools_->senders;
+                session_->rtp_sender = pools_->senders->acquire();
+            }
+            bool sender_ready = session_->rtp_sender != nullptr;
+            if (!sender_ready) {
+                session_->rtp_sender = std::make_unique<RtpSender>();
+            }
+            for (int attempt = 0; !sender_ready && attempt < 32; ++attempt) {
                 uint16_t local_rtp_port = RtspServerConfig::getNextRtpPort(
                     config_.rtp_port_current, config_.rtp_port_start, config_.rtp_port_end);
-                if (session_->rtp_sender->init("0.0.0.0", local_rtp_port)) {
-                    sender_ready = true;
-                    break;
-                }
+                sender_ready = session_->rtp_sender->init("0.0.0.0", local_rtp_port);
             }
             if (!sender_ready) {
                 sendResponse(RtspResponse::createError(cseq, 500, "Internal Server Error"));
+                session_->rtp_sender.reset();   // 未绑定成功，不放回端口池
                 session_.reset();
                 return;
             }
@@ -1465,26 +2961,61 @@ private:
         
         // 创建RTP打包器（读 codec 需要在 config_mutex 下做，避免与 auto-extract 竞争）
         CodecType path_codec;
+        bool insert_parameter_sets = false;
+        std::vector<uint8_t> vps, sps, pps;
         {
             std::lock_guard<std::mutex> cfg_lock(media_path->config_mutex);
             path_codec = media_path->config.codec;
+            insert_parameter_sets = media_path->config.insert_parameter_sets;
+            if (insert_parameter_sets) {
+                vps = media_path->config.vps;
+                sps = media_path->config.sps;
+                pps = media_path->config.pps;
+            }
         }
         if (path_codec == CodecType::H264) {
             session_->rtp_packer = std::make_unique<H264RtpPacker>();
         } else {
             session_->rtp_packer = std::make_unique<H265RtpPacker>();
         }
+        if (insert_parameter_sets) {
+            session_->rtp_packer->setParameterSets(vps, sps, pps);
+        }
+        if (subscription->mode != SubscriptionFilter::Mode::All) {
+            subscription->start();
+            session_->subscription = std::move(subscription);
+        }
         session_->rtp_packer->setPayloadType((path_codec == CodecType::H264) ? 96 : 97);
         const uint32_t session_ssrc = static_cast<uint32_t>(
             0x12345678u + std::hash<std::string>{}(session_->session_id));
         session_->rtp_packer->setSsrc(session_ssrc);
+        session_->ssrc = session_ssrc;
         // RTCP Sender Report 必须携带同一 SSRC
         if (session_->rtp_sender) {
             session_->rtp_sender->setSsrc(session_ssrc);
         }
         
-        // 添加到媒体路径
-        media_path->addSession(session_->session_id, session_);
+        // 添加到媒体路径：绑定端口期间路径可能已被移除，并发 SETUP 也可能已占满名额，
+        // 在同一把锁下复核后再加入（只做计数，无 I/O），被拒时端口随会话析构放回端口池
+        bool registered = false;
+        {
+            std::lock_guard<std::mutex> lock(paths_mutex_);
+            auto it = paths_.find(path);
+            registered = it != paths_.end() && it->second == media_path;
+            admitted = !registered || !admission_check_ || admission_check_(path, client_ip, local_ip);
+            if (registered && admitted) {
+                media_path->addSession(session_->session_id, session_);
+            }
+        }
+        if (!registered || !admitted) {
+            session_.reset();
+            if (!registered) {
+                sendResponse(RtspResponse::createError(cseq, 404, "Not Found"));
+            } else {
+                sendResponse(RtspResponse::createError(cseq, 453, "Not Enough Bandwidth"));
+            }
+            return;
+        }
         stats_.sessions_created++;
         if (connect_cb_) {
             connect_cb_(session_->path, session_->client_ip);
@@ -1519,6 +3050,21 @@ private:
         sendResponse(RtspResponse::createSetup(cseq, session_->session_id, transport_ss.str()));
     }
 
+    // 按 SETUP URL 的末段匹配 ANNOUNCE 里的 a=control；单轨时 URL 任意都落到第 0 轨
+    int findAnnouncedTrack(const RtspRequest& request) const {
+        const auto& tracks = session_->announced_tracks;
+        if (tracks.size() == 1) {
+            return 0;
+        }
+        const std::string tail = trackControlTail(request.getPath());
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            if (tracks[i].control == tail) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
     void handlePublisherSetup(const RtspRequest& request, int cseq) {
         if (!session_ || session_->role != SessionRole::Publisher) {
             sendResponse(RtspResponse::createError(cseq, 455, "Method Not Valid In This State"));
@@ -1538,24 +3084,47 @@ private:
             return;
         }
 
-        std::shared_ptr<MediaPath> media_path;
-        {
-            std::lock_guard<std::mutex> lock(paths_mutex_);
-            auto it = paths_.find(session_->path);
-            if (it == paths_.end()) {
-                sendResponse(RtspResponse::createError(cseq, 404, "Not Found"));
-                return;
-            }
-            media_path = it->second;
+        const int track_index = findAnnouncedTrack(request);
+        if (track_index < 0) {
+            sendResponse(RtspResponse::createError(cseq, 404, "Not Found"));
+            return;
         }
+        const AnnouncedTrack& track = session_->announced_tracks[static_cast<size_t>(track_index)];
 
-        session_->client_rtp_port = static_cast<uint16_t>(client_rtp_port);
-        session_->client_rtcp_port = static_cast<uint16_t>(client_rtcp_port != 0 ? client_rtcp_port : client_rtp_port + 1);
+        std::shared_ptr<MediaPath> media_path = findPath(track.path);
+        if (!media_path) {
+            sendResponse(RtspResponse::createError(cseq, 404, "Not Found"));
+            return;
+        }
+
+        // 会话挂在主路径上（超时清理/断连清理都以 session_->path 为准），哪一轨先 SETUP 都挂
+        const bool first_setup = std::none_of(
+            session_->rtp_receivers.begin(), session_->rtp_receivers.end(),
+            [](const std::unique_ptr<PublishRtpReceiver>& r) { return r != nullptr; });
+        std::shared_ptr<MediaPath> main_path = track_index == 0 ? media_path : findPath(session_->path);
+        if (first_setup && !main_path) {
+            sendResponse(RtspResponse::createError(cseq, 404, "Not Found"));
+            return;
+        }
+
+        if (track_index == 0) {
+            session_->client_rtp_port = static_cast<uint16_t>(client_rtp_port);
+            session_->client_rtcp_port = static_cast<uint16_t>(client_rtcp_port != 0 ? client_rtcp_port : client_rtp_port + 1);
+        }
+        const uint16_t reply_rtcp_port =
+            static_cast<uint16_t>(client_rtcp_port != 0 ? client_rtcp_port : client_rtp_port + 1);
 
-        if (!session_->rtp_receiver) {
-            auto receiver = std::make_unique<PublishRtpReceiver>();
+        auto& slot = session_->rtp_receivers[static_cast<size_t>(track_index)];
+        if (!slot) {
+            std::shared_ptr<RtpIngestPool> ingest = pools_->ingestPool();
+            auto receiver = std::make_unique<PublishRtpReceiver>(ingest);
             bool receiver_ready = false;
-            for (int attempt = 0; attempt < 32; ++attempt) {
+            UdpSource source;
+            if (ingest->sharedRtpPort() != 0 &&
+                makeUdpSource(session_->client_ip, static_cast<uint16_t>(client_rtp_port), &source)) {
+                receiver_ready = receiver->initShared(source);
+            }
+            for (int attempt = 0; !receiver_ready && attempt < 32; ++attempt) {
                 const uint16_t local_rtp_port = RtspServerConfig::getNextRtpPort(
                     config_.rtp_port_current, config_.rtp_port_start, config_.rtp_port_end);
                 if (receiver->init(local_rtp_port, static_cast<uint16_t>(local_rtp_port + 1))) {
@@ -1574,11 +3143,13 @@ private:
                                        media_path->config.width,
                                        media_path->config.height,
                                        media_path->config.fps,
-                                       session_->publisher_payload_type);
+                                       track.payload_type);
             }
             std::weak_ptr<MediaPath> weak_path = media_path;
-            std::weak_ptr<ClientSession> weak_session = session_;
-            receiver->setCallback([weak_path, weak_session, this](const VideoFrame& frame) {
+            // 接收器归会话所有，回调只在接收器注册期间发生，会话必然还在；
+            // 不在收流线程上 lock 会话，避免最后一个引用在这里释放、接收器在自己的回调里析构
+            ClientSession* owner = session_.get();
+            receiver->setCallback([weak_path, owner, this](const VideoFrame& frame) {
                 if (auto path = weak_path.lock()) {
                     // 在 config_mutex 下做 auto-extract，与 DESCRIBE 的读侧互斥
                     {
@@ -1592,24 +3163,24 @@ private:
                             (void)autoExtractH265ParameterSets(path->config, frame.data, frame.size);
                         }
                     }
-                    path->broadcastFrame(frame);
+                    path->broadcastSharedFrame(frame);
                     stats_.frames_pushed++;
                 }
-                if (auto session = weak_session.lock()) {
-                    session->last_activity_ns.store(steadyNowNs(), std::memory_order_relaxed);
-                }
+                owner->last_activity_ns.store(steadyNowNs(), std::memory_order_relaxed);
             });
-            session_->rtp_receiver = std::move(receiver);
+            slot = std::move(receiver);
 
-            media_path->addSession(session_->session_id, session_);
-            stats_.sessions_created++;
+            if (first_setup) {
+                main_path->addSession(session_->session_id, session_);
+                stats_.sessions_created++;
+            }
         }
 
         std::stringstream transport_ss;
-        transport_ss << "RTP/AVP;unicast;client_port=" << session_->client_rtp_port
-                     << "-" << session_->client_rtcp_port
-                     << ";server_port=" << session_->rtp_receiver->getRtpPort()
-                     << "-" << session_->rtp_receiver->getRtcpPort();
+        transport_ss << "RTP/AVP;unicast;client_port=" << client_rtp_port
+                     << "-" << reply_rtcp_port
+                     << ";server_port=" << slot->getRtpPort()
+                     << "-" << slot->getRtcpPort();
 
         sendResponse(RtspResponse::createSetup(cseq, session_->session_id, transport_ss.str()));
     }
@@ -1635,21 +3206,122 @@ private:
             return;
         }
 
-        // 幂等处理：已在播放直接返回成功，避免重复创建线程导致崩溃
-        if (!session_->playing) {
+        std::shared_ptr<MediaPath> media_path;
+        {
+            std::lock_guard<std::mutex> lock(paths_mutex_);
+            auto it = paths_.find(session_->path);
+            if (it != paths_.end() && (it->second->file_source || it->second->timeshift)) {
+                media_path = it->second;
+            }
+        }
+
+        // 先定好帧来源（回看会话不再接收直播广播），再开始发送
+        std::string range;
+        if (media_path && media_path->file_source) {
+            range = startFilePlayback(*media_path, request.getHeader("Range"));
+        } else if (media_path) {
+            range = startTimeShift(media_path, request.getHeader("Range"));
+        }
+
+        RtspResponse response = RtspResponse::createPlay(cseq, session_->session_id);
+        if (!range.empty()) {
+            response.setHeader("Range", range);
+        }
+        // 响应先于媒体数据写出：interleaved 的 $ 包不会夹在 PLAY 响应之前被客户端当作响应内容丢掉。
+        // playing 在响应之前置位，客户端收到 200 后立即到达的帧不会被广播跳过，只是先入队。
+        // 幂等处理：已在播放直接返回成功。已入队的帧交给发送工作池；
+        // 单线程模式没有工作池，由事件循环 drainQueue
+        const bool start = !session_->playing;
+        if (start) {
+            session_->holdSend();
             session_->playing = true;
-            if (!session_->send_thread.joinable()) {
-                session_->send_thread = std::thread([this]() {
-                    session_->sendLoop();
-                });
+        }
+        sendResponse(response);
+        if (start) {
+            session_->scheduleSend();
+        }
+    }
+
+    std::shared_ptr<TimeShiftPlayback> timeShiftPlayback(const std::shared_ptr<MediaPath>& media_path) {
+        auto& playback = session_->timeshift_playback;
+        if (!playback) {
+            playback = std::make_shared<TimeShiftPlayback>();
+            playback->buffer = media_path->timeshift;
+            playback->path = media_path;
+            playback->session = session_;
+            playback->speed = std::max(1.0, media_path->snapshotConfig().timeshift_catchup_speed);
+        }
+        return playback;
+    }
+
+    // 时移路径：带 Range: npt= 或暂停后续播时从时移缓冲回看，否则直接看直播。
+    // npt 相对缓冲（见 parseTimeShiftNpt）；回看时返回实际起点的 Range 头，直播返回空。
+    std::string startTimeShift(const std::shared_ptr<MediaPath>& media_path, const std::string& range) {
+        const TimeShiftBuffer& buffer = *media_path->timeshift;
+        auto playback = timeShiftPlayback(media_path);
+        uint64_t position = 0;
+        uint64_t offset_ms = 0;
+        bool from_live = false;
+        bool from_buffer = false;
+        if (parseTimeShiftNpt(range, offset_ms, from_live)) {
+            from_buffer = buffer.seek(offset_ms, from_live, position);
+        } else if (playback->takeResumePosition(position)) {
+            position = std::max(position, buffer.oldestPosition());
+            from_buffer = true;
+        }
+
+        VideoFrame first{};
+        bool end_of_au = true;
+        if (!from_buffer || !buffer.read(position, first, end_of_au)) {
+            playback->stop();
+            std::lock_guard<std::mutex> lock(media_path->sessions_mutex);
+            if (session_->time_shifted) {
+                session_->time_shifted = false;
+                session_->awaiting_au_start = true;
             }
+            return "";
         }
-        
-        sendResponse(RtspResponse::createPlay(cseq, session_->session_id));
+
+        {
+            std::lock_guard<std::mutex> lock(media_path->sessions_mutex);
+            session_->time_shifted = true;
+        }
+        session_->clearQueue();  // 丢掉已入队的直播帧
+        const uint64_t generation = playback->start(position);
+        media_path->scheduler->schedule(playback, steadyNowNs(), generation);
+        return "npt=" + formatNpt(buffer.nptOf(first.pts)) + "-";
+    }
+
+    // 文件点播：按 Range 定位（无 Range 时从暂停处继续），返回响应的 Range 头
+    std::string startFilePlayback(MediaPath& media_path, const std::string& range) {
+        const FileSource& source = *media_path.file_source;
+        auto& playback = session_->file_playback;
+        size_t index = 0;
+        if (playback) {
+            index = playback->pause();
+            session_->clearQueue();  // 丢掉旧位置已入队的帧
+        } else {
+            playback = std::make_shared<FilePlayback>();
+            playback->source = media_path.file_source;
+            playback->session = session_;
+        }
+
+        uint64_t npt_ms = 0;
+        if (parseNptStart(range, npt_ms)) {
+            index = source.seekIndex(npt_ms);
+        } else if (index >= source.entries().size()) {
+            index = 0;
+        }
+        const uint64_t generation = playback->start(index);
+        media_path.scheduler->schedule(playback, steadyNowNs(), generation);
+        return "npt=" + formatNpt(source.entries()[index].dts_us / 1000) + "-" + formatNpt(source.durationMs());
     }
 
     void handleRecord(const RtspRequest& request, int cseq) {
-        if (!session_ || session_->role != SessionRole::Publisher || !session_->rtp_receiver) {
+        const bool has_receiver = session_ &&
+            std::any_of(session_->rtp_receivers.begin(), session_->rtp_receivers.end(),
+                        [](const std::unique_ptr<PublishRtpReceiver>& r) { return r != nullptr; });
+        if (!session_ || session_->role != SessionRole::Publisher || !has_receiver) {
             sendResponse(RtspResponse::createError(cseq, 455, "Method Not Valid In This State"));
             return;
         }
@@ -1660,7 +3332,13 @@ private:
             return;
         }
 
-        session_->rtp_receiver->start();
+        for (auto& receiver : session_->rtp_receivers) {
+            if (receiver && !receiver->start()) {
+                // 共享端口上同一来源地址已被另一个推流会话占用
+                sendResponse(RtspResponse::createError(cseq, 500, "Internal Server Error"));
+                return;
+            }
+        }
         session_->last_activity_ns.store(steadyNowNs(), std::memory_order_relaxed);
 
         RtspResponse response = RtspResponse::createOk(cseq);
@@ -1674,6 +3352,20 @@ private:
             sendResponse(RtspResponse::createError(cseq, 455, "Method Not Valid In This State"));
             return;
         }
+        if (session_->file_playback) {
+            session_->file_playback->pause();
+        }
+        std::shared_ptr<MediaPath> media_path;
+        {
+            std::lock_guard<std::mutex> lock(paths_mutex_);
+            auto it = paths_.find(session_->path);
+            if (it != paths_.end() && it->second->timeshift) {
+                media_path = it->second;
+            }
+        }
+        if (media_path && session_->role == SessionRole::Player) {
+            timeShiftPlayback(media_path)->pause();  // 记下续播位置
+        }
         session_->stop();
         sendResponse(RtspResponse::createOk(cseq));
     }
@@ -1712,6 +3404,7 @@ private:
             if (media_path) {
                 media_path->removeSession(session_->session_id);
             }
+            releaseAnnouncedPaths(paths_, paths_mutex_, *session_);
             stats_.sessions_closed++;
             if (disconnect_cb_ && session_->role == SessionRole::Player) {
                 disconnect_cb_(session_->path, session_->client_ip);
@@ -1722,26 +3415,85 @@ private:
         sendResponse(RtspResponse::createTeardown(cseq));
     }
     
+    // paths_mutex_ 只护这一次查表；SDP 构建、端口绑定和应答发送都在锁外，
+    // 慢客户端或端口耗尽不会拖住推流、其他请求和清理线程
+    std::shared_ptr<MediaPath> findPath(const std::string& path) {
+        std::lock_guard<std::mutex> lock(paths_mutex_);
+        auto it = paths_.find(path);
+        return it != paths_.end() ? it->second : nullptr;
+    }
+
+    // 新观看者在本节点过载时收到 302/305 + Location；每个连接只判断一次
+    bool redirectIfOverloaded(const RtspRequest& request, int cseq, const std::string& path) {
+        if (admitted_ || !redirect_check_) {
+            return false;
+        }
+        std::string target = request.getUri();
+        const size_t scheme = target.find("://");
+        if (scheme != std::string::npos) {
+            const size_t slash = target.find('/', scheme + 3);
+            target = slash == std::string::npos ? "/" : target.substr(slash);
+        }
+        std::string location;
+        const int status = redirect_check_(path, target, location);
+        if (status == 0 || location.empty()) {
+            admitted_ = true;
+            return false;
+        }
+        RtspResponse response = RtspResponse::createError(
+            cseq, status, status == 305 ? "Use Proxy" : "Moved Temporarily");
+        response.setHeader("Location", location);
+        sendResponse(response);
+        stats_.redirects++;
+        RTSP_LOG_INFO("Redirected " + path + " to " + location);
+        return true;
+    }
+
     void sendResponse(const RtspResponse& response) {
         std::string data = response.build();
-        // 带超时的响应写，防止客户端停止读取时阻塞连接线程
-        constexpr int kRtspRespSendTimeoutMs = 2000;
+        if (output_) {
+            output_->data += data;
+            return;
+        }
+        // 与 interleaved RTP 走同一个待发缓冲，保证不插进半个 RTP 包中间；写不完的由 handle() 接着写
         std::lock_guard<std::mutex> lock(*send_mutex_);
-        ssize_t sent = socket_->sendAll(reinterpret_cast<const uint8_t*>(data.data()),
-                                        data.size(), kRtspRespSendTimeoutMs);
-        if (sent != static_cast<ssize_t>(data.size())) {
-            RTSP_LOG_WARNING("RTSP response send timeout/failed, closing connection");
+        pending_->data += data;
+        if (!pending_->flushTo(*socket_)) {
+            RTSP_LOG_WARNING("RTSP response send failed, closing connection");
             socket_->shutdownReadWrite();
         }
     }
 
-    bool checkAuthorization(const RtspRequest& request, int cseq) {
-        if (!config_.auth_enabled) return true;
-        if (request.getMethod() == RtspMethod::Options) return true;
-
-        std::string auth = request.getHeader("Authorization");
-        auto reject = [&](bool digest, bool stale) {
-            RtspResponse resp(cseq);
+    // 多线程模式：写出待发缓冲里尚未写出的部分，返回是否仍有待发数据。对端持续
+    // kStalledOutputTimeoutMs 一个字节都不收时关闭连接，防止不读的客户端无限占用内存
+    bool flushPending() {
+        constexpr int64_t kStalledOutputTimeoutMs = 2000;
+        if (!pending_) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(*send_mutex_);
+        if (pending_->data.empty()) {
+            return false;
+        }
+        const bool ok = pending_->flushTo(*socket_);
+        if (!ok || (pending_->stalled_since_ns != 0 &&
+                    steadyNowNs() - pending_->stalled_since_ns > kStalledOutputTimeoutMs * 1000000)) {
+            RTSP_LOG_WARNING("RTSP output stalled/failed, closing connection");
+            socket_->shutdownReadWrite();
+            pending_->data.clear();
+            pending_->stalled_since_ns = 0;
+            return false;
+        }
+        return !pending_->data.empty();
+    }
+
+    bool checkAuthorization(const RtspRequest& request, int cseq) {
+        if (!config_.auth_enabled) return true;
+        if (request.getMethod() == RtspMethod::Options) return true;
+
+        std::string auth = request.getHeader("Authorization");
+        auto reject = [&](bool digest, bool stale) {
+            RtspResponse resp(cseq);
             resp.setStatus(401, "Unauthorized");
             stats_.auth_challenges++;
             stats_.auth_failures++;
@@ -1837,6 +3589,15 @@ private:
     RtspServer::ClientDisconnectCallback& disconnect_cb_;
     std::shared_ptr<std::mutex> send_mutex_;
     ServerStatsAtomic& stats_;
+    RedirectCheck redirect_check_;
+    bool admitted_ = false;    // 本连接已通过重定向判断（之后的 SETUP 不再重定向）
+    std::string describe_query_;   // 最近一次 DESCRIBE URL 的查询串（订阅模式）
+    AdmissionCheck admission_check_;
+    std::shared_ptr<SessionPools> pools_;
+    std::shared_ptr<ViewerCounters> viewer_counters_;
+    std::shared_ptr<ConnectionOutput> output_;   // 单线程模式的待发缓冲，由事件循环写出
+    std::shared_ptr<ConnectionOutput> pending_;  // 多线程模式的待发缓冲（持 send_mutex_，与发送 worker 共用）
+    std::string buffer_;                         // 尚未拆出完整请求/interleaved 包的已收字节
     std::shared_ptr<ClientSession> session_;
     std::string digest_nonce_;
     std::chrono::steady_clock::time_point digest_nonce_created_;
@@ -1853,31 +3614,266 @@ public:
     
     std::mutex paths_mutex_;
     std::map<std::string, std::shared_ptr<MediaPath>> paths_;
+    // 文件点播共用的排程线程（首次 addFilePath 时创建）
+    std::shared_ptr<PlaybackScheduler> playback_scheduler_;
+    HlsServer hls_server_;
     
     ClientConnectCallback connect_callback_;
     ClientDisconnectCallback disconnect_callback_;
     ServerStatsAtomic stats_;
 
-    std::mutex connections_mutex_;
-    struct ConnectionHandle {
-        std::shared_ptr<Socket> socket;
+    // 负载感知重定向（redirect_mutex_ 保护策略与回调的替换）
+    std::mutex redirect_mutex_;
+    std::shared_ptr<RedirectPolicy> redirect_policy_;
+    RedirectCallback redirect_callback_;
+    // 发送码率、CPU 占用与发送队列积压由清理线程约每秒采样一次；观看会话数随登记/移除实时维护
+    std::atomic<uint64_t> egress_bps_{0};
+    std::atomic<uint32_t> cpu_usage_permille_{0};
+    std::atomic<uint64_t> queued_units_{0};
+    std::shared_ptr<ViewerCounters> viewer_counters_ = std::make_shared<ViewerCounters>();
+
+    // 准入控制（admission_mutex_ 保护配置替换）
+    std::mutex admission_mutex_;
+    AdmissionConfig admission_;
+    int64_t load_sample_ns_ = 0;
+    uint64_t load_sample_bytes_ = 0;
+    std::clock_t load_sample_clock_ = 0;
+
+    // 每个 DESCRIBE 都要读（checkRedirect），只读原子量，不拿 paths_mutex_
+    ServerLoad currentLoad() const {
+        ServerLoad load;
+        load.sessions = viewer_counters_->total.load(std::memory_order_relaxed);
+        load.queued_units = queued_units_.load(std::memory_order_relaxed);
+        load.egress_bps = egress_bps_.load();
+        load.cpu_usage = cpu_usage_permille_.load() / 1000.0;
+        return load;
+    }
+
+    // 所有观看会话发送队列中待发的单元数（由 sampleLoad 每秒采样）
+    void sampleQueuedUnits() {
+        uint64_t queued = 0;
+        std::lock_guard<std::mutex> lock(paths_mutex_);
+        for (auto& path_pair : paths_) {
+            auto& path = path_pair.second;
+            std::lock_guard<std::mutex> session_lock(path->sessions_mutex);
+            for (auto& session_pair : path->sessions) {
+                auto& session = session_pair.second;
+                // 码率组会话同时挂在各档位上，只在组路径上计一次
+                if (session->role != SessionRole::Player || session->path != path->path) {
+                    continue;
+                }
+                std::lock_guard<std::mutex> queue_lock(session->queue_mutex);
+                queued += session->frame_queue.size();
+            }
+        }
+        queued_units_.store(queued, std::memory_order_relaxed);
+    }
+
+    int checkRedirect(const std::string& path, const std::string& target, std::string& location) {
+        std::shared_ptr<RedirectPolicy> policy;
+        RedirectCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(redirect_mutex_);
+            policy = redirect_policy_;
+            callback = redirect_callback_;
+        }
+        if (!policy && !callback) {
+            return 0;
+        }
+        const ServerLoad load = currentLoad();
+        if (callback) {
+            return callback(path, load, location);
+        }
+        return policy->decide(path, target, load, location) ? policy->statusCode() : 0;
+    }
+
+    // 调用方（SETUP）持有 paths_mutex_，判断与加入会话在同一把锁下，并发 SETUP 不会同时越过上限。
+    // 会话数读 ViewerCounters（O(1)）；只有配置了带宽上限时才按路径（不按会话）累加码率
+    bool checkAdmission(const std::string& path, const std::string& client_ip, const std::string& local_ip) {
+        AdmissionConfig limits;
+        {
+            std::lock_guard<std::mutex> lock(admission_mutex_);
+            limits = admission_;
+        }
+        const bool check_bandwidth = limits.max_egress_bps > 0 || limits.max_egress_bps_per_interface > 0;
+        if (limits.max_sessions == 0 && limits.max_sessions_per_path == 0 &&
+            limits.max_sessions_per_ip == 0 && !check_bandwidth) {
+            return true;
+        }
+
+        ViewerCounters& viewers = *viewer_counters_;
+        const uint64_t total = viewers.total.load(std::memory_order_relaxed);
+        uint64_t on_path = 0;
+        uint64_t from_ip = 0;
+        uint64_t egress_bps = 0;
+        uint64_t interface_bps = 0;
+        uint64_t new_bps = 0;
+        std::vector<std::pair<const std::string*, uint64_t>> bitrates;
+        if (check_bandwidth) {
+            bitrates.reserve(paths_.size());
+            for (auto& path_pair : paths_) {
+                const uint64_t bitrate = path_pair.second->viewerBitrate();
+                if (path_pair.first == path) {
+                    new_bps = bitrate;
+                }
+                bitrates.emplace_back(&path_pair.first, bitrate);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(viewers.mutex);
+            on_path = ViewerCounters::lookup(viewers.per_path, path);
+            from_ip = ViewerCounters::lookup(viewers.per_ip, client_ip);
+            for (const auto& entry : bitrates) {
+                egress_bps += ViewerCounters::lookup(viewers.per_path, *entry.first) * entry.second;
+                interface_bps += ViewerCounters::lookup(viewers.per_path_interface,
+                                                        std::make_pair(*entry.first, local_ip)) * entry.second;
+            }
+        }
+
+        const char* reason = nullptr;
+        if (limits.max_sessions > 0 && total >= limits.max_sessions) {
+            stats_.admission_rejected_sessions++;
+            reason = "session limit";
+        } else if (limits.max_sessions_per_path > 0 && on_path >= limits.max_sessions_per_path) {
+            stats_.admission_rejected_path++;
+            reason = "path session limit";
+        } else if (limits.max_sessions_per_ip > 0 && from_ip >= limits.max_sessions_per_ip) {
+            stats_.admission_rejected_ip++;
+            reason = "client session limit";
+        } else if ((limits.max_egress_bps > 0 && egress_bps + new_bps > limits.max_egress_bps) ||
+                   (limits.max_egress_bps_per_interface > 0 &&
+                    interface_bps + new_bps > limits.max_egress_bps_per_interface)) {
+            stats_.admission_rejected_bandwidth++;
+            reason = "egress bandwidth";
+        }
+        if (reason) {
+            RTSP_LOG_WARNING("Admission rejected (" + std::string(reason) + "): " + path + " from " + client_ip);
+            return false;
+        }
+        return true;
+    }
+
+    // 各直播路径的实测码率（文件点播路径的码率在创建时已按平均码率写入）
+    void samplePathBitrates(int64_t now_ns) {
+        std::lock_guard<std::mutex> lock(paths_mutex_);
+        for (auto& path_pair : paths_) {
+            auto& path = path_pair.second;
+            if (path->file_source || !path->renditions.empty()) {
+                continue;
+            }
+            const uint64_t bytes = path->bytes_in.load(std::memory_order_relaxed);
+            if (path->bitrate_sample_ns != 0) {
+                const double seconds = (now_ns - path->bitrate_sample_ns) / 1e9;
+                path->bitrate_bps.store(static_cast<uint64_t>((bytes - path->bitrate_sample_bytes) * 8 / seconds));
+            }
+            path->bitrate_sample_bytes = bytes;
+            path->bitrate_sample_ns = now_ns;
+        }
+    }
+
+    void sampleLoad() {
+        const int64_t now_ns = steadyNowNs();
+        const uint64_t bytes = stats_.rtp_bytes_sent.load();
+        const std::clock_t cpu = std::clock();
+        if (load_sample_ns_ == 0) {
+            load_sample_ns_ = now_ns;
+            load_sample_bytes_ = bytes;
+            load_sample_clock_ = cpu;
+            return;
+        }
+        const int64_t elapsed_ns = now_ns - load_sample_ns_;
+        if (elapsed_ns < 1000000000LL) {
+            return;
+        }
+        const double seconds = elapsed_ns / 1e9;
+        samplePathBitrates(now_ns);
+        sampleQueuedUnits();
+        egress_bps_.store(static_cast<uint64_t>((bytes - load_sample_bytes_) * 8 / seconds));
+        if (cpu != static_cast<std::clock_t>(-1) && load_sample_clock_ != static_cast<std::clock_t>(-1)) {
+            const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+            const double cpu_seconds = static_cast<double>(cpu - load_sample_clock_) / CLOCKS_PER_SEC;
+            const double usage = std::min(1.0, cpu_seconds / seconds / cores);
+            cpu_usage_permille_.store(static_cast<uint32_t>(usage * 1000.0));
+        }
+        load_sample_ns_ = now_ns;
+        load_sample_bytes_ = bytes;
+        load_sample_clock_ = cpu;
+    }
+
+    // 连接线程缓存：处理完一个连接的线程留下来等下一个连接（最多 kMaxIdleConnectionThreads 个、
+    // 空闲 kIdleConnectionThreadMs 后退出），重连风暴下不必为每个连接创建/join 线程
+    static constexpr size_t kMaxIdleConnectionThreads = 32;
+    static constexpr int kIdleConnectionThreadMs = 30000;
+    struct ConnectionThread {
         std::thread thread;
-        std::shared_ptr<std::atomic<bool>> done;
+        std::shared_ptr<ThreadExit> exit;
     };
-    std::vector<ConnectionHandle> connections_;
-    
+    std::mutex connections_mutex_;
+    std::condition_variable connections_cv_;
+    std::deque<std::shared_ptr<Socket>> pending_connections_;   // 已 accept、等空闲线程接手
+    std::vector<std::shared_ptr<Socket>> active_connections_;  // 正在处理的连接（stop 时 shutdown）
+    std::vector<ConnectionThread> connection_threads_;
+    size_t idle_connection_threads_ = 0;
+
+    std::shared_ptr<SessionPools> session_pools_;
+
     std::thread cleanup_thread_;
+    std::shared_ptr<ThreadExit> cleanup_exit_;
     std::mutex cleanup_mutex_;
     std::condition_variable cleanup_cv_;
-    
+
+    void dispatchConnection(std::shared_ptr<Socket> socket) {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        pending_connections_.push_back(std::move(socket));
+        if (idle_connection_threads_ >= pending_connections_.size()) {
+            connections_cv_.notify_one();
+            return;
+        }
+        auto exit = std::make_shared<ThreadExit>();
+        connection_threads_.push_back(
+            {startThread(ThreadRole::Connection, "rtsp-conn", [this, exit]() {
+                 connectionWorker();
+                 exit->set();
+             }),
+             exit});
+    }
+
+    void connectionWorker() {
+        std::unique_lock<std::mutex> lock(connections_mutex_);
+        while (true) {
+            idle_connection_threads_++;
+            connections_cv_.wait_for(lock, std::chrono::milliseconds(kIdleConnectionThreadMs), [this] {
+                return !running_ || !pending_connections_.empty();
+            });
+            idle_connection_threads_--;
+            if (!running_ || pending_connections_.empty()) {
+                return;
+            }
+            std::shared_ptr<Socket> socket = std::move(pending_connections_.front());
+            pending_connections_.pop_front();
+            active_connections_.push_back(socket);
+            lock.unlock();
+
+            createConnection(socket)->handle();
+            socket->close();
+
+            lock.lock();
+            active_connections_.erase(std::find(active_connections_.begin(), active_connections_.end(), socket));
+            if (idle_connection_threads_ >= kMaxIdleConnectionThreads) {
+                return;
+            }
+        }
+    }
+
+    // join 已退出的连接线程（空闲超时或超出缓存上限）
     void cleanupFinishedConnections() {
-        std::vector<ConnectionHandle> finished;
+        std::vector<ConnectionThread> finished;
         {
             std::lock_guard<std::mutex> lock(connections_mutex_);
-            for (auto it = connections_.begin(); it != connections_.end();) {
-                if (it->done && it->done->load()) {
-                    finished.push_back({std::move(it->socket), std::move(it->thread), std::move(it->done)});
-                    it = connections_.erase(it);
+            for (auto it = connection_threads_.begin(); it != connection_threads_.end();) {
+                if (it->exit->isSet()) {
+                    finished.push_back(std::move(*it));
+                    it = connection_threads_.erase(it);
                 } else {
                     ++it;
                 }
@@ -1885,12 +3881,55 @@ public:
         }
 
         for (auto& handle : finished) {
-            if (handle.socket) {
-                handle.socket->close();
-                handle.socket.reset();
+            handle.thread.join();
+        }
+    }
+
+    // 清理超时会话：先在锁下收集过期的 shared_ptr 与断连信息，
+    // 再完全脱离 paths_mutex_/sessions_mutex 之后调用 session->stop()。
+    // 这样即使 stop() 等待的发送 worker 被 TCP 对端阻塞，也不会占着大锁
+    // 导致其他请求、推流、清理全部挂死。
+    void expireSessions() {
+        std::vector<std::shared_ptr<ClientSession>> expired_sessions;
+        std::vector<std::pair<std::string, std::string>> disconnects;
+        {
+            std::lock_guard<std::mutex> lock(paths_mutex_);
+            const int64_t now_ns = steadyNowNs();
+            const int64_t timeout_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                           std::chrono::milliseconds(config_.session_timeout_ms))
+                                           .count();
+            for (auto& path_pair : paths_) {
+                auto& path = path_pair.second;
+                std::lock_guard<std::mutex> session_lock(path->sessions_mutex);
+                for (auto it = path->sessions.begin(); it != path->sessions.end();) {
+                    const int64_t last_activity_ns =
+                        it->second->last_activity_ns.load(std::memory_order_relaxed);
+                    if (last_activity_ns != 0 && now_ns - last_activity_ns > timeout_ns) {
+                        // 码率组会话同时挂在组路径与各档位路径上，只在组路径上计数/回调一次
+                        if (it->second->path == path->path) {
+                            RTSP_LOG_INFO("Session timeout: " + it->first);
+                            expired_sessions.push_back(it->second);
+                            stats_.sessions_closed++;
+                            if (it->second->role == SessionRole::Player) {
+                                disconnects.emplace_back(path->path, it->second->client_ip);
+                            }
+                        }
+                        path->onViewerRemoved(*it->second);
+                        it = path->sessions.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
             }
-            if (handle.thread.joinable()) {
-                handle.thread.join();
+        }
+        // 锁外 stop（等发送 worker 发完当前单元），即使 send 被阻塞也不会牵连全局
+        for (auto& session : expired_sessions) {
+            session->stop();
+            releaseAnnouncedPaths(paths_, paths_mutex_, *session);
+        }
+        for (const auto& d : disconnects) {
+            if (disconnect_callback_) {
+                disconnect_callback_(d.first, d.second);
             }
         }
     }
@@ -1907,229 +3946,793 @@ public:
             wait_lock.unlock();
 
             cleanupFinishedConnections();
-            
-            // 清理超时会话：先在锁下收集过期的 shared_ptr 与断连信息，
-            // 再完全脱离 paths_mutex_/sessions_mutex 之后调用 session->stop()。
-            // 这样即使 stop() 里 join 的发送线程被 TCP 对端阻塞，也不会占着大锁
-            // 导致其他请求、推流、清理全部挂死。
-            std::vector<std::shared_ptr<ClientSession>> expired_sessions;
-            std::vector<std::pair<std::string, std::string>> disconnects;
-            {
-                std::lock_guard<std::mutex> lock(paths_mutex_);
-                const int64_t now_ns = steadyNowNs();
-                const int64_t timeout_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                                               std::chrono::milliseconds(config_.session_timeout_ms))
-                                               .count();
-                for (auto& path_pair : paths_) {
-                    auto& path = path_pair.second;
-                    std::lock_guard<std::mutex> session_lock(path->sessions_mutex);
-                    for (auto it = path->sessions.begin(); it != path->sessions.end();) {
-                        const int64_t last_activity_ns =
-                            it->second->last_activity_ns.load(std::memory_order_relaxed);
-                        if (last_activity_ns != 0 && now_ns - last_activity_ns > timeout_ns) {
-                            RTSP_LOG_INFO("Session timeout: " + it->first);
-                            expired_sessions.push_back(it->second);
-                            stats_.sessions_closed++;
-                            if (it->second->role == SessionRole::Player) {
-                                disconnects.emplace_back(path->path, it->second->client_ip);
-                            }
-                            it = path->sessions.erase(it);
-                        } else {
-                            ++it;
-                        }
-                    }
-                }
+            sampleLoad();
+            expireSessions();
+        }
+
+        cleanupFinishedConnections();
+    }
+
+    std::unique_ptr<RtspConnection> createConnection(std::shared_ptr<Socket> socket,
+                                                     std::shared_ptr<ConnectionOutput> output = nullptr) {
+        return std::make_unique<RtspConnection>(
+            std::move(socket), paths_, paths_mutex_, config_, connect_callback_, disconnect_callback_, stats_,
+            [this](const std::string& path, const std::string& target, std::string& location) {
+                return checkRedirect(path, target, location);
+            },
+            [this](const std::string& path, const std::string& client_ip, const std::string& local_ip) {
+                return checkAdmission(path, client_ip, local_ip);
+            },
+            session_pools_, viewer_counters_, std::move(output));
+    }
+
+    // 单线程模式（config_.single_threaded）下需要内部线程的功能不可用
+    bool rejectSingleThreaded(const char* feature) {
+        if (!config_.single_threaded) {
+            return false;
+        }
+        RTSP_LOG_ERROR(std::string(feature) + " is not available in single-threaded mode");
+        return true;
+    }
+
+    // 单线程模式：监听 socket 与全部连接由应用线程调用 processEvents 驱动，
+    // 不创建连接线程、发送线程与清理线程
+    struct PolledConnection {
+        std::shared_ptr<Socket> socket;
+        std::shared_ptr<ConnectionOutput> output;
+        std::unique_ptr<RtspConnection> connection;
+        bool closed = false;
+    };
+    std::unique_ptr<Socket> listen_socket_;
+    std::vector<std::unique_ptr<PolledConnection>> polled_connections_;
+    int64_t next_housekeeping_ns_ = 0;
+    static constexpr int64_t kHousekeepingIntervalNs = 100000000;  // 与清理线程相同的 100ms 节奏
+
+    bool startPolled() {
+        listen_socket_ = std::make_unique<Socket>();
+        if (!listen_socket_->bind(config_.host, config_.port) || !listen_socket_->listen() ||
+            !listen_socket_->setNonBlocking(true)) {
+            listen_socket_.reset();
+            return false;
+        }
+        next_housekeeping_ns_ = steadyNowNs();
+        return true;
+    }
+
+    void acceptPolled() {
+        while (auto socket = listen_socket_->accept()) {
+            socket->setNonBlocking(true);
+            auto polled = std::make_unique<PolledConnection>();
+            polled->socket = std::shared_ptr<Socket>(std::move(socket));
+            polled->output = std::make_shared<ConnectionOutput>();
+            polled->connection = createConnection(polled->socket, polled->output);
+            polled_connections_.push_back(std::move(polled));
+        }
+    }
+
+    void readPolled(PolledConnection& polled) {
+        uint8_t temp[4096];
+        // 每轮最多读 64KB，避免一个连接独占事件循环
+        for (int i = 0; i < 16; ++i) {
+            const ssize_t n = polled.socket->recvSome(temp, sizeof(temp));
+            if (n < 0 || (n > 0 && !polled.connection->consume(temp, static_cast<size_t>(n)))) {
+                polled.closed = true;
+                return;
             }
-            // 锁外 stop（join 发送线程），即使 send 被阻塞也不会牵连全局
-            for (auto& session : expired_sessions) {
-                session->stop();
+            if (n < static_cast<ssize_t>(sizeof(temp))) {
+                return;
             }
-            for (const auto& d : disconnects) {
-                if (disconnect_callback_) {
-                    disconnect_callback_(d.first, d.second);
-                }
+        }
+    }
+
+    void flushPolled(PolledConnection& polled) {
+        if (!polled.output->flushTo(*polled.socket)) {
+            polled.closed = true;
+        }
+    }
+
+    static bool hasQueuedMedia(const std::shared_ptr<ClientSession>& session) {
+        if (!session || session->role != SessionRole::Player || !session->playing) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(session->queue_mutex);
+        return !session->frame_queue.empty();
+    }
+
+    int polledDeadlineMs() const {
+        for (const auto& polled : polled_connections_) {
+            if (hasQueuedMedia(polled->connection->session())) {
+                return 0;
+            }
+        }
+        const int64_t remain_ns = next_housekeeping_ns_ - steadyNowNs();
+        return remain_ns <= 0 ? 0 : static_cast<int>((remain_ns + 999999) / 1000000);
+    }
+
+    std::vector<PollDescriptor> polledDescriptors() const {
+        std::vector<PollDescriptor> descriptors;
+        if (!listen_socket_) {
+            return descriptors;
+        }
+        PollDescriptor listen;
+        listen.fd = listen_socket_->getFd();
+        descriptors.push_back(listen);
+        for (const auto& polled : polled_connections_) {
+            PollDescriptor descriptor;
+            descriptor.fd = polled->socket->getFd();
+            descriptor.writable = !polled->output->data.empty();
+            descriptors.push_back(descriptor);
+        }
+        return descriptors;
+    }
+
+    int processPolled(int wait_ms) {
+        Selector selector;
+        for (const auto& descriptor : polledDescriptors()) {
+            selector.addRead(descriptor.fd);
+            if (descriptor.writable) {
+                selector.addWrite(descriptor.fd);
+            }
+        }
+        const int ready = std::max(0, selector.wait(wait_ms));
+
+        // 新连接排在末尾，本轮不在 selector 中，下一轮再读
+        const size_t existing = polled_connections_.size();
+        if (ready > 0 && selector.isReadable(listen_socket_->getFd())) {
+            acceptPolled();
+        }
+        for (size_t i = 0; i < existing; ++i) {
+            PolledConnection& polled = *polled_connections_[i];
+            const int fd = polled.socket->getFd();
+            if (ready > 0 && (selector.isReadable(fd) || selector.hasError(fd))) {
+                readPolled(polled);
+            }
+        }
+        // 推流线程（即调用线程）入队的帧在这里打包发送，随后统一写出待发缓冲
+        for (auto& polled : polled_connections_) {
+            const auto& session = polled->connection->session();
+            if (!polled->closed && hasQueuedMedia(session)) {
+                session->drainQueue();
+            }
+            if (!polled->closed && !polled->output->data.empty()) {
+                flushPolled(*polled);
+            }
+        }
+
+        const int64_t now_ns = steadyNowNs();
+        if (now_ns >= next_housekeeping_ns_) {
+            sampleLoad();
+            expireSessions();
+            next_housekeeping_ns_ = now_ns + kHousekeepingIntervalNs;
+        }
+
+        for (auto it = polled_connections_.begin(); it != polled_connections_.end();) {
+            if ((*it)->closed) {
+                closePolled(**it);
+                it = polled_connections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return ready;
+    }
+
+    void closePolled(PolledConnection& polled) {
+        polled.connection->releaseSession();
+        polled.connection.reset();
+        polled.socket->close();
+    }
+
+    void stopPolled() {
+        for (auto& polled : polled_connections_) {
+            closePolled(*polled);
+        }
+        polled_connections_.clear();
+        if (listen_socket_) {
+            listen_socket_->close();
+            listen_socket_.reset();
+        }
+    }
+};
+
+uint16_t RtspServerConfig::getNextRtpPort(uint32_t& current, uint32_t start, uint32_t end) {
+    // 用全局 mutex 序列化并发 SETUP 的端口分配，避免两路会话拿到同一对端口。
+    // 端口池本身是系统全局资源，全局锁是合适粒度。
+    static std::mutex port_allocation_mutex;
+    std::lock_guard<std::mutex> lock(port_allocation_mutex);
+    if (start >= end) {
+        // 非法区间，退化为 current 原值并自增以便调用方 bind 失败后进入重试路径
+        uint16_t port = static_cast<uint16_t>(current);
+        current += 2;
+        return port;
+    }
+    if (current < start || current + 1 >= end) {
+        current = start;
+    }
+    uint16_t port = static_cast<uint16_t>(current);
+    current += 2;
+    if (current + 1 >= end) {
+        current = start;
+    }
+    return port;
+}
+
+RtspServer::RtspServer() : impl_(std::make_unique<Impl>()) {}
+RtspServer::~RtspServer() {
+    stop();
+}
+
+bool RtspServer::init(const RtspServerConfig& config) {
+    impl_->config_ = config;
+    return true;
+}
+
+bool RtspServer::init(const std::string& host, uint16_t port) {
+    impl_->config_.host = host;
+    impl_->config_.port = port;
+    return true;
+}
+
+bool RtspServer::start() {
+    if (impl_->running_) return false;
+
+    impl_->session_pools_ = std::make_shared<SessionPools>();
+    if (impl_->config_.udp_port_pool_size > 0) {
+        impl_->session_pools_->senders = std::make_shared<RtpSenderPool>(impl_->config_.udp_port_pool_size);
+    }
+
+    if (impl_->config_.single_threaded) {
+        if (!impl_->startPolled()) {
+            RTSP_LOG_ERROR("Failed to start RTSP server on " + impl_->config_.host +
+                           ":" + std::to_string(impl_->config_.port));
+            return false;
+        }
+        impl_->running_ = true;
+        RTSP_LOG_INFO("RTSP server started (single-threaded) on " + impl_->config_.host +
+                      ":" + std::to_string(impl_->config_.port));
+        return true;
+    }
+    
+    uint32_t send_threads = impl_->config_.send_threads;
+    if (send_threads == 0) {
+        send_threads = std::max(2u, std::thread::hardware_concurrency());
+    }
+    impl_->session_pools_->send_workers = std::make_shared<SendWorkerPool>(send_threads);
+
+    uint32_t ingest_threads = impl_->config_.ingest_threads;
+    if (ingest_threads == 0) {
+        ingest_threads = std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+    }
+    impl_->session_pools_->ingest_threads = ingest_threads;
+    if (impl_->config_.shared_ingest_port != 0 &&
+        !impl_->session_pools_->ingestPool()->bindShared(impl_->config_.host, impl_->config_.shared_ingest_port)) {
+        RTSP_LOG_ERROR("Failed to bind shared ingest port " + std::to_string(impl_->config_.shared_ingest_port));
+        impl_->session_pools_.reset();
+        return false;
+    }
+
+    impl_->tcp_server_ = std::make_unique<TcpServer>();
+    
+    impl_->tcp_server_->setNewConnectionCallback([this](std::unique_ptr<Socket> socket) {
+        impl_->dispatchConnection(std::shared_ptr<Socket>(std::move(socket)));
+    });
+    
+    // 连接线程以 running_ 判断是否继续等待，须在第一个连接到来之前置位
+    impl_->running_ = true;
+    if (!impl_->tcp_server_->start(impl_->config_.host, impl_->config_.port)) {
+        RTSP_LOG_ERROR("Failed to start RTSP server on " + impl_->config_.host + 
+                       ":" + std::to_string(impl_->config_.port));
+        impl_->running_ = false;
+        impl_->session_pools_.reset();
+        return false;
+    }
+    
+    impl_->cleanup_exit_ = std::make_shared<ThreadExit>();
+    impl_->cleanup_thread_ = startThread(ThreadRole::Background, "rtsp-cleanup", [this, exit = impl_->cleanup_exit_]() {
+        impl_->cleanupLoop();
+        exit->set();
+    });
+    
+    RTSP_LOG_INFO("RTSP server started on " + impl_->config_.host + 
+                  ":" + std::to_string(impl_->config_.port));
+    
+    return true;
+}
+
+void RtspServer::stop() {
+    stopWithTimeout(5000);
+}
+
+bool RtspServer::stopWithTimeout(uint32_t timeout_ms) {
+    const auto begin = std::chrono::steady_clock::now();
+    RTSP_LOG_INFO("RtspServer stop start, timeout_ms=" + std::to_string(timeout_ms));
+    impl_->running_ = false;
+    impl_->cleanup_cv_.notify_all();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    
+    if (impl_->tcp_server_) {
+        impl_->tcp_server_->stop();
+    }
+    impl_->stopPolled();
+    
+    std::vector<Impl::ConnectionThread> connections;
+    {
+        std::lock_guard<std::mutex> lock(impl_->connections_mutex_);
+        for (auto& socket : impl_->active_connections_) {
+            // 先 shutdown 让连接线程里阻塞中的 recv 立刻返回；close 留给连接
+            // 线程自己执行。这样避免"主线程 close(fd) 同时另一线程还在 recv(fd)"
+            // 的 fd 并发使用（TSan 会判为数据竞争，OS 层虽安全但不干净）。
+            socket->shutdownReadWrite();
+        }
+        // 尚未被接手的连接直接关闭；空闲线程看到 running_ 为假后退出
+        for (auto& socket : impl_->pending_connections_) {
+            socket->close();
+        }
+        impl_->pending_connections_.clear();
+        impl_->connections_cv_.notify_all();
+        connections = std::move(impl_->connection_threads_);
+        impl_->connection_threads_.clear();
+    }
+    bool all_joined = true;
+    for (auto& c : connections) {
+        uint32_t remain = 0;
+        auto now = std::chrono::steady_clock::now();
+        if (now < deadline) {
+            remain = static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+        }
+        if (!joinThreadWithTimeout(c.thread, c.exit, remain)) {
+            all_joined = false;
+            RTSP_LOG_ERROR("RtspServer stop timeout: connection thread still alive (blocking: RTSP connection loop)");
+        }
+    }
+
+    {
+        uint32_t remain = 0;
+        auto now = std::chrono::steady_clock::now();
+        if (now < deadline) {
+            remain = static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+        }
+        if (!joinThreadWithTimeout(impl_->cleanup_thread_, impl_->cleanup_exit_, remain)) {
+            all_joined = false;
+            RTSP_LOG_ERROR("RtspServer stop timeout: cleanup_thread still alive (blocking: cleanup loop sleep/wait)");
+        }
+    }
+    
+    impl_->hls_server_.stop();
+
+    // 清理所有路径（在锁外析构，录像器可能需要写完积压数据）
+    std::map<std::string, std::shared_ptr<MediaPath>> paths;
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        paths.swap(impl_->paths_);
+    }
+    for (const auto& entry : paths) {
+        if (entry.second->relay) {
+            entry.second->relay->stop();
+        }
+        impl_->hls_server_.removePackager(entry.first);
+    }
+    paths.clear();
+    // 会话都已停止：发送工作池随最后一个持有者析构（join rtsp-send 线程），端口池关闭空闲端口
+    impl_->session_pools_.reset();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin).count();
+    RTSP_LOG_INFO("RtspServer stop done, elapsed_ms=" + std::to_string(elapsed));
+    return all_joined;
+}
+
+bool RtspServer::isRunning() const {
+    return impl_->running_;
+}
+
+std::vector<PollDescriptor> RtspServer::getPollDescriptors() const {
+    if (!impl_->config_.single_threaded || !impl_->running_) {
+        return {};
+    }
+    return impl_->polledDescriptors();
+}
+
+int RtspServer::processEvents(int timeout_ms) {
+    if (!impl_->config_.single_threaded || !impl_->running_) {
+        return -1;
+    }
+    int wait_ms = impl_->polledDeadlineMs();
+    if (timeout_ms >= 0 && timeout_ms < wait_ms) {
+        wait_ms = timeout_ms;
+    }
+    return impl_->processPolled(wait_ms);
+}
+
+int RtspServer::nextTimerDeadline() const {
+    if (!impl_->config_.single_threaded || !impl_->running_) {
+        return -1;
+    }
+    return impl_->polledDeadlineMs();
+}
+
+bool RtspServer::addPath(const PathConfig& config) {
+    if (config.timeshift_max_bytes > 0 && impl_->rejectSingleThreaded("Time-shift")) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+    
+    if (impl_->paths_.find(config.path) != impl_->paths_.end()) {
+        return false;
+    }
+    
+    auto path = std::make_shared<MediaPath>();
+    path->path = config.path;
+    path->viewer_counters = impl_->viewer_counters_;
+    path->config = config;
+    applySpsInfo(path->config);
+    if (config.timeshift_max_bytes > 0) {
+        if (!impl_->playback_scheduler_) {
+            impl_->playback_scheduler_ = std::make_shared<PlaybackScheduler>();
+        }
+        path->timeshift = std::make_shared<TimeShiftBuffer>(config.timeshift_max_bytes);
+        path->scheduler = impl_->playback_scheduler_;
+    }
+    
+    impl_->paths_[config.path] = path;
+    
+    RTSP_LOG_INFO("Added path: " + config.path);
+    return true;
+}
+
+bool RtspServer::addFilePath(const FilePathConfig& config) {
+    if (config.path.empty() || impl_->rejectSingleThreaded("File playback")) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        if (impl_->paths_.find(config.path) != impl_->paths_.end()) {
+            return false;
+        }
+    }
+
+    // 映射与建索引可能要扫描整个文件，放在 paths_mutex_ 之外
+    auto source = FileSource::open(config);
+    if (!source) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+    if (impl_->paths_.find(config.path) != impl_->paths_.end()) {
+        return false;
+    }
+    if (!impl_->playback_scheduler_) {
+        impl_->playback_scheduler_ = std::make_shared<PlaybackScheduler>();
+    }
+    auto path = std::make_shared<MediaPath>();
+    path->path = config.path;
+    path->viewer_counters = impl_->viewer_counters_;
+    path->config = source->pathConfig();
+    applySpsInfo(path->config);
+    path->file_source = source;
+    path->scheduler = impl_->playback_scheduler_;
+    if (source->durationMs() > 0) {
+        uint64_t total_bytes = 0;
+        for (const auto& entry : source->entries()) {
+            total_bytes += entry.size;
+        }
+        path->bitrate_bps = total_bytes * 8 * 1000 / source->durationMs();
+    }
+    impl_->paths_[config.path] = path;
+
+    RTSP_LOG_INFO("Added file path: " + config.path + " -> " + config.file + " (" +
+                  std::to_string(source->entries().size()) + " access units, index " +
+                  (source->indexLoaded() ? "loaded" : "built") + ")");
+    return true;
+}
+
+bool RtspServer::addRelayPath(const RelayPathConfig& config) {
+    if (config.path.empty() || config.url.empty() || impl_->rejectSingleThreaded("Relay")) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+    if (impl_->paths_.find(config.path) != impl_->paths_.end()) {
+        return false;
+    }
+
+    auto path = std::make_shared<MediaPath>();
+    path->path = config.path;
+    path->viewer_counters = impl_->viewer_counters_;
+    path->config.path = config.path;
+    std::weak_ptr<MediaPath> weak_path = path;
+    ServerStatsAtomic* stats = &impl_->stats_;
+
+    RelaySource::Callbacks callbacks;
+    callbacks.on_describe = [weak_path](const MediaInfo& info) {
+        auto media_path = weak_path.lock();
+        if (!media_path) {
+            return;
+        }
+        std::lock_guard<std::mutex> cfg_lock(media_path->config_mutex);
+        PathConfig& cached = media_path->config;
+        cached.codec = info.codec;
+        cached.width = info.width;
+        cached.height = info.height;
+        cached.fps = info.fps;
+        cached.profile_idc = info.profile_idc;
+        cached.level_idc = info.level_idc;
+        cached.high_tier = info.high_tier;
+        if (!info.sps.empty()) {
+            cached.sps = info.sps;
+        }
+        if (!info.pps.empty()) {
+            cached.pps = info.pps;
+        }
+        if (!info.vps.empty()) {
+            cached.vps = info.vps;
+        }
+    };
+    // IDR 上刷新参数集缓存，然后广播。上游 RtspClient 交付的帧由 managed_data 持有且之后不再改写，
+    // 与推流收流一样直接共享，不再拷贝；时间戳在本地副本上补齐
+    callbacks.on_frame = [weak_path, stats](const VideoFrame& frame) {
+        auto media_path = weak_path.lock();
+        if (!media_path) {
+            return;
+        }
+        if (frame.type == FrameType::IDR) {
+            std::lock_guard<std::mutex> cfg_lock(media_path->config_mutex);
+            if (media_path->config.codec == CodecType::H264) {
+                autoExtractH264ParameterSets(media_path->config, frame.data, frame.size);
+            } else {
+                autoExtractH265ParameterSets(media_path->config, frame.data, frame.size);
+            }
+        }
+        VideoFrame shared = frame.managed_data ? frame : cloneFrameManaged(frame);
+        normalizeTimestamps(shared);
+        media_path->broadcastSharedFrame(shared);
+        stats->frames_pushed++;
+    };
+    callbacks.on_upstream_stopped = [weak_path]() {
+        if (auto media_path = weak_path.lock()) {
+            media_path->clearLatestFrame();
+        }
+    };
+    callbacks.viewers = [weak_path]() -> size_t {
+        auto media_path = weak_path.lock();
+        if (!media_path) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> session_lock(media_path->sessions_mutex);
+        return media_path->sessions.size();
+    };
+    path->relay = std::make_shared<RelaySource>(config, std::move(callbacks));
+    path->relay->start();
+    impl_->paths_[config.path] = path;
+
+    RTSP_LOG_INFO("Added relay path: " + config.path);
+    return true;
+}
+
+bool RtspServer::getRelayStats(const std::string& path, RelayStats& stats) const {
+    std::shared_ptr<MediaPath> media_path;
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        auto it = impl_->paths_.find(path);
+        if (it == impl_->paths_.end() || !it->second->relay) {
+            return false;
+        }
+        media_path = it->second;
+    }
+    stats = media_path->relay->stats();
+    return true;
+}
+
+bool RtspServer::addPath(const std::string& path, CodecType codec) {
+    PathConfig config;
+    config.path = path;
+    config.codec = codec;
+    return addPath(config);
+}
+
+bool RtspServer::removePath(const std::string& path) {
+    // 路径析构可能要等录像器写完积压数据，放到 paths_mutex_ 之外
+    std::shared_ptr<MediaPath> removed;
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        auto it = impl_->paths_.find(path);
+        if (it == impl_->paths_.end()) {
+            return false;
+        }
+        // 码率组持有档位路径的引用，删掉后组内会话会停在该档位上收不到帧
+        for (const auto& entry : impl_->paths_) {
+            const auto& renditions = entry.second->renditions;
+            if (std::find(renditions.begin(), renditions.end(), it->second) != renditions.end()) {
+                RTSP_LOG_ERROR("Path " + path + " is a rendition of group " + entry.first +
+                               "; remove the group first");
+                return false;
             }
         }
-
-        cleanupFinishedConnections();
+        removed = std::move(it->second);
+        impl_->paths_.erase(it);
     }
-};
-
-uint16_t RtspServerConfig::getNextRtpPort(uint32_t& current, uint32_t start, uint32_t end) {
-    // 用全局 mutex 序列化并发 SETUP 的端口分配，避免两路会话拿到同一对端口。
-    // 端口池本身是系统全局资源，全局锁是合适粒度。
-    static std::mutex port_allocation_mutex;
-    std::lock_guard<std::mutex> lock(port_allocation_mutex);
-    if (start >= end) {
-        // 非法区间，退化为 current 原值并自增以便调用方 bind 失败后进入重试路径
-        uint16_t port = static_cast<uint16_t>(current);
-        current += 2;
-        return port;
+    // 先停上游：转发线程的回调里可能临时持有路径引用
+    if (removed->relay) {
+        removed->relay->stop();
     }
-    if (current < start || current + 1 >= end) {
-        current = start;
+    impl_->hls_server_.removePackager(path);
+    return true;
+}
+
+bool RtspServer::addRenditionGroup(const RenditionGroupConfig& config) {
+    if (config.path.empty() || config.renditions.empty()) {
+        return false;
     }
-    uint16_t port = static_cast<uint16_t>(current);
-    current += 2;
-    if (current + 1 >= end) {
-        current = start;
+    std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+    if (impl_->paths_.find(config.path) != impl_->paths_.end()) {
+        return false;
     }
-    return port;
-}
 
-RtspServer::RtspServer() : impl_(std::make_unique<Impl>()) {}
-RtspServer::~RtspServer() {
-    stop();
-}
+    auto group = std::make_shared<MediaPath>();
+    group->path = config.path;
+    group->viewer_counters = impl_->viewer_counters_;
+    group->rendition_policy = config;
+    for (const auto& rendition_path : config.renditions) {
+        auto it = impl_->paths_.find(rendition_path);
+        if (it == impl_->paths_.end() || !it->second->isLive()) {
+            RTSP_LOG_ERROR("Invalid rendition path (missing, a group or a file path): " + rendition_path);
+            return false;
+        }
+        group->renditions.push_back(it->second);
+    }
+    group->config = group->snapshotConfig();
+    for (const auto& rendition : group->renditions) {
+        if (rendition->snapshotConfig().codec != group->config.codec) {
+            RTSP_LOG_ERROR("Rendition group requires a single codec: " + config.path);
+            return false;
+        }
+    }
 
-bool RtspServer::init(const RtspServerConfig& config) {
-    impl_->config_ = config;
+    impl_->paths_[config.path] = group;
+    RTSP_LOG_INFO("Added rendition group: " + config.path + " (" +
+                  std::to_string(config.renditions.size()) + " renditions)");
     return true;
 }
 
-bool RtspServer::init(const std::string& host, uint16_t port) {
-    impl_->config_.host = host;
-    impl_->config_.port = port;
+bool RtspServer::startRecording(const std::string& path, const RecordConfig& config) {
+    if (impl_->rejectSingleThreaded("Recording")) {
+        return false;
+    }
+    std::shared_ptr<MediaPath> media_path;
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        auto it = impl_->paths_.find(path);
+        if (it == impl_->paths_.end() || !it->second->isLive()) {
+            return false;
+        }
+        media_path = it->second;
+    }
+
+    auto recorder = std::make_shared<PathRecorder>(path, media_path->snapshotConfig(), config);
+    {
+        std::lock_guard<std::mutex> lock(media_path->sessions_mutex);
+        if (media_path->recorder) {
+            return false;
+        }
+        if (!recorder->start()) {
+            return false;
+        }
+        media_path->recorder = recorder;
+    }
+    RTSP_LOG_INFO("Started recording path: " + path + " -> " + config.directory);
     return true;
 }
 
-bool RtspServer::start() {
-    if (impl_->running_) return false;
-    
-    impl_->tcp_server_ = std::make_unique<TcpServer>();
-    
-    impl_->tcp_server_->setNewConnectionCallback([this](std::unique_ptr<Socket> socket) {
-        auto shared_socket = std::shared_ptr<Socket>(std::move(socket));
-        auto done = std::make_shared<std::atomic<bool>>(false);
-        std::thread conn_thread([this, s = shared_socket, done]() mutable {
-            RtspConnection conn(s, impl_->paths_, impl_->paths_mutex_, impl_->config_,
-                                impl_->connect_callback_, impl_->disconnect_callback_,
-                                impl_->stats_);
-            conn.handle();
-            if (s) {
-                s->close();
-            }
-            done->store(true);
-        });
-        {
-            std::lock_guard<std::mutex> lock(impl_->connections_mutex_);
-            impl_->connections_.push_back({shared_socket, std::move(conn_thread), done});
+bool RtspServer::stopRecording(const std::string& path) {
+    std::shared_ptr<MediaPath> media_path;
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        auto it = impl_->paths_.find(path);
+        if (it == impl_->paths_.end()) {
+            return false;
         }
-    });
-    
-    if (!impl_->tcp_server_->start(impl_->config_.host, impl_->config_.port)) {
-        RTSP_LOG_ERROR("Failed to start RTSP server on " + impl_->config_.host + 
-                       ":" + std::to_string(impl_->config_.port));
+        media_path = it->second;
+    }
+
+    std::shared_ptr<PathRecorder> recorder;
+    {
+        std::lock_guard<std::mutex> lock(media_path->sessions_mutex);
+        recorder = std::move(media_path->recorder);
+    }
+    if (!recorder) {
         return false;
     }
-    
-    impl_->running_ = true;
-    impl_->cleanup_thread_ = std::thread([this]() {
-        impl_->cleanupLoop();
-    });
-    
-    RTSP_LOG_INFO("RTSP server started on " + impl_->config_.host + 
-                  ":" + std::to_string(impl_->config_.port));
-    
+    // 摘下后再停：写线程排空积压期间不阻塞广播
+    recorder->stop();
+    RTSP_LOG_INFO("Stopped recording path: " + path);
     return true;
 }
 
-void RtspServer::stop() {
-    stopWithTimeout(5000);
+bool RtspServer::startHlsServer(uint16_t port, const std::string& host) {
+    if (impl_->rejectSingleThreaded("HLS")) {
+        return false;
+    }
+    return impl_->hls_server_.start(host, port);
 }
 
-bool RtspServer::stopWithTimeout(uint32_t timeout_ms) {
-    const auto begin = std::chrono::steady_clock::now();
-    RTSP_LOG_INFO("RtspServer stop start, timeout_ms=" + std::to_string(timeout_ms));
-    impl_->running_ = false;
-    impl_->cleanup_cv_.notify_all();
-    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
-    
-    if (impl_->tcp_server_) {
-        impl_->tcp_server_->stop();
+void RtspServer::stopHlsServer() {
+    impl_->hls_server_.stop();
+}
+
+bool RtspServer::startHls(const std::string& path, const HlsConfig& config) {
+    if (config.part_duration_ms == 0 || config.segment_count == 0) {
+        return false;
     }
-    
-    std::vector<Impl::ConnectionHandle> connections;
+    std::shared_ptr<MediaPath> media_path;
     {
-        std::lock_guard<std::mutex> lock(impl_->connections_mutex_);
-        for (auto& c : impl_->connections_) {
-            if (c.socket) {
-                // 先 shutdown 让连接线程里阻塞中的 recv 立刻返回；close 留给连接
-                // 线程自己执行。这样避免"主线程 close(fd) 同时另一线程还在 recv(fd)"
-                // 的 fd 并发使用（TSan 会判为数据竞争，OS 层虽安全但不干净）。
-                c.socket->shutdownReadWrite();
-            }
-        }
-        connections = std::move(impl_->connections_);
-        impl_->connections_.clear();
-    }
-    bool all_joined = true;
-    for (auto& c : connections) {
-        uint32_t remain = 0;
-        auto now = std::chrono::steady_clock::now();
-        if (now < deadline) {
-            remain = static_cast<uint32_t>(
-                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
-        }
-        if (!joinThreadWithTimeout(c.thread, remain)) {
-            all_joined = false;
-            RTSP_LOG_ERROR("RtspServer stop timeout: connection thread still alive (blocking: RTSP connection loop)");
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        auto it = impl_->paths_.find(path);
+        if (it == impl_->paths_.end() || !it->second->isLive()) {
+            return false;
         }
+        media_path = it->second;
     }
 
+    auto packager = std::make_shared<HlsPackager>(path, media_path->snapshotConfig(), config);
+    packager->start();
     {
-        uint32_t remain = 0;
-        auto now = std::chrono::steady_clock::now();
-        if (now < deadline) {
-            remain = static_cast<uint32_t>(
-                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
-        }
-        if (!joinThreadWithTimeout(impl_->cleanup_thread_, remain)) {
-            all_joined = false;
-            RTSP_LOG_ERROR("RtspServer stop timeout: cleanup_thread still alive (blocking: cleanup loop sleep/wait)");
+        std::lock_guard<std::mutex> lock(media_path->sessions_mutex);
+        if (media_path->hls) {
+            return false;
         }
+        media_path->hls = packager;
     }
-    
-    // 清理所有路径
-    std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
-    impl_->paths_.clear();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now() - begin).count();
-    RTSP_LOG_INFO("RtspServer stop done, elapsed_ms=" + std::to_string(elapsed));
-    return all_joined;
+    impl_->hls_server_.addPackager(path, packager);
+    RTSP_LOG_INFO("Started HLS for path: " + path);
+    return true;
 }
 
-bool RtspServer::isRunning() const {
-    return impl_->running_;
-}
+bool RtspServer::stopHls(const std::string& path) {
+    std::shared_ptr<MediaPath> media_path;
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        auto it = impl_->paths_.find(path);
+        if (it == impl_->paths_.end()) {
+            return false;
+        }
+        media_path = it->second;
+    }
 
-bool RtspServer::addPath(const PathConfig& config) {
-    std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
-    
-    if (impl_->paths_.find(config.path) != impl_->paths_.end()) {
+    std::shared_ptr<HlsPackager> packager;
+    {
+        std::lock_guard<std::mutex> lock(media_path->sessions_mutex);
+        packager = std::move(media_path->hls);
+    }
+    if (!packager) {
         return false;
     }
-    
-    auto path = std::make_shared<MediaPath>();
-    path->path = config.path;
-    path->config = config;
-    
-    impl_->paths_[config.path] = path;
-    
-    RTSP_LOG_INFO("Added path: " + config.path);
+    impl_->hls_server_.removePackager(path);
+    packager->stop();
+    RTSP_LOG_INFO("Stopped HLS for path: " + path);
     return true;
 }
 
-bool RtspServer::addPath(const std::string& path, CodecType codec) {
-    PathConfig config;
-    config.path = path;
-    config.codec = codec;
-    return addPath(config);
-}
+bool RtspServer::getRecordStats(const std::string& path, RecordStats& stats) const {
+    std::shared_ptr<MediaPath> media_path;
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        auto it = impl_->paths_.find(path);
+        if (it == impl_->paths_.end()) {
+            return false;
+        }
+        media_path = it->second;
+    }
 
-bool RtspServer::removePath(const std::string& path) {
-    std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
-    return impl_->paths_.erase(path) > 0;
+    std::shared_ptr<PathRecorder> recorder;
+    {
+        std::lock_guard<std::mutex> lock(media_path->sessions_mutex);
+        recorder = media_path->recorder;
+    }
+    if (!recorder) {
+        return false;
+    }
+    stats = recorder->stats();
+    return true;
 }
 
 std::vector<PathConfig> RtspServer::getPathsSnapshot() const {
@@ -2150,7 +4753,7 @@ bool RtspServer::pushFrame(const std::string& path, const VideoFrame& frame) {
     {
         std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
         auto it = impl_->paths_.find(path);
-        if (it == impl_->paths_.end()) {
+        if (it == impl_->paths_.end() || !it->second->acceptsPush()) {  // 码率组、文件、转发路径不接受推流
             return false;
         }
         media_path = it->second;
@@ -2175,7 +4778,7 @@ bool RtspServer::pushH264Data(const std::string& path, const uint8_t* data, size
     {
         std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
         auto it = impl_->paths_.find(path);
-        if (it == impl_->paths_.end()) {
+        if (it == impl_->paths_.end() || !it->second->acceptsPush()) {
             return false;
         }
         media_path = it->second;
@@ -2211,7 +4814,7 @@ bool RtspServer::pushH265Data(const std::string& path, const uint8_t* data, size
     {
         std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
         auto it = impl_->paths_.find(path);
-        if (it == impl_->paths_.end()) {
+        if (it == impl_->paths_.end() || !it->second->acceptsPush()) {
             return false;
         }
         media_path = it->second;
@@ -2233,6 +4836,83 @@ bool RtspServer::pushH265Data(const std::string& path, const uint8_t* data, size
     return true;
 }
 
+bool RtspServer::pushNalu(const std::string& path, const uint8_t* data, size_t size,
+                         uint64_t pts, bool last_in_access_unit) {
+    if (data == nullptr || size == 0) {
+        return false;
+    }
+
+    std::shared_ptr<MediaPath> media_path;
+    {
+        std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+        auto it = impl_->paths_.find(path);
+        if (it == impl_->paths_.end() || !it->second->acceptsPush()) {
+            return false;
+        }
+        media_path = it->second;
+    }
+
+    CodecType codec = CodecType::H264;
+    {
+        std::lock_guard<std::mutex> cfg_lock(media_path->config_mutex);
+        codec = media_path->config.codec;
+    }
+
+    // 帧类型由 NALU 类型推出；参数集出现时同步更新 SDP 用的 sps/pps/vps
+    bool has_idr = false;
+    bool has_parameter_set = false;
+    forEachAnnexBNalu(data, size, [&](const uint8_t* nalu, size_t nalu_size) {
+        if (nalu_size == 0) {
+            return;
+        }
+        if (codec == CodecType::H264) {
+            const uint8_t type = nalu[0] & 0x1F;
+            has_idr = has_idr || type == 5;
+            has_parameter_set = has_parameter_set || type == 7 || type == 8;
+        } else {
+            const uint8_t type = (nalu[0] >> 1) & 0x3F;
+            has_idr = has_idr || (type >= 16 && type <= 21);
+            has_parameter_set = has_parameter_set || (type >= 32 && type <= 34);
+        }
+    });
+    if (has_parameter_set) {
+        bool updated = false;
+        {
+            std::lock_guard<std::mutex> cfg_lock(media_path->config_mutex);
+            updated = codec == CodecType::H264
+                ? autoExtractH264ParameterSets(media_path->config, data, size)
+                : autoExtractH265ParameterSets(media_path->config, data, size);
+        }
+        if (updated) {
+            RTSP_LOG_INFO("Auto-updated parameter sets for path: " + path);
+        }
+    }
+
+    VideoFrame unit = {};
+    unit.codec = codec;
+    unit.type = has_idr ? FrameType::IDR : FrameType::P;
+    unit.pts = pts;
+    unit.dts = pts;
+    const bool has_start_code = hasStartCode4(data, size, 0) || hasStartCode3(data, size, 0);
+    if (has_start_code) {
+        unit.data = const_cast<uint8_t*>(data);
+        unit.size = size;
+    } else {
+        // 裸 NALU：补 4 字节起始码，队列与 IDR 缓存里统一保存 Annex-B
+        static const uint8_t kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+        unit.managed_data = std::make_shared<std::vector<uint8_t>>(kStartCode, kStartCode + 4);
+        unit.managed_data->insert(unit.managed_data->end(), data, data + size);
+        unit.data = unit.managed_data->data();
+        unit.size = unit.managed_data->size();
+    }
+
+    media_path->broadcastNalu(unit, last_in_access_unit);
+    if (last_in_access_unit) {
+        impl_->stats_.frames_pushed++;
+    }
+    return true;
+}
+
 std::shared_ptr<IVideoFrameInput> RtspServer::getFrameInput(const std::string& path) {
     // 捕获 MediaPath 的 weak_ptr，避免把裸 Impl* 暴露给外部导致 Server 析构后 UAF。
     std::weak_ptr<MediaPath> weak_path;
@@ -2249,7 +4929,7 @@ std::shared_ptr<IVideoFrameInput> RtspServer::getFrameInput(const std::string& p
         explicit FrameInput(std::weak_ptr<MediaPath> wp) : weak_path_(std::move(wp)) {}
         bool pushFrame(const VideoFrame& frame) override {
             auto path = weak_path_.lock();
-            if (!path) return false;
+            if (!path || !path->acceptsPush()) return false;
             path->broadcastFrame(frame);
             return true;
         }
@@ -2291,6 +4971,35 @@ void RtspServer::setAuthDigest(const std::string& username, const std::string& p
     }
 }
 
+void RtspServer::setRedirectPolicy(const RedirectConfig& config) {
+    std::lock_guard<std::mutex> lock(impl_->redirect_mutex_);
+    if (config.peers.empty()) {
+        impl_->redirect_policy_.reset();
+    } else {
+        impl_->redirect_policy_ = std::make_shared<RedirectPolicy>(config);
+    }
+}
+
+void RtspServer::setRedirectCallback(RedirectCallback callback) {
+    std::lock_guard<std::mutex> lock(impl_->redirect_mutex_);
+    impl_->redirect_callback_ = std::move(callback);
+}
+
+ServerLoad RtspServer::getLoad() const {
+    return impl_->currentLoad();
+}
+
+void RtspServer::setAdmissionControl(const AdmissionConfig& config) {
+    std::lock_guard<std::mutex> lock(impl_->admission_mutex_);
+    impl_->admission_ = config;
+}
+
+uint64_t RtspServer::getPathBitrate(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(impl_->paths_mutex_);
+    auto it = impl_->paths_.find(path);
+    return it == impl_->paths_.end() ? 0 : it->second->viewerBitrate();
+}
+
 RtspServerStats RtspServer::getStats() const {
     RtspServerStats s;
     s.requests_total = impl_->stats_.requests_total.load();
@@ -2301,6 +5010,13 @@ RtspServerStats RtspServer::getStats() const {
     s.frames_pushed = impl_->stats_.frames_pushed.load();
     s.rtp_packets_sent = impl_->stats_.rtp_packets_sent.load();
     s.rtp_bytes_sent = impl_->stats_.rtp_bytes_sent.load();
+    s.rendition_switches = impl_->stats_.rendition_switches.load();
+    s.redirects = impl_->stats_.redirects.load();
+    s.subscription_frames_dropped = impl_->stats_.subscription_frames_dropped.load();
+    s.admission_rejected_sessions = impl_->stats_.admission_rejected_sessions.load();
+    s.admission_rejected_path = impl_->stats_.admission_rejected_path.load();
+    s.admission_rejected_ip = impl_->stats_.admission_rejected_ip.load();
+    s.admission_rejected_bandwidth = impl_->stats_.admission_rejected_bandwidth.load();
     return s;
 }
 
@@ -2322,10 +5038,11 @@ VideoFrame createVideoFrame(CodecType codec, const uint8_t* data, size_t size,
 }
 
 void freeVideoFrame(VideoFrame& frame) {
-    if (!frame.managed_data && frame.data) {
+    if (!frame.managed_data && !frame.data_owner && frame.data) {
         delete[] frame.data;
     }
     frame.managed_data.reset();
+    frame.data_owner.reset();
     frame.data = nullptr;
     frame.size = 0;
 }
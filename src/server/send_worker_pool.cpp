@@ -0,0 +1,74 @@
+#include "send_worker_pool.h"
+
+#include <rtsp-common/thread_policy.h>
+
+#include <algorithm>
+
+namespace rtsp {
+
+SendWorkerPool::SendWorkerPool(size_t threads) {
+    threads = std::max<size_t>(1, threads);
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.push_back(startThread(ThreadRole::MediaSend, "rtsp-send", [this] { loop(); }));
+    }
+}
+
+SendWorkerPool::~SendWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    for (auto& task : ready_) {
+        task->onCancel();
+    }
+    ready_.clear();
+}
+
+void SendWorkerPool::post(std::shared_ptr<SendTask> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            task->onCancel();
+            return;
+        }
+        ready_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void SendWorkerPool::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return !running_ || !ready_.empty(); });
+        if (!running_) {
+            return;
+        }
+        std::shared_ptr<SendTask> task = std::move(ready_.front());
+        ready_.pop_front();
+        lock.unlock();
+
+        const bool again = task->onSend();
+
+        lock.lock();
+        if (again) {
+            if (running_) {
+                ready_.push_back(std::move(task));
+                continue;
+            }
+            task->onCancel();
+        }
+        // 在锁外释放最后一个引用：会话可能在这里析构
+        lock.unlock();
+        task.reset();
+        lock.lock();
+    }
+}
+
+} // namespace rtsp
@@ -0,0 +1,47 @@
+#pragma once
+
+// 会话发送工作池：所有观看会话共用固定数量的发送线程（rtsp-send），
+// 建立/拆除会话不再创建、join 线程。会话有待发数据时把自己投递到就绪队列，
+// worker 每次只为它发一个 AU 就放回队尾，一个慢会话不会独占线程。
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rtsp {
+
+class SendTask {
+public:
+    virtual ~SendTask() = default;
+    // 在 worker 线程上发一轮；返回 true 表示还有待发数据，需要重新排队
+    virtual bool onSend() = 0;
+    // 工作池停止时仍在就绪队列里的任务不再发送，由此得知
+    virtual void onCancel() = 0;
+};
+
+class SendWorkerPool {
+public:
+    explicit SendWorkerPool(size_t threads);
+    ~SendWorkerPool();
+
+    SendWorkerPool(const SendWorkerPool&) = delete;
+    SendWorkerPool& operator=(const SendWorkerPool&) = delete;
+
+    // 由任务自己保证同一时刻至多投递一次（见 ClientSession::send_scheduled）
+    void post(std::shared_ptr<SendTask> task);
+
+private:
+    void loop();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::shared_ptr<SendTask>> ready_;
+    bool running_ = true;
+    std::vector<std::thread> threads_;
+};
+
+} // namespace rtsp
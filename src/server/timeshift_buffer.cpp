@@ -0,0 +1,111 @@
+#include "timeshift_buffer.h"
+
+namespace rtsp {
+
+TimeShiftBuffer::TimeShiftBuffer(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+TimeShiftBuffer::~TimeShiftBuffer() {
+    for (auto& unit : units_) {
+        freeVideoFrame(unit.frame);
+    }
+}
+
+void TimeShiftBuffer::append(const VideoFrame& unit, bool end_of_au) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t position = base_position_ + units_.size();
+    if (!in_au_) {
+        au_start_ = position;
+        au_marked_ = false;
+    }
+    in_au_ = !end_of_au;
+
+    Unit entry;
+    entry.frame = unit;   // 共享托管缓冲，只增加引用计数
+    entry.end_of_au = end_of_au;
+    units_.push_back(std::move(entry));
+    bytes_ += unit.size;
+    newest_pts_ms_ = unit.pts;
+
+    // 逐 slice 推送时 AU 可能以参数集开头：见到 IDR 片段再把 AU 起点补记为 GOP 起点
+    if (unit.type == FrameType::IDR && !au_marked_) {
+        GopMark mark;
+        mark.position = au_start_;
+        mark.pts_ms = unit.pts;
+        gops_.push_back(mark);
+        au_marked_ = true;
+        if (gops_.size() == 1) {
+            evictFrontLocked(au_start_);   // 第一个 IDR 之前的单元不可解码
+        }
+    }
+
+    // 整 GOP 淘汰，至少保留正在写入的一个
+    while (bytes_ > max_bytes_ && gops_.size() > 1) {
+        gops_.pop_front();
+        evictFrontLocked(gops_.front().position);
+    }
+}
+
+void TimeShiftBuffer::evictFrontLocked(uint64_t until) {
+    while (base_position_ < until && !units_.empty()) {
+        bytes_ -= units_.front().frame.size;
+        freeVideoFrame(units_.front().frame);
+        units_.pop_front();
+        base_position_++;
+    }
+}
+
+bool TimeShiftBuffer::seek(uint64_t offset_ms, bool from_live, uint64_t& position) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (gops_.empty()) {
+        return false;
+    }
+    const uint64_t oldest_pts = gops_.front().pts_ms;
+    uint64_t pts_ms = oldest_pts + offset_ms;
+    if (from_live) {
+        pts_ms = newest_pts_ms_ > oldest_pts + offset_ms ? newest_pts_ms_ - offset_ms : oldest_pts;
+    }
+    position = gops_.front().position;
+    for (const auto& mark : gops_) {
+        if (mark.pts_ms > pts_ms) {
+            break;
+        }
+        position = mark.position;
+    }
+    return true;
+}
+
+uint64_t TimeShiftBuffer::nptOf(uint64_t pts_ms) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (gops_.empty() || pts_ms < gops_.front().pts_ms) {
+        return 0;
+    }
+    return pts_ms - gops_.front().pts_ms;
+}
+
+uint64_t TimeShiftBuffer::livePosition() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return base_position_ + units_.size();
+}
+
+uint64_t TimeShiftBuffer::oldestPosition() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return gops_.empty() ? base_position_ + units_.size() : gops_.front().position;
+}
+
+bool TimeShiftBuffer::read(uint64_t position, VideoFrame& unit, bool& end_of_au) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (position < base_position_ || position >= base_position_ + units_.size()) {
+        return false;
+    }
+    const Unit& entry = units_[static_cast<size_t>(position - base_position_)];
+    unit = entry.frame;
+    end_of_au = entry.end_of_au;
+    return true;
+}
+
+size_t TimeShiftBuffer::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+} // namespace rtsp
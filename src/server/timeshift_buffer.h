@@ -0,0 +1,70 @@
+#pragma once
+
+// 直播时移缓冲：路径最近若干 GOP 的环形缓存，按字节数封顶，以 IDR 的 pts 建索引。
+// MediaPath 广播时把共享帧交给 append（只增加引用计数），回看会话按位置从这里读取。
+//
+// 位置是单调递增的单元序号（一个单元即一次广播的整帧或 AU 片段），
+// 淘汰只会整 GOP 地从头部丢弃，因此最老的可读位置总是某个 IDR AU 的起点。
+//
+// 对外的 npt 相对缓冲而言：0 为最老的 IDR，随淘汰整体前移；推流方的 pts 起点不影响定位。
+
+#include <rtsp-server/rtsp_server.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace rtsp {
+
+class TimeShiftBuffer {
+public:
+    explicit TimeShiftBuffer(size_t max_bytes);
+    ~TimeShiftBuffer();
+
+    TimeShiftBuffer(const TimeShiftBuffer&) = delete;
+    TimeShiftBuffer& operator=(const TimeShiftBuffer&) = delete;
+
+    // 由 MediaPath 在 sessions_mutex 下调用（调用是串行的）。frame 须为托管缓冲。
+    void append(const VideoFrame& unit, bool end_of_au);
+
+    // 按 npt 定位：offset_ms 从最老的 IDR 起算（from_live 时从最新写入的单元往回算），
+    // 取不晚于该时刻的最后一个 IDR（越界取两端）；缓冲为空返回 false
+    bool seek(uint64_t offset_ms, bool from_live, uint64_t& position) const;
+    // pts 为 pts_ms 的单元当前的 npt（早于最老的 IDR 记为 0）
+    uint64_t nptOf(uint64_t pts_ms) const;
+    // 下一个将要写入的位置，读到这里即追上直播
+    uint64_t livePosition() const;
+    // 最老的可读位置（已被淘汰的位置应从这里继续）
+    uint64_t oldestPosition() const;
+
+    // 读取 position 处的单元（与缓冲共享引用计数）；
+    // 已淘汰或尚未写入返回 false
+    bool read(uint64_t position, VideoFrame& unit, bool& end_of_au) const;
+
+    size_t bytes() const;
+
+private:
+    struct Unit {
+        VideoFrame frame;
+        bool end_of_au = true;
+    };
+    struct GopMark {
+        uint64_t position = 0;   // IDR AU 的首个单元
+        uint64_t pts_ms = 0;
+    };
+
+    void evictFrontLocked(uint64_t until);
+
+    const size_t max_bytes_;
+    mutable std::mutex mutex_;
+    std::deque<Unit> units_;
+    std::deque<GopMark> gops_;
+    uint64_t base_position_ = 0;     // units_.front() 的位置
+    uint64_t newest_pts_ms_ = 0;     // 最新写入单元的 pts
+    size_t bytes_ = 0;
+    uint64_t au_start_ = 0;          // 当前 AU 首个单元的位置
+    bool in_au_ = false;
+    bool au_marked_ = false;         // 当前 AU 是否已记为 GOP 起点
+};
+
+} // namespace rtsp
@@ -0,0 +1,190 @@
+/**
+ * 准入控制回归测试
+ *
+ * - 单路径/总数/单 IP 会话上限：超限的 SETUP 收到 453，不创建会话，按原因计数
+ * - 出口码率上限：按路径实测码率 × 观看数估算（全局与单网卡）
+ * - 已建立的会话不受影响，放开限制后新会话正常建立
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19805;
+const uint32_t kFps = 25;
+const uint64_t kFrameMs = 1000 / kFps;
+const int kGopFrames = 10;
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    size_t payload = 600;
+    if (index % kGopFrames == 0) {
+        out = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8,
+               0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+               0x00, 0x00, 0x00, 0x01, 0x65, 0x88};
+        payload = 2000;
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A};
+    }
+    for (size_t i = 0; i < payload; ++i) {
+        out.push_back(static_cast<uint8_t>(0x10 + (i % 0x60)));
+    }
+    return out;
+}
+
+using Viewers = std::vector<std::unique_ptr<RtspClient>>;
+
+// 建立一个观看者；SETUP 被拒时返回 false（对象仍放入列表，统一关闭）
+bool addViewer(Viewers& viewers, const std::string& path) {
+    viewers.emplace_back(new RtspClient());
+    RtspClient& client = *viewers.back();
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = false;
+    client.setConfig(cfg);
+    CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + path));
+    CHECK(client.describe());
+    return client.setup(0) && client.play(0);
+}
+
+void closeAll(RtspServer& server, Viewers& viewers) {
+    for (auto& viewer : viewers) {
+        viewer->close();
+    }
+    viewers.clear();
+    const auto begin = std::chrono::steady_clock::now();
+    while (server.getLoad().sessions != 0) {
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void test_session_limits(RtspServer& server) {
+    std::cout << "Testing session limits..." << std::endl;
+    AdmissionConfig config;
+    config.max_sessions_per_path = 2;
+    config.max_sessions = 3;
+    server.setAdmissionControl(config);
+
+    Viewers viewers;
+    CHECK(addViewer(viewers, "/live/a"));
+    CHECK(addViewer(viewers, "/live/a"));
+    const uint64_t created = server.getStats().sessions_created;
+    CHECK(!addViewer(viewers, "/live/a"));
+    CHECK(server.getStats().admission_rejected_path == 1);
+    // 被拒的 SETUP 不创建会话
+    CHECK(server.getStats().sessions_created == created);
+    CHECK(server.getLoad().sessions == 2);
+
+    CHECK(addViewer(viewers, "/live/b"));
+    CHECK(!addViewer(viewers, "/live/b"));
+    CHECK(server.getStats().admission_rejected_sessions == 1);
+
+    // 已建立的会话照常收流
+    VideoFrame frame{};
+    CHECK(viewers[0]->receiveFrame(frame, 3000));
+    closeAll(server, viewers);
+
+    config = AdmissionConfig();
+    config.max_sessions_per_ip = 1;
+    server.setAdmissionControl(config);
+    CHECK(addViewer(viewers, "/live/a"));
+    CHECK(!addViewer(viewers, "/live/b"));
+    CHECK(server.getStats().admission_rejected_ip == 1);
+    closeAll(server, viewers);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_bandwidth_limits(RtspServer& server) {
+    std::cout << "Testing egress bandwidth limits..." << std::endl;
+    const auto begin = std::chrono::steady_clock::now();
+    while (server.getPathBitrate("/live/a") == 0) {
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    const uint64_t bitrate = server.getPathBitrate("/live/a");
+    CHECK(server.getPathBitrate("/missing") == 0);
+
+    // 全局上限容纳两路
+    AdmissionConfig config;
+    config.max_egress_bps = bitrate * 5 / 2;
+    server.setAdmissionControl(config);
+    Viewers viewers;
+    CHECK(addViewer(viewers, "/live/a"));
+    CHECK(addViewer(viewers, "/live/a"));
+    CHECK(!addViewer(viewers, "/live/a"));
+    CHECK(server.getStats().admission_rejected_bandwidth == 1);
+    closeAll(server, viewers);
+
+    // 单网卡上限容纳一路（都经 127.0.0.1）
+    config = AdmissionConfig();
+    config.max_egress_bps_per_interface = bitrate * 3 / 2;
+    server.setAdmissionControl(config);
+    CHECK(addViewer(viewers, "/live/a"));
+    CHECK(!addViewer(viewers, "/live/b"));
+    CHECK(server.getStats().admission_rejected_bandwidth == 2);
+    closeAll(server, viewers);
+
+    // 放开限制后恢复
+    server.setAdmissionControl(AdmissionConfig());
+    for (int i = 0; i < 4; ++i) {
+        CHECK(addViewer(viewers, "/live/a"));
+    }
+    closeAll(server, viewers);
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Admission Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    for (const char* path : {"/live/a", "/live/b"}) {
+        PathConfig config;
+        config.path = path;
+        config.fps = kFps;
+        CHECK(server.addPath(config));
+    }
+    CHECK(server.start());
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        const auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; running; ++i) {
+            std::this_thread::sleep_until(begin + std::chrono::milliseconds(i * kFrameMs));
+            const auto frame = makeFrame(i);
+            for (const char* path : {"/live/a", "/live/b"}) {
+                server.pushH264Data(path, frame.data(), frame.size(), i * kFrameMs, i % kGopFrames == 0);
+            }
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    test_session_limits(server);
+    test_bandwidth_limits(server);
+
+    running = false;
+    pusher.join();
+    server.stop();
+    std::cout << "\n=== All Admission Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// 测试共用的断言宏。
+//
+// CHECK：等价于 assert，但不受 NDEBUG 影响（Release 也会执行和检查）。
+// 测试里很多表达式带副作用（推流、收发、读帧、server.start() ...），放在 assert()
+// 里在 Release/NDEBUG 下会被整个剥掉，测试变成无效。
+
+#include <cstdlib>
+#include <iostream>
+
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "CHECK failed at " << __FILE__ << ":" << __LINE__ \
+                  << ": " << #expr << std::endl; \
+        std::abort(); \
+    } \
+} while (0)
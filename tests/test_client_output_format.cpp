@@ -0,0 +1,238 @@
+/**
+ * 客户端帧输出格式测试
+ *
+ * - AnnexB（默认）：第一个 IDR 前插入 SDP sprop 中的 SPS/PPS，之后的 IDR 不再插入
+ * - Avcc：4 字节大端长度前缀逐个走完恰好覆盖整帧，FU-A 重组的大 NALU 长度正确
+ * - NaluSpans：VideoFrame::nalus 指向各 NALU
+ * - 尾部填充清零、data 起始地址对齐；关闭插入后 IDR 保持原样
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19813;
+const int kGop = 5;
+const size_t kIdrBody = 5000;    // 远超 MTU，走 FU-A
+const size_t kSliceBody = 300;
+
+// IDR 帧内不带参数集，只有一个 IDR slice；P 帧为 SEI + slice 两个 NALU
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    if (index % kGop == 0) {
+        out = {0x00, 0x00, 0x00, 0x01, 0x65};
+        out.resize(out.size() + kIdrBody, 0x42);
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x06, 0x05, 0x01, 0x80,
+               0x00, 0x00, 0x00, 0x01, 0x41};
+        out.resize(out.size() + kSliceBody, 0x42);
+    }
+    return out;
+}
+
+bool openClient(RtspClient& client, const RtspClientConfig& base) {
+    RtspClientConfig config = base;
+    config.prefer_tcp_transport = true;
+    client.setConfig(config);
+    return client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test") &&
+           client.describe() && client.setup(0) && client.play(0);
+}
+
+// 读到第 n 个 IDR（从 1 开始）
+VideoFrame readIdr(RtspClient& client, int n) {
+    VideoFrame frame{};
+    int seen = 0;
+    for (int i = 0; i < 200; ++i) {
+        CHECK(client.receiveFrame(frame, 3000));
+        if (frame.type == FrameType::IDR && ++seen == n) {
+            return frame;
+        }
+    }
+    CHECK(false);
+    return frame;
+}
+
+VideoFrame readP(RtspClient& client) {
+    VideoFrame frame{};
+    for (int i = 0; i < 200; ++i) {
+        CHECK(client.receiveFrame(frame, 3000));
+        if (frame.type != FrameType::IDR) {
+            return frame;
+        }
+    }
+    CHECK(false);
+    return frame;
+}
+
+// 按 AVCC 长度前缀拆出各 NALU 类型；长度须恰好走完整帧
+std::vector<uint8_t> avccTypes(const VideoFrame& frame, std::vector<uint32_t>* sizes) {
+    std::vector<uint8_t> types;
+    size_t off = 0;
+    while (off < frame.size) {
+        CHECK(off + 4 < frame.size);
+        const uint32_t len = (static_cast<uint32_t>(frame.data[off]) << 24) |
+                             (static_cast<uint32_t>(frame.data[off + 1]) << 16) |
+                             (static_cast<uint32_t>(frame.data[off + 2]) << 8) |
+                             static_cast<uint32_t>(frame.data[off + 3]);
+        CHECK(len > 0 && off + 4 + len <= frame.size);
+        types.push_back(frame.data[off + 4] & 0x1F);
+        if (sizes) {
+            sizes->push_back(len);
+        }
+        off += 4 + len;
+    }
+    CHECK(off == frame.size);
+    return types;
+}
+
+void test_annexb_injects_before_first_idr() {
+    std::cout << "Testing Annex-B output injects sprop parameter sets before the first IDR..." << std::endl;
+    RtspClient client;
+    CHECK(openClient(client, RtspClientConfig()));
+
+    VideoFrame first = readIdr(client, 1);
+    CHECK(first.format == FrameFormat::AnnexB);
+    CHECK(first.nalus.empty());
+    const uint8_t expected_prefix[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8,
+                                       0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+                                       0x00, 0x00, 0x00, 0x01, 0x65};
+    CHECK(first.size == sizeof(expected_prefix) + kIdrBody);
+    for (size_t i = 0; i < sizeof(expected_prefix); ++i) {
+        CHECK(first.data[i] == expected_prefix[i]);
+    }
+
+    // 只在第一个 IDR 前插入
+    VideoFrame second = readIdr(client, 1);
+    CHECK(second.size == 5 + kIdrBody);
+    CHECK(second.data[4] == 0x65);
+    client.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_avcc() {
+    std::cout << "Testing AVCC output rewrites start codes to lengths in place..." << std::endl;
+    RtspClientConfig config;
+    config.output_format = FrameFormat::Avcc;
+    RtspClient client;
+    CHECK(openClient(client, config));
+
+    VideoFrame idr = readIdr(client, 1);
+    CHECK(idr.format == FrameFormat::Avcc);
+    std::vector<uint32_t> sizes;
+    const std::vector<uint8_t> types = avccTypes(idr, &sizes);
+    CHECK(types == std::vector<uint8_t>({7, 8, 5}));
+    CHECK(sizes[0] == 6 && sizes[1] == 4 && sizes[2] == 1 + kIdrBody);
+
+    VideoFrame p = readP(client);
+    CHECK(avccTypes(p, nullptr) == std::vector<uint8_t>({6, 1}));
+    client.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_nalu_spans() {
+    std::cout << "Testing NALU span list over the reassembly buffer..." << std::endl;
+    RtspClientConfig config;
+    config.output_format = FrameFormat::NaluSpans;
+    RtspClient client;
+    CHECK(openClient(client, config));
+
+    VideoFrame idr = readIdr(client, 1);
+    CHECK(idr.format == FrameFormat::NaluSpans);
+    CHECK(idr.nalus.size() == 3);
+    CHECK((idr.data[idr.nalus[0].offset] & 0x1F) == 7 && idr.nalus[0].size == 6);
+    CHECK((idr.data[idr.nalus[1].offset] & 0x1F) == 8 && idr.nalus[1].size == 4);
+    CHECK((idr.data[idr.nalus[2].offset] & 0x1F) == 5 && idr.nalus[2].size == 1 + kIdrBody);
+    CHECK(idr.nalus[2].offset + idr.nalus[2].size == idr.size);
+
+    VideoFrame p = readP(client);
+    CHECK(p.nalus.size() == 2);
+    CHECK((p.data[p.nalus[0].offset] & 0x1F) == 6);
+    CHECK((p.data[p.nalus[1].offset] & 0x1F) == 1 && p.nalus[1].size == 1 + kSliceBody);
+    client.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_padding_alignment_and_no_injection() {
+    std::cout << "Testing tail padding, alignment and disabled injection..." << std::endl;
+    RtspClientConfig config;
+    config.output_padding = 64;
+    config.output_alignment = 64;
+    config.inject_parameter_sets = false;
+    RtspClient client;
+    CHECK(openClient(client, config));
+
+    VideoFrame idr = readIdr(client, 1);
+    CHECK(idr.size == 5 + kIdrBody);
+    CHECK(idr.data[4] == 0x65);
+    CHECK(reinterpret_cast<uintptr_t>(idr.data) % 64 == 0);
+    const uint8_t* end = idr.managed_data->data() + idr.managed_data->size();
+    CHECK(idr.data + idr.size + 64 <= end);
+    for (size_t i = 0; i < 64; ++i) {
+        CHECK(idr.data[idr.size + i] == 0);
+    }
+
+    // 不要求对齐时组帧缓冲直接交出，填充同样清零
+    client.close();
+    config.output_alignment = 0;
+    RtspClient plain;
+    CHECK(openClient(plain, config));
+    VideoFrame p = readP(plain);
+    CHECK(p.managed_data->size() >= p.size + 64);
+    for (size_t i = 0; i < 64; ++i) {
+        CHECK(p.data[p.size + i] == 0);
+    }
+    plain.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Client Output Format Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    PathConfig config;
+    config.path = "/live/test";
+    config.sps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+    config.pps = {0x68, 0xCE, 0x3C, 0x80};
+    CHECK(server.addPath(config));
+    CHECK(server.start());
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const auto frame = makeFrame(i);
+            server.pushH264Data("/live/test", frame.data(), frame.size(), static_cast<uint64_t>(i) * 10, i % kGop == 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    test_annexb_injects_before_first_idr();
+    test_avcc();
+    test_nalu_spans();
+    test_padding_alignment_and_no_injection();
+
+    running = false;
+    pusher.join();
+    server.stop();
+    std::cout << "\n=== All Client Output Format Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -14,6 +14,7 @@ using namespace std::chrono_literals;
 
 static std::vector<uint8_t> makeNalu(bool keyframe) {
     std::vector<uint8_t> out;
+    out.reserve(600);
     // Annex-B start code + NALU header
     out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
     if (keyframe) {
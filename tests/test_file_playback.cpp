@@ -0,0 +1,244 @@
+/**
+ * 文件点播回归测试
+ *
+ * - Annex-B 文件：首次加载写出 .idx 索引，DESCRIBE 带 a=range 时长
+ * - PLAY Range: npt= 定位到不晚于该时刻的最近 IDR，之后按时间戳节奏发送
+ * - PAUSE 后无 Range 的 PLAY 从暂停处继续
+ * - startRecording 录制的 fMP4 可直接作为点播源，IDR 前补发参数集
+ * - 文件路径不接受推流
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19795;
+const uint32_t kFps = 25;
+const uint64_t kFrameMs = 1000 / kFps;
+const int kGopFrames = 10;
+
+const std::vector<uint8_t> kSps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+const std::vector<uint8_t> kPps = {0x68, 0xCE, 0x3C, 0x80};
+
+// 整帧单 slice：first_mb_in_slice = 0（首位为 1）
+std::vector<uint8_t> makeSlice(uint8_t header, size_t payload) {
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01, header, 0x88};
+    for (size_t i = 0; i < payload; ++i) {
+        out.push_back(static_cast<uint8_t>(0x10 + (i % 0x60)));
+    }
+    return out;
+}
+
+std::vector<uint8_t> makeFrame(int index) {
+    if (index % kGopFrames != 0) {
+        return makeSlice(0x41, 800);
+    }
+    const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+    const auto idr = makeSlice(0x65, 3000);
+    std::vector<uint8_t> out;
+    out.reserve(2 * sizeof(start_code) + kSps.size() + kPps.size() + idr.size());
+    for (const auto* set : {&kSps, &kPps}) {
+        out.insert(out.end(), start_code, start_code + sizeof(start_code));
+        out.insert(out.end(), set->begin(), set->end());
+    }
+    out.insert(out.end(), idr.begin(), idr.end());
+    return out;
+}
+
+bool fileExists(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    return in.good();
+}
+
+bool openClient(RtspClient& client, const std::string& path, uint64_t* duration_ms = nullptr) {
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = false;
+    client.setConfig(cfg);
+    if (!client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + path) || !client.describe()) {
+        return false;
+    }
+    if (duration_ms) {
+        *duration_ms = client.getSessionInfo().duration_ms;
+    }
+    return client.setup(0);
+}
+
+bool startsWithNalType(const VideoFrame& frame, uint8_t type) {
+    return frame.size > 5 && frame.data[0] == 0 && frame.data[1] == 0 &&
+           ((frame.data[2] == 1 && (frame.data[3] & 0x1F) == type) ||
+            (frame.data[2] == 0 && frame.data[3] == 1 && (frame.data[4] & 0x1F) == type));
+}
+
+void test_annexb_seek_and_pacing(RtspServer& server) {
+    std::cout << "Testing Annex-B file playback with Range seek..." << std::endl;
+    const std::string file = "file_playback_test.h264";
+    const std::string index_file = file + ".idx";
+    std::remove(index_file.c_str());
+    {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        for (int i = 0; i < 3 * kGopFrames; ++i) {
+            const auto frame = makeFrame(i);
+            out.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+        }
+    }
+
+    FilePathConfig config;
+    config.path = "/vod/annexb";
+    config.file = file;
+    config.fps = kFps;
+    CHECK(server.addFilePath(config));
+    CHECK(fileExists(index_file));
+    CHECK(!server.addFilePath(config));
+
+    // 第二个路径复用旁路索引
+    FilePathConfig again = config;
+    again.path = "/vod/again";
+    CHECK(server.addFilePath(again));
+
+    FilePathConfig missing = config;
+    missing.path = "/vod/missing";
+    missing.file = "file_playback_missing.h264";
+    CHECK(!server.addFilePath(missing));
+
+    const auto frame = makeFrame(0);
+    CHECK(!server.pushH264Data(config.path, frame.data(), frame.size(), 0, true));
+
+    RtspClient client;
+    uint64_t duration_ms = 0;
+    CHECK(openClient(client, config.path, &duration_ms));
+    CHECK(duration_ms == 3 * kGopFrames * kFrameMs);
+
+    // npt=0.5 落在第二个 GOP 内：从该 GOP 的 IDR（400ms）开始
+    CHECK(client.play(500));
+    VideoFrame received{};
+    CHECK(client.receiveFrame(received, 2000));
+    CHECK(received.type == FrameType::IDR);
+    CHECK(received.pts == kGopFrames * kFrameMs);
+    const auto first_at = std::chrono::steady_clock::now();
+
+    uint64_t last_pts = received.pts;
+    for (int i = 1; i < 5; ++i) {
+        CHECK(client.receiveFrame(received, 1000));
+        CHECK(received.pts == last_pts + kFrameMs);
+        last_pts = received.pts;
+    }
+    // 按时间戳节奏发送而不是一次性灌出：5 帧至少跨过 4 个帧间隔的大部分
+    const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - first_at).count();
+    CHECK(elapsed_ms >= 120);
+
+    // 暂停后无 Range 的 PLAY 从暂停处继续
+    CHECK(client.pause());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(client.play(0));
+    CHECK(client.receiveFrame(received, 2000));
+    CHECK(received.pts > last_pts);
+    CHECK(received.pts < 3 * kGopFrames * kFrameMs);
+    client.close();
+
+    RtspClient from_start;
+    CHECK(openClient(from_start, again.path));
+    CHECK(from_start.play(0));
+    CHECK(from_start.receiveFrame(received, 2000));
+    CHECK(received.type == FrameType::IDR);
+    CHECK(received.pts == 0);
+    CHECK(startsWithNalType(received, 7));
+    from_start.close();
+
+    CHECK(server.removePath(config.path));
+    CHECK(server.removePath(again.path));
+    CHECK(std::remove(index_file.c_str()) == 0);
+    CHECK(std::remove(file.c_str()) == 0);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_recorded_fmp4_playback(RtspServer& server) {
+    std::cout << "Testing playback of a recorded fMP4 segment..." << std::endl;
+    PathConfig live;
+    live.path = "/live/rec";
+    live.fps = kFps;
+    CHECK(server.addPath(live));
+    RecordConfig record;
+    record.directory = ".";
+    CHECK(server.startRecording(live.path, record));
+    for (int i = 0; i < 2 * kGopFrames; ++i) {
+        const auto frame = makeFrame(i);
+        CHECK(server.pushH264Data(live.path, frame.data(), frame.size(), i * kFrameMs, i % kGopFrames == 0));
+    }
+    RecordStats stats;
+    for (int i = 0; i < 200 && stats.current_file.empty(); ++i) {
+        CHECK(server.getRecordStats(live.path, stats));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(!stats.current_file.empty());
+    CHECK(server.stopRecording(live.path));
+    const std::string file = stats.current_file;
+
+    FilePathConfig config;
+    config.path = "/vod/mp4";
+    config.file = file;
+    CHECK(server.addFilePath(config));
+
+    RtspClient client;
+    uint64_t duration_ms = 0;
+    CHECK(openClient(client, config.path, &duration_ms));
+    CHECK(duration_ms == 2 * kGopFrames * kFrameMs);
+    CHECK(client.play(450));
+
+    // fMP4 样本不带参数集：IDR 前补发 SPS/PPS
+    VideoFrame received{};
+    CHECK(client.receiveFrame(received, 2000));
+    CHECK(received.type == FrameType::IDR);
+    CHECK(received.pts == kGopFrames * kFrameMs);
+    CHECK(startsWithNalType(received, 7));
+    int frames = 1;
+    while (frames < kGopFrames && client.receiveFrame(received, 1000)) {
+        CHECK(received.pts == (kGopFrames + frames) * kFrameMs);
+        CHECK(received.size == makeFrame(kGopFrames + frames).size());
+        frames++;
+    }
+    CHECK(frames == kGopFrames);
+    client.close();
+
+    CHECK(server.removePath(config.path));
+    CHECK(server.removePath(live.path));
+    CHECK(std::remove((file + ".idx").c_str()) == 0);
+    CHECK(std::remove(file.c_str()) == 0);
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running File Playback Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Warning;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    CHECK(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    test_annexb_seek_and_pacing(server);
+    test_recorded_fmp4_playback(server);
+
+    server.stop();
+    std::cout << "\n=== All File Playback Tests Passed! ===" << std::endl;
+    return 0;
+}
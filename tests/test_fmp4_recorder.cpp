@@ -0,0 +1,323 @@
+/**
+ * 路径录像（fragmented MP4）回归测试
+ *
+ * - 段文件结构为 ftyp + moov(avcC) + N × (moof + mdat)，每个 GOP 一个 fragment
+ * - trun 的 data_offset / 样本大小与 mdat 吻合，样本为 4 字节长度前缀且不含参数集
+ * - tfdt 在段内连续，段时长达到上限后在 IDR 处切新文件
+ * - pushNalu 的各 slice 合成同一个样本
+ * - 写盘积压超限时丢帧并计数
+ */
+
+#include <rtsp-server/rtsp-server.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const std::vector<uint8_t> kSps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+const std::vector<uint8_t> kPps = {0x68, 0xCE, 0x3C, 0x80};
+const uint32_t kFps = 25;
+const uint64_t kFrameMs = 1000 / kFps;
+
+std::vector<uint8_t> makeNalu(uint8_t header, size_t payload) {
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01, header};
+    for (size_t i = 0; i < payload; ++i) {
+        out.push_back(static_cast<uint8_t>(0x10 + (i % 0x60)));
+    }
+    return out;
+}
+
+std::vector<uint8_t> makeIdrFrame(size_t payload) {
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01};
+    out.insert(out.end(), kSps.begin(), kSps.end());
+    out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+    out.insert(out.end(), kPps.begin(), kPps.end());
+    const auto slice = makeNalu(0x65, payload);
+    out.insert(out.end(), slice.begin(), slice.end());
+    return out;
+}
+
+uint32_t readU32(const std::vector<uint8_t>& b, size_t pos) {
+    return (static_cast<uint32_t>(b[pos]) << 24) | (static_cast<uint32_t>(b[pos + 1]) << 16) |
+           (static_cast<uint32_t>(b[pos + 2]) << 8) | b[pos + 3];
+}
+
+uint64_t readU64(const std::vector<uint8_t>& b, size_t pos) {
+    return (static_cast<uint64_t>(readU32(b, pos)) << 32) | readU32(b, pos + 4);
+}
+
+bool boxTypeIs(const std::vector<uint8_t>& b, size_t pos, const char* type) {
+    return std::memcmp(b.data() + pos + 4, type, 4) == 0;
+}
+
+// 在 [begin, end) 内找直接或嵌套的 box，返回 box 起点
+size_t findBox(const std::vector<uint8_t>& b, size_t begin, size_t end, const char* type) {
+    for (size_t i = begin; i + 8 <= end; ++i) {
+        if (std::memcmp(b.data() + i + 4, type, 4) == 0 && readU32(b, i) >= 8 && i + readU32(b, i) <= end) {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+struct ParsedSegment {
+    size_t fragments = 0;
+    size_t samples = 0;
+    std::vector<size_t> nalus_per_sample;
+    uint64_t total_duration = 0;
+    bool first_sample_sync = false;
+};
+
+ParsedSegment parseSegment(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    CHECK(in.good());
+    const std::vector<uint8_t> b((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ParsedSegment result;
+
+    size_t pos = 0;
+    CHECK(b.size() > 16 && boxTypeIs(b, pos, "ftyp"));
+    pos += readU32(b, pos);
+    CHECK(boxTypeIs(b, pos, "moov"));
+    const size_t moov_end = pos + readU32(b, pos);
+    const size_t avcc = findBox(b, pos, moov_end, "avcC");
+    CHECK(avcc != std::string::npos);
+    CHECK(std::memcmp(b.data() + avcc + 8 + 8, kSps.data(), kSps.size()) == 0);
+    CHECK(findBox(b, pos, moov_end, "trex") != std::string::npos);
+    pos = moov_end;
+
+    uint64_t expected_decode_time = 0;
+    while (pos < b.size()) {
+        CHECK(boxTypeIs(b, pos, "moof"));
+        const size_t moof = pos;
+        const size_t moof_size = readU32(b, moof);
+        const size_t mdat = moof + moof_size;
+        CHECK(mdat + 8 <= b.size() && boxTypeIs(b, mdat, "mdat"));
+        const size_t mdat_size = readU32(b, mdat);
+
+        const size_t tfdt = findBox(b, moof, mdat, "tfdt");
+        CHECK(tfdt != std::string::npos && b[tfdt + 8] == 1);
+        CHECK(readU64(b, tfdt + 12) == expected_decode_time);
+
+        const size_t trun = findBox(b, moof, mdat, "trun");
+        CHECK(trun != std::string::npos);
+        const uint32_t count = readU32(b, trun + 12);
+        CHECK(readU32(b, trun + 16) == moof_size + 8);  // data_offset 指向 mdat 负载
+        size_t sample_pos = mdat + 8;
+        for (uint32_t i = 0; i < count; ++i) {
+            const size_t entry = trun + 20 + i * 12;
+            const uint32_t duration = readU32(b, entry);
+            const uint32_t size = readU32(b, entry + 4);
+            const uint32_t flags = readU32(b, entry + 8);
+            CHECK(duration == 90000 / kFps);
+            expected_decode_time += duration;
+            if (result.samples == 0) {
+                result.first_sample_sync = flags == 0x02000000;
+            }
+
+            // 样本由若干 [4 字节长度][NALU] 组成，且不含 SPS/PPS
+            size_t nalus = 0;
+            size_t offset = sample_pos;
+            while (offset < sample_pos + size) {
+                const uint32_t len = readU32(b, offset);
+                const uint8_t type = b[offset + 4] & 0x1F;
+                CHECK(type != 7 && type != 8);
+                CHECK(type == ((flags == 0x02000000) ? 5 : 1));
+                offset += 4 + len;
+                nalus++;
+            }
+            CHECK(offset == sample_pos + size);
+            result.nalus_per_sample.push_back(nalus);
+            sample_pos += size;
+            result.samples++;
+        }
+        CHECK(sample_pos == mdat + mdat_size);
+        result.fragments++;
+        pos = mdat + mdat_size;
+    }
+    result.total_duration = expected_decode_time;
+    return result;
+}
+
+std::string waitForFileChange(RtspServer& server, const std::string& path, const std::string& previous) {
+    for (int i = 0; i < 200; ++i) {
+        RecordStats stats;
+        CHECK(server.getRecordStats(path, stats));
+        if (!stats.current_file.empty() && stats.current_file != previous) {
+            return stats.current_file;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(false);
+    return std::string();
+}
+
+void pushGop(RtspServer& server, const std::string& path, uint64_t& pts, int frames) {
+    const auto idr = makeIdrFrame(2000);
+    const auto p = makeNalu(0x41, 600);
+    for (int i = 0; i < frames; ++i) {
+        const auto& frame = (i == 0) ? idr : p;
+        CHECK(server.pushH264Data(path, frame.data(), frame.size(), pts, i == 0));
+        pts += kFrameMs;
+    }
+}
+
+void test_segments_rotate_on_idr(RtspServer& server) {
+    std::cout << "Testing fMP4 segments rotate on IDR..." << std::endl;
+    const std::string path = "/rec/gop";
+    PathConfig config;
+    config.path = path;
+    config.fps = kFps;
+    config.width = 640;
+    config.height = 360;
+    CHECK(server.addPath(config));
+
+    RecordConfig record;
+    record.directory = ".";
+    record.segment_duration_ms = 1000;
+    CHECK(!server.startRecording("/rec/none", record));
+    CHECK(server.startRecording(path, record));
+    CHECK(!server.startRecording(path, record));
+
+    // 录像只从 IDR 开始
+    uint64_t pts = 0;
+    const auto p = makeNalu(0x41, 600);
+    CHECK(server.pushH264Data(path, p.data(), p.size(), pts, false));
+    pts += kFrameMs;
+
+    // 每个 GOP 正好 1 秒：下一个 IDR 到来时段时长达到上限，切新文件
+    std::vector<std::string> files;
+    for (int gop = 0; gop < 3; ++gop) {
+        pushGop(server, path, pts, kFps);
+        files.push_back(waitForFileChange(server, path, files.empty() ? std::string() : files.back()));
+    }
+
+    RecordStats stats;
+    for (int i = 0; i < 200; ++i) {
+        CHECK(server.getRecordStats(path, stats));
+        if (stats.frames_written == 2 * kFps) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(stats.frames_written == 2 * kFps);
+    CHECK(stats.segments_completed == 2);
+    CHECK(stats.frames_dropped == 0);
+    CHECK(stats.bytes_written > 0);
+    CHECK(stats.max_write_latency_us >= stats.avg_write_latency_us);
+
+    // 停止时写出最后一个 GOP
+    CHECK(server.stopRecording(path));
+    CHECK(!server.stopRecording(path));
+    CHECK(!server.getRecordStats(path, stats));
+
+    for (const auto& file : files) {
+        const ParsedSegment segment = parseSegment(file);
+        CHECK(segment.fragments == 1);
+        CHECK(segment.samples == kFps);
+        CHECK(segment.first_sample_sync);
+        CHECK(segment.total_duration == 90000);
+        CHECK(std::remove(file.c_str()) == 0);
+    }
+    CHECK(server.removePath(path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_slices_form_one_sample(RtspServer& server) {
+    std::cout << "Testing pushNalu slices recorded as one sample..." << std::endl;
+    const std::string path = "/rec/slices";
+    PathConfig config;
+    config.path = path;
+    config.fps = kFps;
+    CHECK(server.addPath(config));
+
+    RecordConfig record;
+    record.directory = ".";
+    CHECK(server.startRecording(path, record));
+
+    std::vector<uint8_t> sps = {0x00, 0x00, 0x00, 0x01};
+    sps.insert(sps.end(), kSps.begin(), kSps.end());
+    std::vector<uint8_t> pps = {0x00, 0x00, 0x00, 0x01};
+    pps.insert(pps.end(), kPps.begin(), kPps.end());
+    const auto idr_slice = makeNalu(0x65, 500);
+    const auto p_slice = makeNalu(0x41, 300);
+
+    const int frames = 10;
+    for (int f = 0; f < frames; ++f) {
+        const uint64_t pts = f * kFrameMs;
+        if (f == 0) {
+            CHECK(server.pushNalu(path, sps.data(), sps.size(), pts, false));
+            CHECK(server.pushNalu(path, pps.data(), pps.size(), pts, false));
+        }
+        const auto& slice = (f == 0) ? idr_slice : p_slice;
+        CHECK(server.pushNalu(path, slice.data(), slice.size(), pts, false));
+        CHECK(server.pushNalu(path, slice.data(), slice.size(), pts, false));
+        CHECK(server.pushNalu(path, slice.data(), slice.size(), pts, true));
+    }
+    const std::string file = waitForFileChange(server, path, std::string());
+    CHECK(server.stopRecording(path));
+
+    const ParsedSegment segment = parseSegment(file);
+    CHECK(segment.samples == static_cast<size_t>(frames));
+    CHECK(segment.first_sample_sync);
+    for (size_t nalus : segment.nalus_per_sample) {
+        CHECK(nalus == 3);
+    }
+    CHECK(std::remove(file.c_str()) == 0);
+    CHECK(server.removePath(path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_backlog_limit_drops_frames(RtspServer& server) {
+    std::cout << "Testing record backlog limit..." << std::endl;
+    const std::string path = "/rec/backlog";
+    PathConfig config;
+    config.path = path;
+    CHECK(server.addPath(config));
+
+    RecordConfig record;
+    record.directory = ".";
+    record.max_backlog_bytes = 16;  // 任何帧都放不下
+    CHECK(server.startRecording(path, record));
+    uint64_t pts = 0;
+    pushGop(server, path, pts, 5);
+
+    RecordStats stats;
+    CHECK(server.getRecordStats(path, stats));
+    CHECK(stats.frames_dropped == 5);
+    CHECK(stats.frames_written == 0);
+    CHECK(stats.backlog_bytes == 0);
+    CHECK(stats.current_file.empty());
+    CHECK(server.stopRecording(path));
+    CHECK(server.removePath(path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running fMP4 Recorder Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Warning;
+    setLogConfig(log_config);
+
+    // 录像不依赖网络：路径存在即可推流
+    RtspServer server;
+    test_segments_rotate_on_idr(server);
+    test_slices_form_one_sample(server);
+    test_backlog_limit_drops_frames(server);
+
+    std::cout << "\n=== All fMP4 Recorder Tests Passed! ===" << std::endl;
+    return 0;
+}
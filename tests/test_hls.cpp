@@ -0,0 +1,254 @@
+/**
+ * HLS / LL-HLS 输出回归测试
+ *
+ * - 播放列表：EXT-X-MAP / PART-INF / 部分段（IDR 起始的标 INDEPENDENT）/ 完整段 / PRELOAD-HINT
+ * - init.mp4 为 ftyp + moov(avcC)，完整段等于其各部分段的拼接，部分段时长不超过 PART-TARGET
+ * - _HLS_msn/_HLS_part 阻塞重载与 preload hint 指向的部分段都等到生成后才返回
+ * - 超前太多的阻塞请求 400，未开启/已停止的路径 404
+ */
+
+#include <rtsp-server/rtsp-server.h>
+#include <rtsp-common/socket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kRtspPort = 19797;
+const uint16_t kHttpPort = 19798;
+const uint32_t kFps = 25;
+const uint64_t kFrameMs = 1000 / kFps;
+const int kGopFrames = 25;   // 1 秒一个 IDR
+
+const std::vector<uint8_t> kSps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+const std::vector<uint8_t> kPps = {0x68, 0xCE, 0x3C, 0x80};
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    size_t payload = 500;
+    if (index % kGopFrames == 0) {
+        out = {0x00, 0x00, 0x00, 0x01};
+        out.insert(out.end(), kSps.begin(), kSps.end());
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+        out.insert(out.end(), kPps.begin(), kPps.end());
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01, 0x65, 0x88});
+        payload = 2000;
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A};
+    }
+    for (size_t i = 0; i < payload; ++i) {
+        out.push_back(static_cast<uint8_t>(0x10 + (i % 0x60)));
+    }
+    return out;
+}
+
+struct HttpResult {
+    int status = 0;
+    std::string body;
+};
+
+HttpResult httpGet(const std::string& target) {
+    HttpResult result;
+    Socket s;
+    if (!s.connect("127.0.0.1", kHttpPort, 3000)) {
+        return result;
+    }
+    const std::string request = "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    if (s.send(reinterpret_cast<const uint8_t*>(request.data()), request.size()) <= 0) {
+        return result;
+    }
+    std::string response;
+    uint8_t buf[8192];
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < deadline) {
+        const ssize_t n = s.recv(buf, sizeof(buf), 500);
+        if (n > 0) {
+            response.append(reinterpret_cast<char*>(buf), static_cast<size_t>(n));
+        } else if (n == 0) {
+            break;
+        }
+    }
+    if (response.compare(0, 5, "HTTP/") == 0) {
+        result.status = std::atoi(response.c_str() + 9);
+    }
+    const size_t header_end = response.find("\r\n\r\n");
+    if (header_end != std::string::npos) {
+        result.body = response.substr(header_end + 4);
+    }
+    return result;
+}
+
+int countLines(const std::string& text, const std::string& prefix) {
+    int count = 0;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, prefix.size(), prefix) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// 解析 "#EXT-X-PART:DURATION=x,URI=..." 中的最大时长
+double maxPartDuration(const std::string& playlist) {
+    double max_duration = 0;
+    std::istringstream in(playlist);
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::string tag = "#EXT-X-PART:DURATION=";
+        if (line.compare(0, tag.size(), tag) == 0) {
+            max_duration = std::max(max_duration, std::atof(line.c_str() + tag.size()));
+        }
+    }
+    return max_duration;
+}
+
+void pushFrames(RtspServer& server, const std::string& path, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+        const auto frame = makeFrame(i);
+        CHECK(server.pushH264Data(path, frame.data(), frame.size(), i * kFrameMs, i % kGopFrames == 0));
+    }
+}
+
+void test_playlist_and_segments(RtspServer& server) {
+    std::cout << "Testing LL-HLS playlist and segments..." << std::endl;
+    PathConfig config;
+    config.path = "/live/hls";
+    config.fps = kFps;
+    CHECK(server.addPath(config));
+    HlsConfig hls;
+    hls.part_duration_ms = 200;
+    hls.segment_duration_ms = 1000;
+    hls.segment_count = 4;
+    CHECK(server.startHls(config.path, hls));
+    CHECK(!server.startHls(config.path, hls));
+    CHECK(httpGet("/live/hls/index.m3u8").status == 404);  // 还没有内容
+
+    // 3 个 GOP 加第 4 个 GOP 的前 6 帧：段 0-2 完整，段 3 已有第一个部分段（第 6 帧到达时封装前 5 帧）
+    pushFrames(server, config.path, 0, 3 * kGopFrames + 6);
+
+    const HttpResult playlist = httpGet("/live/hls/index.m3u8");
+    CHECK(playlist.status == 200);
+    const std::string& text = playlist.body;
+    CHECK(text.compare(0, 7, "#EXTM3U") == 0);
+    CHECK(text.find("#EXT-X-MAP:URI=\"init.mp4\"") != std::string::npos);
+    CHECK(text.find("#EXT-X-PART-INF:PART-TARGET=0.200") != std::string::npos);
+    CHECK(text.find("CAN-BLOCK-RELOAD=YES") != std::string::npos);
+    CHECK(text.find("#EXT-X-MEDIA-SEQUENCE:0") != std::string::npos);
+    CHECK(countLines(text, "#EXTINF:1.000,") == 3);
+    CHECK(text.find("seg2.m4s") != std::string::npos);
+    CHECK(text.find("URI=\"part3.0.m4s\",INDEPENDENT=YES") != std::string::npos);
+    CHECK(text.find("#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part3.1.m4s\"") != std::string::npos);
+    CHECK(maxPartDuration(text) > 0.0 && maxPartDuration(text) <= 0.2);
+
+    const HttpResult init = httpGet("/live/hls/init.mp4");
+    CHECK(init.status == 200);
+    CHECK(init.body.size() > 8 && init.body.compare(4, 4, "ftyp") == 0);
+    CHECK(init.body.find("avcC") != std::string::npos);
+
+    // 完整段 = 各部分段拼接
+    const HttpResult segment = httpGet("/live/hls/seg1.m4s");
+    CHECK(segment.status == 200);
+    CHECK(segment.body.compare(4, 4, "moof") == 0);
+    std::string joined;
+    for (int i = 0;; ++i) {
+        const std::string uri = "part1." + std::to_string(i) + ".m4s";
+        if (text.find(uri) == std::string::npos) {
+            break;
+        }
+        const HttpResult part = httpGet("/live/hls/" + uri);
+        CHECK(part.status == 200);
+        joined += part.body;
+    }
+    CHECK(!joined.empty());
+    CHECK(joined == segment.body);
+
+    CHECK(httpGet("/live/hls/seg99.m4s").status == 404);
+    CHECK(httpGet("/live/none/index.m3u8").status == 404);
+    CHECK(httpGet("/live/hls/index.m3u8?_HLS_msn=9").status == 400);
+
+    // 阻塞重载与 preload hint：请求先发出，推流后才返回
+    auto blocked_playlist = std::async(std::launch::async, [] {
+        return httpGet("/live/hls/index.m3u8?_HLS_msn=3&_HLS_part=1");
+    });
+    auto blocked_part = std::async(std::launch::async, [] {
+        return httpGet("/live/hls/part3.1.m4s");
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(blocked_playlist.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready);
+    CHECK(blocked_part.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready);
+    pushFrames(server, config.path, 3 * kGopFrames + 6, 3 * kGopFrames + 12);
+    const HttpResult reloaded = blocked_playlist.get();
+    CHECK(reloaded.status == 200);
+    CHECK(reloaded.body.find("URI=\"part3.1.m4s\"") != std::string::npos);
+    const HttpResult hinted = blocked_part.get();
+    CHECK(hinted.status == 200);
+    CHECK(hinted.body.compare(4, 4, "moof") == 0);
+
+    CHECK(server.stopHls(config.path));
+    CHECK(!server.stopHls(config.path));
+    CHECK(httpGet("/live/hls/index.m3u8").status == 404);
+    CHECK(server.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_segment_window(RtspServer& server) {
+    std::cout << "Testing segment window and removePath..." << std::endl;
+    PathConfig config;
+    config.path = "/live/window";
+    config.fps = kFps;
+    CHECK(server.addPath(config));
+    HlsConfig hls;
+    hls.segment_duration_ms = 1000;
+    hls.segment_count = 2;
+    CHECK(server.startHls(config.path, hls));
+    pushFrames(server, config.path, 0, 6 * kGopFrames + 1);
+
+    const HttpResult playlist = httpGet("/live/window/index.m3u8");
+    CHECK(playlist.status == 200);
+    CHECK(countLines(playlist.body, "#EXTINF:") == 2);
+    CHECK(playlist.body.find("#EXT-X-MEDIA-SEQUENCE:4") != std::string::npos);
+    CHECK(httpGet("/live/window/seg3.m4s").status == 404);
+    CHECK(httpGet("/live/window/seg5.m4s").status == 200);
+
+    CHECK(server.removePath(config.path));
+    CHECK(httpGet("/live/window/index.m3u8").status == 404);
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running HLS Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Warning;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kRtspPort));
+    CHECK(server.start());
+    CHECK(server.startHlsServer(kHttpPort, "127.0.0.1"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    test_playlist_and_segments(server);
+    test_segment_window(server);
+
+    server.stop();
+    std::cout << "\n=== All HLS Tests Passed! ===" << std::endl;
+    return 0;
+}
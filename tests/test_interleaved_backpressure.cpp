@@ -0,0 +1,174 @@
+/**
+ * interleaved 慢连接不拖累共享发送线程
+ *
+ * - 只有一个发送线程（send_threads = 1）；一个 RTP over TCP 播放端 PLAY 后不再读
+ * - 同时在播的 UDP 播放端帧间隔保持均匀：发送 worker 只做非阻塞写，不等慢连接
+ * - 对端持续不收时服务端关闭该连接
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-common/socket.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19821;
+const uint64_t kFrameMs = 40;
+const int kUdpViewers = 2;
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    if (index % 25 == 0) {
+        out = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8,
+               0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+               0x00, 0x00, 0x00, 0x01, 0x65, 0x88};
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A};
+    }
+    // 每秒约 1.2MB：几秒内就能填满不读的 TCP 连接的内核缓冲
+    out.resize(out.size() + 48000, 0x42);
+    return out;
+}
+
+// 发一个请求并读到响应头结束；读不到返回空
+std::string request(Socket& sock, const std::string& text) {
+    CHECK(sock.send(reinterpret_cast<const uint8_t*>(text.data()), text.size()) ==
+          static_cast<ssize_t>(text.size()));
+    std::string reply;
+    uint8_t buf[2048];
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (reply.find("\r\n\r\n") == std::string::npos && std::chrono::steady_clock::now() < deadline) {
+        const ssize_t n = sock.recv(buf, sizeof(buf), 200);
+        if (n > 0) {
+            reply.append(reinterpret_cast<const char*>(buf), static_cast<size_t>(n));
+        } else if (n == 0) {
+            break;
+        }
+    }
+    return reply;
+}
+
+// 每个 UDP 播放端记录相邻两帧到达的最大间隔
+struct UdpViewer {
+    RtspClient client;
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point last_frame;
+    int64_t max_gap_ms = 0;
+    int frames = 0;
+};
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Interleaved Backpressure Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = kPort;
+    config.send_threads = 1;
+    RtspServer server;
+    CHECK(server.init(config));
+    PathConfig path;
+    path.path = "/live/test";
+    path.codec = CodecType::H264;
+    CHECK(server.addPath(path));
+    CHECK(server.start());
+
+    const std::string url = "rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test";
+
+    // 不读的 interleaved 播放端：PLAY 之后再也不 recv，缩小接收缓冲让积压尽早出现
+    Socket stalled;
+    CHECK(stalled.connect("127.0.0.1", kPort, 2000));
+    stalled.setRecvBufferSize(4096);
+    CHECK(request(stalled, "DESCRIBE " + url + " RTSP/1.0\r\nCSeq: 1\r\nAccept: application/sdp\r\n\r\n")
+              .find("200 OK") != std::string::npos);
+    const std::string setup_reply =
+        request(stalled, "SETUP " + url + "/stream RTSP/1.0\r\nCSeq: 2\r\n"
+                         "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n\r\n");
+    CHECK(setup_reply.find("200 OK") != std::string::npos);
+    const size_t session_pos = setup_reply.find("Session: ");
+    CHECK(session_pos != std::string::npos);
+    const std::string session_id =
+        setup_reply.substr(session_pos + 9, setup_reply.find_first_of(";\r", session_pos) - session_pos - 9);
+    CHECK(request(stalled, "PLAY " + url + " RTSP/1.0\r\nCSeq: 3\r\nSession: " + session_id + "\r\n\r\n")
+              .find("200 OK") != std::string::npos);
+
+    std::vector<std::unique_ptr<UdpViewer>> viewers;
+    for (int i = 0; i < kUdpViewers; ++i) {
+        viewers.emplace_back(new UdpViewer());
+        UdpViewer* viewer = viewers.back().get();
+        RtspClientConfig cfg;
+        cfg.prefer_tcp_transport = false;
+        cfg.fallback_to_tcp = false;
+        viewer->client.setConfig(cfg);
+        viewer->client.setFrameCallback([viewer](const VideoFrame&) {
+            const auto now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(viewer->mutex);
+            if (viewer->frames > 0) {
+                const int64_t gap = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                        now - viewer->last_frame).count();
+                viewer->max_gap_ms = std::max(viewer->max_gap_ms, gap);
+            }
+            viewer->last_frame = now;
+            viewer->frames++;
+        });
+        CHECK(viewer->client.open(url));
+        CHECK(viewer->client.describe());
+        CHECK(viewer->client.setup(0));
+        CHECK(viewer->client.play(0));
+    }
+
+    // 推 6 秒：期间 interleaved 连接的缓冲早已写满，随后因持续不收被服务端关闭
+    const int kFrames = 150;
+    auto next_frame = std::chrono::steady_clock::now();
+    for (int i = 0; i < kFrames; ++i) {
+        const auto frame = makeFrame(i);
+        CHECK(server.pushH264Data("/live/test", frame.data(), frame.size(), i * kFrameMs, i % 25 == 0));
+        next_frame += std::chrono::milliseconds(kFrameMs);
+        std::this_thread::sleep_until(next_frame);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    for (auto& viewer : viewers) {
+        std::lock_guard<std::mutex> lock(viewer->mutex);
+        std::cout << "  udp viewer: frames=" << viewer->frames << " max_gap_ms=" << viewer->max_gap_ms
+                  << std::endl;
+        CHECK(viewer->frames >= kFrames * 8 / 10);
+        // 原先慢连接的阻塞写会占住唯一的发送线程最多 2 秒
+        CHECK(viewer->max_gap_ms < 500);
+    }
+
+    // 不读的连接已被服务端关闭，其会话随之移除，只剩 UDP 播放端
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (server.getLoad().sessions != kUdpViewers && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(server.getLoad().sessions == kUdpViewers);
+    std::cout << "  PASSED" << std::endl;
+
+    for (auto& viewer : viewers) {
+        viewer->client.close();
+    }
+    stalled.close();
+    server.stop();
+    std::cout << "\n=== All Interleaved Backpressure Tests Passed! ===" << std::endl;
+    return 0;
+}
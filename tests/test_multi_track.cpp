@@ -0,0 +1,396 @@
+/**
+ * 多轨会话回归测试
+ *
+ * - RtspPublisher 一个会话 ANNOUNCE/SETUP/RECORD 两路视频，内置 server 以
+ *   "<path>" 与 "<path>/streamid=1" 分别对外提供主/子码流
+ * - RtspClient 在一个会话内 SETUP 两路流（TCP interleaved 0-1 / 2-3），
+ *   聚合 PLAY 后按轨道回调收帧
+ * - 只 SETUP 第 1 轨的推流会话同样挂到主路径上（会超时清理）；ANNOUNCE 新建的子路径
+ *   在推流会话结束（TEARDOWN / 超时）后移除，主路径保留
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-publisher/rtsp-publisher.h>
+#include <rtsp-server/rtsp-server.h>
+#include <rtsp-common/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+std::vector<uint8_t> makeIdr(size_t payload_bytes) {
+    std::vector<uint8_t> idr = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x28,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+        0x00, 0x00, 0x00, 0x01, 0x65
+    };
+    for (size_t i = 0; i < payload_bytes; ++i) {
+        idr.push_back(static_cast<uint8_t>(0x10 + (i & 0x3F)));
+    }
+    return idr;
+}
+
+bool pullOneFrame(uint16_t port, const std::string& path,
+                  RtspPublisher& publisher, size_t track,
+                  const std::vector<uint8_t>& idr, VideoFrame* out) {
+    RtspClient client;
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = true;
+    client.setConfig(cfg);
+    if (!client.open("rtsp://127.0.0.1:" + std::to_string(port) + path)) return false;
+    if (!client.describe() || !client.setup(0) || !client.play(0)) return false;
+    bool got = false;
+    for (int i = 0; i < 20 && !got; ++i) {
+        publisher.pushH264Data(track, idr.data(), idr.size(), static_cast<uint64_t>(i * 40), true);
+        got = client.receiveFrame(*out, 200);
+    }
+    client.close();
+    return got;
+}
+
+void test_publisher_two_tracks_one_session() {
+    std::cout << "Testing multi-track publish in one session..." << std::endl;
+
+    const uint16_t port = 19790;
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", port));
+    CHECK(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    RtspPublisher publisher;
+    RtspPublishConfig publish_config;
+    publish_config.local_rtp_port = 25160;
+    publisher.setConfig(publish_config);
+    CHECK(publisher.open("rtsp://127.0.0.1:" + std::to_string(port) + "/live/cam"));
+
+    PublishMediaInfo main_stream;
+    main_stream.width = 1280;
+    main_stream.height = 720;
+    main_stream.sps = {0x67, 0x42, 0x00, 0x28};
+    main_stream.pps = {0x68, 0xCE, 0x3C, 0x80};
+    PublishMediaInfo sub_stream = main_stream;
+    sub_stream.width = 640;
+    sub_stream.height = 360;
+    CHECK(publisher.announce(std::vector<PublishMediaInfo>{main_stream, sub_stream}));
+    CHECK(publisher.setup());
+    CHECK(publisher.record());
+
+    const auto main_idr = makeIdr(64);
+    const auto sub_idr = makeIdr(16);
+
+    VideoFrame frame{};
+    CHECK(pullOneFrame(port, "/live/cam", publisher, 0, main_idr, &frame));
+    CHECK(frame.size == main_idr.size());
+    CHECK(frame.width == 1280);
+
+    CHECK(pullOneFrame(port, "/live/cam/streamid=1", publisher, 1, sub_idr, &frame));
+    CHECK(frame.size == sub_idr.size());
+    CHECK(frame.width == 640);
+
+    // 越界轨道直接拒绝
+    CHECK(!publisher.pushH264Data(2, sub_idr.data(), sub_idr.size(), 0, true));
+
+    publisher.close();
+    server.stop();
+    std::cout << "multi-track publish passed!" << std::endl;
+}
+
+// 最小化的双轨 mock server：TCP interleaved，两轨分别在通道 0 / 2 上发送单 NALU RTP 包
+struct TwoTrackMockServer {
+    uint16_t port;
+    Socket listen_socket;
+    std::unique_ptr<Socket> conn;
+    std::thread thread;
+    std::mutex mutex;
+    std::atomic<int> setups_with_session{0};
+    std::vector<std::string> interleaved_requested;
+
+    explicit TwoTrackMockServer(uint16_t p) : port(p) {}
+
+    ~TwoTrackMockServer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (conn) conn->close();
+            listen_socket.close();
+        }
+        if (thread.joinable()) thread.join();
+    }
+
+    static std::string readRequest(Socket& sock) {
+        std::string buffer;
+        uint8_t tmp[4096];
+        while (buffer.find("\r\n\r\n") == std::string::npos) {
+            ssize_t n = sock.recv(tmp, sizeof(tmp), 3000);
+            if (n <= 0) return "";
+            buffer.append(reinterpret_cast<const char*>(tmp), static_cast<size_t>(n));
+        }
+        return buffer;
+    }
+
+    static std::string header(const std::string& req, const std::string& re) {
+        std::smatch m;
+        if (std::regex_search(req, m, std::regex(re, std::regex::icase))) return m[1].str();
+        return "";
+    }
+
+    void reply(int cseq, const std::string& extra, const std::string& body = "") {
+        std::string resp = "RTSP/1.0 200 OK\r\nCSeq: " + std::to_string(cseq) + "\r\n" + extra;
+        if (!body.empty()) resp += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        resp += "\r\n" + body;
+        conn->sendAll(reinterpret_cast<const uint8_t*>(resp.data()), resp.size(), 1000);
+    }
+
+    void sendInterleaved(uint8_t channel, uint16_t seq, uint32_t ssrc, const std::vector<uint8_t>& nalu) {
+        std::vector<uint8_t> pkt(4 + 12 + nalu.size());
+        pkt[0] = '$';
+        pkt[1] = channel;
+        pkt[2] = static_cast<uint8_t>(((12 + nalu.size()) >> 8) & 0xFF);
+        pkt[3] = static_cast<uint8_t>((12 + nalu.size()) & 0xFF);
+        uint8_t* rtp = pkt.data() + 4;
+        rtp[0] = 0x80;
+        rtp[1] = 0x80 | 96;
+        rtp[2] = static_cast<uint8_t>(seq >> 8);
+        rtp[3] = static_cast<uint8_t>(seq & 0xFF);
+        const uint32_t ts = 3000u * seq;
+        rtp[4] = static_cast<uint8_t>(ts >> 24);
+        rtp[5] = static_cast<uint8_t>(ts >> 16);
+        rtp[6] = static_cast<uint8_t>(ts >> 8);
+        rtp[7] = static_cast<uint8_t>(ts);
+        rtp[8] = static_cast<uint8_t>(ssrc >> 24);
+        rtp[9] = static_cast<uint8_t>(ssrc >> 16);
+        rtp[10] = static_cast<uint8_t>(ssrc >> 8);
+        rtp[11] = static_cast<uint8_t>(ssrc);
+        memcpy(rtp + 12, nalu.data(), nalu.size());
+        conn->sendAll(pkt.data(), pkt.size(), 1000);
+    }
+
+    void start() {
+        CHECK(listen_socket.bind("127.0.0.1", port));
+        CHECK(listen_socket.listen());
+        thread = std::thread([this]() { run(); });
+    }
+
+    void run() {
+        auto accepted = listen_socket.accept();
+        if (!accepted) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            conn = std::move(accepted);
+        }
+        const std::string sdp =
+            "v=0\r\n"
+            "o=- 1 1 IN IP4 127.0.0.1\r\n"
+            "s=TwoTrack\r\n"
+            "c=IN IP4 0.0.0.0\r\n"
+            "t=0 0\r\n"
+            "m=video 0 RTP/AVP 96\r\n"
+            "a=rtpmap:96 H264/90000\r\n"
+            "a=control:track1\r\n"
+            "m=audio 0 RTP/AVP 0\r\n"
+            "a=control:audio\r\n"
+            "m=video 0 RTP/AVP 96\r\n"
+            "a=rtpmap:96 H264/90000\r\n"
+            "a=control:track2\r\n";
+        while (true) {
+            const std::string req = readRequest(*conn);
+            if (req.empty()) return;
+            const int cseq = std::stoi(header(req, "CSeq:\\s*(\\d+)"));
+            if (req.rfind("DESCRIBE ", 0) == 0) {
+                reply(cseq, "Content-Type: application/sdp\r\n", sdp);
+            } else if (req.rfind("SETUP ", 0) == 0) {
+                if (!header(req, "Session:\\s*([^\\r\\n]+)").empty()) {
+                    setups_with_session++;
+                }
+                const std::string channels = header(req, "interleaved=(\\d+-\\d+)");
+                interleaved_requested.push_back(channels);
+                reply(cseq, "Transport: RTP/AVP/TCP;unicast;interleaved=" + channels +
+                            "\r\nSession: 4242;timeout=60\r\n");
+            } else if (req.rfind("PLAY ", 0) == 0) {
+                reply(cseq, "Session: 4242\r\n");
+                for (uint16_t seq = 1; seq <= 3; ++seq) {
+                    sendInterleaved(0, seq, 0x1111, {0x65, 0x01, 0x02, 0x03});
+                    sendInterleaved(2, seq, 0x2222, {0x65, 0x0A, 0x0B});
+                }
+            } else {
+                reply(cseq, "");
+                if (req.rfind("TEARDOWN ", 0) == 0) return;
+            }
+        }
+    }
+};
+
+void test_client_two_streams_one_session() {
+    std::cout << "Testing multi-stream pull in one session..." << std::endl;
+
+    TwoTrackMockServer mock(19791);
+    mock.start();
+
+    RtspClient client;
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = true;
+    client.setConfig(cfg);
+
+    std::mutex mu;
+    std::vector<int> frames_per_track(2, 0);
+    std::vector<size_t> size_per_track(2, 0);
+    client.setTrackFrameCallback([&](int stream_index, const VideoFrame& frame) {
+        std::lock_guard<std::mutex> lock(mu);
+        CHECK(stream_index == 0 || stream_index == 1);
+        frames_per_track[static_cast<size_t>(stream_index)]++;
+        size_per_track[static_cast<size_t>(stream_index)] = frame.size;
+    });
+
+    CHECK(client.open("rtsp://127.0.0.1:19791/cam"));
+    CHECK(client.describe());
+    // 音频段被跳过，只剩两路视频
+    CHECK(client.getSessionInfo().media_streams.size() == 2);
+    CHECK(client.setupAll());
+    CHECK(client.play(0));
+
+    // 单流兼容接口只收首轨
+    VideoFrame frame{};
+    CHECK(client.receiveFrame(frame, 2000));
+    CHECK(frame.size == 4 + 4);
+
+    for (int i = 0; i < 50; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            if (frames_per_track[0] >= 2 && frames_per_track[1] >= 2) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        CHECK(frames_per_track[0] >= 2);
+        CHECK(frames_per_track[1] >= 2);
+        CHECK(size_per_track[0] == 4 + 4);
+        CHECK(size_per_track[1] == 4 + 3);
+    }
+
+    client.close();
+
+    CHECK(mock.setups_with_session.load() == 1);
+    CHECK(mock.interleaved_requested.size() == 2);
+    CHECK(mock.interleaved_requested[0] == "0-1");
+    CHECK(mock.interleaved_requested[1] == "2-3");
+    std::cout << "multi-stream pull passed!" << std::endl;
+}
+
+// 裸 RTSP 推流端：发一条请求并读回应答，返回状态码，session 非空时带上 Session 头
+int rawRequest(Socket& sock, const std::string& method, const std::string& url, int cseq,
+               const std::string& headers, const std::string& body, std::string* session) {
+    std::string request = method + " " + url + " RTSP/1.0\r\nCSeq: " + std::to_string(cseq) + "\r\n" + headers;
+    if (session && !session->empty()) {
+        request += "Session: " + *session + "\r\n";
+    }
+    if (!body.empty()) {
+        request += "Content-Type: application/sdp\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    request += "\r\n" + body;
+    if (sock.sendAll(reinterpret_cast<const uint8_t*>(request.data()), request.size(), 2000) !=
+        static_cast<ssize_t>(request.size())) {
+        return -1;
+    }
+    std::string response;
+    if (!recvRtspMessage(sock, &response, 2000) || response.size() < 12) {
+        return -1;
+    }
+    std::smatch m;
+    static const std::regex session_re("Session: ([^;\r\n]+)");
+    if (session && std::regex_search(response, m, session_re)) {
+        *session = m[1].str();
+    }
+    return std::atoi(response.c_str() + 9);
+}
+
+bool hasPath(const RtspServer& server, const std::string& path) {
+    for (const auto& config : server.getPathsSnapshot()) {
+        if (config.path == path) return true;
+    }
+    return false;
+}
+
+void test_publisher_sub_track_only() {
+    std::cout << "Testing publisher that sets up only the second track..." << std::endl;
+
+    const uint16_t port = 19820;
+    RtspServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = port;
+    config.session_timeout_ms = 300;
+    RtspServer server;
+    CHECK(server.init(config));
+    CHECK(server.start());
+
+    const std::string base = "rtsp://127.0.0.1:" + std::to_string(port) + "/live/raw";
+    const std::string sdp =
+        "v=0\r\no=- 0 0 IN IP4 127.0.0.1\r\ns=raw\r\nc=IN IP4 127.0.0.1\r\nt=0 0\r\n"
+        "m=video 0 RTP/AVP 96\r\na=rtpmap:96 H264/90000\r\na=control:streamid=0\r\n"
+        "m=video 0 RTP/AVP 97\r\na=rtpmap:97 H264/90000\r\na=control:streamid=1\r\n";
+
+    // 1. 只 SETUP 子轨并 RECORD 后不再发请求：会话挂在主路径上，超时后连同子路径一起清理
+    {
+        Socket sock;
+        CHECK(sock.connect("127.0.0.1", port, 2000));
+        std::string session;
+        CHECK(rawRequest(sock, "ANNOUNCE", base, 1, "", sdp, &session) == 200);
+        CHECK(hasPath(server, "/live/raw") && hasPath(server, "/live/raw/streamid=1"));
+        CHECK(rawRequest(sock, "SETUP", base + "/streamid=1", 2,
+                         "Transport: RTP/AVP;unicast;client_port=25170-25171;mode=record\r\n", "", &session) == 200);
+        CHECK(rawRequest(sock, "RECORD", base, 3, "", "", &session) == 200);
+        CHECK(server.getStats().sessions_created == 1);
+
+        bool expired = false;
+        for (int i = 0; i < 100 && !expired; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            expired = server.getStats().sessions_closed == 1;
+        }
+        CHECK(expired);
+        CHECK(!hasPath(server, "/live/raw/streamid=1"));
+        CHECK(hasPath(server, "/live/raw"));
+        sock.close();
+    }
+
+    // 2. TEARDOWN 立即移除本次 ANNOUNCE 新建的子路径
+    {
+        Socket sock;
+        CHECK(sock.connect("127.0.0.1", port, 2000));
+        std::string session;
+        CHECK(rawRequest(sock, "ANNOUNCE", base, 1, "", sdp, &session) == 200);
+        CHECK(hasPath(server, "/live/raw/streamid=1"));
+        CHECK(rawRequest(sock, "SETUP", base + "/streamid=1", 2,
+                         "Transport: RTP/AVP;unicast;client_port=25172-25173;mode=record\r\n", "", &session) == 200);
+        CHECK(rawRequest(sock, "TEARDOWN", base, 3, "", "", &session) == 200);
+        CHECK(!hasPath(server, "/live/raw/streamid=1"));
+        CHECK(hasPath(server, "/live/raw"));
+        sock.close();
+    }
+
+    server.stop();
+    std::cout << "sub-track-only publish passed!" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Multi-Track Session Tests ===" << std::endl;
+    test_publisher_two_tracks_one_session();
+    test_client_two_streams_one_session();
+    test_publisher_sub_track_only();
+    std::cout << "\n=== All Multi-Track Session Tests Passed! ===" << std::endl;
+    return 0;
+}
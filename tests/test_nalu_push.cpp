@@ -0,0 +1,271 @@
+/**
+ * 按 slice 推送（RtspServer::pushNalu）回归测试
+ *
+ * - 一个 AU 分两次推送，客户端依靠 AU 末包的 marker 立即出帧，无需等下一帧
+ * - 裸 NALU（无起始码）会被补齐为 Annex-B
+ * - IDR 缓存在 AU 结束后整体更新，新加入的客户端拿到完整 IDR
+ * - 客户端 NALU 回调：AU 未结束时已完整的 slice 立即交付，帧回调照常出整帧
+ * - 队列满时发送方正发到 AU 中途：不丢该 AU 的剩余 slice，客户端收到的每帧都完整
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19792;
+const uint16_t kEarlyPort = 19793;
+const uint16_t kOverflowPort = 19822;
+
+std::vector<uint8_t> makeSlice(uint8_t nal_header, size_t payload_bytes, bool with_start_code) {
+    std::vector<uint8_t> out;
+    if (with_start_code) {
+        out = {0x00, 0x00, 0x00, 0x01};
+    }
+    out.push_back(nal_header);
+    for (size_t i = 0; i < payload_bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(0x20 + (i % 0x40)));
+    }
+    return out;
+}
+
+bool openClient(RtspClient& client, bool tcp, uint16_t port = kPort,
+                const std::string& path = "/live/slice") {
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = tcp;
+    client.setConfig(cfg);
+    return client.open("rtsp://127.0.0.1:" + std::to_string(port) + path) &&
+           client.describe() && client.setup(0) && client.play(0);
+}
+
+void test_server_push_nalu() {
+    std::cout << "Testing server pushNalu..." << std::endl;
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    PathConfig cfg;
+    cfg.path = "/live/slice";
+    cfg.codec = CodecType::H264;
+    cfg.width = 640;
+    cfg.height = 480;
+    CHECK(server.addPath(cfg));
+    CHECK(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    CHECK(!server.pushNalu("/live/missing", nullptr, 0, 0, true));
+
+    RtspClient client;
+    CHECK(openClient(client, true));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // AU 片段 0：SPS + PPS + 第一个 IDR slice（带起始码，跨多个 RTP 包）
+    std::vector<uint8_t> part0 = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E,
+                                  0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80};
+    const auto slice0 = makeSlice(0x65, 4000, true);
+    part0.insert(part0.end(), slice0.begin(), slice0.end());
+    // AU 片段 1：第二个 IDR slice，裸 NALU
+    const auto slice1 = makeSlice(0x65, 300, false);
+
+    CHECK(server.pushNalu("/live/slice", part0.data(), part0.size(), 1000, false));
+
+    VideoFrame frame{};
+    // AU 尚未结束，客户端不应出帧
+    CHECK(!client.receiveFrame(frame, 200));
+
+    CHECK(server.pushNalu("/live/slice", slice1.data(), slice1.size(), 1000, true));
+    // 末片带 marker：不需要下一帧到来即可出帧
+    CHECK(client.receiveFrame(frame, 1000));
+    CHECK(frame.type == FrameType::IDR);
+    CHECK(frame.size == part0.size() + 4 + slice1.size());
+
+    // 新客户端通过 IDR 缓存拿到完整的拼装帧（UDP：缓存帧紧跟 PLAY 发出）
+    RtspClient late_client;
+    CHECK(openClient(late_client, false));
+    VideoFrame cached{};
+    CHECK(late_client.receiveFrame(cached, 1000));
+    CHECK(cached.type == FrameType::IDR);
+    CHECK(cached.size == frame.size);
+
+    const RtspServerStats stats = server.getStats();
+    CHECK(stats.frames_pushed == 1);
+
+    // 参数集已从 slice 中自动提取
+    const auto paths = server.getPathsSnapshot();
+    CHECK(paths.size() == 1);
+    CHECK(paths[0].sps.size() == 4);
+    CHECK(paths[0].pps.size() == 4);
+
+    late_client.close();
+    client.close();
+    server.stop();
+    std::cout << "server pushNalu passed!" << std::endl;
+}
+
+void test_client_nalu_callback() {
+    std::cout << "Testing client NALU callback..." << std::endl;
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kEarlyPort));
+    PathConfig cfg;
+    cfg.path = "/live/early";
+    cfg.codec = CodecType::H264;
+    CHECK(server.addPath(cfg));
+    CHECK(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::mutex mu;
+    std::vector<ReceivedNalu> nalus;  // data 仅回调内有效，这里只记录元信息
+    int frames = 0;
+    RtspClient client;
+    client.setNaluCallback([&](const ReceivedNalu& nalu) {
+        std::lock_guard<std::mutex> lock(mu);
+        ReceivedNalu meta = nalu;
+        meta.data = nullptr;
+        nalus.push_back(meta);
+    });
+    client.setFrameCallback([&](const VideoFrame&) {
+        std::lock_guard<std::mutex> lock(mu);
+        frames++;
+    });
+    CHECK(openClient(client, true, kEarlyPort, "/live/early"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto waitNalus = [&](size_t count) {
+        for (int i = 0; i < 100; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                if (nalus.size() >= count) return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    };
+
+    // slice 0 走 FU-A 分片，重组完成后即交付；此时 AU 尚未结束，不应出帧
+    const auto slice0 = makeSlice(0x65, 3000, true);
+    const auto slice1 = makeSlice(0x65, 200, true);
+    CHECK(server.pushNalu("/live/early", slice0.data(), slice0.size(), 40, false));
+    CHECK(waitNalus(1));
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        CHECK(frames == 0);
+        CHECK(nalus[0].nal_type == 5);
+        CHECK(nalus[0].size == slice0.size());
+        CHECK(nalus[0].pts == 40);
+        CHECK(nalus[0].access_unit_start);
+        CHECK(!nalus[0].access_unit_end);
+    }
+
+    CHECK(server.pushNalu("/live/early", slice1.data(), slice1.size(), 40, true));
+    CHECK(waitNalus(2));
+    VideoFrame frame{};
+    CHECK(client.receiveFrame(frame, 1000));
+    CHECK(frame.size == slice0.size() + slice1.size());
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        CHECK(frames == 1);
+        CHECK(nalus[1].size == slice1.size());
+        CHECK(!nalus[1].access_unit_start);
+        CHECK(nalus[1].access_unit_end);
+    }
+
+    // 下一 AU 的首个 NALU 重新标记 access_unit_start
+    const auto p_slice = makeSlice(0x41, 100, true);
+    CHECK(server.pushNalu("/live/early", p_slice.data(), p_slice.size(), 80, true));
+    CHECK(waitNalus(3));
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        CHECK(nalus[2].nal_type == 1);
+        CHECK(nalus[2].access_unit_start);
+        CHECK(nalus[2].access_unit_end);
+    }
+
+    client.close();
+    server.stop();
+    std::cout << "client NALU callback passed!" << std::endl;
+}
+
+void test_overflow_mid_au() {
+    std::cout << "Testing queue overflow while an AU is mid-send..." << std::endl;
+
+    RtspServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = kOverflowPort;
+    config.send_threads = 1;
+    RtspServer server;
+    CHECK(server.init(config));
+    PathConfig cfg;
+    cfg.path = "/live/burst";
+    cfg.codec = CodecType::H264;
+    CHECK(server.addPath(cfg));
+    CHECK(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // 每个 AU 4 个 slice；不限速推送，唯一的发送线程跟不上，队列反复写满，
+    // 溢出时发送线程多半正停在某个 AU 中途
+    const int kSlices = 4;
+    const int kAccessUnits = 600;
+    const auto idr = makeSlice(0x65, 1200, true);
+    const auto p_slice = makeSlice(0x41, 1200, true);
+    const size_t idr_au_size = idr.size() * kSlices;
+    const size_t p_au_size = p_slice.size() * kSlices;
+
+    std::atomic<int> frames{0};
+    std::atomic<int> broken{0};
+    RtspClient clients[3];
+    for (auto& client : clients) {
+        client.setFrameCallback([&](const VideoFrame& frame) {
+            frames++;
+            if (frame.size != idr_au_size && frame.size != p_au_size) {
+                broken++;
+            }
+        });
+        CHECK(openClient(client, true, kOverflowPort, "/live/burst"));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    for (int au = 0; au < kAccessUnits; ++au) {
+        const auto& slice = au % 50 == 0 ? idr : p_slice;
+        for (int i = 0; i < kSlices; ++i) {
+            CHECK(server.pushNalu("/live/burst", slice.data(), slice.size(),
+                                  static_cast<uint64_t>(au) * 40, i == kSlices - 1));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    std::cout << "  frames=" << frames.load() << "/" << kAccessUnits * 3 << " broken=" << broken.load()
+              << std::endl;
+    CHECK(frames.load() > 0);
+    // 原先溢出时把发送中 AU 的剩余 slice 一并丢掉，客户端收到缺 slice、无 marker 的半帧
+    CHECK(broken.load() == 0);
+
+    for (auto& client : clients) {
+        client.close();
+    }
+    server.stop();
+    std::cout << "queue overflow mid-AU passed!" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Slice-Level Push Tests ===" << std::endl;
+    test_server_push_nalu();
+    test_client_nalu_callback();
+    test_overflow_mid_au();
+    std::cout << "\n=== All Slice-Level Push Tests Passed! ===" << std::endl;
+    return 0;
+}
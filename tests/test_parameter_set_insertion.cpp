@@ -0,0 +1,248 @@
+/**
+ * 打包时参数集补发测试
+ *
+ * - H.264：不带 SPS 的 IDR 前补一个 STAP-A（SPS+PPS），P 帧不补
+ * - AU 已自带 SPS 时不补，且流内参数集更新缓存
+ * - pushNalu 式分片 AU：只在第一个 IDR slice 前补一次
+ * - H.265：补一个 AP（VPS+SPS+PPS）
+ * - 端到端：PathConfig::insert_parameter_sets 开启后，关闭 sprop 插入的客户端也能在 IDR 前拿到 SPS/PPS
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+#include <rtsp-common/rtp_packer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19814;
+const int kGop = 5;
+const std::vector<uint8_t> kSps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+const std::vector<uint8_t> kPps = {0x68, 0xCE, 0x3C, 0x80};
+
+std::vector<uint8_t> annexB(std::initializer_list<std::vector<uint8_t>> nalus) {
+    std::vector<uint8_t> out;
+    for (const auto& nalu : nalus) {
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+        out.insert(out.end(), nalu.begin(), nalu.end());
+    }
+    return out;
+}
+
+std::vector<uint8_t> slice(uint8_t header, size_t body) {
+    std::vector<uint8_t> nalu(1 + body, 0x42);
+    nalu[0] = header;
+    return nalu;
+}
+
+std::vector<RtpPacket> pack(RtpPacker& packer, const std::vector<uint8_t>& data, bool end_of_au = true) {
+    VideoFrame frame{};
+    frame.data = const_cast<uint8_t*>(data.data());
+    frame.size = data.size();
+    frame.pts = 40;
+    return packer.packNalus(frame, end_of_au);
+}
+
+void freePackets(std::vector<RtpPacket>& packets) {
+    for (auto& packet : packets) {
+        delete[] packet.data;
+    }
+    packets.clear();
+}
+
+// 校验聚合包内逐个（16 位长度 + NALU）与期望一致
+void checkAggregate(const RtpPacket& packet, size_t header_size,
+                    const std::vector<std::vector<uint8_t>>& expected) {
+    size_t off = 12 + header_size;
+    for (const auto& nalu : expected) {
+        CHECK(off + 2 <= packet.size);
+        const size_t len = (static_cast<size_t>(packet.data[off]) << 8) | packet.data[off + 1];
+        CHECK(len == nalu.size());
+        CHECK(std::equal(nalu.begin(), nalu.end(), packet.data + off + 2));
+        off += 2 + len;
+    }
+    CHECK(off == packet.size);
+}
+
+void test_h264_stap_a_before_idr() {
+    std::cout << "Testing STAP-A insertion before an IDR without SPS..." << std::endl;
+    H264RtpPacker packer;
+    packer.setParameterSets({}, kSps, kPps);
+
+    auto packets = pack(packer, annexB({{0x09, 0x10}, slice(0x65, 200)}));
+    CHECK(packets.size() == 3);
+    CHECK((packets[0].data[12] & 0x1F) == 9);
+    CHECK(packets[1].data[12] == (0x60 | 24));     // NRI 取 SPS/PPS 中最大（3）
+    checkAggregate(packets[1], 1, {kSps, kPps});
+    CHECK(packets[1].timestamp == packets[2].timestamp && !packets[1].marker);
+    CHECK((packets[2].data[12] & 0x1F) == 5 && packets[2].marker);
+    CHECK(packets[1].seq == static_cast<uint16_t>(packets[0].seq + 1));
+    freePackets(packets);
+
+    // P 帧不补
+    packets = pack(packer, annexB({slice(0x41, 100)}));
+    CHECK(packets.size() == 1);
+    freePackets(packets);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_h264_inband_sets_skip_and_refresh_cache() {
+    std::cout << "Testing in-band parameter sets suppress insertion and refresh the cache..." << std::endl;
+    H264RtpPacker packer;
+    packer.setParameterSets({}, kSps, kPps);
+
+    const std::vector<uint8_t> new_sps = {0x67, 0x64, 0x00, 0x28, 0xAC};
+    const std::vector<uint8_t> new_pps = {0x68, 0xEE, 0x3C};
+    auto packets = pack(packer, annexB({new_sps, new_pps, slice(0x65, 200)}));
+    CHECK(packets.size() == 3);
+    CHECK((packets[0].data[12] & 0x1F) == 7 && (packets[1].data[12] & 0x1F) == 8);
+    freePackets(packets);
+
+    // 下一个不带参数集的 IDR 补发的是流内更新后的参数集
+    packets = pack(packer, annexB({slice(0x65, 200)}));
+    CHECK(packets.size() == 2);
+    checkAggregate(packets[0], 1, {new_sps, new_pps});
+    freePackets(packets);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_split_access_unit_inserts_once() {
+    std::cout << "Testing a multi-slice IDR access unit gets one insertion..." << std::endl;
+    H264RtpPacker packer;
+    packer.setParameterSets({}, kSps, kPps);
+
+    auto part0 = pack(packer, annexB({slice(0x65, 3000)}), false);
+    auto part1 = pack(packer, annexB({slice(0x65, 200)}), true);
+    CHECK((part0[0].data[12] & 0x1F) == 24);
+    CHECK(part1.size() == 1 && (part1[0].data[12] & 0x1F) == 5 && part1[0].marker);
+    for (const auto& packet : part0) {
+        CHECK(!packet.marker);
+    }
+    freePackets(part0);
+    freePackets(part1);
+
+    // 新 AU 重新判断
+    auto next = pack(packer, annexB({slice(0x65, 200)}));
+    CHECK(next.size() == 2 && (next[0].data[12] & 0x1F) == 24);
+    freePackets(next);
+
+    // 没有开启时行为不变
+    H264RtpPacker plain;
+    auto packets = pack(plain, annexB({slice(0x65, 200)}));
+    CHECK(packets.size() == 1);
+    freePackets(packets);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_h265_ap_before_irap() {
+    std::cout << "Testing H.265 AP insertion before an IRAP..." << std::endl;
+    const std::vector<uint8_t> vps = {0x40, 0x01, 0x0C, 0x01};
+    const std::vector<uint8_t> sps = {0x42, 0x01, 0x01, 0x01, 0x60};
+    const std::vector<uint8_t> pps = {0x44, 0x01, 0xC1, 0x72};
+    H265RtpPacker packer;
+    packer.setParameterSets(vps, sps, pps);
+
+    auto packets = pack(packer, annexB({{0x26, 0x01, 0xAF, 0x00}}));   // IDR_W_RADL
+    CHECK(packets.size() == 2);
+    CHECK(((packets[0].data[12] >> 1) & 0x3F) == 48);
+    CHECK(packets[0].data[13] == 0x01);                // LayerId 0，TID 1
+    checkAggregate(packets[0], 2, {vps, sps, pps});
+    CHECK(((packets[1].data[12] >> 1) & 0x3F) == 19 && packets[1].marker);
+    freePackets(packets);
+
+    // CRA 同样是 IRAP；TRAIL 不补
+    packets = pack(packer, annexB({{0x2A, 0x01, 0xAF}}));
+    CHECK(packets.size() == 2);
+    freePackets(packets);
+    packets = pack(packer, annexB({{0x02, 0x01, 0xD0}}));
+    CHECK(packets.size() == 1);
+    freePackets(packets);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_end_to_end() {
+    std::cout << "Testing viewers without sprop injection receive in-band SPS/PPS..." << std::endl;
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    PathConfig config;
+    config.path = "/live/test";
+    config.sps = kSps;
+    config.pps = kPps;
+    config.insert_parameter_sets = true;
+    CHECK(server.addPath(config));
+    CHECK(server.start());
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const bool idr = i % kGop == 0;
+            const auto frame = annexB({slice(idr ? 0x65 : 0x41, idr ? 4000 : 300)});
+            server.pushH264Data("/live/test", frame.data(), frame.size(), static_cast<uint64_t>(i) * 10, idr);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    RtspClientConfig client_config;
+    client_config.prefer_tcp_transport = true;
+    client_config.inject_parameter_sets = false;
+    client_config.output_format = FrameFormat::NaluSpans;
+    RtspClient client;
+    client.setConfig(client_config);
+    CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test"));
+    CHECK(client.describe() && client.setup(0) && client.play(0));
+
+    int idrs = 0;
+    for (int i = 0; i < 200 && idrs < 3; ++i) {
+        VideoFrame frame{};
+        CHECK(client.receiveFrame(frame, 3000));
+        std::vector<uint8_t> types;
+        for (const auto& span : frame.nalus) {
+            types.push_back(frame.data[span.offset] & 0x1F);
+        }
+        if (frame.type == FrameType::IDR) {
+            CHECK(types == std::vector<uint8_t>({7, 8, 5}));
+            CHECK(frame.nalus[0].size == kSps.size() && frame.nalus[1].size == kPps.size());
+            idrs++;
+        } else {
+            CHECK(types == std::vector<uint8_t>({1}));
+        }
+    }
+    CHECK(idrs == 3);
+
+    client.close();
+    running = false;
+    pusher.join();
+    server.stop();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Parameter Set Insertion Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    test_h264_stap_a_before_idr();
+    test_h264_inband_sets_skip_and_refresh_cache();
+    test_split_access_unit_inserts_once();
+    test_h265_ap_before_irap();
+    test_end_to_end();
+
+    std::cout << "\n=== All Parameter Set Insertion Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * SimpleRtspPlayer 缓存方式测试
+ *
+ * - Mailbox：读取停顿后积压被折叠，readLatestFrame 从最新 IDR 开始，之后按解码顺序连续
+ * - 跳过的帧计入 frames_skipped；收到 = 读取 + 跳过 + 仍在缓存
+ * - Queue：readLatestFrame 不可用，缓存满后新帧计入跳过
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19810;
+const int kGop = 10;
+const uint64_t kFrameMs = 10;
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    if (index % kGop == 0) {
+        out = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8,
+               0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+               0x00, 0x00, 0x00, 0x01, 0x65, 0x88};
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A};
+    }
+    out.resize(out.size() + 500, 0x42);
+    return out;
+}
+
+std::string url() {
+    return "rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test";
+}
+
+void test_mailbox() {
+    std::cout << "Testing mailbox collapses backlog to the latest IDR..." << std::endl;
+    SimpleRtspPlayer player;
+    player.setBufferMode(PlayerBufferMode::Mailbox);
+    CHECK(player.open(url()));
+
+    VideoFrame frame{};
+    CHECK(player.readLatestFrame(frame, 3000));
+    CHECK(frame.type == FrameType::IDR);
+
+    // 读取停顿若干个 GOP：积压只剩最新 IDR 之后的部分
+    std::this_thread::sleep_for(std::chrono::milliseconds(kFrameMs * kGop * 5));
+    CHECK(player.readLatestFrame(frame, 3000));
+    CHECK(frame.type == FrameType::IDR);
+    CHECK(player.getStats().frames_skipped > 0);
+
+    // 之后按解码顺序连续取到依赖帧
+    uint64_t last_pts = frame.pts;
+    for (int i = 0; i < kGop / 2; ++i) {
+        CHECK(player.readLatestFrame(frame, 3000));
+        CHECK(frame.pts > last_pts);
+        last_pts = frame.pts;
+    }
+
+    const SimplePlayerStats stats = player.getStats();
+    CHECK(stats.frames_read == 2 + kGop / 2);
+    CHECK(stats.frames_received >= stats.frames_read + stats.frames_skipped);
+    player.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_queue() {
+    std::cout << "Testing queue mode keeps FIFO order and counts overflow..." << std::endl;
+    SimpleRtspPlayer player;
+    CHECK(player.open(url()));
+
+    VideoFrame frame{};
+    CHECK(player.readFrame(frame));
+    CHECK(!player.readLatestFrame(frame, 0));
+
+    // 队列上限 30 帧，停顿远超 30 帧间隔
+    std::this_thread::sleep_for(std::chrono::milliseconds(kFrameMs * 60));
+    uint64_t last_pts = 0;
+    for (int i = 0; i < 5; ++i) {
+        CHECK(player.readFrame(frame));
+        CHECK(i == 0 || frame.pts > last_pts);
+        last_pts = frame.pts;
+    }
+    const SimplePlayerStats stats = player.getStats();
+    CHECK(stats.frames_read == 6);
+    CHECK(stats.frames_skipped > 0);
+    player.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Player Mailbox Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    PathConfig config;
+    config.path = "/live/test";
+    CHECK(server.addPath(config));
+    CHECK(server.start());
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const auto frame = makeFrame(i);
+            server.pushH264Data("/live/test", frame.data(), frame.size(), i * kFrameMs, i % kGop == 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(kFrameMs));
+        }
+    });
+
+    test_mailbox();
+    test_queue();
+
+    running = false;
+    pusher.join();
+    server.stop();
+    std::cout << "\n=== All Player Mailbox Tests Passed! ===" << std::endl;
+    return 0;
+}
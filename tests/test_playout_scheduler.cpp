@@ -0,0 +1,252 @@
+/**
+ * 客户端自适应播放调度测试
+ *
+ * - 服务端按 pts 40ms 一帧、但每 4 帧成组突发发送：未开启调度时客户端几乎同时收到一组，
+ *   开启后按呈现时刻均匀释放，目标延迟自适应到覆盖突发的量级，并报告抖动
+ * - 发送端停顿 600ms 后按原节奏继续：超过 playout_late_drop_ms 的帧丢弃到下一个 IDR，
+ *   目标延迟随即增大，之后恢复连续输出
+ * - 在帧回调（调度线程）里 close()：调度线程不被 detach，随后重新播放与析构时由所有者 join
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19818;
+const int kGop = 10;
+const uint64_t kFrameMs = 40;
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01, static_cast<uint8_t>(index % kGop == 0 ? 0x65 : 0x41)};
+    out.resize(out.size() + 300, 0x42);
+    return out;
+}
+
+bool openClient(RtspClient& client, const RtspClientConfig& base, const std::string& path) {
+    RtspClientConfig config = base;
+    config.prefer_tcp_transport = true;
+    client.setConfig(config);
+    return client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + path) &&
+           client.describe() && client.setup(0) && client.play(0);
+}
+
+// 读 count 帧，返回相邻两帧取出的时间间隔（毫秒）
+std::vector<double> readIntervals(RtspClient& client, int count) {
+    std::vector<double> intervals;
+    auto last = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        VideoFrame frame{};
+        CHECK(client.receiveFrame(frame, 3000));
+        const auto now = std::chrono::steady_clock::now();
+        if (i > 0) {
+            intervals.push_back(std::chrono::duration<double, std::milli>(now - last).count());
+        }
+        last = now;
+    }
+    return intervals;
+}
+
+void test_bursty_arrival_is_smoothed(RtspServer& server) {
+    std::cout << "Testing bursty arrivals are released on the presentation schedule..." << std::endl;
+    PathConfig config;
+    config.path = "/live/burst";
+    config.sps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+    config.pps = {0x68, 0xCE, 0x3C, 0x80};
+    CHECK(server.addPath(config));
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const auto frame = makeFrame(i);
+            server.pushH264Data(config.path, frame.data(), frame.size(), static_cast<uint64_t>(i) * kFrameMs,
+                                i % kGop == 0);
+            if (i % 4 == 3) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(4 * kFrameMs));
+            }
+        }
+    });
+
+    // 未开启：一组 4 帧几乎同时到达
+    RtspClient direct;
+    CHECK(openClient(direct, RtspClientConfig(), config.path));
+    const std::vector<double> raw = readIntervals(direct, 24);
+    CHECK(*std::min_element(raw.begin(), raw.end()) < 10.0);
+    CHECK(direct.getStats().playout_frames_released == 0);
+    direct.close();
+
+    RtspClientConfig playout;
+    playout.playout_scheduler = true;
+    RtspClient client;
+    CHECK(openClient(client, playout, config.path));
+    readIntervals(client, 24);   // 预热：窗口内积累到足以覆盖突发的延迟分位
+    const std::vector<double> smoothed = readIntervals(client, 40);
+    double sum = 0;
+    for (double interval : smoothed) {
+        sum += interval;
+    }
+    const double mean = sum / static_cast<double>(smoothed.size());
+    CHECK(mean > 30.0 && mean < 50.0);
+    // 单帧间隔不再出现成组突发的 0 / 160ms
+    int bunched = 0;
+    for (double interval : smoothed) {
+        if (interval < 15.0 || interval > 90.0) {
+            bunched++;
+        }
+    }
+    CHECK(bunched <= 2);
+
+    const RtspClientStats stats = client.getStats();
+    CHECK(stats.playout_frames_released >= 64);
+    CHECK(stats.playout_target_delay_ms >= 80 && stats.playout_target_delay_ms <= 1000);
+    CHECK(stats.playout_jitter_ms > 0);
+    CHECK(stats.playout_frames_dropped == 0);
+    client.close();
+
+    running = false;
+    pusher.join();
+    CHECK(server.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_late_frames_dropped_until_idr(RtspServer& server) {
+    std::cout << "Testing frames later than playout_late_drop_ms are dropped until the next IDR..." << std::endl;
+    PathConfig config;
+    config.path = "/live/stall";
+    config.sps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+    config.pps = {0x68, 0xCE, 0x3C, 0x80};
+    CHECK(server.addPath(config));
+
+    std::atomic<bool> running{true};
+    std::atomic<bool> stall{false};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            if (stall.exchange(false)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(600));
+            }
+            const auto frame = makeFrame(i);
+            server.pushH264Data(config.path, frame.data(), frame.size(), static_cast<uint64_t>(i) * kFrameMs,
+                                i % kGop == 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(kFrameMs));
+        }
+    });
+
+    RtspClientConfig playout;
+    playout.playout_scheduler = true;
+    playout.playout_late_drop_ms = 100;
+    RtspClient client;
+    CHECK(openClient(client, playout, config.path));
+    readIntervals(client, 20);
+    CHECK(client.getStats().playout_frames_dropped == 0);
+
+    stall = true;
+    bool saw_idr_after_drop = false;
+    uint64_t last_pts = 0;
+    for (int i = 0; i < 60; ++i) {
+        VideoFrame frame{};
+        CHECK(client.receiveFrame(frame, 3000));
+        if (last_pts != 0 && frame.pts > last_pts + kFrameMs) {
+            // 丢帧之后第一帧必是 IDR（不输出缺参考的 P 帧）
+            CHECK(frame.type == FrameType::IDR);
+            saw_idr_after_drop = true;
+        }
+        last_pts = frame.pts;
+    }
+    const RtspClientStats stats = client.getStats();
+    CHECK(saw_idr_after_drop);
+    CHECK(stats.playout_frames_dropped > 0);
+    CHECK(stats.playout_frames_late > 0);
+    CHECK(stats.playout_target_delay_ms >= 300);
+    client.close();
+
+    running = false;
+    pusher.join();
+    CHECK(server.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_close_from_release_callback(RtspServer& server) {
+    std::cout << "Testing close() from the frame callback on the playout thread..." << std::endl;
+    PathConfig config;
+    config.path = "/live/close";
+    config.sps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+    config.pps = {0x68, 0xCE, 0x3C, 0x80};
+    CHECK(server.addPath(config));
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const auto frame = makeFrame(i);
+            server.pushH264Data(config.path, frame.data(), frame.size(), static_cast<uint64_t>(i) * kFrameMs,
+                                i % kGop == 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(kFrameMs));
+        }
+    });
+
+    RtspClientConfig playout;
+    playout.playout_scheduler = true;
+    {
+        RtspClient client;
+        std::atomic<int> frames{0};
+        std::atomic<bool> closed{false};
+        client.setFrameCallback([&](const VideoFrame&) {
+            if (++frames == 5) {
+                client.close();
+                closed = true;
+            }
+        });
+        CHECK(openClient(client, playout, config.path));
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!closed && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK(closed);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        CHECK(frames == 5);
+
+        // 同一个客户端重新播放：换下的调度器在这里（非调度线程）被 join
+        client.setFrameCallback(nullptr);
+        CHECK(openClient(client, playout, config.path));
+        readIntervals(client, 5);
+        client.close();
+    }
+
+    running = false;
+    pusher.join();
+    CHECK(server.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Playout Scheduler Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    CHECK(server.start());
+    test_bursty_arrival_is_smoothed(server);
+    test_late_frames_dropped_until_idr(server);
+    test_close_from_release_callback(server);
+    server.stop();
+
+    std::cout << "\n=== All Playout Scheduler Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,252 @@
+/**
+ * 拉流转发（边缘代理）回归测试
+ *
+ * - DESCRIBE 用预取缓存的参数集应答，此时尚未建立上游会话
+ * - 多个观看者共用一路上游；最后一个离开后经过空闲宽限期才断开上游
+ * - 再次有观看者时重新拉流，首帧为新的 IDR（不会发旧缓存）
+ * - 预取完成前 DESCRIBE 立即应答 503 + Retry-After；上游不可达时一直如此，转发路径不接受推流
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+#include <rtsp-common/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kUpstreamPort = 19799;
+const uint16_t kEdgePort = 19800;
+const uint16_t kDeadPort = 19801;   // 无人监听
+const uint32_t kFps = 25;
+const uint64_t kFrameMs = 1000 / kFps;
+const int kGopFrames = 10;
+const uint32_t kIdleTimeoutMs = 400;
+
+std::atomic<uint64_t> g_last_pushed_pts{0};
+
+const std::vector<uint8_t> kSps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+const std::vector<uint8_t> kPps = {0x68, 0xCE, 0x3C, 0x80};
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    size_t payload = 600;
+    if (index % kGopFrames == 0) {
+        out = {0x00, 0x00, 0x00, 0x01};
+        out.insert(out.end(), kSps.begin(), kSps.end());
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+        out.insert(out.end(), kPps.begin(), kPps.end());
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01, 0x65, 0x88});
+        payload = 2000;
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A};
+    }
+    for (size_t i = 0; i < payload; ++i) {
+        out.push_back(static_cast<uint8_t>(0x10 + (i % 0x60)));
+    }
+    return out;
+}
+
+std::string edgeUrl(const std::string& path) {
+    return "rtsp://127.0.0.1:" + std::to_string(kEdgePort) + path;
+}
+
+bool openViewer(RtspClient& client, const std::string& path) {
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = false;
+    client.setConfig(cfg);
+    return client.open(edgeUrl(path)) && client.describe() && client.setup(0) && client.play(0);
+}
+
+RelayStats relayStats(RtspServer& edge, const std::string& path) {
+    RelayStats stats;
+    CHECK(edge.getRelayStats(path, stats));
+    return stats;
+}
+
+// 等待预取的上游参数就绪（之前的 DESCRIBE 应答 503）
+void waitDescribed(RtspServer& edge, const std::string& path) {
+    const auto begin = std::chrono::steady_clock::now();
+    while (!relayStats(edge, path).described) {
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// 等待上游拉流状态变为 active，返回等待耗时（毫秒）
+int64_t waitUpstreamActive(RtspServer& edge, const std::string& path, bool active) {
+    const auto begin = std::chrono::steady_clock::now();
+    while (relayStats(edge, path).upstream_active != active) {
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - begin).count();
+}
+
+void test_single_upstream(RtspServer& upstream, RtspServer& edge) {
+    std::cout << "Testing shared upstream and idle teardown..." << std::endl;
+    const std::string path = "/relay/cam";
+    RelayPathConfig config;
+    config.path = path;
+    config.url = "rtsp://127.0.0.1:" + std::to_string(kUpstreamPort) + "/cam";
+    config.idle_timeout_ms = kIdleTimeoutMs;
+    CHECK(edge.addRelayPath(config));
+    CHECK(!edge.addRelayPath(config));
+    CHECK(!edge.pushH264Data(path, kSps.data(), kSps.size(), 0, false));
+
+    // DESCRIBE 用缓存应答：参数集已就绪，上游没有建立会话
+    waitDescribed(edge, path);
+    {
+        RtspClient probe;
+        CHECK(probe.open(edgeUrl(path)) && probe.describe());
+        const SessionInfo info = probe.getSessionInfo();
+        CHECK(!info.media_streams.empty());
+        CHECK(info.media_streams[0].sps == kSps);
+        CHECK(info.media_streams[0].pps == kPps);
+        probe.close();
+    }
+    CHECK(upstream.getStats().sessions_created == 0);
+    CHECK(relayStats(edge, path).upstream_connects == 0);
+
+    // 三个观看者共用一路上游
+    std::vector<std::unique_ptr<RtspClient>> viewers;
+    for (int i = 0; i < 3; ++i) {
+        viewers.emplace_back(new RtspClient());
+        CHECK(openViewer(*viewers.back(), path));
+    }
+    for (auto& viewer : viewers) {
+        VideoFrame frame{};
+        CHECK(viewer->receiveFrame(frame, 3000));
+        CHECK(viewer->receiveFrame(frame, 3000));
+    }
+    CHECK(upstream.getStats().sessions_created == 1);
+    RelayStats stats = relayStats(edge, path);
+    CHECK(stats.upstream_active);
+    CHECK(stats.upstream_connects == 1);
+    CHECK(stats.frames_relayed > 0);
+
+    // 部分观看者离开不影响上游；全部离开后经过宽限期才断开
+    viewers[0]->close();
+    viewers[1]->close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2 * kIdleTimeoutMs));
+    CHECK(relayStats(edge, path).upstream_active);
+    viewers[2]->close();
+    const int64_t waited_ms = waitUpstreamActive(edge, path, false);
+    CHECK(waited_ms >= static_cast<int64_t>(kIdleTimeoutMs) - 50);
+    CHECK(upstream.getStats().sessions_closed == 1);
+    const uint64_t teardown_pts = g_last_pushed_pts.load();
+
+    // 再次观看：重新拉流，首帧为断开之后的新 IDR（间隔超过一个 GOP，旧缓存必然更早）
+    std::this_thread::sleep_for(std::chrono::milliseconds(2 * kGopFrames * kFrameMs));
+    RtspClient again;
+    CHECK(openViewer(again, path));
+    VideoFrame frame{};
+    CHECK(again.receiveFrame(frame, 3000));
+    CHECK(frame.type == FrameType::IDR);
+    CHECK(frame.pts > teardown_pts);
+    CHECK(relayStats(edge, path).upstream_connects == 2);
+    CHECK(upstream.getStats().sessions_created == 2);
+    again.close();
+
+    // removePath 立即断开上游
+    CHECK(edge.removePath(path));
+    RelayStats removed;
+    CHECK(!edge.getRelayStats(path, removed));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_unreachable_upstream(RtspServer& edge) {
+    std::cout << "Testing unreachable upstream..." << std::endl;
+    RelayPathConfig config;
+    config.path = "/relay/dead";
+    config.url = "rtsp://127.0.0.1:" + std::to_string(kDeadPort) + "/cam";
+    config.upstream_timeout_ms = 500;
+    config.retry_interval_ms = 100;
+    CHECK(edge.addRelayPath(config));
+
+    // 预取未完成：立即 503 + Retry-After，不在连接线程上等上游
+    {
+        Socket sock;
+        CHECK(sock.connect("127.0.0.1", kEdgePort, 2000));
+        const std::string request = "DESCRIBE " + edgeUrl(config.path) + " RTSP/1.0\r\nCSeq: 1\r\n\r\n";
+        const auto begin = std::chrono::steady_clock::now();
+        CHECK(sock.sendAll(reinterpret_cast<const uint8_t*>(request.data()), request.size(), 2000) ==
+              static_cast<ssize_t>(request.size()));
+        std::string response;
+        CHECK(recvRtspMessage(sock, &response, 2000));
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(200));
+        CHECK(response.find("RTSP/1.0 503") == 0);
+        CHECK(response.find("Retry-After: 1\r\n") != std::string::npos);
+    }
+
+    RtspClient probe;
+    CHECK(probe.open(edgeUrl(config.path)));
+    CHECK(!probe.describe());
+    probe.close();
+    const auto begin = std::chrono::steady_clock::now();
+    while (relayStats(edge, config.path).upstream_failures == 0) {
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(!relayStats(edge, config.path).described);
+    CHECK(!relayStats(edge, config.path).upstream_active);
+    CHECK(edge.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Relay Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServer upstream;
+    CHECK(upstream.init("127.0.0.1", kUpstreamPort));
+    PathConfig camera;
+    camera.path = "/cam";
+    camera.fps = kFps;
+    CHECK(upstream.addPath(camera));
+    CHECK(upstream.start());
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        const auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; running; ++i) {
+            std::this_thread::sleep_until(begin + std::chrono::milliseconds(i * kFrameMs));
+            const auto frame = makeFrame(i);
+            const uint64_t pts = (i + 1) * kFrameMs;
+            upstream.pushH264Data(camera.path, frame.data(), frame.size(), pts, i % kGopFrames == 0);
+            g_last_pushed_pts = pts;
+        }
+    });
+
+    RtspServer edge;
+    CHECK(edge.init("127.0.0.1", kEdgePort));
+    CHECK(edge.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    test_single_upstream(upstream, edge);
+    test_unreachable_upstream(edge);
+
+    edge.stop();
+    running = false;
+    pusher.join();
+    upstream.stop();
+    std::cout << "\n=== All Relay Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,352 @@
+/**
+ * 码率组（多档位自动切换）回归测试
+ *
+ * - DESCRIBE 码率组路径只描述一路视频（最高档）
+ * - RTCP RR 报告丢包后，会话在低档位的 IDR 处降档，并补上低档位的 SPS/PPS
+ * - 链路恢复且持续 upgrade_hold_ms 后，在高档位的 IDR 处升档
+ * - 切换前后 RTP 序列号连续、时间戳递增、SSRC 不变
+ * - 档位路径属于码率组时 removePath 拒绝删除，删除码率组后才可删除
+ */
+
+#include <rtsp-server/rtsp-server.h>
+#include <rtsp-common/socket.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19794;
+const std::string kBaseUrl = "rtsp://127.0.0.1:19794";
+
+const std::vector<uint8_t> kHighSps = {0x67, 0x64, 0x00, 0x33};
+const std::vector<uint8_t> kHighPps = {0x68, 0xEE, 0x3C, 0x80};
+const std::vector<uint8_t> kLowSps = {0x67, 0x42, 0x00, 0x1E};
+const std::vector<uint8_t> kLowPps = {0x68, 0xCE, 0x38, 0x80};
+
+const uint8_t kHighFill = 0xAA;
+const uint8_t kLowFill = 0xBB;
+
+struct RtpInfo {
+    uint16_t seq = 0;
+    uint32_t ts = 0;
+    uint32_t ssrc = 0;
+    bool marker = false;
+    std::vector<uint8_t> payload;
+};
+
+// 只认 TCP interleaved 的最小 RTSP 播放端：可以在 RTCP 通道上回送任意 RR
+class RawPlayer {
+public:
+    bool connect() { return sock_.connect("127.0.0.1", kPort, 2000); }
+
+    std::string request(const std::string& method, const std::string& url, const std::string& extra) {
+        const std::string req = method + " " + url + " RTSP/1.0\r\nCSeq: " + std::to_string(++cseq_) +
+                                "\r\n" + extra + "\r\n";
+        sock_.sendAll(reinterpret_cast<const uint8_t*>(req.data()), req.size(), 1000);
+        for (int i = 0; i < 100; ++i) {
+            drainInterleaved();
+            const size_t end = buf_.find("\r\n\r\n");
+            if (end != std::string::npos && buf_.rfind("RTSP/1.0", 0) == 0) {
+                size_t total = end + 4;
+                const size_t cl = buf_.find("Content-Length: ");
+                if (cl != std::string::npos && cl < end) {
+                    total += static_cast<size_t>(std::stoul(buf_.substr(cl + 16)));
+                }
+                if (buf_.size() >= total) {
+                    std::string resp = buf_.substr(0, total);
+                    buf_.erase(0, total);
+                    return resp;
+                }
+            }
+            fill(50);
+        }
+        return "";
+    }
+
+    bool readPacket(RtpInfo& out, int timeout_ms) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (packets_.empty() && std::chrono::steady_clock::now() < deadline) {
+            fill(50);
+            drainInterleaved();
+        }
+        if (packets_.empty()) return false;
+        out = packets_.front();
+        packets_.pop_front();
+        return true;
+    }
+
+    // 读取一个完整 AU（直到 marker）
+    std::vector<RtpInfo> readAccessUnit() {
+        std::vector<RtpInfo> au;
+        RtpInfo pkt;
+        while (readPacket(pkt, 1000)) {
+            au.push_back(pkt);
+            if (pkt.marker) break;
+        }
+        return au;
+    }
+
+    bool noPacketWithin(int timeout_ms) {
+        RtpInfo pkt;
+        return !readPacket(pkt, timeout_ms);
+    }
+
+    void sendReceiverReport(uint32_t media_ssrc, uint8_t fraction_lost) {
+        std::vector<uint8_t> rr(4 + 32, 0);
+        rr[0] = '$';
+        rr[1] = 1;  // RTCP 通道
+        rr[3] = 32;
+        uint8_t* p = rr.data() + 4;
+        p[0] = 0x81;  // V=2, RC=1
+        p[1] = 201;
+        p[3] = 7;
+        p[7] = 0x01;  // 发送者 SSRC
+        p[8] = static_cast<uint8_t>(media_ssrc >> 24);
+        p[9] = static_cast<uint8_t>(media_ssrc >> 16);
+        p[10] = static_cast<uint8_t>(media_ssrc >> 8);
+        p[11] = static_cast<uint8_t>(media_ssrc);
+        p[12] = fraction_lost;
+        sock_.sendAll(rr.data(), rr.size(), 1000);
+    }
+
+private:
+    void fill(int timeout_ms) {
+        uint8_t tmp[8192];
+        ssize_t n = sock_.recv(tmp, sizeof(tmp), timeout_ms);
+        if (n > 0) buf_.append(reinterpret_cast<const char*>(tmp), static_cast<size_t>(n));
+    }
+
+    void drainInterleaved() {
+        while (buf_.size() >= 4 && buf_[0] == '$') {
+            const size_t len = (static_cast<uint8_t>(buf_[2]) << 8) | static_cast<uint8_t>(buf_[3]);
+            if (buf_.size() < 4 + len) return;
+            const auto* d = reinterpret_cast<const uint8_t*>(buf_.data()) + 4;
+            if (buf_[1] == 0 && len >= 12) {
+                RtpInfo info;
+                info.marker = (d[1] & 0x80) != 0;
+                info.seq = static_cast<uint16_t>((d[2] << 8) | d[3]);
+                info.ts = (static_cast<uint32_t>(d[4]) << 24) | (d[5] << 16) | (d[6] << 8) | d[7];
+                info.ssrc = (static_cast<uint32_t>(d[8]) << 24) | (d[9] << 16) | (d[10] << 8) | d[11];
+                info.payload.assign(d + 12, d + len);
+                packets_.push_back(info);
+            }
+            buf_.erase(0, 4 + len);
+        }
+    }
+
+    Socket sock_;
+    std::string buf_;
+    std::deque<RtpInfo> packets_;
+    int cseq_ = 0;
+};
+
+std::vector<uint8_t> makeFrame(const std::vector<uint8_t>* sps, const std::vector<uint8_t>* pps,
+                               uint8_t nal_header, uint8_t fill) {
+    std::vector<uint8_t> out;
+    const std::vector<uint8_t>* sets[] = {sps, pps};
+    for (const auto* set : sets) {
+        if (!set) continue;
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+        out.insert(out.end(), set->begin(), set->end());
+    }
+    out.insert(out.end(), {0x00, 0x00, 0x00, 0x01, nal_header});
+    out.insert(out.end(), 200, fill);
+    return out;
+}
+
+uint8_t renditionOf(const std::vector<RtpInfo>& au) {
+    CHECK(!au.empty());
+    return au.back().payload.back();
+}
+
+struct StreamChecker {
+    bool has_prev = false;
+    RtpInfo prev;
+
+    void check(const std::vector<RtpInfo>& au) {
+        for (const auto& pkt : au) {
+            if (has_prev) {
+                CHECK(pkt.ssrc == prev.ssrc);
+                CHECK(pkt.seq == static_cast<uint16_t>(prev.seq + 1));
+                CHECK(pkt.ts >= prev.ts);
+            }
+            prev = pkt;
+            has_prev = true;
+        }
+    }
+};
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Rendition Group Tests ===" << std::endl;
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    PathConfig high;
+    high.path = "/cam/high";
+    high.width = 1920;
+    high.height = 1080;
+    high.sps = kHighSps;
+    high.pps = kHighPps;
+    PathConfig low = high;
+    low.path = "/cam/low";
+    low.width = 640;
+    low.height = 360;
+    low.sps = kLowSps;
+    low.pps = kLowPps;
+    CHECK(server.addPath(high));
+    CHECK(server.addPath(low));
+
+    RenditionGroupConfig group;
+    group.path = "/cam";
+    group.renditions = {"/cam/high", "/cam/low"};
+    group.upgrade_hold_ms = 300;
+    group.loss_report_max_age_ms = 300;
+
+    RenditionGroupConfig missing = group;
+    missing.path = "/cam2";
+    missing.renditions = {"/cam/high", "/cam/none"};
+    CHECK(!server.addRenditionGroup(missing));
+    CHECK(server.addRenditionGroup(group));
+    CHECK(!server.addRenditionGroup(group));
+    RenditionGroupConfig nested = group;
+    nested.path = "/cam3";
+    nested.renditions = {"/cam"};
+    CHECK(!server.addRenditionGroup(nested));
+    CHECK(!server.removePath("/cam/low"));
+    CHECK(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // 码率组本身不接受推流
+    const auto high_idr = makeFrame(&kHighSps, &kHighPps, 0x65, kHighFill);
+    CHECK(!server.pushH264Data("/cam", high_idr.data(), high_idr.size(), 0, true));
+
+    RawPlayer player;
+    CHECK(player.connect());
+    const std::string describe = player.request("DESCRIBE", kBaseUrl + "/cam", "Accept: application/sdp\r\n");
+    CHECK(describe.find("200 OK") != std::string::npos);
+    CHECK(describe.find("m=video") == describe.rfind("m=video"));
+    CHECK(describe.find("1920-1080") != std::string::npos);
+    CHECK(describe.find("Z2QAMw==") != std::string::npos);  // base64(kHighSps)
+
+    const std::string setup = player.request("SETUP", kBaseUrl + "/cam/stream",
+                                             "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n");
+    CHECK(setup.find("200 OK") != std::string::npos);
+    const size_t sid_pos = setup.find("Session: ");
+    CHECK(sid_pos != std::string::npos);
+    const std::string sid = setup.substr(sid_pos + 9, setup.find_first_of(";\r", sid_pos) - sid_pos - 9);
+    CHECK(player.request("PLAY", kBaseUrl + "/cam", "Session: " + sid + "\r\n").find("200 OK") !=
+           std::string::npos);
+
+    const auto low_idr = makeFrame(nullptr, nullptr, 0x65, kLowFill);
+    const auto high_p = makeFrame(nullptr, nullptr, 0x41, kHighFill);
+    const auto low_p = makeFrame(nullptr, nullptr, 0x41, kLowFill);
+    StreamChecker checker;
+
+    // 起始档位为最高档
+    CHECK(server.pushH264Data("/cam/high", high_idr.data(), high_idr.size(), 0, true));
+    CHECK(server.pushH264Data("/cam/low", low_idr.data(), low_idr.size(), 0, true));
+    auto au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kHighFill);
+    checker.check(au);
+    CHECK(player.noPacketWithin(100));
+    const uint32_t ssrc = au.front().ssrc;
+
+    // 50% 丢包：等低档位的 IDR 降档，之前仍转发高档位
+    player.sendReceiverReport(ssrc, 128);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(server.pushH264Data("/cam/high", high_p.data(), high_p.size(), 40, false));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kHighFill);
+    checker.check(au);
+
+    CHECK(server.pushH264Data("/cam/low", low_idr.data(), low_idr.size(), 80, true));
+    CHECK(server.pushH264Data("/cam/high", high_idr.data(), high_idr.size(), 80, true));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kLowFill);
+    // 低档位 IDR 未带参数集：切换时补上低档位的 SPS/PPS
+    CHECK(au.size() == 3);
+    CHECK(au[0].payload == kLowSps);
+    CHECK(au[1].payload == kLowPps);
+    checker.check(au);
+    CHECK(player.noPacketWithin(100));
+
+    CHECK(server.pushH264Data("/cam/high", high_p.data(), high_p.size(), 120, false));
+    CHECK(server.pushH264Data("/cam/low", low_p.data(), low_p.size(), 120, false));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kLowFill);
+    checker.check(au);
+    CHECK(player.noPacketWithin(100));
+
+    // 丢包消失，持续 upgrade_hold_ms 后在高档位的 IDR 处升档
+    player.sendReceiverReport(ssrc, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    CHECK(server.pushH264Data("/cam/low", low_p.data(), low_p.size(), 160, false));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kLowFill);
+    checker.check(au);
+    // 选档在该 AU 发送完成后评估，给发送线程一点时间
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    CHECK(server.pushH264Data("/cam/high", high_idr.data(), high_idr.size(), 200, true));
+    CHECK(server.pushH264Data("/cam/low", low_idr.data(), low_idr.size(), 200, true));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kHighFill);
+    CHECK(au[0].payload == kHighSps);
+    checker.check(au);
+    CHECK(player.noPacketWithin(100));
+
+    CHECK(server.getStats().rendition_switches == 2);
+
+    // 再次丢包降档后对端不再发 RR：丢包率过期作废，空闲 upgrade_hold_ms 后照常升档
+    player.sendReceiverReport(ssrc, 128);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(server.pushH264Data("/cam/high", high_p.data(), high_p.size(), 240, false));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kHighFill);
+    checker.check(au);
+    CHECK(server.pushH264Data("/cam/low", low_idr.data(), low_idr.size(), 280, true));
+    CHECK(server.pushH264Data("/cam/high", high_idr.data(), high_idr.size(), 280, true));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kLowFill);
+    checker.check(au);
+    CHECK(player.noPacketWithin(100));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(800));
+    CHECK(server.pushH264Data("/cam/low", low_p.data(), low_p.size(), 320, false));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kLowFill);
+    checker.check(au);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // 播放中删除档位路径被拒绝：升档目标仍在，会话照常切回高档位
+    CHECK(!server.removePath("/cam/high"));
+    CHECK(server.pushH264Data("/cam/high", high_idr.data(), high_idr.size(), 360, true));
+    CHECK(server.pushH264Data("/cam/low", low_idr.data(), low_idr.size(), 360, true));
+    au = player.readAccessUnit();
+    CHECK(renditionOf(au) == kHighFill);
+    checker.check(au);
+    CHECK(player.noPacketWithin(100));
+    CHECK(server.getStats().rendition_switches == 4);
+
+    player.request("TEARDOWN", kBaseUrl + "/cam", "Session: " + sid + "\r\n");
+    CHECK(server.removePath("/cam"));
+    CHECK(server.removePath("/cam/high"));
+    CHECK(server.removePath("/cam/low"));
+    server.stop();
+
+    std::cout << "\n=== All Rendition Group Tests Passed! ===" << std::endl;
+    return 0;
+}
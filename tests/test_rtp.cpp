@@ -76,7 +76,8 @@ void test_h264_single_nalu() {
     // 验证RTP头
     assert(packet.size == 12 + nalu_data.size() - 4);  // RTP头 + NALU（去掉起始码）
     assert((packet.data[0] & 0xC0) == 0x80);  // V=2
-    assert(packet.data[1] == 96);  // payload type
+    assert((packet.data[1] & 0x7F) == 96);  // payload type
+    assert(packet.data[1] & 0x80);  // M 位写入 RTP 头
     assert(packet.marker);  // 单包应该有marker
     
     // 验证序列号
@@ -185,7 +186,8 @@ void test_h265_packing() {
     
     // 验证RTP头
     assert((packet.data[0] & 0xC0) == 0x80);  // V=2
-    assert(packet.data[1] == 96);  // payload type
+    assert((packet.data[1] & 0x7F) == 96);  // payload type
+    assert(packet.data[1] & 0x80);  // M 位写入 RTP 头
     
     // 验证H.265 payload header
     uint8_t payload_type = (packet.data[12] >> 1) & 0x3F;
@@ -283,6 +285,40 @@ void test_sequence_number() {
     std::cout << "  Sequence number tests passed!" << std::endl;
 }
 
+void test_nalu_marker_only_on_access_unit_end() {
+    std::cout << "Testing slice-level packing marker..." << std::endl;
+
+    // 一个 AU 拆成两个 slice：第一个大 slice 走 FU-A，第二个小 slice 单包
+    auto slice0 = createH264IdrNalu(3000);
+    auto slice1 = createH264IdrNalu(200);
+
+    H264RtpPacker packer;
+    VideoFrame part0 = createVideoFrame(CodecType::H264, slice0.data(), slice0.size(), 3000, 1920, 1080, 30);
+    VideoFrame part1 = createVideoFrame(CodecType::H264, slice1.data(), slice1.size(), 3000, 1920, 1080, 30);
+
+    auto packets0 = packer.packNalus(part0, false);
+    auto packets1 = packer.packNalus(part1, true);
+    assert(packets0.size() > 1);
+    assert(packets1.size() == 1);
+
+    // FU-A 末片（E 位）不是 AU 结尾，不能置 marker
+    for (const auto& packet : packets0) {
+        assert(!packet.marker);
+        assert(!(packet.data[1] & 0x80));
+        assert(packet.timestamp == packets1[0].timestamp);
+    }
+    assert(packets1[0].marker);
+    assert(packets1[0].data[1] & 0x80);
+    assert(packets1[0].seq == static_cast<uint16_t>(packets0.back().seq + 1));
+
+    for (auto& p : packets0) delete[] p.data;
+    for (auto& p : packets1) delete[] p.data;
+    freeVideoFrame(part0);
+    freeVideoFrame(part1);
+
+    std::cout << "  Slice-level packing marker tests passed!" << std::endl;
+}
+
 int main() {
     std::cout << "=== Running RTP Tests ===" << std::endl;
     
@@ -292,6 +328,7 @@ int main() {
         test_h265_packing();
         test_h265_fragmentation();
         test_sequence_number();
+        test_nalu_marker_only_on_access_unit_end();
         
         std::cout << "\n=== All RTP Tests Passed! ===" << std::endl;
         return 0;
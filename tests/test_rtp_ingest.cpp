@@ -0,0 +1,314 @@
+/**
+ * 推流收流事件循环测试
+ *
+ * - 多个推流者只占用 ingest_threads 个 rtsp-ingest 线程，不再每个推流者一个接收线程
+ * - 共享端口：SETUP 应答的 server_port 为共享端口，按来源地址分流到各自路径；
+ *   未注册来源、同一来源上换了 SSRC 的报文被丢弃
+ * - 乱序到达的 FU-A 分片经重排环恢复为完整的帧
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-publisher/rtsp-publisher.h>
+#include <rtsp-common/socket.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <dirent.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19811;
+const uint16_t kSharedPort = 19812;
+const size_t kBodySize = 2997;   // 3 个分片等分
+
+// 进程内名为 name 的线程数
+int countThreads(const std::string& name) {
+    int count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    CHECK(dir != nullptr);
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::ifstream comm(std::string("/proc/self/task/") + entry->d_name + "/comm");
+        std::string line;
+        if (std::getline(comm, line) && line == name) {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+std::string baseUrl() {
+    return "rtsp://127.0.0.1:" + std::to_string(kPort);
+}
+
+// 手工 ANNOUNCE/SETUP/RECORD 的推流者，RTP 包自己构造，可控制乱序与 SSRC
+class RawPublisher {
+public:
+    bool open(const std::string& path, uint16_t client_port, std::string* setup_reply) {
+        if (!control_.connect("127.0.0.1", kPort, 2000) || !rtp_.bindUdp("127.0.0.1", client_port)) {
+            return false;
+        }
+        const std::string url = baseUrl() + path;
+        const std::string sdp =
+            "v=0\r\no=- 1 1 IN IP4 127.0.0.1\r\ns=Raw\r\nc=IN IP4 127.0.0.1\r\nt=0 0\r\n"
+            "m=video 0 RTP/AVP 96\r\na=rtpmap:96 H264/90000\r\n"
+            "a=fmtp:96 packetization-mode=1;sprop-parameter-sets=Z0IAKA==,aM48gA==\r\n"
+            "a=control:streamid=0\r\n";
+        std::string reply;
+        if (!request("ANNOUNCE " + url + " RTSP/1.0\r\nCSeq: 1\r\nContent-Type: application/sdp\r\n"
+                     "Content-Length: " + std::to_string(sdp.size()) + "\r\n\r\n" + sdp, &reply)) {
+            return false;
+        }
+        if (!request("SETUP " + url + "/streamid=0 RTSP/1.0\r\nCSeq: 2\r\nTransport: RTP/AVP;unicast;client_port=" +
+                     std::to_string(client_port) + "-" + std::to_string(client_port + 1) + ";mode=record\r\n\r\n",
+                     &reply)) {
+            return false;
+        }
+        *setup_reply = reply;
+        const size_t pos = reply.find("Session: ");
+        if (pos == std::string::npos) {
+            return false;
+        }
+        session_ = reply.substr(pos + 9, reply.find_first_of(";\r", pos + 9) - pos - 9);
+        const size_t port_pos = reply.find("server_port=");
+        if (port_pos == std::string::npos) {
+            return false;
+        }
+        server_port_ = static_cast<uint16_t>(std::atoi(reply.c_str() + port_pos + 12));
+        return request("RECORD " + url + " RTSP/1.0\r\nCSeq: 3\r\nSession: " + session_ + "\r\n\r\n", &reply);
+    }
+
+    // 一个 IDR：NAL 头 + kBodySize 字节负载（全部为 tag），拆成 3 个 FU-A；reorder 时按 0、2、1 发出
+    void sendFrame(uint32_t timestamp, uint8_t tag, bool reorder, uint32_t ssrc = 0x11223344) {
+        std::vector<std::vector<uint8_t>> packets;
+        const size_t piece = kBodySize / 3;
+        for (size_t i = 0; i < 3; ++i) {
+            std::vector<uint8_t> packet = {
+                0x80, static_cast<uint8_t>(96 | (i == 2 ? 0x80 : 0x00)),
+                static_cast<uint8_t>(seq_ >> 8), static_cast<uint8_t>(seq_ & 0xFF),
+                static_cast<uint8_t>(timestamp >> 24), static_cast<uint8_t>(timestamp >> 16),
+                static_cast<uint8_t>(timestamp >> 8), static_cast<uint8_t>(timestamp),
+                static_cast<uint8_t>(ssrc >> 24), static_cast<uint8_t>(ssrc >> 16),
+                static_cast<uint8_t>(ssrc >> 8), static_cast<uint8_t>(ssrc),
+                0x7C, static_cast<uint8_t>(0x05 | (i == 0 ? 0x80 : 0x00) | (i == 2 ? 0x40 : 0x00))};
+            packet.insert(packet.end(), piece, tag);
+            packets.push_back(packet);
+            seq_++;
+        }
+        const size_t order[3] = {0, reorder ? 2u : 1u, reorder ? 1u : 2u};
+        for (size_t index : order) {
+            rtp_.sendTo(packets[index].data(), packets[index].size(), "127.0.0.1", server_port_);
+        }
+    }
+
+    uint16_t serverPort() const { return server_port_; }
+
+private:
+    bool request(const std::string& text, std::string* reply) {
+        if (control_.sendAll(reinterpret_cast<const uint8_t*>(text.data()), text.size(), 2000) !=
+            static_cast<ssize_t>(text.size())) {
+            return false;
+        }
+        return recvRtspMessage(control_, reply, 2000) && reply->find("RTSP/1.0 200") == 0;
+    }
+
+    Socket control_;
+    Socket rtp_;
+    std::string session_;
+    uint16_t server_port_ = 0;
+    uint16_t seq_ = 1000;
+};
+
+bool openViewer(RtspClient& client, const std::string& path) {
+    RtspClientConfig config;
+    config.prefer_tcp_transport = true;
+    client.setConfig(config);
+    return client.open(baseUrl() + path) && client.describe() && client.setup(0) && client.play(0);
+}
+
+// 帧末尾是完整的 kBodySize 字节负载且全部为 tag
+bool frameCarries(const VideoFrame& frame, uint8_t tag) {
+    if (frame.size < kBodySize) {
+        return false;
+    }
+    for (size_t i = frame.size - kBodySize; i < frame.size; ++i) {
+        if (frame.data[i] != tag) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_publishers_share_loop_threads() {
+    std::cout << "Testing many publishers run on a fixed number of ingest threads..." << std::endl;
+    RtspServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = kPort;
+    config.ingest_threads = 2;
+    RtspServer server;
+    CHECK(server.init(config));
+    CHECK(server.start());
+
+    const int kPublishers = 12;
+    std::vector<std::unique_ptr<RtspPublisher>> publishers;
+    for (int i = 0; i < kPublishers; ++i) {
+        publishers.emplace_back(new RtspPublisher());
+        RtspPublishConfig publish_config;
+        publish_config.local_rtp_port = static_cast<uint16_t>(25300 + 2 * i);
+        publishers.back()->setConfig(publish_config);
+        CHECK(publishers.back()->open(baseUrl() + "/live/pub" + std::to_string(i)));
+        PublishMediaInfo media;
+        media.sps = {0x67, 0x42, 0x00, 0x28};
+        media.pps = {0x68, 0xCE, 0x3C, 0x80};
+        media.control_track = "streamid=0";
+        CHECK(publishers.back()->announce(media));
+        CHECK(publishers.back()->setup());
+        CHECK(publishers.back()->record());
+    }
+    CHECK(countThreads("rtsp-ingest") == 2);
+
+    RtspClient viewer;
+    CHECK(openViewer(viewer, "/live/pub7"));
+    const std::vector<uint8_t> idr = {0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x21};
+    VideoFrame frame{};
+    bool got_frame = false;
+    for (int i = 0; i < 25 && !got_frame; ++i) {
+        for (auto& publisher : publishers) {
+            CHECK(publisher->pushH264Data(idr.data(), idr.size(), static_cast<uint64_t>(i) * 40, true));
+        }
+        got_frame = viewer.receiveFrame(frame, 200);
+    }
+    CHECK(got_frame);
+    CHECK(server.getStats().frames_pushed >= static_cast<uint64_t>(kPublishers));
+
+    viewer.close();
+    for (auto& publisher : publishers) {
+        publisher->close();
+    }
+    server.stop();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_shared_port_demux() {
+    std::cout << "Testing shared ingest port demuxes by source address and SSRC..." << std::endl;
+    RtspServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = kPort;
+    config.ingest_threads = 2;
+    config.shared_ingest_port = kSharedPort;
+    RtspServer server;
+    CHECK(server.init(config));
+    CHECK(server.start());
+
+    RawPublisher a;
+    RawPublisher b;
+    std::string reply;
+    CHECK(a.open("/live/a", 25401, &reply));
+    CHECK(reply.find("server_port=" + std::to_string(kSharedPort) + "-" + std::to_string(kSharedPort + 1)) !=
+          std::string::npos);
+    CHECK(b.open("/live/b", 25403, &reply));
+    CHECK(a.serverPort() == kSharedPort && b.serverPort() == kSharedPort);
+
+    RtspClient viewer_a;
+    RtspClient viewer_b;
+    CHECK(openViewer(viewer_a, "/live/a"));
+    CHECK(openViewer(viewer_b, "/live/b"));
+
+    // 未注册的来源发往共享端口：丢弃
+    Socket stranger;
+    CHECK(stranger.bindUdp("127.0.0.1", 25405));
+
+    int frames_a = 0;
+    int frames_b = 0;
+    for (int i = 0; i < 40 && (frames_a < 3 || frames_b < 3); ++i) {
+        const uint32_t ts = static_cast<uint32_t>(i) * 3600;
+        a.sendFrame(ts, 0xA1, false);
+        b.sendFrame(ts, 0xB2, false);
+        // 同一来源换了 SSRC：丢弃
+        a.sendFrame(ts + 1800, 0xEE, false, 0x55667788);
+        const std::vector<uint8_t> junk(64, 0xCC);
+        stranger.sendTo(junk.data(), junk.size(), "127.0.0.1", kSharedPort);
+
+        VideoFrame frame{};
+        while (viewer_a.receiveFrame(frame, 20)) {
+            CHECK(frameCarries(frame, 0xA1));
+            frames_a++;
+        }
+        while (viewer_b.receiveFrame(frame, 20)) {
+            CHECK(frameCarries(frame, 0xB2));
+            frames_b++;
+        }
+    }
+    CHECK(frames_a >= 3);
+    CHECK(frames_b >= 3);
+
+    viewer_a.close();
+    viewer_b.close();
+    server.stop();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_reordered_fragments() {
+    std::cout << "Testing reorder ring restores out-of-order FU-A fragments..." << std::endl;
+    RtspServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = kPort;
+    RtspServer server;
+    CHECK(server.init(config));
+    CHECK(server.start());
+
+    RawPublisher publisher;
+    std::string reply;
+    CHECK(publisher.open("/live/reorder", 25411, &reply));
+    CHECK(publisher.serverPort() != 0);
+
+    RtspClient viewer;
+    CHECK(openViewer(viewer, "/live/reorder"));
+    int frames = 0;
+    for (int i = 0; i < 40 && frames < 3; ++i) {
+        publisher.sendFrame(static_cast<uint32_t>(i) * 3600, static_cast<uint8_t>(0x30 + i), true);
+        VideoFrame frame{};
+        while (viewer.receiveFrame(frame, 20)) {
+            // 分片按 0、2、1 到达：重排后负载完整且只来自一帧
+            CHECK(frameCarries(frame, frame.data[frame.size - 1]));
+            frames++;
+        }
+    }
+    CHECK(frames >= 3);
+
+    viewer.close();
+    server.stop();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running RTP Ingest Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    test_publishers_share_loop_threads();
+    test_shared_port_demux();
+    test_reordered_fragments();
+
+    std::cout << "\n=== All RTP Ingest Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,231 @@
+/**
+ * 控制面压力测试：大量并发 SETUP 下的推流延迟
+ *
+ * 1000 条连接同时做 UDP SETUP（各自绑定一对 RTP/RTCP 端口）并保持不断开，其中每 4 个有 1 个接着 PLAY，
+ * 真正收流；同时另有一批连接在 interleaved PLAY 之后连发请求、再也不读应答。期间两路径持续推流：
+ * - 全部 SETUP 成功，会话都挂到路径上；单路径名额恰为 1000，并发下不超发，第 1001 个得到 453
+ * - 单次 pushH264Data 的耗时有界：paths_mutex_ 只护查表，准入只读计数，端口绑定与应答发送
+ *   不占全局锁，不读应答的连接也不会拖住推流
+ */
+
+#include <rtsp-common/socket.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19819;
+const int kSetups = 1000;
+const int kSetupThreads = 8;
+const int kGop = 30;
+const int kPlayEvery = 4;          // 每 4 个 SETUP 中有 1 个接着 PLAY
+const int kStalledReaders = 16;    // interleaved PLAY 后只发不读的连接
+
+std::vector<uint8_t> makeFrame(int index, size_t body = 1000) {
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01, static_cast<uint8_t>(index % kGop == 0 ? 0x65 : 0x41)};
+    out.resize(out.size() + body, 0x42);
+    return out;
+}
+
+bool sendRequest(Socket& socket, const std::string& request) {
+    return socket.sendAll(reinterpret_cast<const uint8_t*>(request.data()), request.size(), 5000) ==
+           static_cast<ssize_t>(request.size());
+}
+
+// 应答里的会话号（去掉 ;timeout=）
+std::string sessionIdOf(const std::string& response) {
+    const size_t pos = response.find("Session: ");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    return response.substr(pos + 9, response.find_first_of(";\r", pos) - pos - 9);
+}
+
+// 发 SETUP 并等到 200 应答，play 时再 PLAY；连接保持打开，会话随之保留
+bool setupSession(Socket& socket, int index, bool play) {
+    if (!socket.connect("127.0.0.1", kPort, 5000)) {
+        return false;
+    }
+    const uint16_t client_port = static_cast<uint16_t>(40000 + (index % 1000) * 2);
+    const std::string url = "rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/storm";
+    std::string response;
+    if (!sendRequest(socket, "SETUP " + url + "/stream RTSP/1.0\r\nCSeq: 1\r\n"
+                             "Transport: RTP/AVP;unicast;client_port=" + std::to_string(client_port) + "-" +
+                             std::to_string(client_port + 1) + "\r\n\r\n") ||
+        !recvRtspMessage(socket, &response, 10000) || response.find("RTSP/1.0 200") != 0) {
+        return false;
+    }
+    if (!play) {
+        return true;
+    }
+    return sendRequest(socket, "PLAY " + url + " RTSP/1.0\r\nCSeq: 2\r\nSession: " + sessionIdOf(response) +
+                               "\r\n\r\n") &&
+           recvRtspMessage(socket, &response, 10000) && response.find("RTSP/1.0 200") == 0;
+}
+
+// interleaved SETUP 之后 PLAY，并连发 GET_PARAMETER，再也不读：服务端的待发数据只进不出
+bool floodWithoutReading(Socket& socket) {
+    if (!socket.connect("127.0.0.1", kPort, 5000)) {
+        return false;
+    }
+    socket.setRecvBufferSize(4096);
+    const std::string url = "rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/bulk";
+    std::string response;
+    if (!sendRequest(socket, "SETUP " + url + "/stream RTSP/1.0\r\nCSeq: 1\r\n"
+                             "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n\r\n") ||
+        !recvRtspMessage(socket, &response, 10000) || response.find("RTSP/1.0 200") != 0) {
+        return false;
+    }
+    const std::string session = sessionIdOf(response);
+    if (!sendRequest(socket, "PLAY " + url + " RTSP/1.0\r\nCSeq: 2\r\nSession: " + session + "\r\n\r\n")) {
+        return false;
+    }
+    for (int cseq = 3; cseq < 203; ++cseq) {
+        // 服务端关掉连接后发送失败即停
+        if (!sendRequest(socket, "GET_PARAMETER " + url + " RTSP/1.0\r\nCSeq: " + std::to_string(cseq) +
+                                 "\r\nSession: " + session + "\r\n\r\n")) {
+            break;
+        }
+    }
+    return true;
+}
+
+void test_push_latency_under_setup_storm() {
+    std::cout << "Testing push latency stays bounded under " << kSetups << " concurrent SETUPs..." << std::endl;
+    RtspServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = kPort;
+    config.session_timeout_ms = 120000;
+    RtspServer server;
+    CHECK(server.init(config));
+
+    PathConfig hot;
+    hot.path = "/live/hot";
+    hot.sps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+    hot.pps = {0x68, 0xCE, 0x3C, 0x80};
+    CHECK(server.addPath(hot));
+    PathConfig storm = hot;
+    storm.path = "/live/storm";
+    CHECK(server.addPath(storm));
+    // 不读应答的连接收这一路大帧，几秒内就把内核缓冲与服务端待发缓冲写满
+    PathConfig bulk = hot;
+    bulk.path = "/live/bulk";
+    CHECK(server.addPath(bulk));
+    AdmissionConfig admission;
+    admission.max_sessions_per_path = kSetups;
+    server.setAdmissionControl(admission);
+    CHECK(server.start());
+
+    // 推流线程逐次计时：hot 与 storm 两路计时，storm 路径的广播要遍历正在增长的会话表；bulk 路径不计时
+    std::atomic<bool> running{true};
+    std::vector<int64_t> latencies_us;
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const auto frame = makeFrame(i);
+            const auto start = std::chrono::steady_clock::now();
+            server.pushH264Data(hot.path, frame.data(), frame.size(), static_cast<uint64_t>(i) * 10, i % kGop == 0);
+            server.pushH264Data(storm.path, frame.data(), frame.size(), static_cast<uint64_t>(i) * 10,
+                                i % kGop == 0);
+            latencies_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                                       std::chrono::steady_clock::now() - start)
+                                       .count());
+            const auto big = makeFrame(i, 48000);
+            server.pushH264Data(bulk.path, big.data(), big.size(), static_cast<uint64_t>(i) * 10, i % kGop == 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    std::vector<std::unique_ptr<Socket>> sockets(kSetups);
+    std::vector<std::unique_ptr<Socket>> stalled(kStalledReaders);
+    std::atomic<int> succeeded{0};
+    std::atomic<int> stalled_set_up{0};
+    std::vector<std::thread> clients;
+    const auto storm_start = std::chrono::steady_clock::now();
+    clients.emplace_back([&]() {
+        for (auto& socket : stalled) {
+            socket.reset(new Socket());
+            if (floodWithoutReading(*socket)) {
+                stalled_set_up++;
+            }
+        }
+    });
+    for (int t = 0; t < kSetupThreads; ++t) {
+        clients.emplace_back([&, t]() {
+            for (int i = t; i < kSetups; i += kSetupThreads) {
+                sockets[static_cast<size_t>(i)].reset(new Socket());
+                if (setupSession(*sockets[static_cast<size_t>(i)], i, i % kPlayEvery == 0)) {
+                    succeeded++;
+                }
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    const auto storm_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - storm_start).count();
+    // 继续推流，直到不读应答的连接因待发数据持续写不出去被服务端关闭，只剩 storm 路径的会话
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (server.getLoad().sessions != static_cast<uint32_t>(kSetups) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    running = false;
+    pusher.join();
+    CHECK(server.getLoad().sessions == static_cast<uint32_t>(kSetups));
+
+    CHECK(succeeded == kSetups);
+    CHECK(stalled_set_up == kStalledReaders);
+    CHECK(server.getStats().sessions_created == static_cast<uint64_t>(kSetups + kStalledReaders));
+    Socket extra;
+    CHECK(!setupSession(extra, kSetups, false));
+    CHECK(server.getStats().admission_rejected_path == 1);
+    extra.close();
+
+    CHECK(latencies_us.size() >= 10);
+    std::sort(latencies_us.begin(), latencies_us.end());
+    const int64_t p50 = latencies_us[latencies_us.size() / 2];
+    const int64_t p99 = latencies_us[latencies_us.size() * 99 / 100];
+    const int64_t worst = latencies_us.back();
+    std::cout << "  " << kSetups << " SETUPs in " << storm_ms << " ms, " << latencies_us.size()
+              << " pushes: p50=" << p50 << "us p99=" << p99 << "us max=" << worst << "us" << std::endl;
+    CHECK(p50 < 5000);
+    CHECK(worst < 200000);
+
+    for (auto& socket : sockets) {
+        socket->close();
+    }
+    for (auto& socket : stalled) {
+        socket->close();
+    }
+    server.stop();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running SETUP Storm Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    test_push_latency_under_setup_storm();
+
+    std::cout << "\n=== All SETUP Storm Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * 单线程服务端模式测试
+ *
+ * - 启动后不创建任何线程；getPollDescriptors 覆盖监听与每个连接
+ * - 由 processEvents 驱动 accept、请求处理、UDP 与 RTP over TCP 发送
+ * - 会话超时在 processEvents 内清理；需要内部线程的功能被拒绝
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+    #include <dirent.h>
+    #include <fstream>
+#endif
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19808;
+const uint64_t kFrameMs = 40;
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    if (index % 10 == 0) {
+        out = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8,
+               0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+               0x00, 0x00, 0x00, 0x01, 0x65, 0x88};
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A};
+    }
+    // 大于 MTU，走 FU-A 分片
+    out.resize(out.size() + 3000, 0x42);
+    return out;
+}
+
+// 进程内各线程的名字（非 Linux 返回空，不参与比较）
+std::vector<std::string> threadNames() {
+    std::vector<std::string> names;
+#if defined(__linux__)
+    DIR* dir = opendir("/proc/self/task");
+    CHECK(dir != nullptr);
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::ifstream comm(std::string("/proc/self/task/") + entry->d_name + "/comm");
+        std::string name;
+        std::getline(comm, name);
+        names.push_back(name);
+    }
+    closedir(dir);
+#endif
+    return names;
+}
+
+// 服务端线程（多线程模式下的连接、发送、清理、监听线程）
+bool hasServerThreads() {
+    for (const auto& name : threadNames()) {
+        if (name == "rtsp-conn" || name == "rtsp-send" || name == "rtsp-cleanup" || name == "rtsp-accept") {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 在当前（推帧）线程上驱动服务端，直到 done 为真；期间按 25fps 推帧
+void drive(RtspServer& server, const std::function<bool()>& done, int& frame_index) {
+    using Clock = std::chrono::steady_clock;
+    const auto begin = Clock::now();
+    auto next_frame = begin;
+    while (!done()) {
+        CHECK(Clock::now() - begin < std::chrono::seconds(10));
+        if (Clock::now() >= next_frame) {
+            const auto frame = makeFrame(frame_index);
+            CHECK(server.pushH264Data("/live/test", frame.data(), frame.size(), frame_index * kFrameMs,
+                                      frame_index % 10 == 0));
+            frame_index++;
+            next_frame += std::chrono::milliseconds(kFrameMs);
+        }
+        const auto until_frame = std::chrono::duration_cast<std::chrono::milliseconds>(next_frame - Clock::now());
+        const int deadline = server.nextTimerDeadline();
+        CHECK(deadline >= 0 && deadline <= 100);
+        CHECK(server.processEvents(static_cast<int>(std::max<int64_t>(0, until_frame.count()))) >= 0);
+    }
+}
+
+void test_unsupported_features(RtspServer& server) {
+    std::cout << "Testing features that need internal threads are rejected..." << std::endl;
+    RtspServer threaded;
+    CHECK(threaded.processEvents(0) == -1);
+    CHECK(threaded.nextTimerDeadline() == -1);
+    CHECK(threaded.getPollDescriptors().empty());
+
+    PathConfig timeshift;
+    timeshift.path = "/live/timeshift";
+    timeshift.timeshift_max_bytes = 1024 * 1024;
+    CHECK(!server.addPath(timeshift));
+    CHECK(!server.startHlsServer(kPort + 1, "127.0.0.1"));
+    RelayPathConfig relay;
+    relay.path = "/relay";
+    relay.url = "rtsp://127.0.0.1:1/x";
+    CHECK(!server.addRelayPath(relay));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_play(RtspServer& server, int& frame_index) {
+    std::cout << "Testing UDP and TCP players driven by processEvents..." << std::endl;
+    std::atomic<int> ready{0};
+    std::atomic<bool> release{false};
+    std::atomic<int> finished{0};
+    auto player = [&](bool tcp) {
+        RtspClient client;
+        RtspClientConfig cfg;
+        cfg.prefer_tcp_transport = tcp;
+        client.setConfig(cfg);
+        CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test"));
+        CHECK(client.describe());
+        CHECK(client.setup(0));
+        CHECK(client.play(0));
+        for (int i = 0; i < 10; ++i) {
+            VideoFrame frame{};
+            CHECK(client.receiveFrame(frame, 3000));
+            CHECK(frame.size > 3000);
+        }
+        ready++;
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        client.close();
+        finished++;
+    };
+    std::thread udp_player(player, false);
+    std::thread tcp_player(player, true);
+
+    drive(server, [&]() { return ready == 2; }, frame_index);
+    CHECK(server.getLoad().sessions == 2);
+    // 监听 + 两个控制连接
+    CHECK(server.getPollDescriptors().size() == 3);
+    // 服务端没有为连接/会话创建线程（进程里只有客户端自己的线程）
+    CHECK(!hasServerThreads());
+    // 刚推入的帧须立即处理
+    const auto frame = makeFrame(frame_index);
+    CHECK(server.pushH264Data("/live/test", frame.data(), frame.size(), frame_index * kFrameMs, false));
+    frame_index++;
+    CHECK(server.nextTimerDeadline() == 0);
+
+    release = true;
+    drive(server, [&]() { return finished == 2 && server.getLoad().sessions == 0; }, frame_index);
+    udp_player.join();
+    tcp_player.join();
+    CHECK(server.getStats().sessions_created == 2);
+    CHECK(server.getStats().rtp_packets_sent > 0);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_session_expiry(RtspServer& server, int& frame_index) {
+    std::cout << "Testing session expiry in processEvents..." << std::endl;
+    std::atomic<bool> set_up{false};
+    std::atomic<bool> release{false};
+    std::thread idle([&]() {
+        RtspClient client;
+        RtspClientConfig cfg;
+        cfg.prefer_tcp_transport = false;
+        client.setConfig(cfg);
+        CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test"));
+        CHECK(client.describe());
+        CHECK(client.setup(0));
+        set_up = true;
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        client.close();
+    });
+    drive(server, [&]() { return set_up.load(); }, frame_index);
+    const uint64_t closed = server.getStats().sessions_closed;
+    CHECK(server.getLoad().sessions == 1);
+    // 不 PLAY、不保活：session_timeout_ms 后由 processEvents 清理
+    drive(server, [&]() { return server.getLoad().sessions == 0; }, frame_index);
+    CHECK(server.getStats().sessions_closed == closed + 1);
+
+    release = true;
+    drive(server, [&]() { return server.getPollDescriptors().size() == 1; }, frame_index);
+    idle.join();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Single-Threaded Server Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServerConfig config;
+    config.host = "127.0.0.1";
+    config.port = kPort;
+    config.session_timeout_ms = 1000;
+    config.single_threaded = true;
+
+    const size_t threads_before = threadNames().size();
+    RtspServer server;
+    CHECK(server.init(config));
+    PathConfig path;
+    path.path = "/live/test";
+    CHECK(server.addPath(path));
+    CHECK(server.start());
+    CHECK(threadNames().size() == threads_before);
+    CHECK(server.getPollDescriptors().size() == 1);
+    CHECK(server.getPollDescriptors()[0].readable);
+
+    int frame_index = 0;
+    test_unsupported_features(server);
+    test_play(server, frame_index);
+    test_session_expiry(server, frame_index);
+
+    server.stop();
+    CHECK(server.processEvents(0) == -1);
+    std::cout << "\n=== All Single-Threaded Server Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * SPS 解析测试
+ *
+ * - H.264：High 1080p（裁剪 8 行、VUI 25fps、含防竞争字节）、Baseline 无 VUI、
+ *   场编码 + 缩放矩阵 + POC type 1
+ * - H.265：Main 1080p（一致性窗口、帧间预测的短期参考集、VUI 29.97fps）、
+ *   Main10 high tier 多子层 + 缩放列表 + 长期参考 + VUI
+ * - 截断 / 类型不符时返回 false
+ * - 服务端：addPath 与推流中的 SPS 更新路径快照；客户端 DESCRIBE 后 MediaInfo 取自 SPS
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+#include <rtsp-common/sps_parser.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19815;
+
+// 以下 SPS 按 H.264 7.3.2.1 / H.265 7.3.2.2 逐字段编码（含 00 00 03 防竞争字节）
+const std::vector<uint8_t> kH264High = {
+    0x67, 0x64, 0x00, 0x28, 0xAC, 0xD9, 0x40, 0x78, 0x02, 0x27, 0xE5, 0xC0,
+    0x44, 0x00, 0x00, 0x03, 0x00, 0x04, 0x00, 0x00, 0x03, 0x00, 0xCA, 0x10
+};
+
+const std::vector<uint8_t> kH264Baseline = {
+    0x67, 0x42, 0xC0, 0x1E, 0xDA, 0x02, 0x80, 0xF6, 0x40
+};
+
+const std::vector<uint8_t> kH264Interlaced = {
+    0x67, 0x64, 0x00, 0x29, 0xAD, 0xAF, 0xFF, 0xE0, 0x28, 0x54, 0xC8, 0x56,
+    0x03, 0xC0, 0x22, 0x7E, 0xD0
+};
+
+const std::vector<uint8_t> kH265Main = {
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00,
+    0x03, 0x00, 0x00, 0x03, 0x00, 0x7B, 0xA0, 0x03, 0xC0, 0x80, 0x11, 0x07,
+    0xCB, 0x96, 0x5E, 0x49, 0x36, 0x6B, 0xDA, 0xE0, 0x10, 0x00, 0x00, 0x3E,
+    0x90, 0x00, 0x07, 0x53, 0x01
+};
+
+const std::vector<uint8_t> kH265Main10 = {
+    0x42, 0x01, 0x03, 0x22, 0x20, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+    0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x99, 0xC0, 0x00, 0x00, 0x03, 0x00,
+    0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x01,
+    0x23, 0x96, 0xA0, 0x01, 0xE0, 0x20, 0x02, 0x1C, 0x4D, 0x94, 0x5E, 0x49,
+    0x12, 0xFF, 0xFF, 0xE4, 0x62, 0x0A, 0x37, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFC, 0x8C, 0x41, 0x46, 0x84, 0x3F, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xC8, 0xC4, 0x14, 0x68, 0x43, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFC, 0x9B, 0xBE, 0x55, 0xD1, 0x57, 0xFF, 0xC0, 0x01,
+    0x00, 0x00, 0xDA, 0x80, 0x80, 0x80, 0xD2, 0x1F, 0x80, 0x00, 0x00, 0x03,
+    0x00, 0x80, 0x00, 0x00, 0x19, 0x08
+};
+
+void test_h264() {
+    std::cout << "Testing H.264 SPS parsing..." << std::endl;
+    SpsInfo info;
+    CHECK(parseH264Sps(kH264High.data(), kH264High.size(), info));
+    CHECK(info.width == 1920 && info.height == 1080);
+    CHECK(info.fps == 25);
+    CHECK(info.profile_idc == 100 && info.constraint_flags == 0 && info.level_idc == 40);
+
+    CHECK(parseH264Sps(kH264Baseline.data(), kH264Baseline.size(), info));
+    CHECK(info.width == 640 && info.height == 480);
+    CHECK(info.fps == 0);
+    CHECK(info.profile_idc == 66 && info.constraint_flags == 0xC0 && info.level_idc == 30);
+
+    // 场编码：高度按两场计，裁剪单位为 4 行
+    CHECK(parseH264Sps(kH264Interlaced.data(), kH264Interlaced.size(), info));
+    CHECK(info.width == 1920 && info.height == 1080);
+    CHECK(info.level_idc == 41);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_h265() {
+    std::cout << "Testing H.265 SPS parsing..." << std::endl;
+    SpsInfo info;
+    CHECK(parseH265Sps(kH265Main.data(), kH265Main.size(), info));
+    CHECK(info.width == 1920 && info.height == 1080);
+    CHECK(info.fps == 30);
+    CHECK(info.profile_idc == 1 && info.level_idc == 123 && !info.high_tier);
+
+    CHECK(parseH265Sps(kH265Main10.data(), kH265Main10.size(), info));
+    CHECK(info.width == 3840 && info.height == 2160);
+    CHECK(info.fps == 50);
+    CHECK(info.profile_idc == 2 && info.level_idc == 153 && info.high_tier);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_malformed() {
+    std::cout << "Testing truncated and mistyped SPS..." << std::endl;
+    SpsInfo info;
+    for (size_t len = 0; len < 8; ++len) {
+        CHECK(!parseH264Sps(kH264High.data(), len, info));
+    }
+    CHECK(!parseH265Sps(kH264High.data(), kH264High.size(), info));
+    CHECK(!parseH264Sps(kH265Main.data(), kH265Main.size(), info));
+    const std::vector<uint8_t> zeros = {0x67, 0x64, 0x00, 0x28, 0x00, 0x00, 0x00, 0x00};
+    CHECK(!parseH264Sps(zeros.data(), zeros.size(), info));
+    // 任意截断都不越界
+    for (size_t len = 0; len <= kH265Main10.size(); ++len) {
+        parseSps(CodecType::H265, kH265Main10.data(), len, info);
+    }
+    std::cout << "  PASSED" << std::endl;
+}
+
+MediaInfo describe() {
+    RtspClient client;
+    CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test"));
+    CHECK(client.describe());
+    const SessionInfo session = client.getSessionInfo();
+    CHECK(!session.media_streams.empty());
+    client.close();
+    return session.media_streams.front();
+}
+
+PathConfig snapshot(const RtspServer& server) {
+    for (const auto& config : server.getPathsSnapshot()) {
+        if (config.path == "/live/test") {
+            return config;
+        }
+    }
+    CHECK(false);
+    return PathConfig();
+}
+
+void test_server_and_client() {
+    std::cout << "Testing SPS-derived path info in snapshots and client MediaInfo..." << std::endl;
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    PathConfig config;
+    config.path = "/live/test";
+    config.sps = kH264Baseline;
+    config.pps = {0x68, 0xCE, 0x3C, 0x80};
+    CHECK(server.addPath(config));
+    CHECK(server.start());
+
+    PathConfig path = snapshot(server);
+    CHECK(path.width == 640 && path.height == 480 && path.fps == 30);
+    CHECK(path.profile_idc == 66 && path.level_idc == 30);
+    MediaInfo media = describe();
+    CHECK(media.width == 640 && media.height == 480);
+    CHECK(media.profile_idc == 66 && media.level_idc == 30);
+
+    // 推流中出现新的 SPS：路径信息随之刷新
+    std::vector<uint8_t> idr = {0x00, 0x00, 0x00, 0x01};
+    idr.insert(idr.end(), kH264High.begin(), kH264High.end());
+    idr.insert(idr.end(), {0x00, 0x00, 0x00, 0x01, 0x68, 0xEE, 0x3C, 0x80,
+                           0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00});
+    CHECK(server.pushH264Data("/live/test", idr.data(), idr.size(), 0, true));
+    path = snapshot(server);
+    CHECK(path.width == 1920 && path.height == 1080 && path.fps == 25);
+    CHECK(path.profile_idc == 100 && path.level_idc == 40);
+    media = describe();
+    CHECK(media.width == 1920 && media.height == 1080 && media.fps == 25);
+    CHECK(media.profile_idc == 100 && media.level_idc == 40);
+
+    server.stop();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running SPS Parser Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    test_h264();
+    test_h265();
+    test_malformed();
+    test_server_and_client();
+
+    std::cout << "\n=== All SPS Parser Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,251 @@
+/**
+ * 订阅模式测试（缩略图墙场景）
+ *
+ * 推流：GOP 10，IDR 后参考 P 帧（nal_ref_idc=2）与非参考帧（nal_ref_idc=0）交替，pts 间隔 40ms（25fps）
+ * - ?mode=idr：只收到 IDR
+ * - ?every=N：收到的帧数约为 1/N，参考链不断（收到的参考帧之前同 GOP 的参考帧都已收到）
+ * - ?maxfps=N：按 pts 计的帧率不超过上限，非参考帧先丢
+ * - 全参考帧 GOP（IPPP）跟不上限速时退化为只发 IDR，相邻发出帧间隔均匀；跟得上时不退化
+ * - 丢弃的帧不进入打包：客户端看到的 RTP 序号连续，无丢包事件
+ * - 订阅参数来自 DESCRIBE URL（SETUP URL 按 Content-Base 拼接不带查询串）；非法参数 SETUP 返回失败
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19816;
+const int kGop = 10;
+const uint64_t kFrameMs = 40;
+
+bool isIdrIndex(int index) { return index % kGop == 0; }
+bool isRefIndex(int index) { return index % kGop % 2 == 1; }     // 奇数位为参考 P 帧，偶数位为非参考帧
+
+std::vector<uint8_t> makeFrame(int index) {
+    uint8_t header = 0x01;                 // non-IDR slice，nal_ref_idc = 0
+    size_t body = 200;
+    if (isIdrIndex(index)) {
+        header = 0x65;
+        body = 3000;
+    } else if (isRefIndex(index)) {
+        header = 0x41;
+    }
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01, header};
+    out.resize(out.size() + body, 0x42);
+    return out;
+}
+
+// 全参考帧 GOP：IDR 之后全是参考 P 帧，没有可丢的非参考帧
+std::vector<uint8_t> makeAllReferenceFrame(int index) {
+    const bool idr = isIdrIndex(index);
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01, static_cast<uint8_t>(idr ? 0x65 : 0x41)};
+    out.resize(out.size() + (idr ? 3000 : 200), 0x42);
+    return out;
+}
+
+bool openClient(RtspClient& client, const std::string& query, const std::string& path = "/live/test") {
+    RtspClientConfig config;
+    config.prefer_tcp_transport = true;
+    config.inject_parameter_sets = false;
+    client.setConfig(config);
+    return client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + path + query) &&
+           client.describe() && client.setup(0) && client.play(0);
+}
+
+// 读 count 帧，返回各帧按 pts 还原的推流序号
+std::vector<int> readIndices(RtspClient& client, int count) {
+    std::vector<int> indices;
+    for (int i = 0; i < count; ++i) {
+        VideoFrame frame{};
+        CHECK(client.receiveFrame(frame, 5000));
+        indices.push_back(static_cast<int>(frame.pts / kFrameMs));
+        CHECK(frame.size > 4);
+        const uint8_t header = frame.data[4];
+        CHECK((header == 0x65) == isIdrIndex(indices.back()));
+    }
+    return indices;
+}
+
+// 参考链不断：收到的每个参考 P 帧，同 GOP 内更早的参考帧也都收到了
+void checkReferenceChain(const std::vector<int>& indices) {
+    std::map<int, int> next_ref;           // GOP 序号 -> 期望的下一个参考帧位置
+    bool synced = false;
+    for (int index : indices) {
+        const int gop = index / kGop;
+        const int pos = index % kGop;
+        if (pos == 0) {
+            next_ref[gop] = 1;
+            synced = true;
+        } else if (isRefIndex(index)) {
+            CHECK(synced && next_ref.count(gop));
+            CHECK(pos == next_ref[gop]);
+            next_ref[gop] = pos + 2;
+        }
+    }
+}
+
+int countNonRef(const std::vector<int>& indices) {
+    int count = 0;
+    for (int index : indices) {
+        if (!isIdrIndex(index) && !isRefIndex(index)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void test_idr_only(RtspServer& server) {
+    std::cout << "Testing mode=idr delivers only IDR frames..." << std::endl;
+    const uint64_t dropped_before = server.getStats().subscription_frames_dropped;
+    RtspClient client;
+    CHECK(openClient(client, "?mode=idr"));
+    const std::vector<int> indices = readIndices(client, 4);
+    for (int index : indices) {
+        CHECK(isIdrIndex(index));
+    }
+    CHECK(client.getStats().rtp_packet_loss_events == 0);
+    CHECK(server.getStats().subscription_frames_dropped >= dropped_before + 3 * (kGop - 1));
+    client.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_every_nth() {
+    std::cout << "Testing every=3 decimates while keeping the reference chain..." << std::endl;
+    RtspClient client;
+    CHECK(openClient(client, "?every=3"));
+    const std::vector<int> indices = readIndices(client, 30);
+    checkReferenceChain(indices);
+    // 约每 3 帧发 1 帧
+    const int span = indices.back() - indices.front() + 1;
+    CHECK(span >= 30 * 3 / 2);
+    CHECK(countNonRef(indices) < static_cast<int>(indices.size()) / 2);
+    CHECK(client.getStats().rtp_packet_loss_events == 0);
+    client.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_max_fps() {
+    std::cout << "Testing maxfps=5 caps the rate and drops non-reference frames first..." << std::endl;
+    RtspClient client;
+    CHECK(openClient(client, "?maxfps=5"));
+    const std::vector<int> indices = readIndices(client, 25);
+    checkReferenceChain(indices);
+    // 25fps 源限到 5fps：桶里只有 1 个令牌，pts 跨度内的帧数不超过 5fps（首帧另计）
+    const uint64_t span_ms = static_cast<uint64_t>(indices.back() - indices.front()) * kFrameMs;
+    CHECK(indices.size() <= span_ms * 5 / 1000 + 1 + 1);
+    // 非参考帧需要距上一帧 200ms，源里只有 40ms 间隔的交替帧，几乎全被丢掉
+    CHECK(countNonRef(indices) * 5 < static_cast<int>(indices.size()));
+    CHECK(client.getStats().rtp_packet_loss_events == 0);
+    client.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_all_reference_gop() {
+    std::cout << "Testing all-reference GOPs fall back to evenly spaced IDR frames..." << std::endl;
+    RtspClient client;
+    CHECK(openClient(client, "?every=3", "/live/ippp"));
+    const std::vector<int> indices = readIndices(client, 6);
+    // 参考帧跟不上令牌、又没有非参考帧可丢：每个 GOP 只发 IDR，相邻两帧正好隔一个 GOP，
+    // 不会先连发几帧再冻住到下一个 IDR
+    for (size_t i = 0; i < indices.size(); ++i) {
+        CHECK(isIdrIndex(indices[i]));
+        if (i > 0) {
+            CHECK(indices[i] - indices[i - 1] == kGop);
+        }
+    }
+    CHECK(client.getStats().rtp_packet_loss_events == 0);
+    client.close();
+
+    // 令牌跟得上源帧率时不退化：全部帧照发
+    RtspClient fast;
+    CHECK(openClient(fast, "?maxfps=30", "/live/ippp"));
+    const std::vector<int> all = readIndices(fast, 2 * kGop);
+    for (size_t i = 1; i < all.size(); ++i) {
+        CHECK(all[i] == all[i - 1] + 1);
+    }
+    fast.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_unfiltered_and_invalid() {
+    std::cout << "Testing default subscription and invalid parameters..." << std::endl;
+    RtspClient client;
+    CHECK(openClient(client, "?mode=all&token=abc"));
+    const std::vector<int> indices = readIndices(client, 20);
+    for (size_t i = 1; i < indices.size(); ++i) {
+        CHECK(indices[i] == indices[i - 1] + 1);
+    }
+    CHECK(countNonRef(indices) > 0);
+    client.close();
+
+    RtspClient bad;
+    RtspClientConfig config;
+    config.prefer_tcp_transport = true;
+    bad.setConfig(config);
+    CHECK(bad.open("rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test?every=0"));
+    CHECK(bad.describe());
+    CHECK(!bad.setup(0));
+    bad.close();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Subscription Mode Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    PathConfig config;
+    config.path = "/live/test";
+    config.fps = 25;
+    config.sps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+    config.pps = {0x68, 0xCE, 0x3C, 0x80};
+    CHECK(server.addPath(config));
+    config.path = "/live/ippp";
+    CHECK(server.addPath(config));
+    CHECK(server.start());
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const auto frame = makeFrame(i);
+            server.pushH264Data("/live/test", frame.data(), frame.size(), static_cast<uint64_t>(i) * kFrameMs,
+                                isIdrIndex(i));
+            const auto ippp = makeAllReferenceFrame(i);
+            server.pushH264Data("/live/ippp", ippp.data(), ippp.size(), static_cast<uint64_t>(i) * kFrameMs,
+                                isIdrIndex(i));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    test_idr_only(server);
+    test_every_nth();
+    test_max_fps();
+    test_all_reference_gop();
+    test_unfiltered_and_invalid();
+
+    running = false;
+    pusher.join();
+    server.stop();
+    std::cout << "\n=== All Subscription Mode Tests Passed! ===" << std::endl;
+    return 0;
+}
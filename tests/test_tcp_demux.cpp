@@ -0,0 +1,199 @@
+/**
+ * 客户端 RTP over TCP 解复用测试
+ *
+ * 脚本化的服务端把 RTP、RTCP 通道包、服务端发起的 RTSP 请求、迟到的旧响应与保活响应
+ * 混在同一条控制连接里，按奇数长度切块写出：
+ * - 紧跟 PLAY 响应发出的 $ 包不丢；每个 RTP 包都被交付，RTCP 通道单独计数，不进入 RTP 解包
+ * - GET_PARAMETER 在播放中完成（按 CSeq 取到自己的响应），接收不中断
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include "socket.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19809;
+const int kFrames = 60;
+const size_t kPayloadSize = 900;
+
+int requestCSeq(const std::string& request) {
+    static const std::regex cseq_re("CSeq:\\s*(\\d+)", std::regex::icase);
+    std::smatch m;
+    return std::regex_search(request, m, cseq_re) ? std::stoi(m[1].str()) : -1;
+}
+
+std::string okResponse(int cseq, const std::string& extra = "", const std::string& body = "") {
+    std::string out = "RTSP/1.0 200 OK\r\nCSeq: " + std::to_string(cseq) + "\r\n" + extra;
+    if (!body.empty()) {
+        out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    return out + "\r\n" + body;
+}
+
+void appendInterleaved(std::string& out, uint8_t channel, const std::vector<uint8_t>& packet) {
+    out.push_back('$');
+    out.push_back(static_cast<char>(channel));
+    out.push_back(static_cast<char>(packet.size() >> 8));
+    out.push_back(static_cast<char>(packet.size() & 0xFF));
+    out.append(reinterpret_cast<const char*>(packet.data()), packet.size());
+}
+
+// 每帧一个 RTP 包（单 NALU，置 marker）
+std::vector<uint8_t> rtpPacket(int index) {
+    std::vector<uint8_t> packet = {0x80, 0xE0,
+                                   static_cast<uint8_t>(index >> 8), static_cast<uint8_t>(index),
+                                   0, 0, 0, 0, 0x11, 0x22, 0x33, 0x44};
+    const uint32_t ts = static_cast<uint32_t>(index) * 3600;
+    packet[4] = static_cast<uint8_t>(ts >> 24);
+    packet[5] = static_cast<uint8_t>(ts >> 16);
+    packet[6] = static_cast<uint8_t>(ts >> 8);
+    packet[7] = static_cast<uint8_t>(ts);
+    packet.push_back(index % 10 == 0 ? 0x65 : 0x41);
+    packet.resize(packet.size() + kPayloadSize, static_cast<uint8_t>(index));
+    return packet;
+}
+
+std::vector<uint8_t> senderReport() {
+    std::vector<uint8_t> packet = {0x80, 200, 0x00, 0x06, 0x11, 0x22, 0x33, 0x44};
+    packet.resize(28, 0);
+    return packet;
+}
+
+// 把 data 按 1~97 字节循环切块写出，让 $ 头、RTSP 消息跨越多次读取
+void sendChunked(Socket& socket, const std::string& data, size_t& chunk) {
+    size_t off = 0;
+    while (off < data.size()) {
+        chunk = chunk % 97 + 1;
+        const size_t n = std::min(chunk, data.size() - off);
+        CHECK(socket.sendAll(reinterpret_cast<const uint8_t*>(data.data()) + off, n, 2000) ==
+              static_cast<ssize_t>(n));
+        off += n;
+    }
+}
+
+void scriptedServer(Socket& listener, std::atomic<int>& get_parameters) {
+    auto client = listener.accept();
+    CHECK(client);
+    const std::string sdp = "v=0\r\no=- 0 0 IN IP4 127.0.0.1\r\ns=demux\r\nt=0 0\r\n"
+                            "m=video 0 RTP/AVP 96\r\na=rtpmap:96 H264/90000\r\na=control:track0\r\n";
+    const std::string session = "Session: 4242\r\n";
+
+    // 播放前：逐条应答
+    std::string request;
+    while (recvRtspMessage(*client, &request, 3000)) {
+        const int cseq = requestCSeq(request);
+        std::string response;
+        if (request.compare(0, 8, "DESCRIBE") == 0) {
+            response = okResponse(cseq, "Content-Type: application/sdp\r\n", sdp);
+        } else if (request.compare(0, 5, "SETUP") == 0) {
+            response = okResponse(cseq, session + "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n");
+        } else {
+            response = okResponse(cseq, session);
+        }
+        CHECK(client->sendAll(reinterpret_cast<const uint8_t*>(response.data()), response.size(), 2000) ==
+              static_cast<ssize_t>(response.size()));
+        if (request.compare(0, 4, "PLAY") == 0) {
+            break;
+        }
+    }
+
+    // 播放中：媒体与控制消息混在一条流里
+    size_t chunk = 0;
+    for (int i = 0; i < kFrames; ++i) {
+        std::string out;
+        appendInterleaved(out, 0, rtpPacket(i));
+        if (i % 5 == 0) {
+            appendInterleaved(out, 1, senderReport());
+        }
+        if (i == 3) {
+            out += "SET_PARAMETER rtsp://127.0.0.1/demux RTSP/1.0\r\nCSeq: 1\r\nContent-Length: 5\r\n\r\nhello";
+        }
+        while (client->waitReadable(0) > 0 && recvRtspMessage(*client, &request, 1000)) {
+            const int cseq = requestCSeq(request);
+            if (request.compare(0, 13, "GET_PARAMETER") == 0) {
+                get_parameters++;
+                // 先来一条较早请求迟到的响应，客户端须按 CSeq 跳过
+                out += okResponse(cseq - 1, session);
+            }
+            out += okResponse(cseq, session);
+        }
+        sendChunked(*client, out, chunk);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // 应答之后的请求（TEARDOWN），直到客户端断开
+    while (recvRtspMessage(*client, &request, 2000)) {
+        const std::string response = okResponse(requestCSeq(request), session);
+        client->sendAll(reinterpret_cast<const uint8_t*>(response.data()), response.size(), 2000);
+    }
+}
+
+void test_demux() {
+    std::cout << "Testing interleaved demux with embedded RTSP messages..." << std::endl;
+    Socket listener;
+    CHECK(listener.bind("127.0.0.1", kPort));
+    CHECK(listener.listen());
+    std::atomic<int> get_parameters{0};
+    std::thread server([&]() { scriptedServer(listener, get_parameters); });
+
+    RtspClient client;
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = true;
+    client.setConfig(cfg);
+    CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + "/demux"));
+    CHECK(client.describe());
+    CHECK(client.setup(0));
+    CHECK(client.play(0));
+
+    int received = 0;
+    auto receive = [&](int count) {
+        for (int i = 0; i < count; ++i) {
+            VideoFrame frame{};
+            CHECK(client.receiveFrame(frame, 3000));
+            CHECK(frame.size == 4 + 1 + kPayloadSize);
+            received++;
+        }
+    };
+    receive(10);
+    // 播放中保活：接收线程不停，响应从媒体流中拆出
+    CHECK(client.sendGetParameter(""));
+    CHECK(get_parameters == 1);
+    receive(kFrames - 10);
+    CHECK(received == kFrames);
+
+    const RtspClientStats stats = client.getStats();
+    CHECK(stats.rtp_packets_received == static_cast<uint64_t>(kFrames));
+    CHECK(stats.rtp_packets_reordered == 0);
+    CHECK(stats.rtcp_packets_received == static_cast<uint64_t>((kFrames + 4) / 5));
+    CHECK(stats.using_tcp_transport);
+
+    client.close();
+    server.join();
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running TCP Demux Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+    test_demux();
+    std::cout << "\n=== All TCP Demux Tests Passed! ===" << std::endl;
+    return 0;
+}
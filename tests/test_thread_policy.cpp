@@ -0,0 +1,207 @@
+/**
+ * 线程放置策略测试
+ *
+ * - startThread 按角色设置线程名与 CPU 绑定；只能移动的可调用对象可以直接传入
+ * - SCHED_FIFO 权限不足时记警告，线程照常运行
+ * - 服务端/客户端的线程都经统一入口创建，可在 /proc/self/task 中按名字找到
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+#include "thread_policy.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+    #include <dirent.h>
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19807;
+
+#if defined(__linux__)
+
+std::string currentThreadName() {
+    char name[16] = {0};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    return name;
+}
+
+// 进程内所有线程的名字
+std::multiset<std::string> threadNames() {
+    std::multiset<std::string> names;
+    DIR* dir = opendir("/proc/self/task");
+    CHECK(dir != nullptr);
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::ifstream comm(std::string("/proc/self/task/") + entry->d_name + "/comm");
+        std::string name;
+        if (std::getline(comm, name)) {
+            names.insert(name);
+        }
+    }
+    closedir(dir);
+    return names;
+}
+
+void test_name_and_affinity() {
+    std::cout << "Testing thread name and CPU affinity..." << std::endl;
+    ThreadPolicy policy;
+    policy.media_send.cpus = {0};
+    setThreadPolicy(policy);
+    CHECK(getThreadPolicy().media_send.cpus.size() == 1);
+
+    std::string name;
+    bool pinned = false;
+    int cpu_count = 0;
+    std::unique_ptr<int> moved(new int(7));
+    int moved_value = 0;
+    std::thread worker = startThread(ThreadRole::MediaSend, "test-send-thread-long",
+                                     [&, moved = std::move(moved)]() {
+        name = currentThreadName();
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CHECK(sched_getaffinity(0, sizeof(set), &set) == 0);
+        pinned = CPU_ISSET(0, &set);
+        cpu_count = CPU_COUNT(&set);
+        moved_value = *moved;
+    });
+    worker.join();
+    // 超过 15 字节的名字被截断
+    CHECK(name == "test-send-threa");
+    CHECK(pinned);
+    CHECK(cpu_count == 1);
+    CHECK(moved_value == 7);
+
+    // 其他角色不受影响；关闭命名后沿用进程名
+    policy.set_names = false;
+    setThreadPolicy(policy);
+    std::thread other = startThread(ThreadRole::Background, "test-bg", [&]() {
+        name = currentThreadName();
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CHECK(sched_getaffinity(0, sizeof(set), &set) == 0);
+        cpu_count = CPU_COUNT(&set);
+    });
+    other.join();
+    CHECK(name != "test-bg");
+    CHECK(cpu_count >= 1);
+    setThreadPolicy(ThreadPolicy());
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_fifo_priority() {
+    std::cout << "Testing SCHED_FIFO request..." << std::endl;
+    ThreadPolicy policy;
+    policy.media_receive.fifo_priority = 200;   // 超出上限时截到最大值
+    setThreadPolicy(policy);
+    int sched_policy = -1;
+    bool ran = false;
+    std::thread worker = startThread(ThreadRole::MediaReceive, "test-fifo", [&]() {
+        sched_param param;
+        pthread_getschedparam(pthread_self(), &sched_policy, &param);
+        ran = true;
+    });
+    worker.join();
+    // 没有 CAP_SYS_NICE 时保持普通调度，但线程照常运行
+    CHECK(ran);
+    CHECK(sched_policy == SCHED_FIFO || sched_policy == SCHED_OTHER);
+    setThreadPolicy(ThreadPolicy());
+    std::cout << "  PASSED" << std::endl;
+}
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    if (index % 10 == 0) {
+        out = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8,
+               0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+               0x00, 0x00, 0x00, 0x01, 0x65, 0x88};
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A};
+    }
+    out.resize(out.size() + 500, 0x42);
+    return out;
+}
+
+void test_sdk_threads_named() {
+    std::cout << "Testing SDK thread names..." << std::endl;
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    PathConfig config;
+    config.path = "/live/test";
+    CHECK(server.addPath(config));
+    CHECK(server.start());
+
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const auto frame = makeFrame(i);
+            server.pushH264Data("/live/test", frame.data(), frame.size(), i * 40, i % 10 == 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        }
+    });
+
+    RtspClient client;
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = false;
+    client.setConfig(cfg);
+    CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + "/live/test"));
+    CHECK(client.describe());
+    CHECK(client.setup(0));
+    CHECK(client.play(0));
+    VideoFrame frame{};
+    CHECK(client.receiveFrame(frame, 3000));
+
+    const auto names = threadNames();
+    for (const char* expected : {"rtsp-accept", "rtsp-conn", "rtsp-send", "rtsp-recv", "rtsp-cleanup"}) {
+        if (names.count(expected) == 0) {
+            std::cerr << "missing thread " << expected << std::endl;
+        }
+        CHECK(names.count(expected) > 0);
+    }
+
+    client.close();
+    running = false;
+    pusher.join();
+    server.stop();
+    std::cout << "  PASSED" << std::endl;
+}
+
+#endif
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Thread Policy Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+#if defined(__linux__)
+    test_name_and_affinity();
+    test_fifo_priority();
+    test_sdk_threads_named();
+#else
+    std::cout << "Linux only, skipped" << std::endl;
+#endif
+    std::cout << "\n=== All Thread Policy Tests Passed! ===" << std::endl;
+    return 0;
+}
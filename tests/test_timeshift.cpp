@@ -0,0 +1,265 @@
+/**
+ * 直播时移回归测试
+ *
+ * - 缓冲按字节封顶、整 GOP 淘汰：回看最早只能到最老的 IDR
+ * - PLAY Range: npt= 从不晚于该时刻的 IDR 回看，按倍速追上直播后无缝切回广播（pts 不跳不重）
+ * - PAUSE 后无 Range 的 PLAY 从暂停处继续
+ * - npt 相对缓冲（0 为最老的 IDR），npt=now-N 从直播往回算；应答的 Range 为实际起点
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+#include <rtsp-common/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19796;
+const uint32_t kFps = 25;
+const uint64_t kFrameMs = 1000 / kFps;
+const int kGopFrames = 10;
+
+const std::vector<uint8_t> kSps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+const std::vector<uint8_t> kPps = {0x68, 0xCE, 0x3C, 0x80};
+
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out;
+    size_t payload = 800;
+    if (index % kGopFrames == 0) {
+        out = {0x00, 0x00, 0x00, 0x01};
+        out.insert(out.end(), kSps.begin(), kSps.end());
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+        out.insert(out.end(), kPps.begin(), kPps.end());
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01, 0x65, 0x88});
+        payload = 3000;
+    } else {
+        out = {0x00, 0x00, 0x00, 0x01, 0x41, 0x88};
+    }
+    for (size_t i = 0; i < payload; ++i) {
+        out.push_back(static_cast<uint8_t>(0x10 + (i % 0x60)));
+    }
+    return out;
+}
+
+bool pushFrame(RtspServer& server, const std::string& path, int index, uint64_t base_pts = 0) {
+    const auto frame = makeFrame(index);
+    return server.pushH264Data(path, frame.data(), frame.size(), base_pts + index * kFrameMs,
+                               index % kGopFrames == 0);
+}
+
+// 裸 RTSP 请求，返回整条应答
+std::string rawRequest(Socket& sock, const std::string& request) {
+    std::string response;
+    if (sock.sendAll(reinterpret_cast<const uint8_t*>(request.data()), request.size(), 2000) !=
+            static_cast<ssize_t>(request.size()) ||
+        !recvRtspMessage(sock, &response, 2000)) {
+        return "";
+    }
+    return response;
+}
+
+// SETUP 后带 Range 的 PLAY，返回应答的 Range 头
+std::string playRange(const std::string& path, const std::string& range) {
+    const std::string url = "rtsp://127.0.0.1:" + std::to_string(kPort) + path;
+    Socket sock;
+    if (!sock.connect("127.0.0.1", kPort, 2000)) {
+        return "";
+    }
+    const std::string setup = rawRequest(sock, "SETUP " + url + "/stream RTSP/1.0\r\nCSeq: 1\r\n"
+                                               "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n\r\n");
+    const size_t sid = setup.find("Session: ");
+    if (sid == std::string::npos) {
+        return "";
+    }
+    const std::string session = setup.substr(sid + 9, setup.find_first_of(";\r", sid) - sid - 9);
+    const std::string play = rawRequest(sock, "PLAY " + url + " RTSP/1.0\r\nCSeq: 2\r\nSession: " + session +
+                                                  "\r\nRange: " + range + "\r\n\r\n");
+    const size_t pos = play.find("Range: ");
+    sock.close();
+    return pos == std::string::npos ? "" : play.substr(pos + 7, play.find("\r\n", pos) - pos - 7);
+}
+
+bool openClient(RtspClient& client, const std::string& path) {
+    RtspClientConfig cfg;
+    cfg.prefer_tcp_transport = false;
+    client.setConfig(cfg);
+    return client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + path) &&
+           client.describe() && client.setup(0);
+}
+
+// 暂停后丢掉客户端队列里残留的帧
+void drain(RtspClient& client) {
+    VideoFrame frame{};
+    while (client.receiveFrame(frame, 0)) {
+    }
+}
+
+void test_byte_cap(RtspServer& server) {
+    std::cout << "Testing time-shift byte cap..." << std::endl;
+    PathConfig config;
+    config.path = "/live/capped";
+    config.fps = kFps;
+    config.timeshift_max_bytes = 40 * 1024;
+    CHECK(server.addPath(config));
+
+    const int total = 20 * kGopFrames;
+    for (int i = 0; i < total; ++i) {
+        CHECK(pushFrame(server, config.path, i));
+    }
+
+    // 要求回看到 0：早已淘汰，从缓冲中最老的 IDR 开始
+    RtspClient client;
+    CHECK(openClient(client, config.path));
+    CHECK(client.play(1));
+    VideoFrame received{};
+    do {
+        CHECK(client.receiveFrame(received, 2000));
+    } while (received.type != FrameType::IDR);
+    CHECK(received.pts % (kGopFrames * kFrameMs) == 0);
+    CHECK(received.pts >= (total - 5 * kGopFrames) * kFrameMs);
+    CHECK(received.pts < total * kFrameMs);
+    client.close();
+    CHECK(server.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_rewind_and_catch_up(RtspServer& server) {
+    std::cout << "Testing rewind, catch-up and pause/resume..." << std::endl;
+    PathConfig config;
+    config.path = "/live/dvr";
+    config.fps = kFps;
+    config.timeshift_max_bytes = 1024 * 1024;
+    config.timeshift_catchup_speed = 4.0;
+    CHECK(server.addPath(config));
+
+    std::atomic<bool> running{true};
+    std::atomic<int> pushed{0};
+    std::thread pusher([&]() {
+        const auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; running; ++i) {
+            std::this_thread::sleep_until(begin + std::chrono::milliseconds(i * kFrameMs));
+            pushFrame(server, config.path, i);
+            pushed = i + 1;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    RtspClient client;
+    CHECK(openClient(client, config.path));
+    CHECK(client.play(0));
+    VideoFrame received{};
+    CHECK(client.receiveFrame(received, 2000));
+    const uint64_t live_pts = received.pts;
+    CHECK(live_pts >= 1000);
+
+    // 回看 1 秒前：从该时刻之前最近的 IDR 开始
+    CHECK(client.pause());
+    drain(client);
+    const uint64_t rewind_ms = live_pts - 1000;
+    CHECK(client.play(rewind_ms));
+    CHECK(client.receiveFrame(received, 2000));
+    CHECK(received.type == FrameType::IDR);
+    CHECK(received.pts <= rewind_ms);
+    CHECK(received.pts + kGopFrames * kFrameMs > rewind_ms);
+
+    // 4 倍速追赶：pts 连续，追上后切回直播仍连续
+    uint64_t last_pts = received.pts;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1500);
+    while (std::chrono::steady_clock::now() < deadline) {
+        CHECK(client.receiveFrame(received, 1000));
+        CHECK(received.pts == last_pts + kFrameMs);
+        last_pts = received.pts;
+    }
+    const uint64_t live_edge = static_cast<uint64_t>(pushed.load() - 1) * kFrameMs;
+    CHECK(last_pts + 3 * kFrameMs >= live_edge);
+
+    // 暂停后续播：从暂停处继续，并再次追上直播
+    CHECK(client.pause());
+    drain(client);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    CHECK(client.play(0));
+    CHECK(client.receiveFrame(received, 2000));
+    CHECK(received.pts > last_pts);
+    CHECK(received.pts <= last_pts + 3 * kFrameMs);
+    last_pts = received.pts;
+    const auto resume_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1000);
+    while (std::chrono::steady_clock::now() < resume_deadline) {
+        CHECK(client.receiveFrame(received, 1000));
+        CHECK(received.pts == last_pts + kFrameMs);
+        last_pts = received.pts;
+    }
+    CHECK(last_pts + 3 * kFrameMs >= static_cast<uint64_t>(pushed.load() - 1) * kFrameMs);
+    client.close();
+
+    running = false;
+    pusher.join();
+    CHECK(server.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_seek_mid_buffer(RtspServer& server) {
+    std::cout << "Testing seek into the middle of the buffer..." << std::endl;
+    PathConfig config;
+    config.path = "/live/mid";
+    config.fps = kFps;
+    config.timeshift_max_bytes = 1024 * 1024;
+    CHECK(server.addPath(config));
+
+    // 推流方 pts 不从 0 起：5 个 GOP，IDR 在 base + 0/400/800/1200/1600 ms
+    const uint64_t base = 100000;
+    const int total = 5 * kGopFrames;
+    for (int i = 0; i < total; ++i) {
+        CHECK(pushFrame(server, config.path, i, base));
+    }
+
+    // npt=0.9 取不晚于它的 IDR（第 3 个 GOP），npt=now-1 从最新帧（base+1960）往回 1 秒落在同一 GOP
+    CHECK(playRange(config.path, "npt=0.9-") == "npt=0.800-");
+    CHECK(playRange(config.path, "npt=now-1") == "npt=0.800-");
+    CHECK(playRange(config.path, "npt=0-") == "npt=0.000-");
+    CHECK(playRange(config.path, "npt=30-") == "npt=1.600-");
+
+    RtspClient client;
+    CHECK(openClient(client, config.path));
+    CHECK(client.play(900));
+    VideoFrame received{};
+    CHECK(client.receiveFrame(received, 2000));
+    CHECK(received.type == FrameType::IDR);
+    CHECK(received.pts == base + 2 * kGopFrames * kFrameMs);
+    client.close();
+    CHECK(server.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Time-Shift Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Warning;
+    setLogConfig(log_config);
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    CHECK(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    test_byte_cap(server);
+    test_rewind_and_catch_up(server);
+    test_seek_mid_buffer(server);
+
+    server.stop();
+    std::cout << "\n=== All Time-Shift Tests Passed! ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,244 @@
+/**
+ * 高精度时间戳测试
+ *
+ * - 微秒 -> 90kHz：29.97fps 的帧间隔恒为 3003 刻度，59.94fps 与精确值相差不超过半个刻度，无毫秒取整抖动
+ * - RTP 时间戳展开：32 位回绕后继续递增，乱序的旧时间戳不误判为回绕
+ * - 端到端：推流给出 pts_us，客户端收到的 pts_us 与之相差不超过一个 90kHz 刻度，跨越 RTP 时间戳回绕仍单调
+ * - Annex-B 点播按有理帧率 30000/1001 推算时间戳并按微秒排程
+ */
+
+#include <rtsp-client/rtsp-client.h>
+#include <rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+
+using namespace rtsp;
+
+namespace {
+
+const uint16_t kPort = 19817;
+const int kGop = 10;
+
+// 第 n 帧在 fps_num/fps_den 帧率下的微秒时间戳（截断）
+uint64_t frameUs(uint64_t n, uint64_t fps_num, uint64_t fps_den) {
+    return n * fps_den * 1000000 / fps_num;
+}
+
+// 整帧单 slice：first_mb_in_slice = 0（首位为 1），点播建索引时按它切分 AU
+std::vector<uint8_t> makeFrame(int index) {
+    std::vector<uint8_t> out = {0x00, 0x00, 0x00, 0x01, static_cast<uint8_t>(index % kGop == 0 ? 0x65 : 0x41), 0x88};
+    out.resize(out.size() + 300, 0x42);
+    return out;
+}
+
+void test_rational_rtp_timestamps() {
+    std::cout << "Testing microsecond to 90kHz conversion at 29.97 and 59.94 fps..." << std::endl;
+    for (uint64_t n = 0; n < 10000; ++n) {
+        const uint32_t a = convertUsToRtpTimestamp(frameUs(n, 30000, 1001), 90000);
+        const uint32_t b = convertUsToRtpTimestamp(frameUs(n + 1, 30000, 1001), 90000);
+        CHECK(b - a == 3003);
+        CHECK(a == static_cast<uint32_t>(n * 3003));
+    }
+    for (uint64_t n = 0; n < 10000; ++n) {
+        // 59.94fps 每帧 1501.5 刻度：与精确值 n * 3003 / 2 的差不超过半个刻度
+        const uint32_t ts = convertUsToRtpTimestamp(frameUs(n, 60000, 1001), 90000);
+        const int64_t exact_x2 = static_cast<int64_t>(n) * 3003;
+        const int64_t diff_x2 = static_cast<int64_t>(ts) * 2 - exact_x2;
+        CHECK(diff_x2 >= -1 && diff_x2 <= 1);
+    }
+
+    // 毫秒字段照旧；墙钟量级的微秒不溢出
+    VideoFrame frame{};
+    frame.pts = 40;
+    CHECK(framePtsUs(frame) == 40000 && frameDtsUs(frame) == 0);
+    frame.pts_us = 1234567;
+    CHECK(framePtsUs(frame) == 1234567 && frameDtsUs(frame) == 1234567);
+    const uint64_t wall_us = 1700000000ULL * 1000000 + 500000;
+    CHECK(convertUsToRtpTimestamp(wall_us, 90000) ==
+          static_cast<uint32_t>(1700000000ULL * 90000 + 45000));
+    CHECK(rtpTimestampToUs(3003, 90000) == 33366);
+    CHECK(rtpTimestampToUs((1ULL << 32) + 90000, 90000) == ((1ULL << 32) + 90000) * 100 / 9);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_unwrapper() {
+    std::cout << "Testing 64-bit RTP timestamp unwrapping..." << std::endl;
+    RtpTimestampUnwrapper unwrapper;
+    CHECK(unwrapper.unwrap(0xFFFFF000u) == 0xFFFFF000ull);
+    CHECK(unwrapper.unwrap(0xFFFFFBBBu) == 0xFFFFFBBBull);
+    CHECK(unwrapper.unwrap(0x00000770u) == 0x100000770ull);   // 回绕
+    CHECK(unwrapper.unwrap(0xFFFFFF00u) == 0xFFFFFF00ull);    // 回绕前的迟到包
+    CHECK(unwrapper.unwrap(0x00000770u) == 0x100000770ull);   // 同一时间戳重复调用结果不变
+    CHECK(unwrapper.unwrap(0x00001000u) == 0x100001000ull);
+    uint64_t last = 0x100001000ull;
+    for (int i = 0; i < 3; ++i) {
+        // 连续跨越多次回绕
+        for (uint32_t step = 0; step < 4; ++step) {
+            const uint64_t next = unwrapper.unwrap(static_cast<uint32_t>(last + 0x40000000ull));
+            CHECK(next == last + 0x40000000ull);
+            last = next;
+        }
+    }
+    unwrapper.reset();
+    CHECK(unwrapper.unwrap(5) == 5);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_live_push_across_wrap(RtspServer& server) {
+    std::cout << "Testing pushed pts_us survives end to end across an RTP timestamp wrap..." << std::endl;
+    PathConfig config;
+    config.path = "/live/precise";
+    config.sps = {0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8};
+    config.pps = {0x68, 0xCE, 0x3C, 0x80};
+    CHECK(server.addPath(config));
+
+    // 90kHz 的 32 位时间戳约 47721.86 秒回绕一次：从回绕前 2 秒开始按 59.94fps 推
+    const uint64_t wrap_us = (1ULL << 32) * 1000000 / 90000;
+    const uint64_t base_us = wrap_us - 2000000;
+    const uint64_t first_n = base_us * 60000 / 1001000000 + 1;
+    std::atomic<bool> running{true};
+    std::thread pusher([&]() {
+        for (int i = 0; running; ++i) {
+            const auto data = makeFrame(i);
+            VideoFrame frame{};
+            frame.codec = CodecType::H264;
+            frame.type = i % kGop == 0 ? FrameType::IDR : FrameType::P;
+            frame.data = const_cast<uint8_t*>(data.data());
+            frame.size = data.size();
+            frame.pts_us = frameUs(first_n + static_cast<uint64_t>(i), 60000, 1001);
+            server.pushFrame(config.path, frame);
+            std::this_thread::sleep_for(std::chrono::milliseconds(3));
+        }
+    });
+
+    RtspClientConfig client_config;
+    client_config.prefer_tcp_transport = true;
+    RtspClient client;
+    client.setConfig(client_config);
+    CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + config.path));
+    CHECK(client.describe() && client.setup(0) && client.play(0));
+
+    uint64_t prev_us = 0;
+    bool wrapped = false;
+    for (int i = 0; i < 400 && !wrapped; ++i) {
+        VideoFrame frame{};
+        CHECK(client.receiveFrame(frame, 3000));
+        // 服务端按 32 位发送，客户端展开后回到推流的绝对值：与最近的推流帧时间相差不超过一个 90kHz 刻度
+        const uint64_t n = (frame.pts_us * 60000 + 500000000) / 1001000000;
+        const uint64_t pushed = frameUs(n, 60000, 1001);
+        CHECK(frame.pts_us + 12 >= pushed && frame.pts_us <= pushed + 12);
+        CHECK(frame.pts == frame.pts_us / 1000 && frame.dts_us == frame.pts_us);
+        if (prev_us != 0) {
+            CHECK(frame.pts_us > prev_us);
+            wrapped = frame.pts_us > wrap_us;
+        }
+        prev_us = frame.pts_us;
+    }
+    CHECK(wrapped);
+    CHECK(client.getStats().rtp_packet_loss_events == 0);
+
+    client.close();
+    running = false;
+    pusher.join();
+    CHECK(server.removePath(config.path));
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_rational_file_pacing(RtspServer& server) {
+    std::cout << "Testing Annex-B playback at 30000/1001 fps..." << std::endl;
+    const std::string file = "timestamps_test.h264";
+    std::remove((file + ".idx").c_str());
+    {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        for (int i = 0; i < 60; ++i) {
+            std::vector<uint8_t> frame;
+            if (i % kGop == 0) {
+                frame = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1E, 0x95, 0xA8,
+                         0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80};
+            }
+            const auto slice = makeFrame(i);
+            frame.insert(frame.end(), slice.begin(), slice.end());
+            out.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+        }
+    }
+
+    FilePathConfig config;
+    config.path = "/vod/ntsc";
+    config.file = file;
+    config.fps = 30000;
+    config.fps_den = 1001;
+    CHECK(server.addFilePath(config));
+
+    RtspClientConfig client_config;
+    client_config.prefer_tcp_transport = true;
+    RtspClient client;
+    client.setConfig(client_config);
+    CHECK(client.open("rtsp://127.0.0.1:" + std::to_string(kPort) + config.path));
+    CHECK(client.describe());
+    CHECK(client.getSessionInfo().duration_ms == (frameUs(59, 30000, 1001) + 1000000 / 30) / 1000);
+    CHECK(client.setup(0) && client.play(0));
+
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t first_us = 0;
+    for (int i = 0; i < 60; ++i) {
+        VideoFrame frame{};
+        CHECK(client.receiveFrame(frame, 3000));
+        if (i == 0) {
+            first_us = frame.pts_us;
+        }
+        // 每帧由序号直接推算：与精确值 i * 1001 / 30 毫秒的差在 1 微秒内
+        const uint64_t expected = frameUs(static_cast<uint64_t>(i), 30000, 1001);
+        const uint64_t got = frame.pts_us - first_us;
+        CHECK(got + 1 >= expected && got <= expected + 1);
+    }
+    // 59 个帧间隔按 1001/30 毫秒排程，约 1.97 秒
+    const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    CHECK(elapsed_ms >= 1800 && elapsed_ms < 4000);
+
+    client.close();
+    CHECK(server.removePath(config.path));
+
+    // 帧率变化时旁路索引重建
+    FilePathConfig integer_fps = config;
+    integer_fps.fps = 30;
+    integer_fps.fps_den = 1;
+    CHECK(server.addFilePath(integer_fps));
+    CHECK(server.removePath(integer_fps.path));
+    CHECK(std::remove((file + ".idx").c_str()) == 0);
+    CHECK(std::remove(file.c_str()) == 0);
+    std::cout << "  PASSED" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "=== Running Timestamp Precision Tests ===" << std::endl;
+    LogConfig log_config;
+    log_config.min_level = LogLevel::Error;
+    setLogConfig(log_config);
+
+    test_rational_rtp_timestamps();
+    test_unwrapper();
+
+    RtspServer server;
+    CHECK(server.init("127.0.0.1", kPort));
+    CHECK(server.start());
+    test_live_push_across_wrap(server);
+    test_rational_file_pacing(server);
+    server.stop();
+
+    std::cout << "\n=== All Timestamp Precision Tests Passed! ===" << std::endl;
+    return 0;
+}